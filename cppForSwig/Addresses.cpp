@@ -41,6 +41,15 @@ const BinaryData& AddressEntry_P2PKH::getHash() const
 {
    if (hash_.getSize() == 0)
    {
+      //bulk derivation hashes compressed keys as it goes
+      auto assetSingle = dynamic_pointer_cast<AssetEntry_Single>(getAsset());
+      if (isCompressed() && assetSingle != nullptr &&
+         assetSingle->getPubKey()->compressedHash160_.getSize() == 20)
+      {
+         hash_ = assetSingle->getPubKey()->compressedHash160_;
+         return hash_;
+      }
+
       auto& preimage = getPreimage();
       auto&& hash1 = BtcUtils::getHash160(preimage);
       auto&& hash2 = BtcUtils::getHash160(preimage);
@@ -212,6 +221,15 @@ const BinaryData& AddressEntry_P2WPKH::getHash() const
 {
    if (hash_.getSize() == 0)
    {
+      //bulk derivation hashes compressed keys as it goes
+      auto assetSingle = dynamic_pointer_cast<AssetEntry_Single>(getAsset());
+      if (assetSingle != nullptr &&
+         assetSingle->getPubKey()->compressedHash160_.getSize() == 20)
+      {
+         hash_ = assetSingle->getPubKey()->compressedHash160_;
+         return hash_;
+      }
+
       auto& preimage = getPreimage();
       auto&& hash1 = BtcUtils::getHash160(preimage);
       auto&& hash2 = BtcUtils::getHash160(preimage);
@@ -150,6 +150,10 @@ public:
    SecureBinaryData uncompressed_;
    SecureBinaryData compressed_;
 
+   //hash160 of the compressed key, set by bulk derivation before the asset
+   //is shared, empty otherwise. Not serialized.
+   BinaryData compressedHash160_;
+
 public:
    Asset_PublicKey(SecureBinaryData& pubkey) :
       Asset(AssetType_PublicKey)
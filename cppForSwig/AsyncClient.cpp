@@ -57,6 +57,16 @@ bool BlockDataViewer::connectToRemote(void)
    return sock_->connectToRemote();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void BlockDataViewer::enableLargeFrames()
+{
+   auto wsSock = dynamic_pointer_cast<WebSocketClient>(sock_);
+   if (wsSock == nullptr)
+      return;
+
+   wsSock->enableLargeFrames();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void BlockDataViewer::addPublicKey(const SecureBinaryData& pubkey)
 {
@@ -236,6 +246,19 @@ void BlockDataViewer::getLedgerDelegateForLockboxes(
    sock_->pushPayload(move(payload), read_payload);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void BlockDataViewer::setCacheBudget(size_t byteBudget)
+{
+   //resized in place, callback threads keep using the same cache
+   cache_->setBudget(byteBudget);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ClientCacheStats BlockDataViewer::getCacheStats() const
+{
+   return cache_->getStats();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 AsyncClient::Blockchain BlockDataViewer::blockchain(void)
 {
@@ -318,6 +341,7 @@ void BlockDataViewer::getTxByHash(
    }
 
    bool heightOnly = false;
+   shared_ptr<Tx> cachedTx;
    try
    {
       auto tx = cache_->getTx(bdRef);
@@ -326,6 +350,7 @@ void BlockDataViewer::getTxByHash(
          //Throw out of this scope if the tx is cached but lacks a valid height.
          //Flag to only fetch the height as well.
          heightOnly = true;
+         cachedTx = const_pointer_cast<Tx>(tx);
          throw NoMatch();
       }
 
@@ -360,7 +385,7 @@ void BlockDataViewer::getTxByHash(
 
    auto read_payload = make_shared<Socket_ReadPayload>();
    read_payload->callbackReturn_ =
-      make_unique<CallbackReturn_Tx>(cache_, txHash, callback);
+      make_unique<CallbackReturn_Tx>(cache_, txHash, callback, cachedTx);
    sock_->pushPayload(move(payload), read_payload);
 }
 
@@ -381,11 +406,12 @@ void BlockDataViewer::getTxBatchByHash(
       {
          auto tx = cache_->getTx(hash.getRef());
 
-         //flag to grab only the txheight if it's unset
+         //flag to grab only the txheight if it's unset, carry the tx along
+         //with the request as the cache may evict it in the meantime
          if(tx->getTxHeight() == UINT32_MAX)
             hashesToFetch.insert(make_pair(hash, true));
-         else
-            insertIter->second = tx;
+
+         insertIter->second = tx;
 
          continue;
       }
@@ -447,8 +473,8 @@ void BlockDataViewer::getRawHeaderForTxHash(const BinaryData& txHash,
 
    try
    {
-      auto& height = cache_->getHeightForTxHash(txHash);
-      auto& rawHeader = cache_->getRawHeader(height);
+      auto height = cache_->getHeightForTxHash(txHash);
+      auto rawHeader = cache_->getRawHeader(height);
       callback(rawHeader);
       return;
    }
@@ -472,7 +498,7 @@ void BlockDataViewer::getHeaderByHeight(unsigned height,
 {
    try
    {
-      auto& rawHeader = cache_->getRawHeader(height);
+      auto rawHeader = cache_->getRawHeader(height);
       callback(rawHeader);
       return;
    }
@@ -585,6 +611,34 @@ void BlockDataViewer::getHistoryForWalletSelection(
    sock_->pushPayload(move(payload), read_payload);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void BlockDataViewer::getHistoryForWalletSelection(
+   const vector<string>& wldIDs, const string& orderingStr,
+   uint32_t startTime, uint32_t endTime,
+   function<void(ReturnMessage<vector<::ClientClasses::LedgerEntry>>)> callback)
+{
+   auto payload = make_payload(Methods::getHistoryForWalletSelection);
+   auto command = dynamic_cast<BDVCommand*>(payload->message_.get());
+   if (orderingStr == "ascending")
+      command->set_flag(true);
+   else if (orderingStr == "descending")
+      command->set_flag(false);
+   else
+      throw runtime_error("invalid ordering string");
+
+   for (auto& id : wldIDs)
+      command->add_bindata(id);
+
+   //server resolves the window to a height range with the chain's 
+   //median time index
+   command->set_value(uint64_t(startTime) << 32 | endTime);
+
+   auto read_payload = make_shared<Socket_ReadPayload>();
+   read_payload->callbackReturn_ =
+      make_unique<CallbackReturn_VectorLedgerEntry>(callback);
+   sock_->pushPayload(move(payload), read_payload);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void BlockDataViewer::getSpentnessForOutputs(
    const map<BinaryData, set<unsigned>>& outputs,
@@ -703,6 +757,44 @@ void LedgerDelegate::getHistoryPage(uint32_t id,
    sock_->pushPayload(move(payload), read_payload);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+string LedgerDelegate::streamHistory(unsigned window)
+{
+   auto&& streamId = 
+      BtcUtils::fortuna_.generateRandom(HISTORY_STREAM_ID_LENGTH).toHexStr();
+
+   auto payload = BlockDataViewer::make_payload(Methods::streamHistory);
+   auto command = dynamic_cast<BDVCommand*>(payload->message_.get());
+   command->set_delegateid(delegateID_);
+   command->set_hash(streamId);
+   command->set_value(window);
+
+   sock_->pushPayload(move(payload), nullptr);
+   return streamId;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void LedgerDelegate::ackHistoryStream(const string& streamID, unsigned count)
+{
+   auto payload = BlockDataViewer::make_payload(Methods::ackHistoryStream);
+   auto command = dynamic_cast<BDVCommand*>(payload->message_.get());
+   command->set_hash(streamID);
+   command->set_value(count);
+
+   sock_->pushPayload(move(payload), nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void LedgerDelegate::cancelHistoryStream(const string& streamID)
+{
+   auto payload = BlockDataViewer::make_payload(Methods::ackHistoryStream);
+   auto command = dynamic_cast<BDVCommand*>(payload->message_.get());
+   command->set_hash(streamID);
+   command->set_flag(true);
+
+   sock_->pushPayload(move(payload), nullptr);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void LedgerDelegate::getPageCount(
    function<void(ReturnMessage<uint64_t>)> callback) const
@@ -1333,7 +1425,12 @@ void CallbackReturn_Tx::callback(
       }
       else
       {
-         auto cachedTx = cache_->getTx_NoConst(txHash_.getRef());
+         auto cachedTx = cachedTx_;
+         if (cachedTx == nullptr)
+            cachedTx = cache_->getTx_NoConst(txHash_.getRef());
+         else
+            cache_->insertTx(txHash_, cachedTx);
+
          cachedTx->setTxHeight(msg.height());
          cachedTx->setTxIndex(msg.txindex());
          tx = cachedTx;
@@ -1358,6 +1455,12 @@ void CallbackReturn_Tx::callback(
       ReturnMessage<TxResult> rm(e);
       userCallbackLambda_(move(rm));
    }
+   catch (NoMatch&)
+   {
+      ClientMessageError e("tx evicted from cache", -1);
+      ReturnMessage<TxResult> rm(e);
+      userCallbackLambda_(move(rm));
+   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1413,7 +1516,9 @@ void CallbackReturn_TxBatch::callback(
             }
             else
             {
-               auto txFromCache = cache_->getTx_NoConst(txHash);
+               auto txFromCache = const_pointer_cast<Tx>(cachedTx_[txHash]);
+               cache_->insertTx(txHash, txFromCache);
+
                txFromCache->setTxHeight(txObj.height());
                txFromCache->setTxIndex(txObj.txindex());
 
@@ -1425,7 +1530,10 @@ void CallbackReturn_TxBatch::callback(
          }
 
          if (tx == nullptr)
+         {
+            cachedTx_[txHash] = nullptr;
             continue;
+         }
 
          auto constTx = static_pointer_cast<const Tx>(tx);
          cachedTx_[txHash] = constTx;
@@ -2200,81 +2308,111 @@ void CallbackReturn_SpentnessData::callback(
 //
 // ClientCache
 //
+///////////////////////////////////////////////////////////////////////////////
+ClientCache::ClientCache(size_t byteBudget, unsigned shardCount) :
+   txMap_(byteBudget / 4 * 3, shardCount,
+      [](const BinaryData& hash, const shared_ptr<Tx>& tx)->size_t
+      {
+         //rough per entry overhead for the list & map nodes and Tx members
+         return hash.getSize() + (tx != nullptr ? tx->getSize() : 0) + 256;
+      }),
+   rawHeaderMap_(byteBudget / 8, shardCount,
+      [](const unsigned&, const BinaryData& header)->size_t
+      {
+         return header.getSize() + 96;
+      }),
+   txHashToHeightMap_(byteBudget / 8, shardCount,
+      [](const BinaryData& hash, const unsigned&)->size_t
+      {
+         return hash.getSize() + 96;
+      })
+{}
+
+///////////////////////////////////////////////////////////////////////////////
+void ClientCache::setBudget(size_t byteBudget)
+{
+   txMap_.setBudget(byteBudget / 4 * 3);
+   rawHeaderMap_.setBudget(byteBudget / 8);
+   txHashToHeightMap_.setBudget(byteBudget / 8);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void ClientCache::insertTx(std::shared_ptr<Tx> tx)
 {
-   ReentrantLock(this);
-   txMap_.emplace(tx->getThisHash(), tx);
+   txMap_.put(tx->getThisHash(), tx);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void ClientCache::insertTx(const BinaryData& hash, std::shared_ptr<Tx> tx)
 {
-   ReentrantLock(this);
-   txMap_.emplace(hash, tx);
+   txMap_.put(hash, tx);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void ClientCache::insertRawHeader(unsigned& height, BinaryDataRef header)
 {
-   ReentrantLock(this);
-   rawHeaderMap_.insert(make_pair(height, header));
+   rawHeaderMap_.put(height, header);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 void ClientCache::insertHeightForTxHash(BinaryData& hash, unsigned& height)
 {
-   ReentrantLock(this);
-   txHashToHeightMap_.insert(make_pair(hash, height));
+   txHashToHeightMap_.put(hash, height);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 shared_ptr<const Tx> ClientCache::getTx(const BinaryDataRef& hashRef) const
 {
-   ReentrantLock(this);
-
-   auto iter = txMap_.find(hashRef);
-   if (iter == txMap_.end())
+   shared_ptr<Tx> tx;
+   if (!txMap_.get(hashRef, tx))
       throw NoMatch();
 
-   auto constTx = const_pointer_cast<const Tx>(iter->second);
+   auto constTx = const_pointer_cast<const Tx>(tx);
    return constTx;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 shared_ptr<Tx> ClientCache::getTx_NoConst(const BinaryDataRef& hashRef)
 {
-   ReentrantLock(this);
-
-   auto iter = txMap_.find(hashRef);
-   if (iter == txMap_.end())
+   shared_ptr<Tx> tx;
+   if (!txMap_.get(hashRef, tx))
       throw NoMatch();
 
-   return iter->second;   
+   return tx;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-const BinaryData& ClientCache::getRawHeader(const unsigned& height) const
+BinaryData ClientCache::getRawHeader(const unsigned& height) const
 {
-   ReentrantLock(this);
-
-   auto iter = rawHeaderMap_.find(height);
-   if (iter == rawHeaderMap_.end())
+   BinaryData header;
+   if (!rawHeaderMap_.get(height, header))
       throw NoMatch();
 
-   return iter->second;
+   return header;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-const unsigned& ClientCache::getHeightForTxHash(const BinaryData& height) const
+unsigned ClientCache::getHeightForTxHash(const BinaryData& hash) const
 {
-   ReentrantLock(this);
-
-   auto iter = txHashToHeightMap_.find(height);
-   if (iter == txHashToHeightMap_.end())
+   unsigned height;
+   if (!txHashToHeightMap_.get(hash, height))
       throw NoMatch();
 
-   return iter->second;
+   return height;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ClientCacheStats ClientCache::getStats() const
+{
+   ClientCacheStats stats;
+   stats.txHits_ = txMap_.hits();
+   stats.txMisses_ = txMap_.misses();
+   stats.headerHits_ = rawHeaderMap_.hits() + txHashToHeightMap_.hits();
+   stats.headerMisses_ = rawHeaderMap_.misses() + txHashToHeightMap_.misses();
+   stats.byteSize_ = txMap_.byteSize() + rawHeaderMap_.byteSize() + 
+      txHashToHeightMap_.byteSize();
+
+   return stats;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -23,6 +23,10 @@ Handle codec and socketing for armory client
 #include "WebSocketClient.h"
 #include "ClientClasses.h"
 #include "SocketWritePayload.h"
+#include "ThreadSafeClasses.h"
+
+#define CLIENT_CACHE_DEFAULT_BUDGET (64 * 1024 * 1024)
+#define CLIENT_CACHE_SHARD_COUNT 16
 
 class WalletManager;
 class WalletContainer;
@@ -167,32 +171,67 @@ struct CombinedCounts
 namespace AsyncClient
 {
    ///////////////////////////////////////////////////////////////////////////////
-   class ClientCache : public Lockable
+   struct TxHashHasher
+   {
+      //tx hashes are uniformly distributed, the leading bytes will do
+      size_t operator()(const BinaryData& key) const
+      {
+         size_t result = 0;
+         memcpy(&result, key.getPtr(), 
+            std::min(key.getSize(), sizeof(size_t)));
+         return result;
+      }
+   };
+
+   ///////////////////////////////////////////////////////////////////////////////
+   struct ClientCacheStats
+   {
+      uint64_t txHits_ = 0;
+      uint64_t txMisses_ = 0;
+      uint64_t headerHits_ = 0;
+      uint64_t headerMisses_ = 0;
+      size_t byteSize_ = 0;
+   };
+
+   ///////////////////////////////////////////////////////////////////////////////
+   class ClientCache
    {
+      /***
+      Size bounded, lru evicted. The budget is split between txs (3/4) and 
+      the header & tx height entries (1/8 each). Each map is sharded with 
+      a lock per shard so callback threads don't serialize on the cache.
+      ***/
+
       friend struct CallbackReturn_Tx;
       friend struct CallbackReturn_TxBatch;
       
    private:
-      std::map<BinaryData, std::shared_ptr<Tx>> txMap_;
-      std::map<unsigned, BinaryData> rawHeaderMap_;
-      std::map<BinaryData, unsigned> txHashToHeightMap_;
+      ArmoryThreading::ShardedLruCache<
+         BinaryData, std::shared_ptr<Tx>, TxHashHasher> txMap_;
+      ArmoryThreading::ShardedLruCache<unsigned, BinaryData> rawHeaderMap_;
+      ArmoryThreading::ShardedLruCache<
+         BinaryData, unsigned, TxHashHasher> txHashToHeightMap_;
 
    private:
       std::shared_ptr<Tx> getTx_NoConst(const BinaryDataRef&);
       void insertTx(const BinaryData&, std::shared_ptr<Tx>);
 
    public:
+      ClientCache(size_t byteBudget = CLIENT_CACHE_DEFAULT_BUDGET, 
+         unsigned shardCount = CLIENT_CACHE_SHARD_COUNT);
+
+      //same split as the ctor, entries past the new budget are evicted
+      void setBudget(size_t byteBudget);
+
       void insertTx(std::shared_ptr<Tx>);
       void insertRawHeader(unsigned&, BinaryDataRef);
       void insertHeightForTxHash(BinaryData&, unsigned&);
 
       std::shared_ptr<const Tx> getTx(const BinaryDataRef&) const;
-      const BinaryData& getRawHeader(const unsigned&) const;
-      const unsigned& getHeightForTxHash(const BinaryData&) const;
+      BinaryData getRawHeader(const unsigned&) const;
+      unsigned getHeightForTxHash(const BinaryData&) const;
 
-      //virtuals
-      void initAfterLock(void) {}
-      void cleanUpBeforeUnlock(void) {}
+      ClientCacheStats getStats(void) const;
    };
 
    class NoMatch
@@ -225,6 +264,18 @@ namespace AsyncClient
          std::function<void(ReturnMessage<std::vector<::ClientClasses::LedgerEntry>>)>);
       void getPageCount(std::function<void(ReturnMessage<uint64_t>)>) const;
 
+      /***
+      Streams the delegate's mined history, one page per chunk. Page 
+      boundaries are fixed when the stream opens, zc and later blocks come 
+      through the regular notifications instead. Chunks come in as 
+      BDMAction_HistoryChunk notifications tagged with the returned stream 
+      id, the final one is flagged lastChunk_. The server stays at most 
+      window chunks ahead of the acks.
+      ***/
+      std::string streamHistory(unsigned window);
+      void ackHistoryStream(const std::string& streamID, unsigned count);
+      void cancelHistoryStream(const std::string& streamID);
+
       const std::string& getID(void) const { return delegateID_; }
    };
 
@@ -417,6 +468,7 @@ namespace AsyncClient
       void addPublicKey(const SecureBinaryData&);
 
       //connectivity
+      void enableLargeFrames(void);
       bool connectToRemote(void);
       std::shared_ptr<SocketPrototype> getSocketObject(void) const { return sock_; }
       void goOnline(void);
@@ -447,9 +499,17 @@ namespace AsyncClient
       void getHistoryForWalletSelection(
          const std::vector<std::string>&, const std::string& orderingStr,
          std::function<void(ReturnMessage<std::vector<::ClientClasses::LedgerEntry>>)>);
+      void getHistoryForWalletSelection(
+         const std::vector<std::string>&, const std::string& orderingStr,
+         uint32_t startTime, uint32_t endTime,
+         std::function<void(ReturnMessage<std::vector<::ClientClasses::LedgerEntry>>)>);
 
       void updateWalletsLedgerFilter(const std::vector<BinaryData>& wltIdVec);
 
+      //cache
+      void setCacheBudget(size_t);
+      ClientCacheStats getCacheStats(void) const;
+
       //header data
       Blockchain blockchain(void);
 
@@ -590,10 +650,16 @@ namespace AsyncClient
       BinaryData txHash_;
       TxCallback userCallbackLambda_;
 
+      //set when only the height was requested, the cache may evict the tx
+      //before the reply comes in
+      std::shared_ptr<Tx> cachedTx_;
+
    public:
       CallbackReturn_Tx(std::shared_ptr<ClientCache> cache,
-         const BinaryData& txHash, const TxCallback& lbd) :
-         cache_(cache), txHash_(txHash), userCallbackLambda_(lbd)
+         const BinaryData& txHash, const TxCallback& lbd,
+         std::shared_ptr<Tx> cachedTx = nullptr) :
+         cache_(cache), txHash_(txHash), userCallbackLambda_(lbd),
+         cachedTx_(cachedTx)
       {}
 
       //virtual
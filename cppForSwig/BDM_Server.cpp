@@ -169,6 +169,98 @@ BDVCommandProcessingResultType BDV_Server_Object::processCommand(
       break;
    }
 
+   case Methods::streamHistory:
+   {
+      /*
+         in: delegateID, stream id as hash, window as value
+         out: void, history pages are pushed as history_chunk notifications
+              tagged with the stream id, no more than window chunks ahead
+              of the client's acks. The window defaults to 4 and is capped
+              at HISTORY_STREAM_MAX_WINDOW
+      */
+
+      if (!command->has_delegateid() || command->delegateid().size() == 0 ||
+         !command->has_hash() || 
+         command->hash().size() != HISTORY_STREAM_ID_LENGTH * 2)
+         throw runtime_error("invalid command for streamHistory");
+
+      auto delegateIter = delegateMap_.find(command->delegateid());
+      if (delegateIter == delegateMap_.end())
+         throw runtime_error("unknown delegate for streamHistory");
+
+      auto& streamId = command->hash();
+      if (historyStreams_.find(streamId) != historyStreams_.end())
+         throw runtime_error("history stream id collision");
+
+      HistoryStream stream;
+      stream.delegateID_ = command->delegateid();
+      
+      //page boundaries are frozen for the life of the stream and capped at 
+      //the current top, zc and blocks that show up afterwards are the 
+      //client's to fetch through the regular notifications
+      auto& delegate = delegateIter->second;
+      auto topHeight = getTopBlockHeight();
+      auto pageCount = delegate.getPageCount();
+      for (uint32_t i = 0; i < pageCount; i++)
+      {
+         auto&& range = delegate.getPageRange(i);
+         if (range.first > topHeight)
+            continue;
+
+         range.second = min(range.second, topHeight);
+         stream.ranges_.push_back(range);
+      }
+
+      stream.window_ = 4;
+      if (command->has_value() && command->value() != 0)
+      {
+         stream.window_ = (unsigned)min<uint64_t>(
+            command->value(), HISTORY_STREAM_MAX_WINDOW);
+      }
+      stream.credit_ = stream.window_;
+
+      historyStreams_.insert(make_pair(streamId, stream));
+      pumpHistoryStream(streamId);
+      break;
+   }
+
+   case Methods::ackHistoryStream:
+   {
+      /*
+         in: stream id as hash, consumed chunk count as value, 
+             flag to cancel the stream
+         out: void
+      */
+
+      if (!command->has_hash())
+         throw runtime_error("invalid command for ackHistoryStream");
+
+      auto streamIter = historyStreams_.find(command->hash());
+      if (streamIter == historyStreams_.end())
+      {
+         //stream is done or was cancelled, late acks are harmless
+         break;
+      }
+
+      if (command->has_flag() && command->flag())
+      {
+         historyStreams_.erase(streamIter);
+         break;
+      }
+
+      //acks past the window are clamped, a client can't get more chunks
+      //in flight than it opened the stream with
+      if (command->has_value())
+      {
+         auto& stream = streamIter->second;
+         auto inFlight = stream.window_ - stream.credit_;
+         stream.credit_ += (unsigned)min<uint64_t>(command->value(), inFlight);
+      }
+
+      pumpHistoryStream(command->hash());
+      break;
+   }
+
    case Methods::registerWallet:
    {
       /*
@@ -689,16 +781,16 @@ BDVCommandProcessingResultType BDV_Server_Object::processCommand(
       if (command->bindata_size() == 0)
          throw runtime_error("invalid command for getTxBatchByHash");
 
-      vector<Tx> result;
+      vector<Tx> result(command->bindata_size());
+
+      //full txs are fetched as one batch
+      vector<BinaryDataRef> fullTxHashes;
+      vector<int> fullTxIds;
       for (int i = 0; i < command->bindata_size(); i++)
       {
-         Tx tx;
          auto& txHash = command->bindata(i);
          if (txHash.size() < 32)
-         {
-            result.emplace_back();
             continue;
-         }
 
          BinaryDataRef txHashRef;
          txHashRef.setRef((const uint8_t*)txHash.c_str(), 32);
@@ -709,10 +801,12 @@ BDVCommandProcessingResultType BDV_Server_Object::processCommand(
 
          if (!heightOnly)
          {
-            tx = move(this->getTxByHash(txHashRef));
+            fullTxHashes.push_back(txHashRef);
+            fullTxIds.push_back(i);
          }
          else
          {
+            auto& tx = result[i];
             auto&& txData = getTxMetaData(txHashRef, true);
             tx.setTxHeight(get<0>(txData));
             tx.setTxIndex(get<1>(txData));
@@ -721,10 +815,12 @@ BDVCommandProcessingResultType BDV_Server_Object::processCommand(
             for (auto& id : opIds)
                tx.pushBackOpId(id);
          }
-
-         result.emplace_back(move(tx));
       }
 
+      auto&& fullTxs = this->getTxBatchByHash(fullTxHashes);
+      for (unsigned i = 0; i < fullTxs.size(); i++)
+         result[fullTxIds[i]] = move(fullTxs[i]);
+
       auto response = make_shared<::Codec_CommonTypes::ManyTxWithMetaData>();
       for (auto& tx : result)
       {
@@ -960,6 +1056,8 @@ BDVCommandProcessingResultType BDV_Server_Object::processCommand(
       in:
          vector of wallet ids to get history for, as bindata
          flag, set to true to order history ascending
+         optional value, time window packed as (start << 32 | end) in
+            unix seconds, limits the history to the blocks mined within
       out:
          history for wallet list, as Codec_LedgerEntry::ManyLedgerEntry
       */
@@ -987,13 +1085,50 @@ BDVCommandProcessingResultType BDV_Server_Object::processCommand(
 
       auto&& wltGroup = this->getStandAloneWalletGroup(wltIDs, ordering);
 
+      //resolve the time window to a height range once, pages and 
+      //entries are then filtered by height
+      uint32_t bottom = 0;
+      uint32_t top = UINT32_MAX;
+      bool withZc = true;
+      if (command->has_value())
+      {
+         auto startTime = uint32_t(command->value() >> 32);
+         auto endTime = uint32_t(command->value() & 0xFFFFFFFF);
+
+         auto&& heightRange = 
+            blockchain().getHeightRangeForTimeWindow(startTime, endTime);
+         bottom = heightRange.first;
+         top = heightRange.second;
+
+         auto topHeight = blockchain().top()->getBlockHeight();
+         withZc = bottom <= top && top >= topHeight;
+      }
+
       auto response = make_shared<::Codec_LedgerEntry::ManyLedgerEntry>();
       for (unsigned y = 0; y < wltGroup.getPageCount(); y++)
       {
+         //the newest page carries the zc entries
+         auto newestPage = orderingFlag ? 
+            wltGroup.getPageCount() - 1 : 0;
+         if (!(withZc && y == newestPage) &&
+            !wltGroup.pageOverlapsHeightRange(y, bottom, top))
+            continue;
+
          auto&& histPage = wltGroup.getHistoryPage(y, false, false, UINT32_MAX);
 
          for (auto& le : histPage)
          {
+            auto height = le.getBlockNum();
+            if (height == UINT32_MAX)
+            {
+               if (!withZc)
+                  continue;
+            }
+            else if (height < bottom || height > top)
+            {
+               continue;
+            }
+
             auto lePtr = response->add_values();
             le.fillMessage(lePtr);
          }
@@ -1463,21 +1598,30 @@ BDVCommandProcessingResultType BDV_Server_Object::processCommand(
 
       map<BinaryDataRef, map<unsigned, SpentnessResult>> spenderMap;
       {
-         //grab all spentness data for these outputs
-         auto&& spentness_tx = db_->beginTransaction(SPENTNESS, LMDB::ReadOnly);
-
+         //resolve all tx hashes in one go
+         vector<BinaryDataRef> txHashes;
          for (int i = 0; i < command->bindata_size(); i++)
          {
             auto& rawOutputs = command->bindata(i);
             if (rawOutputs.size() < 33)
                throw runtime_error("malformed output data");
 
+            txHashes.push_back(BinaryDataRef(
+               (const uint8_t*)rawOutputs.c_str(), 32));
+         }
+         auto&& dbKeys = db_->getDBKeysForHashes(txHashes);
+
+         //grab all spentness data for these outputs
+         auto&& spentness_tx = db_->beginTransaction(SPENTNESS, LMDB::ReadOnly);
+
+         for (int i = 0; i < command->bindata_size(); i++)
+         {
+            auto& rawOutputs = command->bindata(i);
             BinaryRefReader brr((const uint8_t*)rawOutputs.c_str(), rawOutputs.size());
             auto txHashRef = brr.get_BinaryDataRef(32);
             auto& opMap = spenderMap[txHashRef];
 
-            //get dbkey for this txhash
-            auto&& dbkey = db_->getDBKeyForHash(txHashRef);
+            auto& dbkey = dbKeys[i];
 
             //convert id to block height and setup stxo
             StoredTxOut stxo;
@@ -2113,6 +2257,84 @@ void BDV_Server_Object::processNotification(
       cb_->callback(callbackPtr);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void BDV_Server_Object::pumpHistoryStream(const string& streamId)
+{
+   auto streamIter = historyStreams_.find(streamId);
+   if (streamIter == historyStreams_.end())
+      return;
+   auto& stream = streamIter->second;
+
+   try
+   {
+      auto delegateIter = delegateMap_.find(stream.delegateID_);
+      if (delegateIter == delegateMap_.end())
+         throw runtime_error("history stream delegate is gone");
+
+      while (stream.credit_ > 0)
+      {
+         auto message = make_shared<BDVCallback>();
+         auto notif = message->add_notification();
+         notif->set_type(NotificationType::history_chunk);
+         notif->set_requestid(streamId);
+         auto ledgers = notif->mutable_ledgers();
+
+         //empty history still gets its terminating chunk
+         if (stream.nextRange_ < stream.ranges_.size())
+         {
+            auto& range = stream.ranges_[stream.nextRange_++];
+
+            //the live pages may have been remapped since the stream opened,
+            //grab the ones overlapping the frozen range and trim them to it
+            auto& delegate = delegateIter->second;
+            auto pageCount = delegate.getPageCount();
+            for (uint32_t i = 0; i < pageCount; i++)
+            {
+               auto&& pageRange = delegate.getPageRange(i);
+               if (pageRange.first > range.second || 
+                  pageRange.second < range.first)
+                  continue;
+
+               auto&& page = delegate.getHistoryPage(i);
+               for (auto& le : page)
+               {
+                  if (le.getBlockNum() < range.first || 
+                     le.getBlockNum() > range.second)
+                     continue;
+
+                  le.fillMessage(ledgers->add_values());
+               }
+            }
+         }
+
+         auto done = stream.nextRange_ >= stream.ranges_.size();
+         notif->set_lastchunk(done);
+
+         --stream.credit_;
+         cb_->callback(message);
+
+         if (done)
+         {
+            historyStreams_.erase(streamIter);
+            return;
+         }
+      }
+   }
+   catch (exception& e)
+   {
+      auto message = make_shared<BDVCallback>();
+      auto notif = message->add_notification();
+      notif->set_type(NotificationType::error);
+      notif->set_requestid(streamId);
+      auto error = notif->mutable_error();
+      error->set_code(-1);
+      error->set_errstr(e.what());
+      cb_->callback(message);
+
+      historyStreams_.erase(streamIter);
+   }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void BDV_Server_Object::registerWallet(
    shared_ptr<::Codec_BDVCommand::BDVCommand> command)
@@ -3427,14 +3649,17 @@ void UnitTest_Callback::callback(shared_ptr<BDVCallback> command)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-shared_ptr<::Codec_BDVCommand::BDVCallback> UnitTest_Callback::getNotification()
+shared_ptr<::Codec_BDVCommand::BDVCallback> UnitTest_Callback::getNotification(
+   bool block)
 {
    try
    {
-      return notifQueue_.pop_front();
+      return notifQueue_.pop_front(block);
    }
    catch (StopBlockingLoop&)
    {}
+   catch (IsEmpty&)
+   {}
 
    return nullptr;
 }
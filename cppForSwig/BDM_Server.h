@@ -54,6 +54,8 @@ namespace DBTestUtils
 {
    std::tuple<std::shared_ptr<::Codec_BDVCommand::BDVCallback>, unsigned> waitOnSignal(
       Clients*, const std::string&, ::Codec_BDVCommand::NotificationType);
+   std::vector<std::shared_ptr<::Codec_BDVCommand::BDVCallback>> 
+      getPendingNotifications(Clients*, const std::string&);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -130,7 +132,8 @@ public:
    bool isValid(void) { return true; }
    void shutdown(void) {}
 
-   std::shared_ptr<::Codec_BDVCommand::BDVCallback> getNotification(void);
+   std::shared_ptr<::Codec_BDVCommand::BDVCallback> getNotification(
+      bool block = true);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -140,6 +143,8 @@ class BDV_Server_Object : public BlockDataViewer
    friend std::tuple<std::shared_ptr<::Codec_BDVCommand::BDVCallback>, unsigned>
       DBTestUtils::waitOnSignal(
       Clients*, const std::string&, ::Codec_BDVCommand::NotificationType);
+   friend std::vector<std::shared_ptr<::Codec_BDVCommand::BDVCallback>>
+      DBTestUtils::getPendingNotifications(Clients*, const std::string&);
 
 private: 
    std::atomic<unsigned> started_;
@@ -151,6 +156,23 @@ private:
 
    std::map<std::string, LedgerDelegate> delegateMap_;
 
+   struct HistoryStream
+   {
+      std::string delegateID_;
+
+      //page height ranges as of the stream opening, one per chunk
+      std::vector<std::pair<uint32_t, uint32_t>> ranges_;
+      size_t nextRange_ = 0;
+
+      //chunks the client has room for, replenished by acks and never 
+      //more than the window it asked for when opening the stream
+      unsigned credit_ = 0;
+      unsigned window_ = 0;
+   };
+
+   //keyed by stream id, only touched from processPayload
+   std::map<std::string, HistoryStream> historyStreams_;
+
    struct walletRegStruct
    {
       std::shared_ptr<::Codec_BDVCommand::BDVCommand> command_;
@@ -182,6 +204,7 @@ private:
    void registerLockbox(std::shared_ptr<::Codec_BDVCommand::BDVCommand>);
    void populateWallets(std::map<std::string, walletRegStruct>&);
    void setup(void);
+   void pumpHistoryStream(const std::string&);
 
    void flagRefresh(
       BDV_refresh refresh, const BinaryData& refreshId,
@@ -211,7 +234,8 @@ class Clients
    friend class ZeroConfCallbacks_BDV;
 
 private:
-   ArmoryThreading::TransactionalMap<std::string, std::shared_ptr<BDV_Server_Object>> BDVs_;
+   ArmoryThreading::TransactionalPersistentMap<
+      std::string, std::shared_ptr<BDV_Server_Object>> BDVs_;
    mutable ArmoryThreading::BlockingQueue<bool> gcCommands_;
    BlockDataManagerThread* bdmT_ = nullptr;
 
@@ -8,6 +8,8 @@
 
 #include "BIP32_Node.h"
 #include "NetworkConfig.h"
+#include "btc/ecc.h"
+#include "btc/sha2.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 void BIP32_Node::init()
@@ -207,6 +209,36 @@ void BIP32_Node::derivePublic(unsigned id)
    setupFromNode(&node);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+SecureBinaryData BIP32_Node::derivePublicChildKey(unsigned id) const
+{
+   if (id & 0x80000000)
+      throw std::runtime_error("cannot hard derive from public key");
+
+   if (pubkey_.getSize() != BTC_ECKEY_COMPRESSED_LENGTH ||
+      chaincode_.getSize() != BTC_BIP32_CHAINCODE_SIZE)
+      throw std::runtime_error("uninitialized bip32 node");
+
+   //I = hmac512(chaincode, pubkey | id)
+   uint8_t data[BTC_ECKEY_COMPRESSED_LENGTH + 4];
+   memcpy(data, pubkey_.getPtr(), BTC_ECKEY_COMPRESSED_LENGTH);
+   data[BTC_ECKEY_COMPRESSED_LENGTH] = (uint8_t)(id >> 24);
+   data[BTC_ECKEY_COMPRESSED_LENGTH + 1] = (uint8_t)(id >> 16);
+   data[BTC_ECKEY_COMPRESSED_LENGTH + 2] = (uint8_t)(id >> 8);
+   data[BTC_ECKEY_COMPRESSED_LENGTH + 3] = (uint8_t)id;
+
+   SecureBinaryData hmac(64);
+   hmac_sha512(chaincode_.getPtr(), BTC_BIP32_CHAINCODE_SIZE,
+      data, sizeof(data), hmac.getPtr());
+
+   //child = point(I_L) + parent
+   SecureBinaryData childKey(pubkey_);
+   if (!btc_ecc_public_key_tweak_add(childKey.getPtr(), hmac.getPtr()))
+      throw std::runtime_error("failed to derive bip32 public key");
+
+   return childKey;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 BIP32_Node BIP32_Node::getPublicCopy() const
 {
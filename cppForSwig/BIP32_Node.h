@@ -67,6 +67,10 @@ public:
    void derivePrivate(unsigned);
    void derivePublic(unsigned);
 
+   //soft child pubkey of this node, leaves the node as is. Same result as
+   //derivePublic without the per call node setup and parent fingerprint
+   SecureBinaryData derivePublicChildKey(unsigned) const;
+
    //static
    static btc_hdnode getHDNodeFromPrivateKey(
       uint8_t depth, unsigned leaf_id, unsigned fingerprint,
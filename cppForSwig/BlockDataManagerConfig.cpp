@@ -334,6 +334,10 @@ void BlockDataManagerConfig::parseArgs(int argc, char* argv[])
    --zcthread-count: defines the maximum number on threads the zc parser can
    create for processing incoming transcations from the network node
 
+   --sigcheck-thread-count: defines how many threads can check the inputs of
+   a single large transaction (chain checks, signed tx evaluation). Defaults
+   to maximum available CPU threads. 1 checks inputs serially
+
    --db-type: sets the db type:
    DB_BARE: tracks wallet history only. Smallest DB.
    DB_FULL: tracks wallet history and resolves all relevant tx hashes.
@@ -714,6 +718,22 @@ void BlockDataManagerConfig::processArgs(const map<string, string>& args,
          zcThreadCount_ = val;
    }
 
+   iter = args.find("sigcheck-thread-count");
+   if (iter != args.end())
+   {
+      int val = 0;
+      try
+      {
+         val = stoi(iter->second);
+      }
+      catch (...)
+      {
+      }
+
+      if (val > 0)
+         sigCheckThreadCount_ = val;
+   }
+
    //cookie
    iter = args.find("cookie");
    if (iter != args.end())
@@ -31,6 +31,8 @@
 size_t MAX_THREADS();
 #define BROADCAST_ID_LENGTH 6
 #define REGISTER_ID_LENGH 5
+#define HISTORY_STREAM_ID_LENGTH 8
+#define HISTORY_STREAM_MAX_WINDOW 64
 
 class BitcoinP2P;
 class BitcoinNodeInterface;
@@ -78,6 +80,7 @@ public:
    unsigned ramUsage_ = 4;
    unsigned threadCount_ = MAX_THREADS();
    unsigned zcThreadCount_ = DEFAULT_ZCTHREAD_COUNT;
+   unsigned sigCheckThreadCount_ = MAX_THREADS();
 
    std::exception_ptr exceptionPtr_ = nullptr;
 
@@ -8,13 +8,17 @@
 
 #include "BlockDataMap.h"
 #include "BtcUtils.h"
+#include "DBUtils.h"
 
+#include <sys/stat.h>
 #ifndef _WIN32
 #include <sys/mman.h>
 #endif
 
 using namespace std;
 
+atomic<bool> BlockData::scannerArena_ = { true };
+
 ////////////////////////////////////////////////////////////////////////////////
 void BlockData::deserialize(const uint8_t* data, size_t size,
    const shared_ptr<BlockHeader> blockHeader,
@@ -47,11 +51,15 @@ void BlockData::deserialize(const uint8_t* data, size_t size,
          "tx count mismatch in deser header");
    }
 
+   if (useArena_)
+      arena_ = std::make_shared<BlockDataArena>(size);
+
+   txns_.reserve(numTx);
    for (unsigned i = 0; i < numTx; i++)
    {
       //light tx deserialization, just figure out the offset and size of
       //txins and txouts
-      auto tx = BCTX::parse(brr);
+      auto tx = BCTX::parse(brr, UINT32_MAX, arena_);
       brr.advance(tx->size_);
 
       //move it to BlockData object vector
@@ -185,8 +193,126 @@ shared_ptr<BlockDataFileMap> BlockDataLoader::get(const string& filename)
 /////////////////////////////////////////////////////////////////////////////
 shared_ptr<BlockDataFileMap> BlockDataLoader::get(uint32_t fileid)
 {
-   //don't have this fileid yet, create it
-   return getNewBlockDataMap(fileid);
+   {
+      unique_lock<mutex> lock(mu_);
+      if (mappedCap_ != 0)
+      {
+         auto iter = findMap(fileid);
+         if (iter != maps_.end())
+            return iter->second;
+      }
+   }
+
+   //don't have this fileid yet, map it outside of the lock
+   auto fileMap = getNewBlockDataMap(fileid);
+
+   vector<shared_ptr<BlockDataFileMap>> evicted;
+   {
+      unique_lock<mutex> lock(mu_);
+      ++stats_.mapCount_;
+
+      //no lru, hand out the fresh map
+      if (mappedCap_ == 0)
+         return fileMap;
+
+      //another thread may have mapped this file in the meantime
+      auto iter = findMap(fileid);
+      if (iter != maps_.end())
+         return iter->second;
+
+      maps_.push_back(make_pair(fileid, fileMap));
+      mappedSize_ += fileMap->size();
+      if (mappedSize_ > stats_.peakMappedSize_)
+         stats_.peakMappedSize_ = mappedSize_;
+
+      //evict the oldest maps past the cap, always keep the one we return
+      while (mappedSize_ > mappedCap_ && maps_.size() > 1)
+      {
+         auto& front = maps_.front();
+         mappedSize_ -= front.second->size();
+         ++stats_.releaseCount_;
+         evicted.push_back(move(front.second));
+         maps_.pop_front();
+      }
+   }
+
+   for (auto& evictedMap : evicted)
+      evictedMap->release();
+
+   return fileMap;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+list<pair<uint32_t, shared_ptr<BlockDataFileMap>>>::iterator 
+   BlockDataLoader::findMap(uint32_t fileid)
+{
+   for (auto iter = maps_.begin(); iter != maps_.end(); ++iter)
+   {
+      if (iter->first != fileid)
+         continue;
+
+      //most recently used goes to the back
+      maps_.splice(maps_.end(), maps_, iter);
+      return iter;
+   }
+
+   return maps_.end();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void BlockDataLoader::setMappedCap(size_t cap)
+{
+   unique_lock<mutex> lock(mu_);
+   mappedCap_ = cap;
+
+   if (cap == 0)
+   {
+      maps_.clear();
+      mappedSize_ = 0;
+   }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void BlockDataLoader::readAhead(const set<uint32_t>& fileids)
+{
+   for (auto& fileid : fileids)
+   {
+      auto fileMap = get(fileid);
+      fileMap->readAhead();
+
+      unique_lock<mutex> lock(mu_);
+      ++stats_.readAheadCount_;
+   }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void BlockDataLoader::release(uint32_t fileid)
+{
+   shared_ptr<BlockDataFileMap> fileMap;
+   {
+      unique_lock<mutex> lock(mu_);
+      for (auto iter = maps_.begin(); iter != maps_.end(); ++iter)
+      {
+         if (iter->first != fileid)
+            continue;
+
+         fileMap = move(iter->second);
+         mappedSize_ -= fileMap->size();
+         ++stats_.releaseCount_;
+         maps_.erase(iter);
+         break;
+      }
+   }
+
+   if (fileMap != nullptr)
+      fileMap->release();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+BlockDataLoaderStats BlockDataLoader::getStats() const
+{
+   unique_lock<mutex> lock(mu_);
+   return stats_;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -254,3 +380,130 @@ BlockDataFileMap::~BlockDataFileMap()
       fileMap_ = nullptr;
    }
 }
+
+/////////////////////////////////////////////////////////////////////////////
+void BlockDataFileMap::readAhead() const
+{
+   if (fileMap_ == nullptr || size_ == 0)
+      return;
+
+#ifndef _WIN32
+   madvise(fileMap_, size_, MADV_SEQUENTIAL);
+   madvise(fileMap_, size_, MADV_WILLNEED);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void BlockDataFileMap::release() const
+{
+   if (fileMap_ == nullptr || size_ == 0)
+      return;
+
+   //the maps are read only and file backed, dropping the pages loses 
+   //nothing, later reads fault them back in from the file
+#ifndef _WIN32
+   madvise(fileMap_, size_, MADV_DONTNEED);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+////
+//// BlockDataCache
+////
+/////////////////////////////////////////////////////////////////////////////
+BlockDataCache& BlockDataCache::instance()
+{
+   static BlockDataCache theCache;
+   return theCache;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+shared_ptr<BlockDataFileMap> BlockDataCache::getFileMap(const string& path)
+{
+   struct stat status;
+   try
+   {
+      status = DBUtils::getPathStat(path);
+   }
+   catch (exception&)
+   {
+      //missing file, let the map carry the failure like an uncached one
+      fileMaps_.erase(path);
+      return make_shared<BlockDataFileMap>(path);
+   }
+
+   shared_ptr<FileMapEntry> entry;
+   if (fileMaps_.get(path, entry) &&
+      entry->inode_ == (uint64_t)status.st_ino &&
+      entry->size_ == (uint64_t)status.st_size &&
+      entry->mtime_ == status.st_mtime)
+   {
+      return entry->map_;
+   }
+
+   entry = make_shared<FileMapEntry>();
+   entry->map_ = make_shared<BlockDataFileMap>(path);
+   entry->inode_ = status.st_ino;
+   entry->size_ = status.st_size;
+   entry->mtime_ = status.st_mtime;
+
+   if (entry->map_->getPtr() != nullptr)
+      fileMaps_.put(path, entry);
+   else
+      fileMaps_.erase(path);
+
+   return entry->map_;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void BlockDataCache::evictFileMap(const string& path)
+{
+   fileMaps_.erase(path);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+shared_ptr<const TxOffsetTable> BlockDataCache::getTxOffsets(
+   const BinaryData& blockHash, const uint8_t* data, size_t size)
+{
+   shared_ptr<const TxOffsetTable> offsets;
+   if (txOffsets_.get(blockHash, offsets))
+      return offsets;
+
+   offsets = make_shared<TxOffsetTable>(computeTxOffsets(data, size));
+   txOffsets_.put(blockHash, offsets);
+   return offsets;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+TxOffsetTable BlockDataCache::computeTxOffsets(
+   const uint8_t* data, size_t size)
+{
+   if (size < HEADER_SIZE)
+      throw BlockDeserializingException(
+      "raw data is smaller than HEADER_SIZE");
+
+   BinaryRefReader brr(data, size);
+   brr.advance(HEADER_SIZE);
+   auto numTx = (size_t)brr.get_var_int();
+
+   TxOffsetTable offsets;
+   offsets.reserve(min(numTx, brr.getSizeRemaining()));
+   for (size_t i = 0; i < numTx; i++)
+   {
+      auto offset = brr.getPosition();
+      auto txLen = BtcUtils::TxCalcLength(
+         brr.getCurrPtr(), brr.getSizeRemaining(), nullptr, nullptr, nullptr);
+      brr.advance(txLen);
+
+      offsets.push_back(make_pair((uint32_t)offset, (uint32_t)txLen));
+   }
+
+   return offsets;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void BlockDataCache::clear()
+{
+   fileMaps_.clear();
+   txOffsets_.clear();
+}
@@ -24,12 +24,213 @@
 #include <iomanip>
 
 #include <map>
+#include <set>
+#include <list>
+#include <algorithm>
 
 #include "BlockObj.h"
 #include "BinaryData.h"
+#include "ThreadSafeClasses.h"
 
 #define OffsetAndSize std::pair<size_t, size_t>
 
+//smallest slab a block arena will allocate
+#define BLOCKDATA_ARENA_MIN_CHUNK 4096
+
+//random access caches, file maps are ~128MB of address space each, tx 
+//offset tables 8 bytes per tx
+#define BLOCKDATA_FILEMAP_CACHE_SIZE 8
+#define BLOCKDATA_TXOFFSETS_CACHE_SIZE 1024
+
+////////////////////////////////////////////////////////////////////////////////
+class BlockDataArena
+{
+   /***
+   Bump allocator for the parsed representation of a block (BCTX objects and
+   their offset tables). Nothing is freed individually, all slabs are 
+   released together when the arena is destroyed.
+
+   Not thread safe, use one arena per block.
+   ***/
+
+private:
+   std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+   const size_t chunkSize_;
+
+   uint8_t* current_ = nullptr;
+   size_t remaining_ = 0;
+
+   size_t allocationCount_ = 0;
+   size_t bytesUsed_ = 0;
+
+private:
+   BlockDataArena(const BlockDataArena&) = delete;
+   BlockDataArena& operator=(const BlockDataArena&) = delete;
+
+public:
+   BlockDataArena(size_t chunkSize) :
+      chunkSize_(std::max(chunkSize, (size_t)BLOCKDATA_ARENA_MIN_CHUNK))
+   {}
+
+   void* allocate(size_t size, size_t alignment)
+   {
+      auto padding = (alignment - ((size_t)current_ % alignment)) % alignment;
+      if (current_ == nullptr || padding + size > remaining_)
+      {
+         auto chunkSize = std::max(chunkSize_, size + alignment);
+         chunks_.push_back(std::unique_ptr<uint8_t[]>(new uint8_t[chunkSize]));
+         current_ = chunks_.back().get();
+         remaining_ = chunkSize;
+         padding = (alignment - ((size_t)current_ % alignment)) % alignment;
+      }
+
+      auto ptr = current_ + padding;
+      current_ += padding + size;
+      remaining_ -= padding + size;
+
+      ++allocationCount_;
+      bytesUsed_ += size;
+      return ptr;
+   }
+
+   size_t allocationCount(void) const { return allocationCount_; }
+   size_t chunkCount(void) const { return chunks_.size(); }
+   size_t bytesUsed(void) const { return bytesUsed_; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+template<typename T> struct BlockDataArenaAllocator
+{
+   /***
+   STL allocator over a BlockDataArena. Holds a reference to the arena so
+   that objects allocated from it (i.e. a shared_ptr<BCTX> escaping its 
+   BlockData) keep it alive.
+   ***/
+
+   typedef T value_type;
+
+   std::shared_ptr<BlockDataArena> arena_;
+
+   BlockDataArenaAllocator(std::shared_ptr<BlockDataArena> arena) :
+      arena_(arena)
+   {}
+
+   template<typename U> BlockDataArenaAllocator(
+      const BlockDataArenaAllocator<U>& rhs) :
+      arena_(rhs.arena_)
+   {}
+
+   T* allocate(size_t count)
+   {
+      return (T*)arena_->allocate(count * sizeof(T), alignof(T));
+   }
+
+   void deallocate(T*, size_t)
+   {}
+
+   template<typename U> 
+   bool operator==(const BlockDataArenaAllocator<U>& rhs) const
+   {
+      return arena_ == rhs.arena_;
+   }
+
+   template<typename U> 
+   bool operator!=(const BlockDataArenaAllocator<U>& rhs) const
+   {
+      return arena_ != rhs.arena_;
+   }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+class OffsetTable
+{
+   /***
+   Fixed size array of OffsetAndSize, either owned or carved out of a block
+   arena. Copies always own their data, so they are safe to use past the
+   lifetime of the arena.
+   ***/
+
+private:
+   OffsetAndSize* ptr_ = nullptr;
+   size_t size_ = 0;
+   std::vector<OffsetAndSize> owned_;
+
+private:
+   void copyFrom(const OffsetTable& rhs)
+   {
+      owned_.assign(rhs.begin(), rhs.end());
+      ptr_ = owned_.size() > 0 ? &owned_[0] : nullptr;
+      size_ = owned_.size();
+   }
+
+public:
+   OffsetTable(void)
+   {}
+
+   OffsetTable(const OffsetTable& rhs)
+   {
+      copyFrom(rhs);
+   }
+
+   OffsetTable(OffsetTable&& rhs) :
+      ptr_(rhs.ptr_), size_(rhs.size_), owned_(std::move(rhs.owned_))
+   {
+      rhs.ptr_ = nullptr;
+      rhs.size_ = 0;
+   }
+
+   OffsetTable& operator=(const OffsetTable& rhs)
+   {
+      if (this != &rhs)
+         copyFrom(rhs);
+      return *this;
+   }
+
+   OffsetTable& operator=(OffsetTable&& rhs)
+   {
+      if (this != &rhs)
+      {
+         owned_ = std::move(rhs.owned_);
+         ptr_ = rhs.ptr_;
+         size_ = rhs.size_;
+
+         rhs.ptr_ = nullptr;
+         rhs.size_ = 0;
+      }
+      return *this;
+   }
+
+   void resize(size_t count, BlockDataArena* arena)
+   {
+      if (arena != nullptr)
+      {
+         owned_.clear();
+         ptr_ = count > 0 ? (OffsetAndSize*)arena->allocate(
+            count * sizeof(OffsetAndSize), alignof(OffsetAndSize)) : nullptr;
+      }
+      else
+      {
+         owned_.resize(count);
+         ptr_ = count > 0 ? &owned_[0] : nullptr;
+      }
+
+      size_ = count;
+   }
+
+   size_t size(void) const { return size_; }
+   bool empty(void) const { return size_ == 0; }
+
+   OffsetAndSize& operator[](size_t i) { return ptr_[i]; }
+   const OffsetAndSize& operator[](size_t i) const { return ptr_[i]; }
+
+   const OffsetAndSize& back(void) const { return ptr_[size_ - 1]; }
+
+   const OffsetAndSize* begin(void) const { return ptr_; }
+   const OffsetAndSize* end(void) const { return ptr_ + size_; }
+   const OffsetAndSize* cbegin(void) const { return ptr_; }
+   const OffsetAndSize* cend(void) const { return ptr_ + size_; }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 struct BCTX
 {
@@ -45,9 +246,9 @@ public:
 
    bool usesWitness_ = false;
 
-   std::vector<OffsetAndSize> txins_;
-   std::vector<OffsetAndSize> txouts_;
-   std::vector<OffsetAndSize> witnesses_;
+   OffsetTable txins_;
+   OffsetTable txouts_;
+   OffsetTable witnesses_;
 
    bool isCoinbase_ = false;
 
@@ -119,53 +320,92 @@ public:
    }
 
    static std::shared_ptr<BCTX> parse(
-      BinaryRefReader brr, unsigned id = UINT32_MAX)
+      BinaryRefReader brr, unsigned id = UINT32_MAX,
+      std::shared_ptr<BlockDataArena> arena = nullptr)
    {
-      return parse(brr.getCurrPtr(), brr.getSizeRemaining(), id);
+      return parse(brr.getCurrPtr(), brr.getSizeRemaining(), id, arena);
    }
 
    static std::shared_ptr<BCTX> parse(
-      const uint8_t* data, size_t len, unsigned id=UINT32_MAX)
+      const uint8_t* data, size_t len, unsigned id=UINT32_MAX,
+      std::shared_ptr<BlockDataArena> arena = nullptr)
    {
-      std::vector<size_t> offsetIns, offsetOuts, offsetsWitness;
-      auto txlen = BtcUtils::TxCalcLength(
-         data, len,
-         &offsetIns, &offsetOuts, &offsetsWitness);
-
-      auto txPtr = std::make_shared<BCTX>(data, txlen);
-
-      //create BCTX object and fill it up
-      txPtr->version_ = READ_UINT32_LE(data);
+      //single pass over the tx, offset tables are sized from the varints
+      //and filled in place
+      auto arenaPtr = arena.get();
+      BinaryRefReader brr(data, len);
+      if (brr.getSizeRemaining() < 6)
+         throw BlockDeserializingException();
+      brr.advance(4);
 
       // Check the marker and flag for witness transaction
-      auto brrPtr = data + 4;
-      auto marker = (const uint16_t*)brrPtr;
+      bool usesWitness = false;
+      auto marker = (const uint16_t*)brr.getCurrPtr();
       if (*marker == 0x0100)
-         txPtr->usesWitness_ = true;
-
-      //convert offsets to offset + size pairs
-      for (unsigned int y = 0; y < offsetIns.size() - 1; y++)
-         txPtr->txins_.push_back(
-            std::make_pair(
-         offsetIns[y],
-         offsetIns[y + 1] - offsetIns[y]));
-
-      for (unsigned int y = 0; y < offsetOuts.size() - 1; y++)
-         txPtr->txouts_.push_back(
-            std::make_pair(
-         offsetOuts[y],
-         offsetOuts[y + 1] - offsetOuts[y]));
-
-      if (txPtr->usesWitness_)
       {
-         for (unsigned int y = 0; y < offsetsWitness.size() - 1; y++)
-            txPtr->witnesses_.push_back(
-               std::make_pair(
-            offsetsWitness[y],
-            offsetsWitness[y + 1] - offsetsWitness[y]));
+         usesWitness = true;
+         brr.advance(2);
+      }
+
+      OffsetTable txins, txouts, witnesses;
+
+      auto nIn = (size_t)brr.get_var_int();
+      txins.resize(nIn, arenaPtr);
+      for (size_t y = 0; y < nIn; y++)
+      {
+         auto offset = brr.getPosition();
+         auto txinLen = BtcUtils::TxInCalcLength(
+            brr.getCurrPtr(), brr.getSizeRemaining());
+         brr.advance(txinLen);
+         txins[y] = std::make_pair(offset, txinLen);
+      }
+
+      auto nOut = (size_t)brr.get_var_int();
+      txouts.resize(nOut, arenaPtr);
+      for (size_t y = 0; y < nOut; y++)
+      {
+         auto offset = brr.getPosition();
+         auto txoutLen = BtcUtils::TxOutCalcLength(
+            brr.getCurrPtr(), brr.getSizeRemaining());
+         brr.advance(txoutLen);
+         txouts[y] = std::make_pair(offset, txoutLen);
+      }
+
+      if (usesWitness)
+      {
+         witnesses.resize(nIn, arenaPtr);
+         for (size_t y = 0; y < nIn; y++)
+         {
+            auto offset = brr.getPosition();
+            auto witnessLen = BtcUtils::TxWitnessCalcLength(
+               brr.getCurrPtr(), brr.getSizeRemaining());
+            brr.advance(witnessLen);
+            witnesses[y] = std::make_pair(offset, witnessLen);
+         }
+      }
+
+      auto lockTimeOffset = brr.getPosition();
+      brr.advance(4);
+      auto txlen = brr.getPosition();
+
+      //create BCTX object and fill it up
+      std::shared_ptr<BCTX> txPtr;
+      if (arena != nullptr)
+      {
+         txPtr = std::allocate_shared<BCTX>(
+            BlockDataArenaAllocator<BCTX>(arena), data, txlen);
+      }
+      else
+      {
+         txPtr = std::make_shared<BCTX>(data, txlen);
       }
 
-      txPtr->lockTime_ = READ_UINT32_LE(data + offsetsWitness.back());
+      txPtr->version_ = READ_UINT32_LE(data);
+      txPtr->usesWitness_ = usesWitness;
+      txPtr->txins_ = std::move(txins);
+      txPtr->txouts_ = std::move(txouts);
+      txPtr->witnesses_ = std::move(witnesses);
+      txPtr->lockTime_ = READ_UINT32_LE(data + lockTimeOffset);
 
       if (id != UINT32_MAX)
       {
@@ -201,6 +441,14 @@ private:
 
    uint32_t uniqueID_ = UINT32_MAX;
 
+   //parse txns into a per block arena rather than the heap
+   bool useArena_ = false;
+   std::shared_ptr<BlockDataArena> arena_;
+
+   //whether the scanners parse into arenas, on unless turned off for 
+   //heap vs arena comparisons
+   static std::atomic<bool> scannerArena_;
+
 public:
    BlockData(void) {}
 
@@ -243,6 +491,11 @@ public:
    const TxFilter<TxFilterType>& getTxFilter(void) const { return txFilter_; }
    uint32_t uniqueID(void) const { return uniqueID_; }
    std::shared_ptr<BlockHeader> getHeaderPtr(void) const { return headerPtr_; }
+
+   void useArena(bool flag) { useArena_ = flag; }
+   static void setScannerArena(bool flag) { scannerArena_.store(flag); }
+   static bool scannerArena(void) { return scannerArena_.load(); }
+   std::shared_ptr<BlockDataArena> getArena(void) const { return arena_; }
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -316,15 +569,44 @@ public:
    }
 
    size_t size(void) const { return size_; }
+
+   //hint the kernel to page the file in ahead of the parser
+   void readAhead(void) const;
+
+   //drop resident pages, the map stays valid and faults back in on access
+   void release(void) const;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+struct BlockDataLoaderStats
+{
+   unsigned mapCount_ = 0;
+   unsigned readAheadCount_ = 0;
+   unsigned releaseCount_ = 0;
+   size_t peakMappedSize_ = 0;
 };
 
 /////////////////////////////////////////////////////////////////////////////
 class BlockDataLoader
 {
+   /***
+   Maps blk files on demand. Once a mapped cap is set, the loader keeps
+   the maps it hands out in an lru. Whenever the total size of the maps in
+   the lru exceeds the cap, it evicts the oldest ones and drops their 
+   pages. Scanners use this to read the next batch's files ahead while 
+   bounding how much of the chain sits in RAM at once.
+   ***/
+
 private:     
    const std::string path_;
    const std::string prefix_;
 
+   mutable std::mutex mu_;
+   std::list<std::pair<uint32_t, std::shared_ptr<BlockDataFileMap>>> maps_;
+   size_t mappedSize_ = 0;
+   size_t mappedCap_ = 0;
+   BlockDataLoaderStats stats_;
+
 private:   
 
    BlockDataLoader(const BlockDataLoader&) = delete; //no copies
@@ -335,6 +617,10 @@ private:
    std::shared_ptr<BlockDataFileMap>
       getNewBlockDataMap(uint32_t fileid);
 
+   //lru lookup, bumps the hit to most recent. Call with mu_ held
+   std::list<std::pair<uint32_t, std::shared_ptr<BlockDataFileMap>>>::iterator
+      findMap(uint32_t fileid);
+
 public:
    BlockDataLoader(const std::string& path);
 
@@ -343,6 +629,65 @@ public:
 
    std::shared_ptr<BlockDataFileMap> get(const std::string& filename);
    std::shared_ptr<BlockDataFileMap> get(uint32_t fileid);
+
+   //0 disables the lru, every get maps the file anew
+   void setMappedCap(size_t);
+   void readAhead(const std::set<uint32_t>&);
+   void release(uint32_t fileid);
+
+   BlockDataLoaderStats getStats(void) const;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+typedef std::vector<std::pair<uint32_t, uint32_t>> TxOffsetTable;
+
+/////////////////////////////////////////////////////////////////////////////
+class BlockDataCache
+{
+   /***
+   Process wide caches for random access reads into blk files (tx and raw
+   block fetches), which would otherwise map a whole blk file and 
+   deserialize the entire block to get at a single tx:
+
+    - LRU of blk file maps keyed by path. Entries are checked against the 
+      file's stat on each fetch and remapped if the file grew or was 
+      replaced.
+
+    - LRU of per block tx offset tables keyed by block hash. Tables are 
+      built by walking tx lengths, no hashing nor txin/txout parsing.
+   ***/
+
+private:
+   struct FileMapEntry
+   {
+      std::shared_ptr<BlockDataFileMap> map_;
+      uint64_t inode_;
+      uint64_t size_;
+      time_t mtime_;
+   };
+
+   ArmoryThreading::LruCache<
+      std::string, std::shared_ptr<FileMapEntry>> fileMaps_;
+   ArmoryThreading::LruCache<
+      BinaryData, std::shared_ptr<const TxOffsetTable>> txOffsets_;
+
+private:
+   BlockDataCache(void) :
+      fileMaps_(BLOCKDATA_FILEMAP_CACHE_SIZE),
+      txOffsets_(BLOCKDATA_TXOFFSETS_CACHE_SIZE)
+   {}
+
+public:
+   static BlockDataCache& instance(void);
+
+   std::shared_ptr<BlockDataFileMap> getFileMap(const std::string& path);
+   void evictFileMap(const std::string& path);
+
+   std::shared_ptr<const TxOffsetTable> getTxOffsets(
+      const BinaryData& blockHash, const uint8_t* data, size_t size);
+   static TxOffsetTable computeTxOffsets(const uint8_t* data, size_t size);
+
+   void clear(void);
 };
 
 #endif
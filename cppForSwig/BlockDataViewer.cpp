@@ -250,6 +250,54 @@ Tx BlockDataViewer::getTxByHash(BinaryData const & txhash) const
       return zeroConfCont_->getTxByHash(txhash);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+vector<Tx> BlockDataViewer::getTxBatchByHash(
+   const vector<BinaryDataRef>& txHashes) const
+{
+   vector<Tx> result(txHashes.size());
+   auto&& stxVec = db_->getStoredTxBatch(txHashes);
+
+   //gather outpoint hashes across the batch to resolve their heights at once
+   vector<BinaryData> opHashes;
+   vector<pair<size_t, unsigned>> opCounts;
+   for (size_t i = 0; i < txHashes.size(); i++)
+   {
+      auto& stx = stxVec[i];
+      if (!stx.isInitialized())
+      {
+         result[i] = zeroConfCont_->getTxByHash(txHashes[i]);
+         continue;
+      }
+
+      auto& tx = result[i];
+      tx = stx.getTxCopy();
+      for (unsigned y = 0; y < tx.getNumTxIn(); y++)
+      {
+         auto&& txin = tx.getTxInCopy(y);
+         auto&& op = txin.getOutPoint();
+         opHashes.push_back(op.getTxHash());
+      }
+
+      opCounts.push_back(make_pair(i, tx.getNumTxIn()));
+   }
+
+   vector<BinaryDataRef> opHashRefs;
+   opHashRefs.reserve(opHashes.size());
+   for (auto& opHash : opHashes)
+      opHashRefs.push_back(opHash.getRef());
+   auto&& opHeights = db_->getHeightsForTxHashes(opHashRefs);
+
+   auto heightIter = opHeights.begin();
+   for (auto& countPair : opCounts)
+   {
+      auto& tx = result[countPair.first];
+      for (unsigned y = 0; y < countPair.second; y++)
+         tx.pushBackOpId(*heightIter++);
+   }
+
+   return result;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 tuple<uint32_t, uint32_t, vector<unsigned>> 
 BlockDataViewer::getTxMetaData(
@@ -522,7 +570,11 @@ LedgerDelegate BlockDataViewer::getLedgerDelegateForWallets()
    auto getPageCount = [this](void)->uint32_t
    { return this->getWalletsPageCount(); };
 
-   return LedgerDelegate(getHist, getBlock, getPageId, getPageCount);
+   auto getPageRange = [this](uint32_t pageID)->pair<uint32_t, uint32_t>
+   { return this->groups_[group_wallet].getPageRange(pageID); };
+
+   return LedgerDelegate(
+      getHist, getBlock, getPageId, getPageCount, getPageRange);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -540,7 +592,11 @@ LedgerDelegate BlockDataViewer::getLedgerDelegateForLockboxes()
    auto getPageCount = [this](void)->uint32_t
    { return this->getLockboxesPageCount(); };
 
-   return LedgerDelegate(getHist, getBlock, getPageId, getPageCount);
+   auto getPageRange = [this](uint32_t pageID)->pair<uint32_t, uint32_t>
+   { return this->groups_[group_lockbox].getPageRange(pageID); };
+
+   return LedgerDelegate(
+      getHist, getBlock, getPageId, getPageCount, getPageRange);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -577,7 +633,11 @@ LedgerDelegate BlockDataViewer::getLedgerDelegateForScrAddr(
    auto getPageCount = [&](void)->uint32_t
    { return sca.getPageCount(); };
 
-   return LedgerDelegate(getHist, getBlock, getPageId, getPageCount);
+   auto getPageRange = [&](uint32_t pageID)->pair<uint32_t, uint32_t>
+   { return sca.getPageRange(pageID); };
+
+   return LedgerDelegate(
+      getHist, getBlock, getPageId, getPageCount, getPageRange);
 }
 
 
@@ -591,34 +651,9 @@ uint32_t BlockDataViewer::getClosestBlockHeightForTime(uint32_t timestamp)
    if (timestamp < genBlock->getTimestamp())
       return 0;
 
-   //get time diff and divide by average time per block (600 sec for Bitcoin)
-   uint32_t diff = timestamp - genBlock->getTimestamp();
-   int32_t blockHint = diff/600;
-
-   //look for a block in the hint vicinity with a timestamp lower than ours
-   while (blockHint > 0)
-   {
-      auto block = blockchain().getHeaderByHeight(blockHint, 0xFF);
-      if (block->getTimestamp() < timestamp)
-         break;
-
-      blockHint -= 1000;
-   }
-
-   //another sanity check
-   if (blockHint < 0)
-      return 0;
-
-   for (uint32_t id = blockHint; id < blockchain().top()->getBlockHeight() - 1; id++)
-   {
-      //not looking for a really precise block, 
-      //anything within the an hour of the timestamp is enough
-      auto block = blockchain().getHeaderByHeight(id, 0xFF);
-      if (block->getTimestamp() + 3600 > timestamp)
-         return block->getBlockHeight();
-   }
-
-   return blockchain().top()->getBlockHeight() - 1;
+   //not looking for a really precise block, anything within an hour 
+   //of the timestamp is enough: first block with timestamp + 3600 past it
+   return blockchain().getHeightForTime(timestamp - 3599);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1076,12 +1111,36 @@ vector<pair<StoredTxOut, BinaryDataRef>> BlockDataViewer::getOutputsForOutpoints
       zcSS = zc_->getSnapshot();
    }
    
-   auto&& stxo_tx = db_->beginTransaction(STXO, LMDB::ReadOnly);
+   //resolve all hashes then all mined outputs in one batch each
+   vector<BinaryDataRef> txHashes;
+   txHashes.reserve(outpoints.size());
+   for (auto& opSet : outpoints)
+      txHashes.push_back(opSet.first);
+   auto&& dbKeys = db_->getDBKeysForHashes(txHashes);
+
+   vector<BinaryData> stxoKeys;
+   auto dbKeyIter = dbKeys.begin();
+   for (auto& opSet : outpoints)
+   {
+      auto& dbkey = *dbKeyIter++;
+      if (dbkey.getSize() != 6)
+         continue;
 
+      for (auto& op : opSet.second)
+      {
+         auto stxoKey = dbkey;
+         stxoKey.append(WRITE_UINT16_BE(op));
+         stxoKeys.emplace_back(move(stxoKey));
+      }
+   }
+
+   auto&& stxoVec = db_->getStoredTxOutBatch(stxoKeys);
+   auto stxoIter = stxoVec.begin();
+
+   dbKeyIter = dbKeys.begin();
    for (auto& opSet : outpoints)
    {
-      //get dbkey for this txhash
-      auto&& dbkey = db_->getDBKeyForHash(opSet.first);
+      auto& dbkey = *dbKeyIter++;
       if (dbkey.getSize() == 6)
       {
          for (auto& op : opSet.second)
@@ -1091,12 +1150,10 @@ vector<pair<StoredTxOut, BinaryDataRef>> BlockDataViewer::getOutputsForOutpoints
             stxoPair.second = opSet.first;
             
             auto& stxo = stxoPair.first;
-            stxo.txOutIndex_ = op;
-            auto stxoKey = dbkey;
-            stxoKey.append(WRITE_UINT16_BE(op));
-
-            if (!db_->getStoredTxOut(stxo, stxoKey))
+            stxo = move(*stxoIter++);
+            if (!stxo.isInitialized())
                throw runtime_error("invalid outpoint");
+            stxo.txOutIndex_ = op;
                
             result.emplace_back(stxoPair);
          }
@@ -1458,6 +1515,31 @@ vector<LedgerEntry> WalletGroup::getHistoryPage(
    return vle;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+pair<uint32_t, uint32_t> WalletGroup::getPageRange(uint32_t pageId) const
+{
+   //pages are stored top down, flip the id like getHistoryPage does
+   auto pageCount = hist_.getPageCount();
+   if (pageId >= pageCount)
+      throw std::range_error("pageId out of range");
+
+   if (order_ == order_ascending)
+      pageId = pageCount - pageId - 1;
+
+   return make_pair(hist_.getPageBottom(pageId), hist_.getPageTop(pageId));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WalletGroup::pageOverlapsHeightRange(
+   uint32_t pageId, uint32_t bottom, uint32_t top) const
+{
+   if (pageId >= hist_.getPageCount())
+      return false;
+
+   auto&& range = getPageRange(pageId);
+   return range.first <= top && range.second >= bottom;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void WalletGroup::updateLedgerFilter(const vector<string>& walletsList)
 {
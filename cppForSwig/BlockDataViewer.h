@@ -82,6 +82,7 @@ public:
    bool hasWallet(const std::string &ID) const;
 
    Tx                getTxByHash(BinaryData const & txHash) const;
+   std::vector<Tx>   getTxBatchByHash(const std::vector<BinaryDataRef>&) const;
    
    std::tuple<uint32_t, uint32_t, std::vector<unsigned>> 
                      getTxMetaData(const BinaryDataRef&, bool) const;
@@ -275,6 +276,9 @@ public:
    size_t getPageCount(void) const { return hist_.getPageCount(); }
    std::vector<LedgerEntry> getHistoryPage(uint32_t pageId, unsigned updateID,
       bool rebuildLedger, bool remapWallets);
+   std::pair<uint32_t, uint32_t> getPageRange(uint32_t pageId) const;
+   bool pageOverlapsHeightRange(uint32_t pageId,
+      uint32_t bottom, uint32_t top) const;
 
    const std::set<BinaryData>& getValidZcSet(void) const
    {
@@ -18,8 +18,350 @@
 #include "BlockObj.h"
 #include "lmdb_wrapper.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(_MSC_VER) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
+////////////////////////////////////////////////////////////////////////////////
+////
+//// TxFilterBatch
+////
+////////////////////////////////////////////////////////////////////////////////
+TxFilterBatch::TxFilterBatch(const vector<uint32_t>& keys)
+{
+   if (keys.size() <= TXFILTER_BATCH_SIMD_MAX)
+   {
+      keys_ = keys;
+      return;
+   }
+
+   //too many keys to test them all per entry, sort them so that each 
+   //entry is looked up instead
+   sortedKeys_.reserve(keys.size());
+   for (size_t i = 0; i < keys.size(); i++)
+      sortedKeys_.push_back(make_pair(keys[i], i));
+   sort(sortedKeys_.begin(), sortedKeys_.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+vector<pair<size_t, uint32_t>> TxFilterBatch::compare(
+   const uint32_t* data, size_t len) const
+{
+   vector<pair<size_t, uint32_t>> hits;
+   if (len == 0)
+      return hits;
+
+   if (sortedKeys_.size() > 0)
+   {
+      for (uint32_t i = 0; i < len; i++)
+      {
+         auto iter = lower_bound(sortedKeys_.begin(), sortedKeys_.end(),
+            make_pair(data[i], (size_t)0));
+
+         while (iter != sortedKeys_.end() && iter->first == data[i])
+         {
+            hits.push_back(make_pair(iter->second, i));
+            ++iter;
+         }
+      }
+
+      return hits;
+   }
+
+   if (keys_.size() == 0)
+      return hits;
+
+   //load each chunk of the filter once, test it against all keys
+   auto pushMask = [&hits](unsigned mask, size_t key, uint32_t offset)->void
+   {
+      for (uint32_t bit = 0; mask != 0; bit++, mask >>= 1)
+      {
+         if (mask & 1)
+            hits.push_back(make_pair(key, offset + bit));
+      }
+   };
+
+   uint32_t i = 0;
+
+#if defined(__AVX2__)
+   for (; i + 8 <= len; i += 8)
+   {
+      auto chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+      for (size_t y = 0; y < keys_.size(); y++)
+      {
+         auto eq = _mm256_cmpeq_epi32(
+            chunk, _mm256_set1_epi32((int)keys_[y]));
+         auto mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq));
+         if (mask != 0)
+            pushMask(mask, y, i);
+      }
+   }
+#elif defined(_MSC_VER) || defined(__SSE2__)
+   for (; i + 4 <= len; i += 4)
+   {
+      auto chunk = _mm_loadu_si128((const __m128i*)(data + i));
+      for (size_t y = 0; y < keys_.size(); y++)
+      {
+         auto eq = _mm_cmpeq_epi32(chunk, _mm_set1_epi32((int)keys_[y]));
+         auto mask = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq));
+         if (mask != 0)
+            pushMask(mask, y, i);
+      }
+   }
+#endif
+
+   //scalar tail
+   for (; i < len; i++)
+   {
+      for (size_t y = 0; y < keys_.size(); y++)
+      {
+         if (data[i] == keys_[y])
+            hits.push_back(make_pair(y, i));
+      }
+   }
+
+   return hits;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TxFilterBatch::probe(const uint8_t* slotPtr, size_t slotCount,
+   uint32_t key, vector<uint32_t>& ordinals)
+{
+   //slot count is a power of 2, empty slots have UINT32_MAX for ordinal
+   ordinals.clear();
+   auto mask = slotCount - 1;
+   auto pos = (size_t)key & mask;
+   size_t probed = 0;
+
+#if defined(_MSC_VER) || defined(__SSE2__)
+   //4 slots per pass: for slot n, bit 2n flags a key match and bit 2n+1 
+   //an empty slot
+   auto pattern = _mm_set_epi32(-1, (int)key, -1, (int)key);
+   while (probed + 4 <= slotCount && pos + 4 <= slotCount)
+   {
+      auto slots = (const __m128i*)(slotPtr + pos * 8);
+      auto lo = _mm_cmpeq_epi32(_mm_loadu_si128(slots), pattern);
+      auto hi = _mm_cmpeq_epi32(_mm_loadu_si128(slots + 1), pattern);
+      auto bits = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(lo)) |
+         ((unsigned)_mm_movemask_ps(_mm_castsi128_ps(hi)) << 4);
+
+      for (unsigned i = 0; bits != 0 && i < 4; i++, bits >>= 2)
+      {
+         if (bits & 2)
+            return;
+
+         if (bits & 1)
+            ordinals.push_back(*(uint32_t*)(slotPtr + (pos + i) * 8 + 4));
+      }
+
+      pos = (pos + 4) & mask;
+      probed += 4;
+   }
+#endif
+
+   //wrap around and unvectorized builds
+   for (; probed < slotCount; probed++)
+   {
+      auto slot = slotPtr + pos * 8;
+      auto ordinal = *(uint32_t*)(slot + 4);
+      if (ordinal == UINT32_MAX)
+         return;
+
+      if (*(uint32_t*)slot == key)
+         ordinals.push_back(ordinal);
+
+      pos = (pos + 1) & mask;
+   }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+////
+//// BlockFilter
+////
+////////////////////////////////////////////////////////////////////////////////
+static uint64_t mix64(uint64_t val)
+{
+   val ^= val >> 30;
+   val *= 0xbf58476d1ce4e5b9ULL;
+   val ^= val >> 27;
+   val *= 0x94d049bb133111ebULL;
+   val ^= val >> 31;
+   return val;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static uint64_t mapToRange(uint64_t hash, uint64_t range)
+{
+   //high 64 bits of hash * range
+#if defined(__SIZEOF_INT128__)
+   return (uint64_t)(((unsigned __int128)hash * range) >> 64);
+#else
+   uint64_t hashLo = hash & 0xFFFFFFFF, hashHi = hash >> 32;
+   uint64_t rangeLo = range & 0xFFFFFFFF, rangeHi = range >> 32;
+
+   uint64_t lolo = hashLo * rangeLo;
+   uint64_t hilo = hashHi * rangeLo;
+   uint64_t lohi = hashLo * rangeHi;
+   uint64_t hihi = hashHi * rangeHi;
+
+   uint64_t mid = (lolo >> 32) + (hilo & 0xFFFFFFFF) + (lohi & 0xFFFFFFFF);
+   return hihi + (hilo >> 32) + (lohi >> 32) + (mid >> 32);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t BlockFilter::hashScript(uint8_t prefix, const BinaryDataRef& script)
+{
+   //fnv1a
+   uint64_t hash = 0xcbf29ce484222325ULL;
+   hash = (hash ^ prefix) * 0x100000001b3ULL;
+
+   auto ptr = script.getPtr();
+   for (size_t i = 0; i < script.getSize(); i++)
+      hash = (hash ^ ptr[i]) * 0x100000001b3ULL;
+
+   return mix64(hash);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t BlockFilter::hashOutpoint(
+   const BinaryDataRef& txHash, uint32_t txOutId)
+{
+   if (txHash.getSize() != 32)
+      throw range_error("unexpected hash length");
+
+   //tx hashes are uniformly distributed already
+   uint64_t hashHead;
+   memcpy(&hashHead, txHash.getPtr(), 8);
+   return mix64(hashHead ^ ((uint64_t)txOutId * 0x9e3779b97f4a7c15ULL));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BlockFilter BlockFilter::create(vector<uint64_t>& elements)
+{
+   sort(elements.begin(), elements.end());
+   elements.erase(
+      unique(elements.begin(), elements.end()), elements.end());
+
+   BlockFilter filter;
+   filter.count_ = elements.size();
+
+   //mapping keeps the order
+   auto range = filter.count_ * BLOCKFILTER_M;
+   for (auto& element : elements)
+      element = mapToRange(element, range);
+
+   BinaryWriter bw;
+   bw.put_var_int(filter.count_);
+   filter.bitsOffset_ = bw.getSize();
+
+   uint8_t currentByte = 0;
+   unsigned bitCount = 0;
+   auto putBit = [&](unsigned bit)->void
+   {
+      currentByte |= bit << (7 - bitCount);
+      if (++bitCount == 8)
+      {
+         bw.put_uint8_t(currentByte);
+         currentByte = 0;
+         bitCount = 0;
+      }
+   };
+
+   uint64_t last = 0;
+   for (auto& element : elements)
+   {
+      auto delta = element - last;
+      last = element;
+
+      //unary quotient, then the remainder msb first
+      for (auto quotient = delta >> BLOCKFILTER_P; quotient > 0; quotient--)
+         putBit(1);
+      putBit(0);
+
+      for (int i = BLOCKFILTER_P - 1; i >= 0; i--)
+         putBit((delta >> i) & 1);
+   }
+
+   if (bitCount != 0)
+      bw.put_uint8_t(currentByte);
+
+   filter.data_ = bw.getData();
+   return filter;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BlockFilter::BlockFilter(const BinaryData& data) :
+   data_(data)
+{
+   if (data_.getSize() == 0)
+      throw runtime_error("empty block filter");
+
+   BinaryRefReader brr(data_.getRef());
+   count_ = brr.get_var_int();
+   bitsOffset_ = brr.getPosition();
+
+   //each element takes at least P + 1 bits
+   auto bitCount = (data_.getSize() - bitsOffset_) * 8;
+   if (count_ > bitCount / (BLOCKFILTER_P + 1))
+      throw runtime_error("invalid block filter size");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool BlockFilter::matchAny(const vector<uint64_t>& keys) const
+{
+   if (count_ == 0 || keys.size() == 0)
+      return false;
+
+   auto ptr = data_.getPtr() + bitsOffset_;
+   auto bitCount = (data_.getSize() - bitsOffset_) * 8;
+   size_t bitPos = 0;
+
+   auto getBit = [&](void)->unsigned
+   {
+      if (bitPos >= bitCount)
+         throw runtime_error("block filter overflow");
+
+      auto bit = (ptr[bitPos >> 3] >> (7 - (bitPos & 7))) & 1;
+      ++bitPos;
+      return bit;
+   };
+
+   auto range = count_ * BLOCKFILTER_M;
+   size_t keyId = 0;
+   auto mappedKey = mapToRange(keys[0], range);
+
+   uint64_t value = 0;
+   for (uint64_t i = 0; i < count_; i++)
+   {
+      uint64_t quotient = 0;
+      while (getBit() == 1)
+         ++quotient;
+
+      uint64_t remainder = 0;
+      for (unsigned y = 0; y < BLOCKFILTER_P; y++)
+         remainder = (remainder << 1) | getBit();
+
+      value += (quotient << BLOCKFILTER_P) | remainder;
+
+      while (mappedKey < value)
+      {
+         if (++keyId == keys.size())
+            return false;
+         mappedKey = mapToRange(keys[keyId], range);
+      }
+
+      if (mappedKey == value)
+         return true;
+   }
+
+   return false;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 void BlockHeader::unserialize(uint8_t const * ptr, uint32_t size)
@@ -22,19 +22,61 @@
 #include <set>
 #include <cassert>
 #include <functional>
+#include <type_traits>
 
 #include "BinaryData.h"
 #include "BtcUtils.h"
 #include "TxClasses.h"
 
+#if defined(_MSC_VER) || defined(__SSE2__)
+#include <xmmintrin.h>
+#endif
+
 typedef uint32_t TxFilterType;
 
+//past this many keys, batch compares look up sorted keys per filter entry 
+//instead of testing every key against every entry
+#define TXFILTER_BATCH_SIMD_MAX 64
+
 ////////////////////////////////////////////////////////////////////////////////
 class LMDBBlockDatabase; 
 class Tx;
 class TxIn;
 class TxOut;
 
+////////////////////////////////////////////////////////////////////////////////
+class TxFilterBatch
+{
+   /***
+   Set of keys to test against many filters. Large batches are sorted once
+   here rather than once per filter.
+   ***/
+
+private:
+   std::vector<uint32_t> keys_;
+   std::vector<std::pair<uint32_t, size_t>> sortedKeys_;
+
+public:
+   explicit TxFilterBatch(const std::vector<uint32_t>&);
+
+   //tests all keys against data, returns (key index, data index) pairs for
+   //all matches, ordered by data index
+   std::vector<std::pair<size_t, uint32_t>> compare(
+      const uint32_t* data, size_t len) const;
+
+   //linear probe over a pool index made of 8 bytes {key, ordinal} slots, 
+   //fills ordinals with the matches for key up to the first empty slot
+   static void probe(const uint8_t* slotPtr, size_t slotCount, 
+      uint32_t key, std::vector<uint32_t>& ordinals);
+
+   static void prefetch(const void* ptr)
+   {
+#if defined(_MSC_VER) || defined(__SSE2__)
+      _mm_prefetch((const char*)ptr, _MM_HINT_T0);
+#endif
+   }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 template<typename T> class TxFilter
 {
@@ -69,6 +111,22 @@ private:
       return *(uint32_t*)(ptr + 8);
    }
 
+   const T* getData(size_t& len) const
+   {
+      if (filterVector_.size() != 0)
+      {
+         len = filterVector_.size();
+         return &filterVector_[0];
+      }
+      else if (filterPtr_ != nullptr)
+      {
+         len = len_;
+         return (const T*)(filterPtr_ + 12);
+      }
+
+      throw std::runtime_error("invalid filter");
+   }
+
    bool checkPtrLen(const uint8_t* ptr)
    {
       if (ptr == nullptr)
@@ -193,6 +251,36 @@ public:
       return resultSet;
    }
 
+   std::vector<std::pair<size_t, uint32_t>> compareBatch(
+      const std::vector<T>& keys) const
+   {
+      size_t len;
+      auto data = getData(len);
+
+      std::vector<std::pair<size_t, uint32_t>> hits;
+      for (uint32_t i = 0; i < len; i++)
+      {
+         for (size_t y = 0; y < keys.size(); y++)
+         {
+            if (data[i] == keys[y])
+               hits.push_back(std::make_pair(y, i));
+         }
+      }
+
+      return hits;
+   }
+
+   std::vector<std::pair<size_t, uint32_t>> compareBatch(
+      const TxFilterBatch& batch) const
+   {
+      static_assert(std::is_same<T, uint32_t>::value,
+         "vectorized batch compare requires 4 bytes keys");
+
+      size_t len;
+      auto data = getData(len);
+      return batch.compare(data, len);
+   }
+
    uint32_t getBlockKey(void) const { return blockKey_; }
 
    void serialize(BinaryWriter& bw) const
@@ -217,6 +305,52 @@ public:
    }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/*
+Golomb coded set of the output scripts and spent outpoints of a block, as 
+in BIP158. Scans check it to skip blocks that can't carry history for the 
+scripts or outpoints they track.
+
+Elements are hashed with a fixed function rather than one keyed by block 
+hash, so a scan hashes its keys once. Hashes are mapped into [0, N * M) by 
+multiply and shift, which preserves their order: sorted keys stay sorted 
+for any N, and are walked alongside the decoded set.
+
+   element count (varint) | Golomb-Rice coded deltas, P bit remainders
+
+False positive rate is 1 / BLOCKFILTER_M per key.
+*/
+#define BLOCKFILTER_P 19
+#define BLOCKFILTER_M 784931ULL
+
+class BlockFilter
+{
+private:
+   BinaryData data_;
+   uint64_t count_ = 0;
+   size_t bitsOffset_ = 0;
+
+public:
+   BlockFilter(void)
+   {}
+
+   //throws on malformed data
+   BlockFilter(const BinaryData& data);
+
+   //element hashes do not need to be sorted or unique
+   static BlockFilter create(std::vector<uint64_t>& elements);
+
+   static uint64_t hashScript(uint8_t prefix, const BinaryDataRef& script);
+   static uint64_t hashOutpoint(const BinaryDataRef& txHash, uint32_t txOutId);
+
+   bool isValid(void) const { return data_.getSize() != 0; }
+   uint64_t getCount(void) const { return count_; }
+   const BinaryData& serialize(void) const { return data_; }
+
+   //keys have to be sorted
+   bool matchAny(const std::vector<uint64_t>& keys) const;
+};
+
 class BlockHeader
 {
    friend class Blockchain;
@@ -372,6 +372,16 @@ void BlockDataManager::loadDiskState(const ProgressCallback &progress,
    LOGINFO << "BDM is ready";
 }
 
+////////////////////////////////////////////////////////////////////////////////
+ChainCheckStats BlockDataManager::getCheckChainStats() const
+{
+   //set by the last chain check, failed ones included
+   if (dbBuilder_ == nullptr)
+      return ChainCheckStats();
+
+   return dbBuilder_->getCheckChainStats();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 Blockchain::ReorganizationState BlockDataManager::readBlkFileUpdate()
 { 
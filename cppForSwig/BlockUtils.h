@@ -90,6 +90,7 @@ class debug_replay_blocks {};
 
 class BlockFiles;
 class DatabaseBuilder;
+struct ChainCheckStats;
 class BDV_Server_Object;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -224,6 +225,7 @@ public:
    void resetDatabases(ResetDBMode mode);
    
    unsigned getCheckedTxCount(void) const { return checkTransactionCount_; }
+   ChainCheckStats getCheckChainStats(void) const;
    NodeStatusStruct getNodeStatus(void) const;
    void registerZcCallbacks(std::unique_ptr<ZeroConfCallbacks> ptr)
    {
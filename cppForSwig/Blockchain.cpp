@@ -11,6 +11,8 @@
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+
 #include "Blockchain.h"
 #include "util.h"
 
@@ -20,6 +22,213 @@
 
 using namespace std;
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//
+// HeaderIndex
+//
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+void HeaderIndex::Chunk::resize(size_t count)
+{
+   headers_.resize(count);
+   hashes_.resize(count * 32);
+   timestamps_.resize(count);
+   medianTimes_.resize(count);
+   difficulty_.resize(count);
+   fileIDs_.resize(count, UINT32_MAX);
+   offsets_.resize(count, UINT64_MAX);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void HeaderIndex::Chunk::set(size_t slot, const shared_ptr<BlockHeader>& header)
+{
+   headers_[slot] = header;
+   if (header == nullptr)
+   {
+      memset(&hashes_[slot * 32], 0, 32);
+      timestamps_[slot] = 0;
+      difficulty_[slot] = 0.0;
+      fileIDs_[slot] = UINT32_MAX;
+      offsets_[slot] = UINT64_MAX;
+      return;
+   }
+
+   auto& hash = header->getThisHash();
+   if (hash.getSize() == 32)
+      memcpy(&hashes_[slot * 32], hash.getPtr(), 32);
+   else
+      memset(&hashes_[slot * 32], 0, 32);
+
+   //the genesis placeholder is flagged initialized but carries no data
+   if (header->serialize().getSize() >= HEADER_SIZE)
+      timestamps_[slot] = header->getTimestamp();
+   else
+      timestamps_[slot] = 0;
+   difficulty_[slot] = header->getDifficulty();
+   fileIDs_[slot] = header->getBlockFileNum();
+   offsets_[slot] = header->getOffset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+shared_ptr<const HeaderIndex> HeaderIndex::update(
+   const map<unsigned, shared_ptr<BlockHeader>>& entries, size_t newSize) const
+{
+   auto newIndex = make_shared<HeaderIndex>(byHeight_);
+   newIndex->count_ = newSize;
+   newIndex->epoch_ = epoch_ + 1;
+
+   auto chunkCount = 
+      (newSize + HEADER_INDEX_CHUNK_SIZE - 1) / HEADER_INDEX_CHUNK_SIZE;
+   newIndex->chunks_.resize(chunkCount);
+
+   //carry over chunks, copy the ones that are resized or written to
+   vector<shared_ptr<Chunk>> dirtyChunks(chunkCount);
+   auto getDirtyChunk = [&](size_t chunkId)->Chunk&
+   {
+      auto& chunkPtr = dirtyChunks[chunkId];
+      if (chunkPtr != nullptr)
+         return *chunkPtr;
+
+      if (chunkId < chunks_.size())
+         chunkPtr = make_shared<Chunk>(*chunks_[chunkId]);
+      else
+         chunkPtr = make_shared<Chunk>();
+
+      chunkPtr->resize(min<size_t>(HEADER_INDEX_CHUNK_SIZE,
+         newSize - chunkId * HEADER_INDEX_CHUNK_SIZE));
+      return *chunkPtr;
+   };
+
+   for (size_t i = 0; i < chunkCount; i++)
+   {
+      auto expectedSize = min<size_t>(HEADER_INDEX_CHUNK_SIZE,
+         newSize - i * HEADER_INDEX_CHUNK_SIZE);
+
+      if (i >= chunks_.size() || chunks_[i]->size() != expectedSize)
+         getDirtyChunk(i);
+   }
+
+   //track the modified range to update median times, id indexes have none
+   size_t firstChanged = SIZE_MAX;
+   size_t lastChanged = 0;
+   if (newSize > count_)
+   {
+      firstChanged = count_;
+      lastChanged = newSize - 1;
+   }
+
+   for (auto& entry : entries)
+   {
+      if (entry.first >= newSize)
+         continue;
+
+      auto chunkId = entry.first / HEADER_INDEX_CHUNK_SIZE;
+      auto slot = getSlot(entry.first);
+      if (dirtyChunks[chunkId] == nullptr && 
+         chunks_[chunkId]->headers_[slot] == entry.second)
+         continue;
+
+      getDirtyChunk(chunkId).set(slot, entry.second);
+      firstChanged = min<size_t>(firstChanged, entry.first);
+      lastChanged = max<size_t>(lastChanged, entry.first);
+   }
+
+   if (!byHeight_)
+      firstChanged = SIZE_MAX;
+
+   auto getChunkForRead = [&](size_t i)->const Chunk&
+   {
+      auto chunkId = i / HEADER_INDEX_CHUNK_SIZE;
+      if (dirtyChunks[chunkId] != nullptr)
+         return *dirtyChunks[chunkId];
+      return *chunks_[chunkId];
+   };
+
+   //a change at i moves the median times from i up, stop once the values
+   //match the previous version past the last window holding a change
+   vector<uint32_t> window;
+   window.reserve(MEDIAN_TIME_SPAN);
+   for (size_t i = firstChanged; i < newSize; i++)
+   {
+      window.clear();
+      auto windowStart = 
+         i >= MEDIAN_TIME_SPAN - 1 ? i - (MEDIAN_TIME_SPAN - 1) : 0;
+      for (auto y = windowStart; y <= i; y++)
+         window.push_back(getChunkForRead(y).timestamps_[getSlot(y)]);
+
+      auto mid = window.begin() + window.size() / 2;
+      nth_element(window.begin(), mid, window.end());
+      auto medianTime = *mid;
+      if (i > 0)
+      {
+         medianTime = max(medianTime, 
+            getChunkForRead(i - 1).medianTimes_[getSlot(i - 1)]);
+      }
+
+      auto& currentVal = getChunkForRead(i).medianTimes_[getSlot(i)];
+      if (currentVal == medianTime)
+      {
+         if (i >= lastChanged + MEDIAN_TIME_SPAN)
+            break;
+         continue;
+      }
+
+      getDirtyChunk(i / HEADER_INDEX_CHUNK_SIZE).medianTimes_[getSlot(i)] =
+         medianTime;
+   }
+
+   for (size_t i = 0; i < chunkCount; i++)
+   {
+      if (dirtyChunks[i] != nullptr)
+         newIndex->chunks_[i] = move(dirtyChunks[i]);
+      else
+         newIndex->chunks_[i] = chunks_[i];
+   }
+
+   return newIndex;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t HeaderIndex::lowerBoundMedianTime(uint32_t timestamp) const
+{
+   size_t lo = 0;
+   size_t hi = count_;
+   while (lo < hi)
+   {
+      auto mid = lo + (hi - lo) / 2;
+      if (medianTime(mid) < timestamp)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   return lo;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t HeaderIndex::lowerBoundTimestamp(uint32_t timestamp) const
+{
+   /***
+   Entries before pos have a median time under timestamp. At pos, the 
+   median is at or past it, so half the window ending at pos at least is
+   too: the first of these is the result. Past the top, look in the last 
+   window.
+   ***/
+
+   auto pos = lowerBoundMedianTime(timestamp);
+   auto start = pos >= MEDIAN_TIME_SPAN - 1 ? pos - (MEDIAN_TIME_SPAN - 1) : 0;
+   auto end = min(pos + 1, count_);
+
+   for (auto i = start; i < end; i++)
+   {
+      if (this->timestamp(i) >= timestamp)
+         return i;
+   }
+
+   return pos;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -37,8 +246,8 @@ Blockchain::Blockchain(const HashString &genesisHash)
 void Blockchain::clear()
 {
    newlyParsedBlocks_.clear();
-   headersByHeight_.clear();
-   headersById_.clear();
+   atomic_store(&headersByHeight_, make_shared<const HeaderIndex>(true));
+   atomic_store(&headersById_, make_shared<const HeaderIndex>());
    headerMap_.clear();
 
    pair<BinaryData, shared_ptr<BlockHeader>> genesisPair;
@@ -73,6 +282,210 @@ Blockchain::ReorganizationState Blockchain::forceOrganize()
    return st;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+BinaryData Blockchain::getChainSnapshot(void) const
+{
+   auto heightIndex = getHeightIndex();
+   auto count = heightIndex->size();
+   if (count == 0)
+      return BinaryData();
+
+   BinaryWriter bw(
+      CHAIN_SNAPSHOT_HEADER_SIZE + count * CHAIN_SNAPSHOT_ENTRY_SIZE);
+   bw.put_uint8_t(CHAIN_SNAPSHOT_VERSION);
+   bw.put_uint32_t(count);
+   bw.put_BinaryDataRef(heightIndex->hash(count - 1));
+
+   for (size_t i = 0; i < count; i++)
+   {
+      auto& header = heightIndex->header(i);
+      bw.put_uint32_t(header->getThisID());
+      bw.put_uint8_t(header->getDuplicateID());
+      bw.put_uint32_t(heightIndex->fileID(i));
+      bw.put_uint64_t(heightIndex->offset(i));
+      bw.put_double(header->getDifficultySum());
+   }
+
+   return bw.getData();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Blockchain::applyChainSnapshot(
+   BinaryDataRef snapshot, unsigned threadCount)
+{
+   if (snapshot.getSize() < CHAIN_SNAPSHOT_HEADER_SIZE)
+      return false;
+
+   BinaryRefReader brr(snapshot);
+   if (brr.get_uint8_t() != CHAIN_SNAPSHOT_VERSION)
+   {
+      LOGWARN << "unsupported chain snapshot version";
+      return false;
+   }
+
+   size_t count = brr.get_uint32_t();
+   auto topHash = brr.get_BinaryDataRef(32);
+   if (count == 0 || 
+      brr.getSizeRemaining() != count * CHAIN_SNAPSHOT_ENTRY_SIZE)
+   {
+      LOGWARN << "malformed chain snapshot";
+      return false;
+   }
+
+   auto headermap = headerMap_.get();
+   if (headermap->find(topHash) == headermap->end())
+   {
+      LOGINFO << "chain snapshot top is not in the headers db";
+      return false;
+   }
+
+   auto entries = brr.get_BinaryDataRef(brr.getSizeRemaining());
+   auto idIndex = getIdIndex();
+
+   //resolve entries against the id index
+   vector<shared_ptr<BlockHeader>> chain(count);
+   vector<double> diffSums(count);
+   atomic<bool> isValid(true);
+
+   auto resolveRange = [&](size_t start, size_t end)->void
+   {
+      BinaryRefReader entryBrr(
+         entries.getPtr() + start * CHAIN_SNAPSHOT_ENTRY_SIZE,
+         (end - start) * CHAIN_SNAPSHOT_ENTRY_SIZE);
+
+      for (size_t i = start; i < end; i++)
+      {
+         auto id = entryBrr.get_uint32_t();
+         auto dup = entryBrr.get_uint8_t();
+         auto fileID = entryBrr.get_uint32_t();
+         auto offset = entryBrr.get_uint64_t();
+         auto diffSum = entryBrr.get_double();
+
+         if (id >= idIndex->size() || idIndex->header(id) == nullptr ||
+            idIndex->fileID(id) != fileID || idIndex->offset(id) != offset ||
+            idIndex->header(id)->getDuplicateID() != dup || !(diffSum > 0))
+         {
+            isValid.store(false, memory_order_relaxed);
+            return;
+         }
+
+         chain[i] = idIndex->header(id);
+         diffSums[i] = diffSum;
+      }
+   };
+
+   //every entry has to link to the one below it
+   auto linkRange = [&](size_t start, size_t end)->void
+   {
+      for (size_t i = start; i < end; i++)
+      {
+         if (i == 0)
+         {
+            if (chain[0]->getThisHash() != genesisHash_)
+            {
+               isValid.store(false, memory_order_relaxed);
+               return;
+            }
+
+            continue;
+         }
+
+         if (chain[i]->getPrevHashRef() != chain[i - 1]->getThisHashRef() ||
+            diffSums[i] <= diffSums[i - 1])
+         {
+            isValid.store(false, memory_order_relaxed);
+            return;
+         }
+      }
+   };
+
+   ArmoryThreading::runOverRanges(count, threadCount, resolveRange);
+   if (isValid.load())
+      ArmoryThreading::runOverRanges(count, threadCount, linkRange);
+
+   if (!isValid.load() || chain.back()->getThisHashRef() != topHash)
+   {
+      LOGWARN << "chain snapshot does not match the headers db";
+      return false;
+   }
+
+   //reset organization data, as a forced rebuild would
+   for (const auto& headerPair : *headermap)
+   {
+      headerPair.second->difficultySum_ = -1;
+      headerPair.second->blockHeight_ = 0;
+      headerPair.second->isFinishedCalc_ = false;
+      headerPair.second->nextHash_ = BtcUtils::EmptyHash();
+      headerPair.second->isMainBranch_ = false;
+   }
+
+   auto applyRange = [&](size_t start, size_t end)->void
+   {
+      for (size_t i = start; i < end; i++)
+      {
+         auto& header = chain[i];
+         header->blockHeight_ = i;
+         header->difficultySum_ = diffSums[i];
+         header->isMainBranch_ = true;
+         header->isOrphan_ = false;
+         header->isFinishedCalc_ = true;
+         if (i + 1 < count)
+            header->nextHash_ = chain[i + 1]->getThisHash();
+      }
+   };
+
+   ArmoryThreading::runOverRanges(count, threadCount, applyRange);
+
+   map<unsigned, shared_ptr<BlockHeader>> heightMap;
+   for (size_t i = 0; i < count; i++)
+      heightMap.emplace_hint(heightMap.end(), i, chain[i]);
+   atomic_store(&headersByHeight_, getHeightIndex()->update(heightMap, count));
+
+   topBlockId_ = chain.back()->getThisID();
+   atomic_store(&topBlockPtr_, chain.back());
+   return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Blockchain::ReorganizationState Blockchain::organizeFromSnapshot(
+   BinaryDataRef snapshot, unsigned threadCount)
+{
+   ReorganizationState st;
+   st.prevTop_ = top();
+
+   if (!applyChainSnapshot(snapshot, threadCount))
+      return forceOrganize();
+
+   //picks up headers past the snapshot top and side branches. This will
+   //rebuild from scratch on its own if the snapshot top was reorged out
+   if (organizeChain(false) != nullptr)
+      LOGWARN << "chain snapshot top was reorged out";
+
+   //the state is reported against the top prior to this call, as with 
+   //forceOrganize
+   st.prevTopStillValid_ = 
+      !st.prevTop_->isInitialized() || st.prevTop_->isMainBranch();
+   if (!st.prevTopStillValid_)
+   {
+      try
+      {
+         auto headerPtr = st.prevTop_;
+         while (!headerPtr->isMainBranch())
+            headerPtr = getHeaderByHash(headerPtr->getPrevHash());
+         st.reorgBranchPoint_ = headerPtr;
+      }
+      catch (exception&)
+      {
+         LOGERR << "could not trace prev top to the main chain";
+         st.reorgBranchPoint_ = getGenesisBlock();
+      }
+   }
+
+   st.hasNewTop_ = (st.prevTop_ != top());
+   st.newTop_ = top();
+   return st;
+}
+
 void Blockchain::updateBranchingMaps(
    LMDBBlockDatabase* db, ReorganizationState& reorgState)
 {
@@ -90,14 +503,19 @@ void Blockchain::updateBranchingMaps(
       if (!headerPtr->isInitialized())
          headerPtr = getGenesisBlock();
 
-      while(headerPtr->getThisHash() != reorgState.newTop_->getNextHash())
+      //the height index already reflects the new main chain
+      auto heightIndex = getHeightIndex();
+      auto topHeight = reorgState.newTop_->getBlockHeight();
+      if (topHeight >= heightIndex->size())
+         throw range_error("new top is missing from height index");
+
+      for (auto height = headerPtr->getBlockHeight(); 
+         height <= topHeight; height++)
       {
-         dupIDs.insert(make_pair(
-            headerPtr->getBlockHeight(), headerPtr->getDuplicateID()));
+         auto& header = heightIndex->header(height);
+         dupIDs.insert(make_pair(height, header->getDuplicateID()));
          blockIDs.insert(make_pair(
-            headerPtr->getThisID(), headerPtr->isMainBranch()));
-         
-         headerPtr = getHeaderByHash(headerPtr->getNextHash());
+            header->getThisID(), header->isMainBranch()));
       }
    }
    catch(exception&)
@@ -181,14 +599,13 @@ const shared_ptr<BlockHeader> Blockchain::getHeaderByHeight(
    Passing a dupId for a forked block will throw.
    */
 
-   auto headermap = headersByHeight_.get();
-
-   auto headerIter = headermap->find(index);
-   if (headerIter == headermap->end())
+   auto heightIndex = getHeightIndex();
+   if (index >= heightIndex->size())
       throw std::range_error("Cannot get block at height " + to_string(index));
 
-   if (dupId > 0x7F || headerIter->second->getDuplicateID() == dupId)
-      return (headerIter->second);
+   auto& header = heightIndex->header(index);
+   if (dupId > 0x7F || header->getDuplicateID() == dupId)
+      return header;
 
    //if we get this far, we're looking for a block that isn't on the main chain
    throw std::length_error("Cannot get block at height " + to_string(index) +
@@ -197,7 +614,7 @@ const shared_ptr<BlockHeader> Blockchain::getHeaderByHeight(
 
 bool Blockchain::hasHeaderByHeight(unsigned height) const
 {
-   if (height >= headersByHeight_.size())
+   if (height >= getHeightIndex()->size())
       return false;
 
    return true;
@@ -216,16 +633,14 @@ const shared_ptr<BlockHeader> Blockchain::getHeaderByHash(HashString const & blk
 
 shared_ptr<BlockHeader> Blockchain::getHeaderById(uint32_t id) const
 {
-   auto headermap = headersById_.get();
-
-   auto headerIter = headermap->find(id);
-   if (headerIter == headermap->end())
+   auto idIndex = getIdIndex();
+   if (id >= idIndex->size() || idIndex->header(id) == nullptr)
    {
       LOGERR << "cannot find block for id: " << id;
       throw std::range_error("Cannot find block by id");
    }
 
-   return headerIter->second;
+   return idIndex->header(id);
 }
 
 bool Blockchain::hasHeaderWithHash(BinaryData const & txHash) const
@@ -301,11 +716,11 @@ shared_ptr<BlockHeader> Blockchain::organizeChain(bool forceRebuild, bool verbos
 
    // If this is the first run, the topBlock is the genesis block
    {
-      auto headermap = headersById_.get();
-      auto topblock_iter = headermap->find(topBlockId_);
-      if (topblock_iter != headermap->end())
+      auto idIndex = getIdIndex();
+      if (topBlockId_ < idIndex->size() && 
+         idIndex->header(topBlockId_) != nullptr)
       {
-         atomic_store(&topBlockPtr_, topblock_iter->second);
+         atomic_store(&topBlockPtr_, idIndex->header(topBlockId_));
       }
       else
       {
@@ -342,7 +757,7 @@ shared_ptr<BlockHeader> Blockchain::organizeChain(bool forceRebuild, bool verbos
 
    
    // Walk down the list one more time, set nextHash fields
-   // Also set headersByHeight_;
+   // Also set headersByHeight_, from the branch point up
    map<unsigned, shared_ptr<BlockHeader>> heightMap;
    bool prevChainStillValid = (newTopBlock == prevTopBlock);
    newTopBlock->nextHash_ = BtcUtils::EmptyHash();
@@ -372,7 +787,8 @@ shared_ptr<BlockHeader> Blockchain::organizeChain(bool forceRebuild, bool verbos
    // Last header in the loop didn't get added (the genesis block on first run)
    thisHeaderPtr->isMainBranch_ = true;
    heightMap[thisHeaderPtr->getBlockHeight()] = thisHeaderPtr;
-   headersByHeight_.update(heightMap);
+   atomic_store(&headersByHeight_, getHeightIndex()->update(
+      heightMap, newTopBlock->getBlockHeight() + 1));
 
    topBlockId_ = newTopBlock->getThisID();
    atomic_store(&topBlockPtr_, newTopBlock);
@@ -599,7 +1015,7 @@ set<uint32_t> Blockchain::addBlocksInBulk(
    }
 
    headerMap_.update(toAddMap);
-   headersById_.update(idMap);
+   updateIdIndex(idMap);
    return returnSet;
 }
 
@@ -616,7 +1032,7 @@ void Blockchain::forceAddBlocksInBulk(
       newlyParsedBlocks_.push_back(headerPair.second);
    }
 
-   headersById_.update(idMap);
+   updateIdIndex(idMap);
    headerMap_.update(bhMap);
 }
 
@@ -625,13 +1041,17 @@ map<unsigned, set<unsigned>> Blockchain::mapIDsPerBlockFile(void) const
 {
    unique_lock<mutex> lock(mu_);
 
-   auto headermap = headersById_.get();
+   auto idIndex = getIdIndex();
    map<unsigned, set<unsigned>> resultMap;
 
-   for (auto& header : *headermap)
+   for (size_t i = 0; i < idIndex->size(); i++)
    {
-      auto& result_set = resultMap[header.second->blkFileNum_];
-      result_set.insert(header.second->uniqueID_);
+      auto& header = idIndex->header(i);
+      if (header == nullptr)
+         continue;
+
+      auto& result_set = resultMap[idIndex->fileID(i)];
+      result_set.insert(header->uniqueID_);
    }
 
    return resultMap;
@@ -640,17 +1060,68 @@ map<unsigned, set<unsigned>> Blockchain::mapIDsPerBlockFile(void) const
 /////////////////////////////////////////////////////////////////////////////
 map<unsigned, HeightAndDup> Blockchain::getHeightAndDupMap(void) const
 {
-   auto headermap = headersById_.get();
+   auto idIndex = getIdIndex();
    map<unsigned, HeightAndDup> hd_map;
 
-   for (auto& block_pair : *headermap)
+   for (size_t i = 0; i < idIndex->size(); i++)
    {
-      HeightAndDup hd(block_pair.second->getBlockHeight(), 
-         block_pair.second->getDuplicateID(),
-         block_pair.second->isMainBranch());
+      auto& header = idIndex->header(i);
+      if (header == nullptr)
+         continue;
+
+      HeightAndDup hd(header->getBlockHeight(), 
+         header->getDuplicateID(),
+         header->isMainBranch());
 
-      hd_map.insert(make_pair(block_pair.first, hd));
+      hd_map.insert(make_pair(i, hd));
    }
 
    return hd_map;
 }
+
+/////////////////////////////////////////////////////////////////////////////
+void Blockchain::updateIdIndex(
+   const map<unsigned, shared_ptr<BlockHeader>>& idMap)
+{
+   //mu_ has to be held by the caller
+   if (idMap.size() == 0)
+      return;
+
+   auto idIndex = getIdIndex();
+   size_t newSize = max<size_t>(idIndex->size(), idMap.rbegin()->first + 1);
+   atomic_store(&headersById_, idIndex->update(idMap, newSize));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+unsigned Blockchain::getHeightForTime(uint32_t timestamp) const
+{
+   auto heightIndex = getHeightIndex();
+   if (heightIndex->size() == 0)
+      return 0;
+
+   auto height = heightIndex->lowerBoundTimestamp(timestamp);
+   if (height >= heightIndex->size())
+      return heightIndex->size() - 1;
+
+   return height;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+pair<unsigned, unsigned> Blockchain::getHeightRangeForTimeWindow(
+   uint32_t start, uint32_t end) const
+{
+   auto heightIndex = getHeightIndex();
+   if (heightIndex->size() == 0 || end < start)
+      return make_pair(1, 0);
+
+   //first block at or past start, first block past end
+   auto bottom = heightIndex->lowerBoundTimestamp(start);
+   auto upper = heightIndex->size();
+   if (end != UINT32_MAX)
+      upper = heightIndex->lowerBoundTimestamp(end + 1);
+
+   if (bottom >= upper)
+      return make_pair(1, 0);
+
+   return make_pair(bottom, upper - 1);
+}
@@ -34,6 +34,111 @@ struct HeightAndDup
    {}
 };
 
+////////////////////////////////////////////////////////////////////////////////
+#define HEADER_INDEX_CHUNK_SIZE 2048
+#define MEDIAN_TIME_SPAN 11
+
+#define CHAIN_SNAPSHOT_VERSION 1
+#define CHAIN_SNAPSHOT_HEADER_SIZE 37
+#define CHAIN_SNAPSHOT_ENTRY_SIZE 25
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Immutable dense index of headers by height or by id. Alongside the header
+// pointers, it carries hash, timestamp, difficulty, file id and offset as 
+// contiguous arrays so callers can walk ranges of blocks without touching 
+// the headers themselves.
+//
+// Entries are stored in fixed size chunks. A new version of the index 
+// shares all the chunks it didn't modify with the previous one, so an 
+// update copies O(k + n/HEADER_INDEX_CHUNK_SIZE) entries for k changes.
+// Versions are published by swapping a shared_ptr, readers grab one once
+// and index into it for as long as they need.
+//
+// Indexes ordered by height also carry the median time past of the 
+// MEDIAN_TIME_SPAN entries ending at each entry, clamped to never go 
+// backwards. That array is monotone so time to position lookups are a 
+// binary search. Id indexes leave it zeroed.
+//
+class HeaderIndex
+{
+private:
+   struct Chunk
+   {
+      std::vector<std::shared_ptr<BlockHeader>> headers_;
+      std::vector<uint8_t> hashes_;
+      std::vector<uint32_t> timestamps_;
+      std::vector<uint32_t> medianTimes_;
+      std::vector<double> difficulty_;
+      std::vector<uint32_t> fileIDs_;
+      std::vector<uint64_t> offsets_;
+
+      size_t size(void) const { return headers_.size(); }
+      void resize(size_t);
+      void set(size_t, const std::shared_ptr<BlockHeader>&);
+   };
+
+   std::vector<std::shared_ptr<const Chunk>> chunks_;
+   size_t count_ = 0;
+   uint64_t epoch_ = 0;
+   bool byHeight_ = false;
+
+private:
+   const Chunk& getChunk(size_t i) const
+   {
+      return *chunks_[i / HEADER_INDEX_CHUNK_SIZE];
+   }
+
+   static size_t getSlot(size_t i)
+   {
+      return i % HEADER_INDEX_CHUNK_SIZE;
+   }
+
+public:
+   explicit HeaderIndex(bool byHeight = false) :
+      byHeight_(byHeight)
+   {}
+
+   size_t size(void) const { return count_; }
+   uint64_t epoch(void) const { return epoch_; }
+
+   //no bounds checks, test against size() first. 
+   //id indexes can have gaps, these carry a null header
+   const std::shared_ptr<BlockHeader>& header(size_t i) const
+   { return getChunk(i).headers_[getSlot(i)]; }
+
+   BinaryDataRef hash(size_t i) const
+   { return BinaryDataRef(&getChunk(i).hashes_[getSlot(i) * 32], 32); }
+
+   uint32_t timestamp(size_t i) const
+   { return getChunk(i).timestamps_[getSlot(i)]; }
+
+   double difficulty(size_t i) const
+   { return getChunk(i).difficulty_[getSlot(i)]; }
+
+   uint32_t fileID(size_t i) const
+   { return getChunk(i).fileIDs_[getSlot(i)]; }
+
+   uint64_t offset(size_t i) const
+   { return getChunk(i).offsets_[getSlot(i)]; }
+
+   uint32_t medianTime(size_t i) const
+   { return getChunk(i).medianTimes_[getSlot(i)]; }
+
+   //first entry with a median time at or past timestamp, size() if none
+   size_t lowerBoundMedianTime(uint32_t timestamp) const;
+
+   //first entry with a block timestamp at or past timestamp, size() if 
+   //none. Located off the median time, so out of order timestamps that 
+   //never moved it are skipped.
+   size_t lowerBoundTimestamp(uint32_t timestamp) const;
+
+   //returns the next version: resized to newSize, with entries overwritten
+   std::shared_ptr<const HeaderIndex> update(
+      const std::map<unsigned, std::shared_ptr<BlockHeader>>& entries,
+      size_t newSize) const;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Manages the blockchain, keeping track of all the block headers
@@ -63,6 +168,22 @@ public:
 
    ReorganizationState organize(bool verbose);
    ReorganizationState forceOrganize();
+
+   /*
+   The snapshot is the organized main chain, by height: 
+      version (1) | height count (4) | top hash (32)
+   followed by one fixed size entry per height:
+      id (4) | dup (1) | file id (4) | offset (8) | difficulty sum (8)
+
+   organizeFromSnapshot checks it against the headers loaded from the db 
+   and applies it in place of a full organize, then catches up on headers
+   that are not part of it. It falls back to forceOrganize if the snapshot 
+   is missing, stale or inconsistent. The returned state is relative to the
+   top prior to the call, as with forceOrganize.
+   */
+   BinaryData getChainSnapshot(void) const;
+   ReorganizationState organizeFromSnapshot(
+      BinaryDataRef snapshot, unsigned threadCount);
    ReorganizationState findReorgPointFromBlock(const BinaryData& blkHash);
 
    void updateBranchingMaps(LMDBBlockDatabase*, ReorganizationState&);
@@ -79,7 +200,8 @@ public:
    bool hasHeaderWithHash(BinaryData const & txHash) const;
    const std::shared_ptr<BlockHeader> getHeaderPtrForTxRef(const TxRef &txr) const;
    
-   std::shared_ptr<const std::map<HashString, std::shared_ptr<BlockHeader>>> allHeaders(void) const
+   std::shared_ptr<const ArmoryThreading::PersistentMap<
+      HashString, std::shared_ptr<BlockHeader>>> allHeaders(void) const
    {
       return headerMap_.get();
    }
@@ -92,6 +214,33 @@ public:
    std::map<unsigned, std::set<unsigned>> mapIDsPerBlockFile(void) const;
    std::map<unsigned, HeightAndDup> getHeightAndDupMap(void) const;
 
+   //main chain by height
+   std::shared_ptr<const HeaderIndex> getHeightIndex(void) const
+   {
+      return std::atomic_load(&headersByHeight_);
+   }
+
+   /*
+   Time lookups go by block timestamp, located through the median time past
+   index. Blocks with out of order timestamps are attributed to their 
+   position in the chain.
+   */
+
+   //first main chain height with a timestamp at or past timestamp,
+   //top height if there is none
+   unsigned getHeightForTime(uint32_t timestamp) const;
+
+   //main chain heights with timestamps in [start, end], 
+   //first > second if there are none
+   std::pair<unsigned, unsigned> getHeightRangeForTimeWindow(
+      uint32_t start, uint32_t end) const;
+
+   //all headers by id
+   std::shared_ptr<const HeaderIndex> getIdIndex(void) const
+   {
+      return std::atomic_load(&headersById_);
+   }
+
 private:
    std::shared_ptr<BlockHeader> organizeChain(bool forceRebuild = false, bool verbose = false);
    /////////////////////////////////////////////////////////////////////////////
@@ -100,17 +249,18 @@ private:
    // difficulties and difficultySum values.  Return the difficultySum of 
    // this block.
    double traceChainDown(std::shared_ptr<BlockHeader> bhpStart);
+   void updateIdIndex(
+      const std::map<unsigned, std::shared_ptr<BlockHeader>>&);
+   bool applyChainSnapshot(BinaryDataRef snapshot, unsigned threadCount);
 
 private:
    //TODO: make this whole class thread safe
 
    const BinaryData genesisHash_;
-   ArmoryThreading::TransactionalMap<
+   ArmoryThreading::TransactionalPersistentMap<
       BinaryData, std::shared_ptr<BlockHeader>> headerMap_;
-   ArmoryThreading::TransactionalMap<
-      unsigned, std::shared_ptr<BlockHeader>> headersById_;
-   ArmoryThreading::TransactionalMap<
-      unsigned, std::shared_ptr<BlockHeader>> headersByHeight_;
+   std::shared_ptr<const HeaderIndex> headersById_;
+   std::shared_ptr<const HeaderIndex> headersByHeight_;
 
    std::vector<std::shared_ptr<BlockHeader>> newlyParsedBlocks_;
    std::shared_ptr<BlockHeader> topBlockPtr_;
@@ -9,9 +9,24 @@
 #include "BlockchainScanner.h"
 #include "log.h"
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
 using namespace std;
 using namespace ArmoryThreading;
 
+////////////////////////////////////////////////////////////////////////////////
+static unsigned getMajorFaultCount()
+{
+#ifndef _WIN32
+   struct rusage usage;
+   if (getrusage(RUSAGE_SELF, &usage) == 0)
+      return (unsigned)usage.ru_majflt;
+#endif
+   return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void BlockchainScanner::scan(int32_t scanFrom)
 {
@@ -68,6 +83,7 @@ void BlockchainScanner::scan_nocheck(int32_t scanFrom)
       return;
 
    TIMER_RESTART("scan_nocheck");
+   auto faultsAtStart = getMajorFaultCount();
 
    startAt_ = scanFrom;
    auto topBlock = blockchain_->top();
@@ -76,6 +92,14 @@ void BlockchainScanner::scan_nocheck(int32_t scanFrom)
 
    auto scrRefMap = scrAddrFilter_->getOutScrRefMap();
 
+   scriptFilterKeys_.clear();
+   for (auto& scrPair : *scrRefMap)
+   {
+      scriptFilterKeys_.push_back(BlockFilter::hashScript(
+         scrPair.first.type_, scrPair.first.scriptRef_));
+   }
+   sort(scriptFilterKeys_.begin(), scriptFilterKeys_.end());
+
    //lambdas
    auto commitLambda = [this](void)
    { writeBlockData(); };
@@ -218,6 +242,15 @@ void BlockchainScanner::scan_nocheck(int32_t scanFrom)
    {
       auto timeSpent = TIMER_READ_SEC("scan_nocheck");
       LOGINFO << "scanned transaction history in " << timeSpent << "s";
+
+      auto&& stats = blockDataLoader_.getStats();
+      LOGINFO << "blk files: " << stats.mapCount_ << " mapped, " <<
+         stats.readAheadCount_ << " read ahead, " << 
+         stats.releaseCount_ << " released, peak mapped " <<
+         stats.peakMappedSize_ / (1024 * 1024) << "MB";
+      LOGINFO << "major faults: " << getMajorFaultCount() - faultsAtStart <<
+         ", blk file map and read ahead time: " << 
+         TIMER_READ_SEC("preload") << "s";
    }
 
    auto timeSpent = TIMER_READ_SEC("throttling");
@@ -246,6 +279,7 @@ void BlockchainScanner::processOutputs()
 
       TIMER_START("preload");
 
+      set<uint32_t> newFileIDs;
       auto file_id = batch->startBlockFileID_;
       while (file_id <= batch->targetBlockFileID_)
       {
@@ -259,11 +293,15 @@ void BlockchainScanner::processOutputs()
          {
             batch->fileMaps_.insert(
                make_pair(file_id, blockDataLoader_.get(file_id)));
+            newFileIDs.insert(file_id);
          }
 
          ++file_id;
       }
 
+      //have the kernel page these in while the current batch is parsed
+      blockDataLoader_.readAhead(newFileIDs);
+
       localFileMap = batch->fileMaps_;
 
       TIMER_STOP("preload");
@@ -379,6 +417,23 @@ void BlockchainScanner::processInputs()
             hash_map.second.begin(), hash_map.second.end());
       }
 
+      //blocks left out by the outputs pass are only loaded if their filter
+      //hits one of our utxos
+      if (batch->blockMap_.size() < batch->filters_.size())
+      {
+         auto& utxoKeys = batch->utxoFilterKeys_;
+         for (auto& hash_map : utxoMap_)
+         {
+            for (auto& utxo_pair : hash_map.second)
+            {
+               utxoKeys.push_back(BlockFilter::hashOutpoint(
+                  hash_map.first, utxo_pair.first));
+            }
+         }
+
+         sort(utxoKeys.begin(), utxoKeys.end());
+      }
+
       //start processing threads
       vector<thread> thr_vec;
       for (unsigned i = 1; i < totalThreadCount_; i++)
@@ -414,6 +469,15 @@ void BlockchainScanner::processInputs()
             utxoMap_.erase(hash_iter);
       }
 
+      //files before the target one won't be parsed again, drop their pages.
+      //the target file carries over into the next batch
+      for (auto& file_pair : batch->fileMaps_)
+      {
+         if (file_pair.first >= batch->targetBlockFileID_)
+            break;
+         blockDataLoader_.release(file_pair.first);
+      }
+
       //push for commit
       commitQueue_.push_back(move(batch));
 
@@ -456,6 +520,7 @@ shared_ptr<BlockData> BlockchainScanner::getBlockData(
    };
 
    auto bdata = make_shared<BlockData>();
+   bdata->useArena(BlockData::scannerArena());
    bdata->deserialize(
       filemap->getPtr() + blockheader->getOffset(),
       blockheader->getBlockSize(),
@@ -464,12 +529,47 @@ shared_ptr<BlockData> BlockchainScanner::getBlockData(
    return bdata;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+BlockFilter BlockchainScanner::computeBlockFilter(const BlockData& blockdata)
+{
+   vector<uint64_t> elements;
+   for (auto& txnPtr : blockdata.getTxns())
+   {
+      const BCTX& txn = *(txnPtr.get());
+      for (auto& txout : txn.txouts_)
+      {
+         BinaryRefReader brr(
+            txn.data_ + txout.first, txout.second);
+         brr.advance(8);
+         unsigned scriptSize = (unsigned)brr.get_var_int();
+         auto&& scrRef = BtcUtils::getTxOutScrAddrNoCopy(
+            brr.get_BinaryDataRef(scriptSize));
+
+         elements.push_back(
+            BlockFilter::hashScript(scrRef.type_, scrRef.scriptRef_));
+      }
+
+      if (txn.isCoinbase_)
+         continue;
+
+      for (auto& txin : txn.txins_)
+      {
+         BinaryDataRef outHash(txn.data_ + txin.first, 32);
+         unsigned txOutId = READ_UINT32_LE(txn.data_ + txin.first + 32);
+         elements.push_back(BlockFilter::hashOutpoint(outHash, txOutId));
+      }
+   }
+
+   return BlockFilter::create(elements);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void BlockchainScanner::processOutputsThread(ParserBatch* batch)
 {
    map<unsigned, shared_ptr<BlockData>> blockMap;
    map<BinaryData, map<unsigned, StoredTxOut>> outputMap;
    map<BinaryData, map<BinaryData, StoredSubHistory>> sshMap;
+   map<uint32_t, BlockFilter> newFilters;
 
    while (1)
    {
@@ -479,6 +579,14 @@ void BlockchainScanner::processOutputsThread(ParserBatch* batch)
       if (currentBlock > batch->end_)
          break;
 
+      //skip blocks that don't pay to any of our scripts
+      auto blockId = blockchain_->getHeaderByHeight(
+         currentBlock, 0xFF)->getThisID();
+      auto& filter = batch->filters_[currentBlock - batch->start_];
+      filter = db_->getBlockFilter(blockId);
+      if (filter.isValid() && !filter.matchAny(scriptFilterKeys_))
+         continue;
+
       auto blockdata = getBlockData(batch, currentBlock);
       if (!blockdata->isInitialized())
       {
@@ -488,6 +596,12 @@ void BlockchainScanner::processOutputsThread(ParserBatch* batch)
 
       blockMap.insert(make_pair(currentBlock, blockdata));
 
+      if (!filter.isValid())
+      {
+         filter = computeBlockFilter(*blockdata);
+         newFilters.insert(make_pair(blockId, filter));
+      }
+
       //TODO: flag isMultisig
       const auto header = blockdata->header();
 
@@ -564,6 +678,7 @@ void BlockchainScanner::processOutputsThread(ParserBatch* batch)
 
    batch->blockMap_.insert(blockMap.begin(), blockMap.end());
    batch->outputMap_.insert(outputMap.begin(), outputMap.end());
+   batch->newFilters_.insert(newFilters.begin(), newFilters.end());
 
    for (auto& ssh_pair : sshMap)
    {
@@ -593,14 +708,27 @@ void BlockchainScanner::processInputsThread(ParserBatch* batch)
       if (currentBlock > batch->end_)
          break;
 
+      shared_ptr<BlockData> blockdata;
       auto blockdata_iter = batch->blockMap_.find(currentBlock);
-      if (blockdata_iter == batch->blockMap_.end())
+      if (blockdata_iter != batch->blockMap_.end())
       {
-         LOGERR << "can't find block #" << currentBlock << " in batch";
-         throw runtime_error("missing block");
+         blockdata = blockdata_iter->second;
       }
+      else
+      {
+         auto& filter = batch->filters_[currentBlock - batch->start_];
+         if (!filter.isValid())
+         {
+            LOGERR << "can't find block #" << currentBlock << " in batch";
+            throw runtime_error("missing block");
+         }
 
-      auto blockdata = blockdata_iter->second;
+         //left out by the outputs pass, only load it if it spends our utxos
+         if (!filter.matchAny(batch->utxoFilterKeys_))
+            continue;
+
+         blockdata = getBlockData(batch, currentBlock);
+      }
 
       const auto header = blockdata->header();
       auto& txns = blockdata->getTxns();
@@ -699,12 +827,15 @@ void BlockchainScanner::processInputsThread(ParserBatch* batch)
 ////////////////////////////////////////////////////////////////////////////////
 void BlockchainScanner::writeBlockData()
 {
-   auto getGlobalOffsetForBlock = [&](unsigned height)->size_t
+   auto heightIndex = blockchain_->getHeightIndex();
+   auto getGlobalOffsetForBlock = [&heightIndex](unsigned height)->size_t
    {
-      auto header = blockchain_->getHeaderByHeight(height, 0xFF);
-      size_t val = header->getBlockFileNum();
+      if (height >= heightIndex->size())
+         throw range_error("Cannot get block at height " + to_string(height));
+
+      size_t val = heightIndex->fileID(height);
       val *= 128 * 1024 * 1024;
-      val += header->getOffset();
+      val += heightIndex->offset(height);
       return val;
    };
 
@@ -721,6 +852,12 @@ void BlockchainScanner::writeBlockData()
       [&](ParserBatch* batch_ref)->void
    { processAndCommitTxHints(batch_ref); };
 
+   //dbs that predate versioned subssh values keep writing the legacy 
+   //format until DatabaseBuilder has migrated them
+   auto&& subsshSdbi = db_->getStoredDBInfo(SUBSSH, 0);
+   bool versionedSubssh = 
+      (subsshSdbi.flags_ & SDBI_FLAG_SUBSSH_VERSIONED) != 0;
+
    TIMER_RESET("write");
 
    while (1)
@@ -741,12 +878,8 @@ void BlockchainScanner::writeBlockData()
       thread writeHintsThreadId = 
          thread(writeHintsLambda, batch.get());
 
-      //sanity check
-      if (batch->blockMap_.size() == 0)
-         continue;
-
-      //serialize data
-      auto topheader = batch->blockMap_.rbegin()->second->getHeaderPtr();
+      //filtered blocks are not in the block map, grab the top from the chain
+      auto topheader = blockchain_->getHeaderByHeight(batch->end_, 0xFF);
       if (topheader == nullptr)
       {
          LOGERR << "empty top block header ptr, aborting scan";
@@ -769,7 +902,10 @@ void BlockchainScanner::writeBlockData()
                subsshkey.put_BinaryData(subssh.first);
 
                auto& bw = serializedSubSSH[subsshkey.getDataRef()];
-               subssh.second.serializeDBValue(bw);
+               if (versionedSubssh)
+                  subssh.second.serializeDBValue(bw);
+               else
+                  subssh.second.serializeDBValue_Legacy(bw);
             }
          }
 
@@ -827,6 +963,9 @@ void BlockchainScanner::writeBlockData()
          scrAddrFilter_->putSubSshSDBI(sdbi);
       }
 
+      //block filters
+      db_->putBlockFilters(batch->newFilters_);
+
       //wait on writeHintsThreadId
       if (writeHintsThreadId.joinable())
          writeHintsThreadId.join();
@@ -1423,6 +1562,7 @@ void BlockchainScanner::getFilterHitsThread(
    map<uint32_t, set<TxFilterResults>>& resultMap)
 {
    map<uint32_t, set<TxFilterResults>> localResults;
+   vector<BinaryData> hashVec(hashSet.begin(), hashSet.end());
 
    {
       auto&& tx = db_->beginTransaction(TXFILTERS, LMDB::ReadOnly);
@@ -1437,15 +1577,16 @@ void BlockchainScanner::getFilterHitsThread(
          try
          {
             auto&& pool = db_->getFilterPoolRefForFileNum<TxFilterType>(fileNum);
-            for (auto& hash : hashSet)
+            auto&& hits = pool.compareBatch(hashVec);
+            for (unsigned i = 0; i < hits.size(); i++)
             {
-               auto&& blockKeys = pool.compare(hash);
+               auto& blockKeys = hits[i];
                if (blockKeys.size() > 0)
                {
                   auto& fileNumEntry = localResults[fileNum];
 
                   TxFilterResults filterResult;
-                  filterResult.hash_ = hash;
+                  filterResult.hash_ = hashVec[i];
                   filterResult.filterHits_ = move(blockKeys);
 
                   fileNumEntry.insert(move(filterResult));
@@ -60,6 +60,15 @@ public:
    std::promise<bool> completedPromise_;
    unsigned count_;
 
+   //block filters, by height - start_. Blocks that don't match the 
+   //scanned scripts are left out of blockMap_ by the outputs pass, the 
+   //inputs pass checks them against the utxos instead
+   std::vector<BlockFilter> filters_;
+   std::vector<uint64_t> utxoFilterKeys_;
+
+   //filters computed during this batch, by block id
+   std::map<uint32_t, BlockFilter> newFilters_;
+
 public:
    ParserBatch(unsigned start, unsigned end, 
       unsigned startID, unsigned endID,
@@ -72,6 +81,7 @@ public:
          throw std::runtime_error("end > start");
 
       blockCounter_.store(start_, std::memory_order_relaxed);
+      filters_.resize(end_ - start_ + 1);
    }
 };
 
@@ -113,6 +123,9 @@ private:
 
    unsigned startAt_ = 0;
 
+   //sorted filter hashes of the scanned scripts
+   std::vector<uint64_t> scriptFilterKeys_;
+
    std::mutex resolverMutex_;
 
    ArmoryThreading::BlockingQueue<std::unique_ptr<ParserBatch>> outputQueue_;
@@ -142,6 +155,7 @@ private:
 
    std::shared_ptr<BlockData> getBlockData(
       ParserBatch*, unsigned);
+   static BlockFilter computeBlockFilter(const BlockData&);
 
    void processOutputs(void);
    void processOutputsThread(ParserBatch*);
@@ -161,7 +175,10 @@ public:
       totalThreadCount_(threadcount), writeQueueDepth_(queue_depth),
       totalBlockFileCount_(bf.fileCount()),
       progress_(prg), reportProgress_(reportProgress)
-   {}
+   {
+      //room for the batches in flight plus the one being read ahead
+      blockDataLoader_.setMappedCap((queue_depth + 2) * BATCH_SIZE);
+   }
 
    void scan(int32_t startHeight);
    void scan_nocheck(int32_t startHeight);
@@ -141,6 +141,17 @@ void BlockchainScanner_Super::scan()
          //post for txout parsing
          processOutputs(batch.get());
          processInputs(batch.get());
+
+         //done parsing, drop the pages of all files but the last one, the
+         //next batch picks up from there
+         auto& fileMaps = batch->bdb_->fileMaps_;
+         if (fileMaps.size() > 1)
+         {
+            auto lastIter = prev(fileMaps.end());
+            for (auto iter = fileMaps.begin(); iter != lastIter; ++iter)
+               iter->second->release();
+         }
+
          serializeSubSsh(move(batch));
 
          if (_count > 
@@ -735,12 +746,15 @@ void BlockchainScanner_Super::writeSubSsh(ParserBatch_Ssh* batch)
 ////////////////////////////////////////////////////////////////////////////////
 void BlockchainScanner_Super::commitSshBatch()
 {
-   auto getGlobalOffsetForBlock = [&](unsigned height)->size_t
+   auto heightIndex = blockchain_->getHeightIndex();
+   auto getGlobalOffsetForBlock = [&heightIndex](unsigned height)->size_t
    {
-      auto header = blockchain_->getHeaderByHeight(height, 0xFF);
-      size_t val = header->getBlockFileNum();
+      if (height >= heightIndex->size())
+         throw range_error("Cannot get block at height " + to_string(height));
+
+      size_t val = heightIndex->fileID(height);
       val *= 128 * 1024 * 1024;
-      val += header->getOffset();
+      val += heightIndex->offset(height);
       return val;
    };
 
@@ -1373,8 +1387,12 @@ void BlockDataBatch::populateFileMap()
 
    for(auto& id : blockDataFileIDs_)
    {
-      fileMaps_.insert(
-         make_pair(id, blockDataLoader_->get(id)));
+      auto fileMap = blockDataLoader_->get(id);
+
+      //get the kernel started on paging in the batch before the parser 
+      //threads fault through it
+      fileMap->readAhead();
+      fileMaps_.insert(make_pair(id, fileMap));
    }
 
    auto begin = min(start_, end_);
@@ -1436,6 +1454,7 @@ shared_ptr<BlockData> BlockDataBatch::getBlockData(unsigned height)
    }
 
    auto bdata = make_shared<BlockData>();
+   bdata->useArena(BlockData::scannerArena());
    bdata->deserialize(
       filemap->getPtr() + blockheader->getOffset(),
       blockheader->getBlockSize(),
@@ -26,6 +26,11 @@ using namespace std;
 void BtcWallet::removeAddressBulk(vector<BinaryDataRef> const & scrAddrBulk)
 {
    scrAddrMap_.erase(scrAddrBulk);
+
+   unique_lock<mutex> lock(balancesMutex_);
+   totalsDirty_ = true;
+   lock.unlock();
+
    needsRefresh(true);
 }
 
@@ -41,8 +46,11 @@ void BtcWallet::clearBlkData(void)
 {
    auto addrMap = scrAddrMap_.get();
 
-   for (auto saPair : *addrMap)
-   { saPair.second->clearBlkData(); }
+   {
+      unique_lock<mutex> lock(balancesMutex_);
+      for (auto saPair : *addrMap)
+      { saPair.second->clearBlkData(); }
+   }
 
    histPages_.reset();
 }
@@ -50,6 +58,12 @@ void BtcWallet::clearBlkData(void)
 ////////////////////////////////////////////////////////////////////////////////
 uint64_t BtcWallet::getSpendableBalance(uint32_t currBlk) const
 {
+   {
+      unique_lock<mutex> lock(balancesMutex_);
+      if (currBlk == balancesHeight_)
+         return spendableBalance_;
+   }
+
    auto addrMap = scrAddrMap_.get();
 
    uint64_t balance = 0;
@@ -62,6 +76,12 @@ uint64_t BtcWallet::getSpendableBalance(uint32_t currBlk) const
 ////////////////////////////////////////////////////////////////////////////////
 uint64_t BtcWallet::getUnconfirmedBalance(uint32_t currBlk) const
 {
+   {
+      unique_lock<mutex> lock(balancesMutex_);
+      if (currBlk == balancesHeight_)
+         return unconfirmedBalance_;
+   }
+
    auto addrMap = scrAddrMap_.get();
 
    uint64_t balance = 0;
@@ -74,6 +94,7 @@ uint64_t BtcWallet::getUnconfirmedBalance(uint32_t currBlk) const
 ////////////////////////////////////////////////////////////////////////////////
 uint64_t BtcWallet::getFullBalance() const
 {
+   unique_lock<mutex> lock(balancesMutex_);
    return balance_;
 }
 
@@ -101,7 +122,16 @@ map<BinaryData, uint32_t> BtcWallet::getAddrTxnCounts(int32_t updateID) const
       if (sa.second->updateID_ <= lastPulledCountsID_)
          continue;
 
-      auto count = sa.second->getTxioCountForLedgers();
+      uint64_t count = UINT32_MAX;
+      {
+         unique_lock<mutex> lock(balancesMutex_);
+         if (sa.second->getBalancesHeight() != UINT32_MAX)
+            count = sa.second->getBalances().txioCount_;
+      }
+
+      if (count == UINT32_MAX)
+         count = sa.second->getTxioCountForLedgers();
+
       if (count == 0 || count == UINT32_MAX)
          continue;
 
@@ -125,9 +155,26 @@ map<BinaryData, tuple<uint64_t, uint64_t, uint64_t>>
       if (sa.second->updateID_ <= lastPulledBalancesID_)
          continue;
 
-      auto full = sa.second->getFullBalance(UINT32_MAX);
-      auto spendable = sa.second->getSpendableBalance(blockHeight);
-      auto unconf = sa.second->getUnconfirmedBalance(blockHeight, confTarget_);
+      uint64_t full, spendable, unconf;
+      bool cached = false;
+      {
+         unique_lock<mutex> lock(balancesMutex_);
+         if (sa.second->getBalancesHeight() == blockHeight)
+         {
+            auto& balances = sa.second->getBalances();
+            full = balances.full_;
+            spendable = balances.spendable_;
+            unconf = balances.unconfirmed_;
+            cached = true;
+         }
+      }
+
+      if (!cached)
+      {
+         full = sa.second->getFullBalance(UINT32_MAX);
+         spendable = sa.second->getSpendableBalance(blockHeight);
+         unconf = sa.second->getUnconfirmedBalance(blockHeight, confTarget_);
+      }
 
       if (lastPulledBalancesID_ <= 0)
       {
@@ -143,6 +190,61 @@ map<BinaryData, tuple<uint64_t, uint64_t, uint64_t>>
    return balanceMap;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void BtcWallet::updateBalances(int32_t updateID, bool newBlock, bool force)
+{
+   /***
+   Without a new block, only the addresses that saw zc changes can have 
+   moved. Otherwise each address checks its ssh summary and only reloads 
+   its history if it was touched. The wallet totals are adjusted by the 
+   delta of every address that changed.
+   ***/
+
+   auto addrMap = scrAddrMap_.get();
+   auto height = bdvPtr_->blockchain().top()->getBlockHeight();
+
+   //setConfTarget runs this from the client request threads
+   unique_lock<mutex> lock(balancesMutex_);
+   for (auto& saPair : *addrMap)
+   {
+      auto& scrAddrObj = saPair.second;
+      if (!newBlock && !force && !scrAddrObj->hasZcChanges())
+         continue;
+
+      auto prevBalances = scrAddrObj->getBalances();
+      if (!scrAddrObj->updateBalances(height, confTarget_, force))
+         continue;
+
+      //unsigned deltas wrap around, the sums stay exact
+      auto& balances = scrAddrObj->getBalances();
+      balance_ += balances.full_ - prevBalances.full_;
+      spendableBalance_ += balances.spendable_ - prevBalances.spendable_;
+      unconfirmedBalance_ += 
+         balances.unconfirmed_ - prevBalances.unconfirmed_;
+      txioCount_ += balances.txioCount_ - prevBalances.txioCount_;
+
+      scrAddrObj->updateID_ = updateID;
+   }
+
+   if (totalsDirty_)
+   {
+      //addresses were removed, rebuild the totals from what's left
+      balance_ = spendableBalance_ = unconfirmedBalance_ = txioCount_ = 0;
+      for (auto& saPair : *addrMap)
+      {
+         auto& balances = saPair.second->getBalances();
+         balance_ += balances.full_;
+         spendableBalance_ += balances.spendable_;
+         unconfirmedBalance_ += balances.unconfirmed_;
+         txioCount_ += balances.txioCount_;
+      }
+
+      totalsDirty_ = false;
+   }
+
+   balancesHeight_ = height;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void BtcWallet::prepareTxOutHistory(uint64_t val)
 {
@@ -444,6 +546,8 @@ map<BinaryData, TxIOPair> BtcWallet::scanWalletZeroConf(
    auto addrMap = scrAddrMap_.get();
    validZcKeys_.clear();
 
+   //scanZC flags the addresses with zc changes for updateBalances
+   unique_lock<mutex> lock(balancesMutex_);
    for (auto& saPair : *addrMap)
    {
       auto&& saResult = saPair.second->scanZC(
@@ -467,7 +571,7 @@ bool BtcWallet::scanWallet(ScanWalletStruct& scanInfo, int32_t updateID)
    {
       //new top block         
       auto&& tx = bdvPtr_->getDB()->beginTransaction(SSH, LMDB::ReadOnly);
-      balance_ = getFullBalanceFromDB(updateID);
+      updateBalances(updateID, true, scanInfo.reorg_);
    }
   
    if (scanInfo.saStruct_.zcMap_.size() != 0 ||
@@ -496,7 +600,7 @@ bool BtcWallet::scanWallet(ScanWalletStruct& scanInfo, int32_t updateID)
             }
          }
 
-         balance_ = getFullBalanceFromDB(updateID);
+         updateBalances(updateID, false, false);
          updateID_ = updateID;
 
          //return false because no new block was parsed
@@ -720,8 +824,8 @@ ScrAddrObj& BtcWallet::getScrAddrObjRef(const BinaryData& key)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-shared_ptr<const map<BinaryData, LedgerEntry>> BtcWallet::getHistoryPage(
-   uint32_t pageId)
+shared_ptr<const ArmoryThreading::PersistentMap<BinaryData, LedgerEntry>>
+   BtcWallet::getHistoryPage(uint32_t pageId)
 {
    if (!bdvPtr_->isBDMRunning())
       return nullptr;
@@ -774,6 +878,12 @@ void BtcWallet::needsRefresh(bool refresh)
 ////////////////////////////////////////////////////////////////////////////////
 uint64_t BtcWallet::getWltTotalTxnCount(void) const
 {
+   {
+      unique_lock<mutex> lock(balancesMutex_);
+      if (balancesHeight_ != UINT32_MAX)
+         return txioCount_;
+   }
+
    uint64_t ntxn = 0;
 
    auto addrMap = scrAddrMap_.get();
@@ -788,8 +898,22 @@ uint64_t BtcWallet::getWltTotalTxnCount(void) const
 void BtcWallet::setConfTarget(unsigned confTarget, const string& hash)
 {
    if(confTarget != confTarget_)
+   {
       confTarget_ = confTarget;
 
+      //unconfirmed balances depend on the target, rebuild them and have 
+      //the next pull resend all addresses
+      unique_lock<mutex> lock(balancesMutex_);
+      auto hasBalances = (balancesHeight_ != UINT32_MAX);
+      lock.unlock();
+
+      if (hasBalances)
+      {
+         updateBalances(updateID_, true, true);
+         resetCounters();
+      }
+   }
+
    if (hash.size() != 0)
    {
       auto&& hashBd = BinaryData::fromString(hash);
@@ -805,4 +929,7 @@ void BtcWallet::unregisterAddresses(const std::set<BinaryDataRef>& addrSet)
 
    scrAddrMap_.erase(bdRefVec);
    histPages_.reset();
+
+   unique_lock<mutex> lock(balancesMutex_);
+   totalsDirty_ = true;
 }
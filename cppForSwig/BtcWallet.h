@@ -98,7 +98,8 @@ public:
    void setWalletID(const std::string &wltId) { walletID_ = wltId; }
    const std::string& walletID() const { return walletID_; }
 
-   std::shared_ptr<const std::map<BinaryData, LedgerEntry>> getHistoryPage(uint32_t);
+   std::shared_ptr<const ArmoryThreading::PersistentMap<
+      BinaryData, LedgerEntry>> getHistoryPage(uint32_t);
    std::vector<LedgerEntry> getHistoryPageAsVector(uint32_t);
    size_t getHistoryPageCount(void) const { return histPages_.getPageCount(); }
 
@@ -149,6 +150,9 @@ private:
    void resetTxOutHistory(void);
    void resetCounters(void);
 
+   //applies per address balance deltas to the wallet totals
+   void updateBalances(int32_t updateID, bool newBlock, bool force);
+
 private:
 
    BlockDataViewer* const        bdvPtr_;
@@ -164,7 +168,15 @@ private:
    //wallet id
    std::string walletID_;
 
+   //wallet totals, maintained as the sum of the per address balances. The
+   //mutex guards these and the balance members of the ScrAddrObj
+   mutable std::mutex            balancesMutex_;
    uint64_t                      balance_ = 0;
+   uint64_t                      spendableBalance_ = 0;
+   uint64_t                      unconfirmedBalance_ = 0;
+   uint64_t                      txioCount_ = 0;
+   uint32_t                      balancesHeight_ = UINT32_MAX;
+   bool                          totalsDirty_ = false;
 
    //set to true to add wallet paged history to global ledgers 
    bool                          uiFilter_ = true;
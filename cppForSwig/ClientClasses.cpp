@@ -278,6 +278,28 @@ bool RemoteCallback::processNotifications(
          break;
       }
 
+      case NotificationType::history_chunk:
+      {
+         //one history page from a stream, ledgers may be empty on the 
+         //last chunk
+         BdmNotification bdmNotif(BDMAction_HistoryChunk);
+         if (notif.has_ledgers())
+         {
+            auto& ledgers = notif.ledgers();
+            for (int y = 0; y < ledgers.values_size(); y++)
+            {
+               auto le = make_shared<LedgerEntry>(callback, i, y);
+               bdmNotif.ledgers_.push_back(le);
+            }
+         }
+
+         bdmNotif.requestID_ = notif.requestid();
+         bdmNotif.lastChunk_ = notif.lastchunk();
+         run(move(bdmNotif));
+
+         break;
+      }
+
       case NotificationType::invalidated_zc:
       {
 
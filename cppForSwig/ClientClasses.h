@@ -234,6 +234,7 @@ struct BdmNotification
    BDV_Error_Struct error_;
 
    std::string requestID_;
+   bool lastChunk_ = false;
 
    BdmNotification(BDMAction action) :
       action_(action)
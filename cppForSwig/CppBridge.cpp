@@ -44,6 +44,9 @@ int main(int argc, char* argv[])
    STARTLOGGING(bdmConfig.logFilePath_, LogLvlDebug);
    LOGENABLESTDOUT();
 
+   //signed tx evaluation checks the inputs of large txs in parallel
+   TransactionVerifier::setThreadCount(bdmConfig.sigCheckThreadCount_);
+
    //setup the bridge
    auto bridge = make_shared<CppBridge>(
       bdmConfig.dataDir_,
@@ -1053,6 +1056,10 @@ void CppBridge::setupDB()
       bdvPtr_->setCheckServerKeyPromptLambda(
          [](const BinaryData&, const string&)->bool{return true;});
 
+      //the bridge ships with the db it talks to, take large replies as
+      //single frames
+      bdvPtr_->enableLargeFrames();
+
       //set bdvPtr in wallet manager
       wltManager_->setBdvPtr(bdvPtr_);
 
@@ -40,7 +40,9 @@ enum DB_PREFIX
    DB_PREFIX_POOL,
    DB_PREFIX_MISSING_HASHES,
    DB_PREFIX_SUBSSH,
-   DB_PREFIX_TEMPSCRIPT
+   DB_PREFIX_TEMPSCRIPT,
+   DB_PREFIX_CHAINSNAPSHOT,
+   DB_PREFIX_BLOCKFILTER
 };
 
 struct FileMap
@@ -146,6 +148,7 @@ public:
 
    static BinaryData getFilterPoolKey(uint32_t filenum);
    static BinaryData getMissingHashesKey(uint32_t id);
+   static BinaryData getBlockFilterKey(uint32_t blockId);
 
    static bool fileExists(const std::string& path, int mode);
 
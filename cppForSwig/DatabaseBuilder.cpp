@@ -15,6 +15,9 @@
 
 using namespace std;
 
+atomic<size_t> DatabaseBuilder::checkChainCacheSize_(
+   CHECKCHAIN_UTXO_CACHE_SIZE);
+
 /////////////////////////////////////////////////////////////////////////////
 void dumpBlock(
    LMDBBlockDatabase* db,
@@ -89,8 +92,17 @@ void DatabaseBuilder::init()
       progress_(BDMPhase_OrganizingChain, 0, UINT32_MAX, 0);
 
    LOGINFO << "organizing chain";
-   auto&& initialReorgState = blockchain_->forceOrganize();
+   TIMER_START("organizechain");
+   auto&& chainSnapshot = db_->getChainSnapshot();
+   auto&& initialReorgState = blockchain_->organizeFromSnapshot(
+      chainSnapshot, bdmConfig_.threadCount_);
+   TIMER_STOP("organizechain");
+   LOGINFO << "organized chain in " << 
+      TIMER_READ_SEC("organizechain") << "s";
    LOGINFO << "updating branches";
+
+   //the valid dup and branch maps start empty, this still walks the whole 
+   //main chain from genesis, snapshot or not
    blockchain_->updateBranchingMaps(db_, initialReorgState);
 
    try
@@ -124,6 +136,10 @@ void DatabaseBuilder::init()
    double updatetime = TIMER_READ_SEC("updateblocksindb");
    LOGINFO << "updated HEADERS db in " << updatetime << "s";
 
+   //the chain is now in sync with the block files, snapshot it for the 
+   //next startup
+   db_->putChainSnapshot(blockchain_->getChainSnapshot());
+
    cycleDatabases();
 
    int scanFrom = -1;
@@ -132,6 +148,7 @@ void DatabaseBuilder::init()
    if (BlockDataManagerConfig::getDbType() != ARMORY_DB_SUPER)
    {
       verifyTxFilters();
+      upgradeSubHistories();
 
       //blockchain object now has the longest chain, update address history
       //retrieve all tracked addresses from DB
@@ -282,7 +299,7 @@ BlockOffset DatabaseBuilder::loadBlockHeadersFromDB(
          calc.fractionCompleted(), calc.remainingSeconds(), counter);
    };
 
-   db_->readAllHeaders(callback);
+   db_->readAllHeaders(callback, bdmConfig_.threadCount_);
    LOGINFO << "grabbed all headers in db";
    blockchain_->addBlocksInBulk(headerMap, false);
 
@@ -1022,263 +1039,756 @@ void DatabaseBuilder::commitAllStxos(
 }
 
 /////////////////////////////////////////////////////////////////////////////
-void DatabaseBuilder::verifyTransactions()
+struct ChainCheckTx
 {
-   struct ParserState
+   std::shared_ptr<BCTX> tx_;
+   TransactionVerifier::utxoMap utxos_;
+   unsigned height_;
+   unsigned txIndex_;
+
+   //some outpoints missed the utxo cache, resolve them from the blk files
+   bool pending_ = false;
+   bool unresolved_ = false;
+
+   //resolving threw, already counted as an unknown error
+   bool failed_ = false;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+struct ChainCheckBatch
+{
+   const unsigned start_;
+   const unsigned end_;
+
+   map<unsigned, shared_ptr<BlockDataFileMap>> fileMaps_;
+   vector<shared_ptr<BlockHeader>> headers_;
+
+   //by height - start_
+   vector<BlockData> blocks_;
+
+   //all txs but coinbases, in chain order
+   vector<ChainCheckTx> txs_;
+
+   promise<bool> completedPromise_;
+
+   ChainCheckBatch(unsigned start, unsigned end) :
+      start_(start), end_(end)
    {
-      atomic<unsigned> blockHeight_;
-      atomic<unsigned> unknownErrors_;
-      atomic<unsigned> unsupportedSigHash_;
-      atomic<unsigned> unresolvedHashes_;
-      atomic<unsigned> parsedCount_;
-      mutex mu_;
+      if (end < start)
+         throw runtime_error("end > start");
 
-      ParserState() 
-      {
-         blockHeight_.store(0);
-         unknownErrors_.store(0);
-         unsupportedSigHash_.store(0);
-         unresolvedHashes_.store(0);
-         parsedCount_.store(0);
-      }
-   };
+      blocks_.resize(end - start + 1);
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+struct ChainCheckState
+{
+   /***
+   Chain verification runs batches of blocks through 4 stages, each on its
+   own thread, so that all 4 work on consecutive batches at once:
+
+    - read: maps the blk files of the batch and reads them ahead
+    - parse: deserializes the blocks and hashes their txs across threads
+    - resolve: walks the batch in chain order, pulling spent outputs from 
+      an lru of unspent outputs and feeding it those of every tx it goes 
+      by. Outpoints older than the cache reaches are resolved from tx 
+      hints and the blk files, across threads.
+    - verify: checks tx scripts across threads, reports progress
+   ***/
+
+   ArmoryThreading::BlockingQueue<unique_ptr<ChainCheckBatch>> parseQueue_;
+   ArmoryThreading::BlockingQueue<unique_ptr<ChainCheckBatch>> resolveQueue_;
+   ArmoryThreading::BlockingQueue<unique_ptr<ChainCheckBatch>> verifyQueue_;
+
+   //36 bytes outpoint to raw txout, a 0 budget disables it
+   ArmoryThreading::ShardedLruCache<BinaryData, BinaryData, BinaryDataHash> 
+      utxoCache_;
+   const bool useCache_;
+
+   //last height out of each stage
+   atomic<unsigned> readHeight_;
+   atomic<unsigned> parsedHeight_;
+   atomic<unsigned> resolvedHeight_;
+
+   atomic<uint64_t> blkFileOutputs_;
+   atomic<unsigned> unknownErrors_;
+   atomic<unsigned> unsupportedSigHash_;
+   atomic<unsigned> unresolvedHashes_;
+   atomic<unsigned> parsedCount_;
+   atomic<unsigned> failedCount_;
+   vector<pair<unsigned, unsigned>> failedTxs_;
+   mutex mu_;
+
+   ChainCheckState(size_t cacheSize) :
+      utxoCache_(cacheSize, 16, 
+         [](const BinaryData& key, const BinaryData& val)->size_t
+         {
+            //rough per entry overhead of the shard list and map nodes
+            return key.getSize() + val.getSize() + 128;
+         }),
+      useCache_(cacheSize > 0)
+   {
+      readHeight_.store(0);
+      parsedHeight_.store(0);
+      resolvedHeight_.store(0);
+
+      blkFileOutputs_.store(0);
+      unknownErrors_.store(0);
+      unsupportedSigHash_.store(0);
+      unresolvedHashes_.store(0);
+      parsedCount_.store(0);
+      failedCount_.store(0);
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+static bool runCheckStage(ChainCheckBatch& batch, ChainCheckState& state,
+   const string& stage, const function<void(void)>& lbd)
+{
+   /*
+   A batch that fails a stage is counted as an unknown error and dropped
+   from the pipeline. Its promise is set so that the read stage doesn't
+   wait on it.
+   */
+
+   try
+   {
+      lbd();
+      return true;
+   }
+   catch (exception& e)
+   {
+      unique_lock<mutex> lock(state.mu_);
+      LOGERR << "+++ " << stage << " failed for blocks #" << 
+         batch.start_ << " to #" << batch.end_;
+      LOGERR << "+++ strerr: " << e.what();
+   }
+   catch (...)
+   {
+      unique_lock<mutex> lock(state.mu_);
+      LOGERR << "+++ " << stage << " failed for blocks #" << 
+         batch.start_ << " to #" << batch.end_;
+   }
+
+   state.unknownErrors_.fetch_add(1, memory_order_relaxed);
+   batch.completedPromise_.set_value(false);
+   return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void DatabaseBuilder::setCheckChainCacheSize(size_t cacheSize)
+{
+   checkChainCacheSize_.store(cacheSize, memory_order_relaxed);
+}
 
-   TIMER_START("10blocks");
+/////////////////////////////////////////////////////////////////////////////
+void DatabaseBuilder::verifyTransactions()
+{
+   ChainCheckState state(checkChainCacheSize_.load(memory_order_relaxed));
+   auto topHeight = blockchain_->top()->getBlockHeight();
+   ProgressCalculator calc(topHeight + 1);
 
-   //dont preload, prefetch
+   //dont preload, read ahead each batch and cap what stays mapped
    BlockDataLoader bdl(blockFiles_.folderPath());
+   bdl.setMappedCap((CHECKCHAIN_QUEUE_DEPTH + 2) * CHECKCHAIN_BATCH_SIZE);
 
-   auto stateStruct = make_shared<ParserState>();
+   TIMER_RESET("checkchain_read");
+   TIMER_RESET("checkchain_parse");
+   TIMER_RESET("checkchain_resolve");
+   TIMER_RESET("checkchain_verify");
+   TIMER_START("checkchain_batch");
 
-   auto verifyBlockTx = [&bdl, this, stateStruct](void)->void
+   auto parseLbd = [this, &state](void)->void
    {
-      map<unsigned, shared_ptr<BlockDataFileMap>> filePtrMap;
+      while (true)
+      {
+         unique_ptr<ChainCheckBatch> batch;
+         try
+         {
+            batch = move(state.parseQueue_.pop_front());
+         }
+         catch (ArmoryThreading::StopBlockingLoop&)
+         {
+            break;
+         }
+
+         TIMER_START("checkchain_parse");
+         auto parsed = runCheckStage(*batch, state, "parse", [&](void)->void
+         {
+            parseCheckBatch(*batch, state);
+         });
+         TIMER_STOP("checkchain_parse");
+
+         if (!parsed)
+            continue;
 
-      auto getFileMap = [&bdl, &filePtrMap](unsigned fileNum)->
-         shared_ptr<BlockDataFileMap>
+         state.parsedHeight_.store(batch->end_, memory_order_relaxed);
+         state.resolveQueue_.push_back(move(batch));
+      }
+
+      state.resolveQueue_.completed();
+   };
+
+   auto resolveLbd = [this, &state](void)->void
+   {
+      while (true)
       {
-         auto& fmp = filePtrMap[fileNum];
-         if (fmp == nullptr)
-            fmp = bdl.get(fileNum);
+         unique_ptr<ChainCheckBatch> batch;
+         try
+         {
+            batch = move(state.resolveQueue_.pop_front());
+         }
+         catch (ArmoryThreading::StopBlockingLoop&)
+         {
+            break;
+         }
 
-         return fmp;
-      };
+         TIMER_START("checkchain_resolve");
+         auto resolved = runCheckStage(*batch, state, "resolve", [&](void)->void
+         {
+            resolveCheckBatch(*batch, state);
+         });
+         TIMER_STOP("checkchain_resolve");
+
+         if (!resolved)
+            continue;
+
+         state.resolvedHeight_.store(batch->end_, memory_order_relaxed);
+         state.verifyQueue_.push_back(move(batch));
+      }
+
+      state.verifyQueue_.completed();
+   };
 
-      auto getUtxoMap = [&bdl, stateStruct, getFileMap, this]
-         (shared_ptr<BCTX> txn)->TransactionVerifier::utxoMap
+   auto verifyLbd = [this, &state, &calc](void)->void
+   {
+      while (true)
       {
-         TransactionVerifier::utxoMap utxomap;
-         for (auto& txin : txn->txins_)
+         unique_ptr<ChainCheckBatch> batch;
+         try
+         {
+            batch = move(state.verifyQueue_.pop_front());
+         }
+         catch (ArmoryThreading::StopBlockingLoop&)
+         {
+            break;
+         }
+
+         TIMER_START("checkchain_verify");
+         auto verified = runCheckStage(*batch, state, "verify", [&](void)->void
+         {
+            verifyCheckBatch(*batch, state);
+         });
+         TIMER_STOP("checkchain_verify");
+
+         if (!verified)
+            continue;
+
+         //report
+         try
          {
-            //get output hash
-            BinaryDataRef hashref(txn->data_ + txin.first, 32);
-            auto outputID = (uint32_t*)(txn->data_ + txin.first + 32);
+            unique_lock<mutex> lock(state.mu_);
+            auto tE = TIMER_READ_SEC("checkchain_batch");
+            TIMER_RESTART("checkchain_batch");
+
+            LOGINFO << "=== verified blocks #" << batch->start_ << 
+               " to #" << batch->end_ << " in " << tE << "s ===";
+
+            LOGINFO << "--- read: up to #" <<
+               state.readHeight_.load(memory_order_relaxed) << ", " <<
+               TIMER_READ_SEC("checkchain_read") << "s";
+
+            LOGINFO << "--- parsed: up to #" <<
+               state.parsedHeight_.load(memory_order_relaxed) << ", " <<
+               TIMER_READ_SEC("checkchain_parse") << "s";
+
+            LOGINFO << "--- resolved: up to #" <<
+               state.resolvedHeight_.load(memory_order_relaxed) << ", " <<
+               TIMER_READ_SEC("checkchain_resolve") << "s, " <<
+               state.utxoCache_.hits() << " utxo cache hits, " <<
+               state.blkFileOutputs_.load(memory_order_relaxed) << 
+               " from blk files, " << state.utxoCache_.size() << 
+               " cached utxos";
+
+            LOGINFO << "--- verified " << 
+               state.parsedCount_.load(memory_order_relaxed) << 
+               " transactions, " << 
+               state.failedCount_.load(memory_order_relaxed) << " failed, " <<
+               TIMER_READ_SEC("checkchain_verify") << "s";
+
+            LOGINFO << "--- *encountered " <<
+               state.unsupportedSigHash_.load(memory_order_relaxed) <<
+               " unknown sighashes";
+
+            LOGINFO << "--- *encountered " <<
+               state.unresolvedHashes_.load(memory_order_relaxed) <<
+               " unresolved hashes";
 
-            //resolve hash
-            StoredTxHints sths;
-            if (!db_->getStoredTxHints(sths, hashref.getSliceRef(0, 4)))
+            LOGINFO << "--- ***encountered " <<
+               state.unknownErrors_.load(memory_order_relaxed) <<
+               " unknown errors";
+
+            if (bdmConfig_.reportProgress_)
             {
-               stateStruct->unresolvedHashes_.fetch_add(1, memory_order_relaxed);
-               throw UnresolvedHashException();
+               calc.advance(batch->end_ + 1);
+               progress_(BDMPhase_BlockData,
+                  calc.fractionCompleted(), calc.remainingSeconds(), 
+                  batch->end_);
             }
+         }
+         catch (exception& e)
+         {
+            LOGERR << "+++ failed to report progress: " << e.what();
+         }
 
-            bool foundtx = false;
-            for (auto& outpointkey : sths.dbKeyList_)
-            {
-               if (outpointkey.getSize() == 0)
-                  continue;
+         //let the reader move on, file maps are released with the batch
+         batch->completedPromise_.set_value(true);
+      }
+   };
 
-               //parse key
-               auto blockkey = outpointkey.getSliceRef(0, 4);
-               auto opDup = (uint8_t*)(outpointkey.getPtr() + 3);
-               if (*opDup != 0xFF)
-                  continue;
+   auto parseThr = thread(parseLbd);
+   auto resolveThr = thread(resolveLbd);
+   auto verifyThr = thread(verifyLbd);
 
-               auto blockID = DBUtils::hgtxToHeight(blockkey);
-               shared_ptr<BlockHeader> bhPtr;
-               try
-               {
-                  bhPtr = blockchain_->getHeaderById(blockID);
-               }
-               catch (exception&)
-               {
-                  continue;
-               }
+   //read stage
+   exception_ptr readError = nullptr;
+   try
+   {
+      vector<future<bool>> completedFutures;
+      unsigned height = 0;
+      while (height <= topHeight)
+      {
+         //keep at most queue depth batches in flight
+         if (completedFutures.size() >= CHECKCHAIN_QUEUE_DEPTH)
+         {
+            completedFutures[
+               completedFutures.size() - CHECKCHAIN_QUEUE_DEPTH].wait();
+         }
 
-               //get tx index
-               BinaryRefReader brr(outpointkey);
-               brr.advance(4);
-               auto txid = brr.get_uint16_t(BE);
+         TIMER_START("checkchain_read");
 
-               //get block data
-               auto blockFileNum = bhPtr->getBlockFileNum();
-               auto fileMap = getFileMap(blockFileNum);
+         //grab blocks up to the batch size
+         vector<shared_ptr<BlockHeader>> headers;
+         size_t batchSize = 0;
+         while (height <= topHeight && batchSize < CHECKCHAIN_BATCH_SIZE)
+         {
+            auto header = blockchain_->getHeaderByHeight(height++, 0xFF);
+            batchSize += header->getBlockSize();
+            headers.push_back(header);
+         }
 
-               auto getID = [bhPtr](const BinaryData&)->unsigned int
-               {
-                  return bhPtr->getThisID();
-               };
+         auto batch = make_unique<ChainCheckBatch>(
+            headers.front()->getBlockHeight(), 
+            headers.back()->getBlockHeight());
+         batch->headers_ = move(headers);
 
-               BlockData bdata;
-               bdata.deserialize(
-                  fileMap->getPtr() + bhPtr->getOffset(),
-                  bhPtr->getBlockSize(),
-                  bhPtr, getID, false, false);
+         //map the batch's files, have the kernel page them in
+         set<uint32_t> fileIDs;
+         for (auto& header : batch->headers_)
+         {
+            auto fileNum = header->getBlockFileNum();
+            if (batch->fileMaps_.find(fileNum) != batch->fileMaps_.end())
+               continue;
 
-               auto& txns = bdata.getTxns();
-               if (txid > txns.size())
-                  continue;
+            batch->fileMaps_.insert(make_pair(fileNum, bdl.get(fileNum)));
+            fileIDs.insert(fileNum);
+         }
+         bdl.readAhead(fileIDs);
 
-               //check hash
-               auto _txn = txns[txid];
-               const auto& txhash = _txn->getHash();
-               if (hashref != txhash.getRef())
-                  continue;
+         TIMER_STOP("checkchain_read");
 
-               //grab output
-               auto txoutcount = _txn->txouts_.size();
-               if (*outputID > txoutcount)
-                  break;
+         completedFutures.push_back(batch->completedPromise_.get_future());
+         state.readHeight_.store(batch->end_, memory_order_relaxed);
+         state.parseQueue_.push_back(move(batch));
+      }
+   }
+   catch (...)
+   {
+      readError = current_exception();
+   }
 
-               BinaryDataRef output(_txn->data_ + _txn->txouts_[*outputID].first,
-                  _txn->txouts_[*outputID].second);
+   //drain the pipeline
+   state.parseQueue_.completed();
 
-               UTXO utxo;
-               utxo.unserializeRaw(output);
-               auto& idmap = utxomap[hashref];
-               idmap[*outputID] = move(utxo);
+   if (parseThr.joinable())
+      parseThr.join();
 
-               foundtx = true;
-               break;
-            }
+   if (resolveThr.joinable())
+      resolveThr.join();
 
-            if (!foundtx)
-               throw UnresolvedHashException();
-         }
+   if (verifyThr.joinable())
+      verifyThr.join();
 
-         return utxomap;
-      };
+   if (readError != nullptr)
+      rethrow_exception(readError);
 
-      unsigned thisHeight = 0;
-      unsigned failedVerifications = 0;
+   checkStats_.checked_ = state.parsedCount_.load(memory_order_relaxed);
+   checkStats_.failed_ = state.failedCount_.load(memory_order_relaxed);
+   checkStats_.cacheHits_ = state.utxoCache_.hits();
+   checkStats_.blkFileOutputs_ = 
+      state.blkFileOutputs_.load(memory_order_relaxed);
+   checkStats_.failedTxs_ = move(state.failedTxs_);
+   sort(checkStats_.failedTxs_.begin(), checkStats_.failedTxs_.end());
 
-      auto&& hintdbtx = db_->beginTransaction(TXHINTS, LMDB::ReadOnly);
+   if (checkStats_.failed_ > 0)
+      throw runtime_error("checkChain failed with script errors");
 
-      while (thisHeight < blockchain_->top()->getBlockHeight())
-      {
-         //grab blockheight
-         thisHeight = stateStruct->blockHeight_.fetch_add(1, memory_order_relaxed);
 
-         BlockData bdata;
-         shared_ptr<BlockHeader> blockheader;
+   if (state.unresolvedHashes_.load(memory_order_relaxed) > 0)
+      throw runtime_error("checkChain failed with unresolved hash errors");
+
+   if (state.unsupportedSigHash_.load(memory_order_relaxed) > 0)
+      throw runtime_error("checkChain failed with unsupported sig hash errors");
+
+   if (state.unknownErrors_.load(memory_order_relaxed) > 0)
+      throw runtime_error("checkChain failed with unknown errors");
+
+   LOGINFO << "Done checking chain";
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void DatabaseBuilder::parseCheckBatch(
+   ChainCheckBatch& batch, ChainCheckState& state)
+{
+   atomic<unsigned> counter(0);
 
-         blockheader = blockchain_->getHeaderByHeight(thisHeight, 0xFF);
+   auto parseLbd = [&batch, &state, &counter](void)->void
+   {
+      while (true)
+      {
+         auto blockId = counter.fetch_add(1, memory_order_relaxed);
+         if (blockId >= batch.blocks_.size())
+            return;
 
-         auto fileMap = getFileMap(blockheader->getBlockFileNum());
+         auto& header = batch.headers_[blockId];
+         auto& fileMap = batch.fileMaps_[header->getBlockFileNum()];
 
-         auto getID = [blockheader](const BinaryData&)->unsigned int
+         auto getID = [header](const BinaryData&)->unsigned int
          {
-            return blockheader->getThisID();
+            return header->getThisID();
          };
 
-         bdata.deserialize(
-            fileMap->getPtr() + blockheader->getOffset(),
-            blockheader->getBlockSize(),
-            blockheader, getID, false, false);
-
-         auto& txns = bdata.getTxns();
-         for (unsigned i = 1; i < txns.size(); i++)
+         try
          {
-            auto& txn = txns[i];
+            if (fileMap->getPtr() == nullptr ||
+               header->getOffset() + header->getBlockSize() > fileMap->size())
+               throw runtime_error("block is out of its blk file bounds");
+
+            auto& bdata = batch.blocks_[blockId];
+            bdata.deserialize(
+               fileMap->getPtr() + header->getOffset(),
+               header->getBlockSize(),
+               header, getID, false, false);
+
+            //hash txs here rather than in the serial resolve pass
+            for (auto& txn : bdata.getTxns())
+               txn->getHash();
+         }
+         catch (exception& e)
+         {
+            unique_lock<mutex> lock(state.mu_);
+            LOGERR << "+++ error at #" << batch.start_ + blockId;
+            LOGERR << "+++ strerr: " << e.what();
+            state.unknownErrors_.fetch_add(1, memory_order_relaxed);
+         }
+      }
+   };
 
-            try
-            {
-               //gather utxos
-               auto&& utxomap = getUtxoMap(txn);
+   vector<thread> thrVec;
+   for (unsigned i = 1; i < bdmConfig_.threadCount_; i++)
+      thrVec.push_back(thread(parseLbd));
+   parseLbd();
 
-               //verify tx
-               TransactionVerifier txV(*txn, utxomap);
-               auto flags = txV.getFlags();
+   for (auto& thr : thrVec)
+   {
+      if (thr.joinable())
+         thr.join();
+   }
+}
 
-               if (blockheader->getTimestamp() > P2SH_TIMESTAMP)
-                  flags |= SCRIPT_VERIFY_P2SH;
+/////////////////////////////////////////////////////////////////////////////
+void DatabaseBuilder::resolveCheckBatch(
+   ChainCheckBatch& batch, ChainCheckState& state)
+{
+   auto& utxoCache = state.utxoCache_;
 
-               if (txn->usesWitness_)
-                  flags |= SCRIPT_VERIFY_SEGWIT;
+   //chain order pass, spends come out of the cache, new outputs go in
+   for (unsigned i = 0; i < batch.blocks_.size(); i++)
+   {
+      auto& bdata = batch.blocks_[i];
+      if (!bdata.isInitialized())
+         continue;
 
-               txV.setFlags(flags);
+      auto& txns = bdata.getTxns();
+      for (unsigned y = 0; y < txns.size(); y++)
+      {
+         auto& txn = txns[y];
 
-               if (txV.verify())
-                  stateStruct->parsedCount_.fetch_add(1, memory_order_relaxed);
-               else
-                  ++failedVerifications;
-            }
-            catch (UnsupportedSigHashTypeException&)
+         //skip coinbase inputs
+         if (y > 0)
+         {
+            ChainCheckTx checkTx;
+            checkTx.tx_ = txn;
+            checkTx.height_ = batch.start_ + i;
+            checkTx.txIndex_ = y;
+
+            for (auto& txin : txn->txins_)
             {
-               stateStruct->unsupportedSigHash_.fetch_add(1, memory_order_relaxed);
+               BinaryData outpoint(txn->data_ + txin.first, 36);
+               BinaryData rawOutput;
+               if (!state.useCache_ || !utxoCache.get(outpoint, rawOutput))
+               {
+                  checkTx.pending_ = true;
+                  continue;
+               }
+
+               utxoCache.erase(outpoint);
+
+               UTXO utxo;
+               utxo.unserializeRaw(rawOutput);
+               auto& idMap = checkTx.utxos_[outpoint.getSliceRef(0, 32)];
+               idMap[*(uint32_t*)(outpoint.getPtr() + 32)] = move(utxo);
             }
-            catch (UnresolvedHashException&)
+
+            batch.txs_.push_back(move(checkTx));
+         }
+
+         if (!state.useCache_)
+            continue;
+
+         auto& txHash = txn->getHash();
+         for (unsigned z = 0; z < txn->txouts_.size(); z++)
+         {
+            BinaryWriter bwKey(36);
+            bwKey.put_BinaryData(txHash);
+            bwKey.put_uint32_t(z);
+            utxoCache.put(bwKey.getData(), BinaryData(txn->getTxOutRef(z)));
+         }
+      }
+   }
+
+   //cache misses are resolved from the blk files
+   atomic<unsigned> counter(0);
+   auto resolveLbd = [this, &batch, &state, &counter](void)->void
+   {
+      auto&& hintdbtx = db_->beginTransaction(TXHINTS, LMDB::ReadOnly);
+
+      while (true)
+      {
+         auto txId = counter.fetch_add(1, memory_order_relaxed);
+         if (txId >= batch.txs_.size())
+            return;
+
+         auto& checkTx = batch.txs_[txId];
+         if (!checkTx.pending_)
+            continue;
+
+         auto& txn = checkTx.tx_;
+         for (auto& txin : txn->txins_)
+         {
+            BinaryDataRef hashRef(txn->data_ + txin.first, 32);
+            auto outputId = *(uint32_t*)(txn->data_ + txin.first + 32);
+
+            auto hashIter = checkTx.utxos_.find(hashRef);
+            if (hashIter != checkTx.utxos_.end() &&
+               hashIter->second.find(outputId) != hashIter->second.end())
+               continue;
+
+            try
             {
-               stateStruct->unresolvedHashes_.fetch_add(1, memory_order_relaxed);
+               auto&& rawOutput = getRawOutputFromBlocks(hashRef, outputId);
+               if (rawOutput.getSize() == 0)
+               {
+                  checkTx.unresolved_ = true;
+                  break;
+               }
+
+               UTXO utxo;
+               utxo.unserializeRaw(rawOutput);
+               checkTx.utxos_[hashRef][outputId] = move(utxo);
+               state.blkFileOutputs_.fetch_add(1, memory_order_relaxed);
             }
             catch (exception& e)
             {
-               unique_lock<mutex> lock(stateStruct->mu_);
-               LOGERR << "+++ error at #" << thisHeight << ":" << i;
+               unique_lock<mutex> lock(state.mu_);
+               LOGERR << "+++ error at #" << checkTx.height_ << ":" << 
+                  checkTx.txIndex_;
                LOGERR << "+++ strerr: " << e.what();
-               stateStruct->unknownErrors_.fetch_add(1, memory_order_relaxed);
+               state.unknownErrors_.fetch_add(1, memory_order_relaxed);
+               checkTx.failed_ = true;
+               break;
             }
          }
+      }
+   };
 
-         if (thisHeight % 1000 == 0)
-         {
-            unique_lock<mutex> lock(stateStruct->mu_);
-            auto tE = TIMER_READ_SEC("10blocks");
-            TIMER_RESTART("10blocks");
+   vector<thread> thrVec;
+   for (unsigned i = 1; i < bdmConfig_.threadCount_; i++)
+      thrVec.push_back(thread(resolveLbd));
+   resolveLbd();
 
-            LOGINFO << "=== time elapsed: " << tE << " ===";
+   for (auto& thr : thrVec)
+   {
+      if (thr.joinable())
+         thr.join();
+   }
+}
 
-            LOGINFO << "current block: " << thisHeight;
-            LOGINFO << "--- verified " << 
-               stateStruct->parsedCount_.load(memory_order_relaxed) << " transactions";
+/////////////////////////////////////////////////////////////////////////////
+BinaryData DatabaseBuilder::getRawOutputFromBlocks(
+   BinaryDataRef txHash, unsigned outputId) const
+{
+   //resolve hash
+   StoredTxHints sths;
+   if (!db_->getStoredTxHints(sths, txHash.getSliceRef(0, 4)))
+      return BinaryData();
 
-            LOGINFO << "--- *encountered " <<
-               stateStruct->unsupportedSigHash_.load(memory_order_relaxed) <<
-               " unknown sighashes";
+   auto& cache = BlockDataCache::instance();
+   for (auto& outpointkey : sths.dbKeyList_)
+   {
+      if (outpointkey.getSize() != 6)
+         continue;
 
-            LOGINFO << "--- *encountered " <<
-               stateStruct->unresolvedHashes_.load(memory_order_relaxed) <<
-               " unresolved hashes";
+      //hint keys carry block ids with a 0xFF dup
+      auto blockkey = outpointkey.getSliceRef(0, 4);
+      auto opDup = (uint8_t*)(outpointkey.getPtr() + 3);
+      if (*opDup != 0xFF)
+         continue;
 
-            LOGINFO << "--- ***encountered " <<
-               stateStruct->unknownErrors_.load(memory_order_relaxed) <<
-               " unknown errors";
-         }
+      auto blockID = DBUtils::hgtxToHeight(blockkey);
+      shared_ptr<BlockHeader> bhPtr;
+      try
+      {
+         bhPtr = blockchain_->getHeaderById(blockID);
+      }
+      catch (exception&)
+      {
+         continue;
       }
-   };
 
-   vector<thread> parserThrVec;
-   for (unsigned i = 1; i < bdmConfig_.threadCount_; i++)
-      parserThrVec.push_back(thread(verifyBlockTx));
+      //get tx index
+      BinaryRefReader brr(outpointkey);
+      brr.advance(4);
+      auto txid = brr.get_uint16_t(BE);
+
+      //slice the tx out of its block, siblings aren't parsed
+      auto&& filename = BtcUtils::getBlkFilename(
+         blockFiles_.folderPath(), bhPtr->getBlockFileNum());
+      auto fileMap = cache.getFileMap(filename);
+      if (fileMap->getPtr() == nullptr ||
+         bhPtr->getOffset() + bhPtr->getBlockSize() > fileMap->size())
+         continue;
+
+      auto blockPtr = fileMap->getPtr() + bhPtr->getOffset();
+      auto txOffsets = cache.getTxOffsets(
+         bhPtr->getThisHash(), blockPtr, bhPtr->getBlockSize());
+      if (txid >= txOffsets->size())
+         continue;
+
+      //check hash
+      auto& txOffset = (*txOffsets)[txid];
+      auto txn = BCTX::parse(blockPtr + txOffset.first, txOffset.second);
+      if (txn->getHash().getRef() != txHash)
+         continue;
+
+      //grab output
+      if (outputId >= txn->txouts_.size())
+         break;
 
-   verifyBlockTx();
+      return BinaryData(txn->getTxOutRef(outputId));
+   }
 
-   checkedTransactions_ = stateStruct->parsedCount_.load(memory_order_relaxed);
+   return BinaryData();
+}
 
-   for (auto& thr : parserThrVec)
-      if (thr.joinable())
-         thr.join();
+/////////////////////////////////////////////////////////////////////////////
+void DatabaseBuilder::verifyCheckBatch(
+   ChainCheckBatch& batch, ChainCheckState& state)
+{
+   atomic<unsigned> counter(0);
 
-   if (stateStruct->unresolvedHashes_.load(memory_order_relaxed) > 0)
-      throw runtime_error("checkChain failed with unresolved hash errors");
+   auto verifyLbd = [this, &batch, &state, &counter](void)->void
+   {
+      while (true)
+      {
+         auto txId = counter.fetch_add(1, memory_order_relaxed);
+         if (txId >= batch.txs_.size())
+            return;
 
-   if (stateStruct->unsupportedSigHash_.load(memory_order_relaxed) > 0)
-      throw runtime_error("checkChain failed with unsupported sig hash errors");
+         auto& checkTx = batch.txs_[txId];
+         if (checkTx.failed_)
+            continue;
 
-   if (stateStruct->unknownErrors_.load(memory_order_relaxed) > 0)
-      throw runtime_error("checkChain failed with unknown errors");
+         if (checkTx.unresolved_)
+         {
+            state.unresolvedHashes_.fetch_add(1, memory_order_relaxed);
+            continue;
+         }
 
-   LOGINFO << "Done checking chain";
+         auto& blockheader = batch.headers_[checkTx.height_ - batch.start_];
+         auto& txn = checkTx.tx_;
+
+         try
+         {
+            //verify tx, txs are already spread across this stage's threads,
+            //the inputs of large ones go to the shared sig check pool so a
+            //single big tx doesn't hold up the batch
+            TransactionVerifier txV(*txn, checkTx.utxos_);
+            txV.setInputThreadCount(bdmConfig_.sigCheckThreadCount_);
+            auto flags = txV.getFlags();
+
+            if (blockheader->getTimestamp() > P2SH_TIMESTAMP)
+               flags |= SCRIPT_VERIFY_P2SH;
+
+            if (txn->usesWitness_)
+               flags |= SCRIPT_VERIFY_SEGWIT;
+
+            txV.setFlags(flags);
+
+            if (txV.verify())
+            {
+               state.parsedCount_.fetch_add(1, memory_order_relaxed);
+            }
+            else
+            {
+               unique_lock<mutex> lock(state.mu_);
+               LOGERR << "+++ script check failed at #" << 
+                  checkTx.height_ << ":" << checkTx.txIndex_;
+               state.failedTxs_.push_back(
+                  make_pair(checkTx.height_, checkTx.txIndex_));
+               state.failedCount_.fetch_add(1, memory_order_relaxed);
+            }
+         }
+         catch (UnsupportedSigHashTypeException&)
+         {
+            state.unsupportedSigHash_.fetch_add(1, memory_order_relaxed);
+         }
+         catch (UnresolvedHashException&)
+         {
+            state.unresolvedHashes_.fetch_add(1, memory_order_relaxed);
+         }
+         catch (exception& e)
+         {
+            unique_lock<mutex> lock(state.mu_);
+            LOGERR << "+++ error at #" << checkTx.height_ << ":" << 
+               checkTx.txIndex_;
+            LOGERR << "+++ strerr: " << e.what();
+            state.unknownErrors_.fetch_add(1, memory_order_relaxed);
+         }
+      }
+   };
+
+   vector<thread> thrVec;
+   for (unsigned i = 1; i < bdmConfig_.threadCount_; i++)
+      thrVec.push_back(thread(verifyLbd));
+   verifyLbd();
+
+   for (auto& thr : thrVec)
+   {
+      if (thr.joinable())
+         thr.join();
+   }
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -1293,6 +1803,8 @@ void DatabaseBuilder::verifyTxFilters()
    fileCounter.store(0, memory_order_relaxed);
 
    set<unsigned> damagedFilters;
+   set<unsigned> outdatedFilters;
+   mutex resultMutex;
 
    auto&& file_id_map = blockchain_->mapIDsPerBlockFile();
 
@@ -1301,6 +1813,7 @@ void DatabaseBuilder::verifyTxFilters()
       auto&& tx = db_->beginTransaction(TXFILTERS, LMDB::ReadOnly);
 
       set<unsigned> mismatchedFilters;
+      set<unsigned> legacyFilters;
 
       while (1)
       {
@@ -1316,11 +1829,13 @@ void DatabaseBuilder::verifyTxFilters()
                continue;
             }
 
-            if (mismatchedFilters.size() > 0)
+            if (mismatchedFilters.size() > 0 || legacyFilters.size() > 0)
             {
-               unique_lock<mutex>(resultMutex);
+               unique_lock<mutex> lock(resultMutex);
                damagedFilters.insert(
                   mismatchedFilters.begin(), mismatchedFilters.end());
+               outdatedFilters.insert(
+                  legacyFilters.begin(), legacyFilters.end());
             }
 
             return;
@@ -1331,13 +1846,13 @@ void DatabaseBuilder::verifyTxFilters()
          try
          {
             auto&& pool = db_->getFilterPoolRefForFileNum<TxFilterType>(fileNum);
-            auto&& filters = pool.getFilterPoolPtr();
+            auto&& blockKeys = pool.getBlockKeys();
 
             auto match_count = 0;
-            for (auto& filter : filters)
+            for (auto& blockKey : blockKeys)
             {
                //check filter blockid is for this block file
-               auto id_iter = idset.find(filter.getBlockKey());
+               auto id_iter = idset.find(blockKey);
                if (id_iter != idset.end())
                   ++match_count;
             }
@@ -1349,6 +1864,10 @@ void DatabaseBuilder::verifyTxFilters()
                mismatchedFilters.insert(fileNum);
                LOGWARN << mismatchCount << " mismatches in txfilter for file #" << fileNum;
             }
+            else if (pool.getVersion() != TXFILTER_POOL_VERSION)
+            {
+               legacyFilters.insert(fileNum);
+            }
          }
          catch (runtime_error&)
          {
@@ -1367,6 +1886,12 @@ void DatabaseBuilder::verifyTxFilters()
       if (thr.joinable())
          thr.join();
    
+   if (outdatedFilters.size() > 0)
+   {
+      LOGINFO << "upgrading " << outdatedFilters.size() << " txfilters";
+      upgradeTxFilters(outdatedFilters);
+   }
+
    if (damagedFilters.size() == 0)
    {
       LOGINFO << "done checking txfilters";
@@ -1377,6 +1902,124 @@ void DatabaseBuilder::verifyTxFilters()
    repairTxFilters(damagedFilters);
 }
 
+/////////////////////////////////////////////////////////////////////////////
+void DatabaseBuilder::upgradeTxFilters(const set<unsigned>& oldFilters)
+{
+   //legacy pools carry all the hash prefixes, no need to hit the blk files,
+   //deser the old entry and write it back in the current format
+   set<unsigned> badFilters;
+
+   for (auto& fileID : oldFilters)
+   {
+      auto&& pool = db_->getFilterPoolForFileNum<TxFilterType>(fileID);
+      if (!pool.isValid())
+      {
+         badFilters.insert(fileID);
+         continue;
+      }
+
+      db_->putFilterPoolForFileNum(fileID, pool);
+   }
+
+   if (badFilters.size() == 0)
+      return;
+
+   LOGWARN << badFilters.size() << " txfilters failed to upgrade, repairing";
+   repairTxFilters(badFilters);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void DatabaseBuilder::upgradeSubHistories()
+{
+   //lite dbs created before versioned subssh values carry legacy entries,
+   //rewrite them in place. Converted entries are skipped, so an interrupted
+   //upgrade picks up where it left off on the next run
+   auto&& sdbi = db_->getStoredDBInfo(SUBSSH, 0);
+   if (sdbi.flags_ & SDBI_FLAG_SUBSSH_VERSIONED)
+      return;
+
+   LOGINFO << "upgrading subssh entries";
+   unsigned upgradeCount = 0;
+   BinaryData lastKey;
+
+   while (1)
+   {
+      map<BinaryData, BinaryWriter> upgraded;
+      bool done = true;
+
+      {
+         auto&& tx = db_->beginTransaction(SUBSSH, LMDB::ReadOnly);
+         auto dbIter = db_->getIterator(SUBSSH);
+
+         bool valid;
+         if (lastKey.getSize() == 0)
+         {
+            valid = dbIter->seekToStartsWith(DB_PREFIX_SCRIPT);
+         }
+         else
+         {
+            valid = dbIter->seekTo(lastKey.getRef());
+            if (valid && dbIter->getKeyRef() == lastKey.getRef())
+               valid = dbIter->advanceAndRead(DB_PREFIX_SCRIPT);
+         }
+
+         while (valid)
+         {
+            auto keyRef = dbIter->getKeyRef();
+            if (keyRef.getSize() == 0 || keyRef.getPtr()[0] != DB_PREFIX_SCRIPT)
+               break;
+
+            auto valRef = dbIter->getValueRef();
+            if (valRef.getSize() > 0 && 
+               valRef.getPtr()[0] == SUBSSH_VALUE_MARKER)
+            {
+               valid = dbIter->advanceAndRead(DB_PREFIX_SCRIPT);
+               continue;
+            }
+
+            StoredSubHistory subssh;
+            subssh.unserializeDBKey(keyRef);
+            subssh.unserializeDBValue(valRef);
+            subssh.serializeDBValue(upgraded[keyRef]);
+
+            if (upgraded.size() >= SUBSSH_UPGRADE_BATCH_SIZE)
+            {
+               lastKey = keyRef;
+               done = false;
+               break;
+            }
+
+            valid = dbIter->advanceAndRead(DB_PREFIX_SCRIPT);
+         }
+      }
+
+      if (upgraded.size() > 0)
+      {
+         auto&& tx = db_->beginTransaction(SUBSSH, LMDB::ReadWrite);
+         for (auto& subssh : upgraded)
+         {
+            db_->putValue(SUBSSH, 
+               subssh.first.getRef(), subssh.second.getDataRef());
+         }
+
+         upgradeCount += upgraded.size();
+      }
+
+      if (done)
+         break;
+   }
+
+   //flag the db, scans write versioned entries from now on
+   {
+      auto&& tx = db_->beginTransaction(SUBSSH, LMDB::ReadWrite);
+      auto&& sdbiRW = db_->getStoredDBInfo(SUBSSH, 0);
+      sdbiRW.flags_ |= SDBI_FLAG_SUBSSH_VERSIONED;
+      db_->putStoredDBInfo(SUBSSH, sdbiRW, 0);
+   }
+
+   LOGINFO << "upgraded " << upgradeCount << " subssh entries";
+}
+
 /////////////////////////////////////////////////////////////////////////////
 void DatabaseBuilder::repairTxFilters(const set<unsigned>& badFilters)
 {   
@@ -15,8 +15,32 @@ class BlockDataManager;
 class ScrAddrFilter;
 class UnresolvedHashException {};
 
+//chain check pipeline: block data per batch, batches in flight and the
+//byte budget of the unspent output lru fed by recent blocks
+#define CHECKCHAIN_BATCH_SIZE       1024 * 1024 * 128ULL
+#define CHECKCHAIN_QUEUE_DEPTH      3
+#define CHECKCHAIN_UTXO_CACHE_SIZE  1024 * 1024 * 1024ULL
+
+//subssh entries rewritten per transaction when migrating legacy values
+#define SUBSSH_UPGRADE_BATCH_SIZE   100000
+
+struct ChainCheckBatch;
+struct ChainCheckState;
+
 typedef std::function<void(BDMPhase, double, unsigned, unsigned)> ProgressCallback;
 
+////////////////////////////////////////////////////////////////////////////////
+struct ChainCheckStats
+{
+   unsigned checked_ = 0;
+   unsigned failed_ = 0;
+   uint64_t cacheHits_ = 0;
+   uint64_t blkFileOutputs_ = 0;
+
+   //height and tx index of the txs that failed script checks
+   std::vector<std::pair<unsigned, unsigned>> failedTxs_;
+};
+
 /////////////////////////////////////////////////////////////////////////////
 class DatabaseBuilder
 {
@@ -30,9 +54,13 @@ private:
    BlockOffset topBlockOffset_;
    const BlockDataManagerConfig bdmConfig_;
 
-   unsigned checkedTransactions_ = 0;
+   ChainCheckStats checkStats_;
    const bool forceRescanSSH_;
 
+   //utxo lru budget of chain checks, CHECKCHAIN_UTXO_CACHE_SIZE by default,
+   //0 resolves all outpoints from the blk files
+   static std::atomic<size_t> checkChainCacheSize_;
+
 private:
    BlockOffset loadBlockHeadersFromDB(const ProgressCallback &progress);
    
@@ -54,13 +82,20 @@ private:
       unsigned fileID);
 
    void verifyTransactions(void);
+   void parseCheckBatch(ChainCheckBatch&, ChainCheckState&);
+   void resolveCheckBatch(ChainCheckBatch&, ChainCheckState&);
+   void verifyCheckBatch(ChainCheckBatch&, ChainCheckState&);
+   BinaryData getRawOutputFromBlocks(BinaryDataRef txHash, unsigned id) const;
+
    void commitAllTxHints(
       const std::map<uint32_t, BlockData>&, const std::set<unsigned>&);
    void commitAllStxos(
       const std::map<uint32_t, BlockData>&, const std::set<unsigned>&);
 
    void repairTxFilters(const std::set<unsigned>&);
+   void upgradeTxFilters(const std::set<unsigned>&);
    void reprocessTxFilter(std::shared_ptr<BlockDataFileMap>, unsigned);
+   void upgradeSubHistories(void);
 
    void cycleDatabases(void);
 
@@ -72,7 +107,10 @@ public:
    Blockchain::ReorganizationState update(void);
 
    void verifyChain(void);
-   unsigned getCheckedTxCount(void) const { return checkedTransactions_; }
+   unsigned getCheckedTxCount(void) const { return checkStats_.checked_; }
+   const ChainCheckStats& getCheckChainStats(void) const 
+   { return checkStats_; }
+   static void setCheckChainCacheSize(size_t);
 
    void verifyTxFilters(void);
 };
@@ -6,6 +6,9 @@
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <thread>
+#include <mutex>
+
 #include "ReentrantLock.h"
 #include "DerivationScheme.h"
 #include "DecryptedDataContainer.h"
@@ -18,6 +21,8 @@
 
 using namespace std;
 
+atomic<unsigned> DerivationScheme_BIP32::extendThreadCount_(0);
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 //// DerivationScheme
@@ -419,47 +424,116 @@ shared_ptr<AssetEntry_Single>
    DerivationScheme_BIP32::computeNextPublicEntry(
    const SecureBinaryData& pubKey,
    const BinaryData& accountID, unsigned index)
+{
+   BIP32_Node node;
+   node.initFromPublicKey(depth_, leafId_, 0, pubKey, chainCode_);
+   return computeNextPublicEntry_FromNode(node, accountID, index);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+shared_ptr<AssetEntry_Single>
+   DerivationScheme_BIP32::computeNextPublicEntry_FromNode(
+   const BIP32_Node& parent, const BinaryData& accountID, unsigned index)
 {
    //derScheme only allows for soft derivation
    if (index > 0x7FFFFFFF)
       throw DerivationSchemeException("illegal: hard derivation");
 
-   BIP32_Node node;
-   node.initFromPublicKey(depth_, leafId_, 0, pubKey, chainCode_);
-   node.derivePublic(index);
-
-   auto nextPubKey = node.movePublicKey();
+   auto&& nextPubKey = parent.derivePublicChildKey(index);
    return make_shared<AssetEntry_Single>(
       index, accountID,
       nextPubKey, nullptr);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void DerivationScheme_BIP32::setExtendThreadCount(unsigned count)
+{
+   extendThreadCount_.store(count, memory_order_relaxed);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 vector<shared_ptr<AssetEntry>> DerivationScheme_BIP32::extendPublicChain(
    shared_ptr<AssetEntry> rootAsset,
    unsigned start, unsigned end)
 {      
    auto rootSingle = dynamic_pointer_cast<AssetEntry_Single>(rootAsset);
+   if (rootSingle == nullptr)
+      throw DerivationSchemeException("invalid root asset object");
 
-   auto nextAsset = [this, rootSingle](
-      unsigned derivationIndex)->shared_ptr<AssetEntry>
+   if (end < start)
+      return vector<shared_ptr<AssetEntry>>();
+
+   //every index derives from the same parent, set it up once
+   BIP32_Node parent;
+   parent.initFromPublicKey(depth_, leafId_, 0, 
+      rootSingle->getPubKey()->getCompressedKey(), chainCode_);
+   auto& accountID = rootSingle->getAccountID();
+
+   /*
+   BIP32 children are independent of one another, large extensions are
+   split across threads. Each thread also hashes the pubkeys it derives,
+   so that address instantiation further down the line finds the hash160
+   ready.
+   */
+   vector<shared_ptr<AssetEntry>> assetVec(end - start + 1);
+   atomic<unsigned> counter(0);
+   exception_ptr eptr = nullptr;
+   mutex eptrMutex;
+
+   auto deriveLbd = [&](void)->void
    {
-      //get pubkey
-      auto pubkey = rootSingle->getPubKey();
-      auto& pubkeyData = pubkey->getCompressedKey();
+      try
+      {
+         while (true)
+         {
+            auto offset = counter.fetch_add(1, memory_order_relaxed);
+            if (offset >= assetVec.size())
+               return;
 
-      return computeNextPublicEntry(pubkeyData,
-         rootSingle->getAccountID(), derivationIndex);
+            auto asset = computeNextPublicEntry_FromNode(
+               parent, accountID, start + offset);
+
+            auto pubkey = asset->getPubKey();
+            auto&& hash1 = BtcUtils::getHash160(pubkey->getCompressedKey());
+            auto&& hash2 = BtcUtils::getHash160(pubkey->getCompressedKey());
+            if (hash1 != hash2)
+               throw DerivationSchemeException("failed to hash pubkey");
+            pubkey->compressedHash160_ = move(hash1);
+
+            assetVec[offset] = asset;
+         }
+      }
+      catch (...)
+      {
+         unique_lock<mutex> lock(eptrMutex);
+         if (eptr == nullptr)
+            eptr = current_exception();
+
+         //stop the other workers early
+         counter.store(assetVec.size(), memory_order_relaxed);
+      }
    };
 
-   vector<shared_ptr<AssetEntry>> assetVec;
+   auto threadCount = extendThreadCount_.load(memory_order_relaxed);
+   if (threadCount == 0)
+      threadCount = thread::hardware_concurrency();
+   threadCount = min<size_t>(threadCount, 
+      assetVec.size() / DERIVATION_BATCH_MIN_PER_THREAD);
 
-   for (unsigned i = start; i <= end; i++)
+   vector<thread> threads;
+   for (unsigned i = 1; i < threadCount; i++)
+      threads.push_back(thread(deriveLbd));
+   deriveLbd();
+
+   for (auto& thr : threads)
    {
-      auto newAsset = nextAsset(i);
-      assetVec.push_back(newAsset);
+      if (thr.joinable())
+         thr.join();
    }
 
+   if (eptr != nullptr)
+      rethrow_exception(eptr);
+
    return assetVec;
 }
 
@@ -531,16 +605,24 @@ std::shared_ptr<AssetEntry_Single>
 DerivationScheme_BIP32_Salted::computeNextPublicEntry(
    const SecureBinaryData& pubKey,
    const BinaryData& full_id, unsigned index)
+{
+   BIP32_Node node;
+   node.initFromPublicKey(getDepth(), getLeafId(), 0, pubKey, getChaincode());
+   return computeNextPublicEntry_FromNode(node, full_id, index);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<AssetEntry_Single> 
+DerivationScheme_BIP32_Salted::computeNextPublicEntry_FromNode(
+   const BIP32_Node& parent,
+   const BinaryData& full_id, unsigned index)
 {
    //derScheme only allows for soft derivation
    if (index > 0x7FFFFFFF)
       throw DerivationSchemeException("illegal: hard derivation");
 
    //compute pub key
-   BIP32_Node node;
-   node.initFromPublicKey(getDepth(), getLeafId(), 0, pubKey, getChaincode());
-   node.derivePublic(index);
-   auto nextPubkey = node.movePublicKey();
+   auto&& nextPubkey = parent.derivePublicChildKey(index);
 
    //salt it
    auto&& saltedPubkey = CryptoECDSA::PubKeyScalarMultiply(nextPubkey, salt_);
@@ -12,6 +12,7 @@
 #include <vector>
 #include <set>
 #include <memory>
+#include <atomic>
 
 #include "WalletFileInterface.h"
 
@@ -20,6 +21,7 @@
 #include "Assets.h"
 
 class DecryptedDataContainer;
+class BIP32_Node;
 
 #define DERIVATIONSCHEME_LEGACY        0xA0
 #define DERIVATIONSCHEME_BIP32         0xA1
@@ -30,6 +32,10 @@ class DecryptedDataContainer;
 
 #define DERIVATION_LOOKUP        100
 
+//bip32 public chain extensions split across threads in chunks of at least 
+//this many indexes
+#define DERIVATION_BATCH_MIN_PER_THREAD 128
+
 enum DerivationSchemeType
 {
    DerSchemeType_ArmoryLegacy,
@@ -126,6 +132,14 @@ private:
    const unsigned depth_;
    const unsigned leafId_;
 
+   //0 to use all cores
+   static std::atomic<unsigned> extendThreadCount_;
+
+protected:
+   //derives from a parent node set up once per extension
+   virtual std::shared_ptr<AssetEntry_Single> computeNextPublicEntry_FromNode(
+      const BIP32_Node& parent, const BinaryData& full_id, unsigned index);
+
 public:
    //tors
    DerivationScheme_BIP32(SecureBinaryData& chainCode,
@@ -159,6 +173,8 @@ public:
 
    unsigned getDepth(void) const { return depth_; }
    unsigned getLeafId(void) const { return leafId_; }
+
+   static void setExtendThreadCount(unsigned);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -187,6 +203,11 @@ public:
       const BinaryData& full_id, unsigned index) override;
 
    BinaryData serialize(void) const override;
+
+protected:
+   std::shared_ptr<AssetEntry_Single> computeNextPublicEntry_FromNode(
+      const BIP32_Node& parent, 
+      const BinaryData& full_id, unsigned index) override;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -310,6 +310,11 @@ bool CryptoECDSA::VerifyPublicKeyValid(SecureBinaryData const & pubKey)
    return cppPubKey.Validate(prng, 3);
 }
 
+SecureBinaryData SignHash_CryptoPP(BinaryData const &, 
+   BTC_PRIVKEY const &, const bool&);
+bool VerifyHash_CryptoPP(BinaryData const &, const BinaryData&, 
+   BTC_PUBKEY const &);
+
 /////////////////////////////////////////////////////////////////////////////
 // Use the secp256k1 curve to sign data of an arbitrary length.
 // Input:  Data to sign  (const SecureBinaryData&)
@@ -326,7 +331,6 @@ SecureBinaryData SignData_CryptoPP(BinaryData const & binToSign,
    // message, it will do the second hash before it signs it.  This is 
    // exactly what we need.
    CryptoPP::SHA256  sha256;
-   BTC_PRNG prng;
 
    // Execute the first sha256 op -- the signer will do the other one
    BinaryData hashVal(32);
@@ -334,6 +338,18 @@ SecureBinaryData SignData_CryptoPP(BinaryData const & binToSign,
                           binToSign.getPtr(), 
                           binToSign.getSize());
 
+   return SignHash_CryptoPP(hashVal, cppPrivKey, detSign);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Same as SignData_CryptoPP, for data that already went through the first
+// sha256 op
+SecureBinaryData SignHash_CryptoPP(BinaryData const & hashVal, 
+                                       BTC_PRIVKEY const & cppPrivKey,
+                                       const bool& detSign)
+{
+   BTC_PRNG prng;
+
    // Do we want to use a PRNG or use deterministic signing (RFC 6979)?
    string signature;
    if(detSign)
@@ -391,6 +407,14 @@ bool VerifyData_CryptoPP(BinaryData const & binMessage,
       binMessage.getPtr(),
       binMessage.getSize());
 
+   return VerifyHash_CryptoPP(hashVal, sig, cppPubKey);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+bool VerifyHash_CryptoPP(BinaryData const & hashVal,
+   const BinaryData& sig,
+   BTC_PUBKEY const & cppPubKey)
+{
    // Verifying message 
    BTC_VERIFIER verifier(cppPubKey);
    return verifier.VerifyMessage((const byte*)hashVal.getPtr(),
@@ -416,6 +440,25 @@ bool CryptoECDSA::VerifyData(BinaryData const & binMessage,
    return VerifyData_CryptoPP(binMessage, binSignature, cppPubKey);
 }
 
+/////////////////////////////////////////////////////////////////////////////
+SecureBinaryData CryptoECDSA::SignData_SingleHashed(
+   BinaryData const & msgSha256,
+   SecureBinaryData const & binPrivKey,
+   const bool& detSign)
+{
+   BTC_PRIVKEY cppPrivKey = ParsePrivateKey(binPrivKey);
+   return SignHash_CryptoPP(msgSha256, cppPrivKey, detSign);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+bool CryptoECDSA::VerifyData_SingleHashed(BinaryData const & msgSha256,
+                             BinaryData const & binSignature,
+                             BinaryData const & pubkey65B) const
+{
+   BTC_PUBKEY cppPubKey = ParsePublicKey(pubkey65B);
+   return VerifyHash_CryptoPP(msgSha256, binSignature, cppPubKey);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Deterministically generate new private key using a chaincode
 // Changed:  added using the hash of the public key to the mix
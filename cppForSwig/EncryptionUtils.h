@@ -328,6 +328,15 @@ public:
       const BinaryData& sig,
       BinaryData const & cppPubKey) const;
 
+   /////////////////////////////////////////////////////////////////////////////
+   // Same as SignData & VerifyData, for messages that already went through 
+   // the first of their 2 sha256 rounds (pass the 32 byte digest)
+   static SecureBinaryData SignData_SingleHashed(BinaryData const & msgSha256,
+      SecureBinaryData const & cppPrivKey, const bool& detSign = true);
+   bool VerifyData_SingleHashed(BinaryData const & msgSha256,
+      const BinaryData& sig,
+      BinaryData const & cppPubKey) const;
+
 
    /////////////////////////////////////////////////////////////////////////////
    // Deterministically generate new private key using a chaincode
@@ -358,12 +358,22 @@ bool CryptoECDSA::VerifyPublicKeyValid(SecureBinaryData const & pubKey)
 // Output: None
 // Return: The signature of the data  (SecureBinaryData)
 SecureBinaryData CryptoECDSA::SignData(BinaryData const & binToSign, 
-   SecureBinaryData const & cppPrivKey, const bool&)
+   SecureBinaryData const & cppPrivKey, const bool& detSign)
 {
-   //hash message
+   //first sha256 round, the second one is done by SignData_SingleHashed
    BinaryData digest(32);
    sha256_Raw(binToSign.getPtr(), binToSign.getSize(), digest.getPtr());
-   sha256_Raw(digest.getPtr(), 32, digest.getPtr());
+   return SignData_SingleHashed(digest, cppPrivKey, detSign);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+SecureBinaryData CryptoECDSA::SignData_SingleHashed(
+   BinaryData const & msgSha256,
+   SecureBinaryData const & cppPrivKey, const bool&)
+{
+   //second sha256 round
+   BinaryData digest(32);
+   sha256_Raw(msgSha256.getPtr(), msgSha256.getSize(), digest.getPtr());
 
    // Only use RFC 6979
    SecureBinaryData sig(74);
@@ -384,13 +394,23 @@ SecureBinaryData CryptoECDSA::SignData(BinaryData const & binToSign,
 bool CryptoECDSA::VerifyData(BinaryData const & binMessage,
    const BinaryData& sig,
    BinaryData const & cppPubKey) const
+{
+   // We execute the first SHA256 op, here.  Next one is done by 
+   // VerifyData_SingleHashed
+   BinaryData digest1(32);
+   sha256_Raw(binMessage.getPtr(), binMessage.getSize(), digest1.getPtr());
+   return VerifyData_SingleHashed(digest1, sig, cppPubKey);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+bool CryptoECDSA::VerifyData_SingleHashed(BinaryData const & msgSha256,
+   const BinaryData& sig,
+   BinaryData const & cppPubKey) const
 {
    //pub keys are already validated by the script parser
 
-   // We execute the first SHA256 op, here.  Next one is done by Verifier
-   BinaryData digest1(32), digest2(32);
-   sha256_Raw(binMessage.getPtr(), binMessage.getSize(), digest1.getPtr());
-   sha256_Raw(digest1.getPtr(), 32, digest2.getPtr());
+   BinaryData digest2(32);
+   sha256_Raw(msgSha256.getPtr(), msgSha256.getSize(), digest2.getPtr());
 
    //setup pubkey
    btc_pubkey key;
@@ -19,7 +19,8 @@ void HistoryPager::addPage(vector<shared_ptr<Page>>& pages,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-shared_ptr<const map<BinaryData, LedgerEntry>> HistoryPager::getPageLedgerMap(
+shared_ptr<const ArmoryThreading::PersistentMap<BinaryData, LedgerEntry>>
+   HistoryPager::getPageLedgerMap(
    function< map<BinaryData, TxIOPair>(uint32_t, uint32_t) > getTxio,
    function< map<BinaryData, LedgerEntry>(
       const map<BinaryData, TxIOPair>&, uint32_t, uint32_t) > buildLedgers,
@@ -69,8 +70,8 @@ shared_ptr<const map<BinaryData, LedgerEntry>> HistoryPager::getPageLedgerMap(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-shared_ptr<const map<BinaryData, LedgerEntry>> HistoryPager::getPageLedgerMap(
-   uint32_t pageId)
+shared_ptr<const ArmoryThreading::PersistentMap<BinaryData, LedgerEntry>>
+   HistoryPager::getPageLedgerMap(uint32_t pageId)
 {
    if (!isInitialized_->load(memory_order_relaxed))
    {
@@ -177,6 +178,22 @@ uint32_t HistoryPager::getPageBottom(uint32_t id) const
    return 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+uint32_t HistoryPager::getPageTop(uint32_t id) const
+{
+   if (!isInitialized_->load(memory_order_relaxed))
+      return UINT32_MAX;
+
+   auto pagesLocal = atomic_load_explicit(&pages_, memory_order_acquire);
+   if (pagesLocal == nullptr)
+      return UINT32_MAX;
+
+   if (id < pagesLocal->size())
+      return (*pagesLocal)[id]->blockEnd_;
+
+   return UINT32_MAX;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 size_t HistoryPager::getPageCount(void) const
 {
@@ -231,23 +248,21 @@ uint32_t HistoryPager::getBlockInVicinity(uint32_t blk) const
       throw std::runtime_error("Uninitialized history");
    }
 
-   uint32_t blkDiff = UINT32_MAX;
-   uint32_t blkHeight = UINT32_MAX;
-
-   for (auto& txioRange : SSHsummary_)
+   //look for txio summary with closest block, the lower one wins ties
+   auto iter = SSHsummary_.lower_bound(blk);
+   if (iter == SSHsummary_.begin())
    {
-      //look for txio summary with closest block
-      uint32_t diff = abs(int(txioRange.first - blk));
-      if (diff == 0)
-         return txioRange.first;
-      else if (diff < blkDiff)
-      {
-         blkHeight = txioRange.first;
-         blkDiff = diff;
-      }
+      if (iter == SSHsummary_.end())
+         return UINT32_MAX;
+      return iter->first;
    }
 
-   return blkHeight;
+   auto prevIter = std::prev(iter);
+   if (iter == SSHsummary_.end() || 
+      blk - prevIter->first <= iter->first - blk)
+      return prevIter->first;
+
+   return iter->first;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
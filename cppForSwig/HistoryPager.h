@@ -31,7 +31,8 @@ private:
       uint32_t count_;
       unsigned updateID_ = UINT32_MAX;
 
-      ArmoryThreading::TransactionalMap<BinaryData, LedgerEntry> pageLedgers_;
+      ArmoryThreading::TransactionalPersistentMap<
+         BinaryData, LedgerEntry> pageLedgers_;
 
       Page(void) : blockStart_(UINT32_MAX), blockEnd_(UINT32_MAX), count_(0)
       {}
@@ -67,13 +68,15 @@ public:
       isInitialized_->store(false, std::memory_order_relaxed);
    }
 
-   std::shared_ptr<const std::map<BinaryData, LedgerEntry>> getPageLedgerMap(
+   std::shared_ptr<const ArmoryThreading::PersistentMap<
+      BinaryData, LedgerEntry>> getPageLedgerMap(
       std::function<std::map<BinaryData, TxIOPair>(uint32_t, uint32_t) > getTxio,
       std::function<std::map<BinaryData, LedgerEntry>(
          const std::map<BinaryData, TxIOPair>&, uint32_t, uint32_t) > buildLedgers,
       uint32_t pageId, unsigned updateID, std::map<BinaryData, TxIOPair>* txioMap = nullptr);
 
-   std::shared_ptr<const std::map<BinaryData, LedgerEntry>> getPageLedgerMap(uint32_t pageId);
+   std::shared_ptr<const ArmoryThreading::PersistentMap<
+      BinaryData, LedgerEntry>> getPageLedgerMap(uint32_t pageId);
 
    void reset(void) 
    { 
@@ -92,12 +95,17 @@ public:
    { return SSHsummary_; }
    
    uint32_t getPageBottom(uint32_t id) const;
+   uint32_t getPageTop(uint32_t id) const;
    size_t   getPageCount(void) const;
    
    uint32_t getRangeForHeightAndCount(uint32_t height, uint32_t count) const;
    uint32_t getBlockInVicinity(uint32_t blk) const;
    uint32_t getPageIdForBlockHeight(uint32_t) const;
 
+   //txio count that closes a page
+   static uint32_t getTxnPerPage(void) { return txnPerPage_; }
+   static void setTxnPerPage(uint32_t count) { txnPerPage_ = count; }
+
    bool isInitiliazed(void) const
    {
       return isInitialized_->load(std::memory_order_relaxed);
@@ -199,16 +199,24 @@ public:
       return getPageCount_();
    }
 
+   //bottom and top block height of the page
+   std::pair<uint32_t, uint32_t> getPageRange(uint32_t id)
+   {
+      return getPageRange_(id);
+   }
+
 private:
    LedgerDelegate(
       std::function<std::vector<LedgerEntry>(uint32_t)> getHist,
       std::function<uint32_t(uint32_t)> getBlock,
       std::function<uint32_t(uint32_t)> getPageId,
-      std::function<uint32_t(void)> getPageCount) :
+      std::function<uint32_t(void)> getPageCount,
+      std::function<std::pair<uint32_t, uint32_t>(uint32_t)> getPageRange) :
       getHistoryPage_(getHist),
       getBlockInVicinity_(getBlock),
       getPageIdForBlockHeight_(getPageId),
-      getPageCount_(getPageCount)
+      getPageCount_(getPageCount),
+      getPageRange_(getPageRange)
    {}
 
 private:
@@ -216,6 +224,8 @@ private:
    const std::function<uint32_t(uint32_t)>            getBlockInVicinity_;
    const std::function<uint32_t(uint32_t)>            getPageIdForBlockHeight_;
    const std::function<uint32_t(void)>                getPageCount_;
+   const std::function<
+      std::pair<uint32_t, uint32_t>(uint32_t)>        getPageRange_;
 };
 
 #endif
@@ -160,7 +160,7 @@ private:
    const unsigned sdbiKey_;
    LMDBBlockDatabase *const lmdb_;
 
-   std::shared_ptr<ArmoryThreading::TransactionalMap<
+   std::shared_ptr<ArmoryThreading::TransactionalPersistentMap<
       BinaryDataRef, std::shared_ptr<AddrAndHash>>> scanFilterAddrMap_;
    std::shared_ptr<ArmoryThreading::TransactionalMap<
       BinaryDataRef, std::shared_ptr<AddrAndHash>>> zcFilterAddrMap_;
@@ -199,7 +199,7 @@ public:
       : sdbiKey_(sdbiKey), lmdb_(lmdb)
    {
       scanFilterAddrMap_ = std::make_shared<
-         ArmoryThreading::TransactionalMap<
+         ArmoryThreading::TransactionalPersistentMap<
          BinaryDataRef, std::shared_ptr<AddrAndHash>>>();
 
       zcFilterAddrMap_ = std::make_shared<
@@ -212,7 +212,8 @@ public:
    LMDBBlockDatabase* db() { return lmdb_; }
 
    ////
-   std::shared_ptr<const std::map<BinaryDataRef, std::shared_ptr<AddrAndHash>>>
+   std::shared_ptr<const ArmoryThreading::PersistentMap<
+      BinaryDataRef, std::shared_ptr<AddrAndHash>>>
       getScanFilterAddrMap(void) const
    { 
       return scanFilterAddrMap_->get(); 
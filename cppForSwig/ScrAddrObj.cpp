@@ -79,11 +79,84 @@ uint64_t ScrAddrObj::getFullBalance(unsigned updateID) const
    return balance;
 }
    
+////////////////////////////////////////////////////////////////////////////////
+bool ScrAddrObj::updateBalances(
+   uint32_t height, unsigned confTarget, bool force)
+{
+   StoredScriptHistory ssh;
+   db_->getStoredScriptHistorySummary(ssh, scrAddr_);
+   auto sshBalance = ssh.getScriptBalance(false);
+
+   auto prevBalances = balances_;
+
+   if (force || zcChanged_ || 
+      balancesHeight_ == UINT32_MAX || height < balancesHeight_ ||
+      sshBalance != sshBalance_ || ssh.totalTxioCount_ != sshTxioCount_)
+   {
+      //this address was touched, reload its history
+      sshBalance_ = sshBalance;
+      sshTxioCount_ = ssh.totalTxioCount_;
+
+      balances_.full_ = sshBalance;
+      balances_.txioCount_ = ssh.totalTxioCount_;
+      maturingTxios_.clear();
+
+      auto&& txios = getTxios();
+      for (auto& txio : txios)
+      {
+         if (txio.second.hasTxOutZC())
+            balances_.full_ += txio.second.getValue();
+         if (txio.second.hasTxInZC())
+            balances_.full_ -= txio.second.getValue();
+
+         //unspent txios, and spends that were reorged out, which still
+         //count as unconfirmed until their output matures
+         if (!txio.second.hasTxIn() ||
+            txio.second.isMineButUnconfirmed(db_, height, confTarget))
+            maturingTxios_.insert(txio);
+      }
+
+      zcChanged_ = false;
+   }
+
+   //age the maturing txios, drop the ones that are settled for good: 
+   //spendable and confirmed only flip back on reorgs, which force a reload
+   balances_.spendable_ = balances_.full_;
+   balances_.unconfirmed_ = 0;
+
+   auto iter = maturingTxios_.begin();
+   while (iter != maturingTxios_.end())
+   {
+      auto& txio = iter->second;
+      auto notSpendable = 
+         !txio.hasTxIn() && !txio.isSpendable(db_, height);
+      auto unconfirmed = txio.isMineButUnconfirmed(db_, height, confTarget);
+
+      if (!notSpendable && !unconfirmed)
+      {
+         maturingTxios_.erase(iter++);
+         continue;
+      }
+
+      if (notSpendable)
+         balances_.spendable_ -= txio.getValue();
+      if (unconfirmed)
+         balances_.unconfirmed_ += txio.getValue();
+
+      ++iter;
+   }
+
+   balancesHeight_ = height;
+   internalBalance_ = balances_.full_;
+   return !(balances_ == prevBalances);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void ScrAddrObj::clearBlkData(void)
 {
    hist_.reset();
    totalTxioCount_ = 0;
+   balancesHeight_ = UINT32_MAX;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -143,13 +216,19 @@ map<BinaryData, TxIOPair> ScrAddrObj::scanZC(const ScanAddressStruct& scanInfo,
       if (scanInfo.minedTxioKeys_ != nullptr)
       {
          if (purgeZC(invalidatedZCMap, *scanInfo.minedTxioKeys_))
+         {
             updateID_ = updateID;
+            zcChanged_ = true;
+         }
       }
       else
       {
          map<BinaryData, BinaryData> dummyMap;
          if (purgeZC(invalidatedZCMap, dummyMap))
+         {
             updateID_ = updateID;
+            zcChanged_ = true;
+         }
       }
    }
 
@@ -211,6 +290,7 @@ map<BinaryData, TxIOPair> ScrAddrObj::scanZC(const ScanAddressStruct& scanInfo,
       return newZC;
 
    updateID_ = updateID;
+   zcChanged_ = true;
 
    for (auto& txioPair : newZC)
    {
@@ -482,7 +562,7 @@ ScrAddrObj& ScrAddrObj::operator= (const ScrAddrObj& rhs)
 
 ////////////////////////////////////////////////////////////////////////////////
 vector<LedgerEntry> ScrAddrObj::getTxLedgerAsVector(
-   const map<BinaryData, LedgerEntry>* leMap) const
+   const ArmoryThreading::PersistentMap<BinaryData, LedgerEntry>* leMap) const
 {
    vector<LedgerEntry>le;
 
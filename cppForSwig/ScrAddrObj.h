@@ -52,6 +52,21 @@ struct ScanAddressStruct
       std::shared_ptr<std::set<BinaryDataRef>>>> newKeysAndScrAddr_;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+struct ScrAddrBalances
+{
+   uint64_t full_ = 0;
+   uint64_t spendable_ = 0;
+   uint64_t unconfirmed_ = 0;
+   uint64_t txioCount_ = 0;
+
+   bool operator==(const ScrAddrBalances& rhs) const
+   {
+      return full_ == rhs.full_ && spendable_ == rhs.spendable_ &&
+         unconfirmed_ == rhs.unconfirmed_ && txioCount_ == rhs.txioCount_;
+   }
+};
+
 class ScrAddrObj
 {
    friend class BtcWallet;
@@ -207,7 +222,7 @@ public:
    std::vector<UnspentTxOut> getSpendableTxOutList(bool ignoreZC=true) const;
    
    std::vector<LedgerEntry> getTxLedgerAsVector(
-      const std::map<BinaryData, LedgerEntry>* leMap) const;
+      const ArmoryThreading::PersistentMap<BinaryData, LedgerEntry>* leMap) const;
 
    void clearBlkData(void);
 
@@ -241,6 +256,8 @@ public:
 
    size_t getPageCount(void) const { return hist_.getPageCount(); }
    std::vector<LedgerEntry> getHistoryPageById(uint32_t id);
+   std::pair<uint32_t, uint32_t> getPageRange(uint32_t id) const
+   { return std::make_pair(hist_.getPageBottom(id), hist_.getPageTop(id)); }
 
    ScrAddrObj& operator= (const ScrAddrObj& rhs);
 
@@ -265,6 +282,20 @@ public:
    uint32_t getBlockInVicinity(uint32_t blk) const;
    uint32_t getPageIdForBlockHeight(uint32_t blk) const;
 
+   /***
+   Balances are materialized per address. updateBalances only reloads the 
+   history when the ssh summary or the zc set moved since the last call, 
+   otherwise it ages the handful of txios that are still maturing (zc, 
+   unconfirmed, immature coinbase, reorged out spends) against the new 
+   height. Returns true if any of the balances changed.
+
+   The balance members are guarded by the owning BtcWallet's balancesMutex_.
+   ***/
+   bool updateBalances(uint32_t height, unsigned confTarget, bool force);
+   const ScrAddrBalances& getBalances(void) const { return balances_; }
+   uint32_t getBalancesHeight(void) const { return balancesHeight_; }
+   bool hasZcChanges(void) const { return zcChanged_; }
+
    uint32_t getTxioCountForLedgers(void)
    {
       //return UINT32_MAX unless count has changed since last call
@@ -305,6 +336,14 @@ private:
 
    mutable int32_t updateID_ = 0;
    mutable uint64_t internalBalance_ = 0;
+
+   //materialized balances
+   ScrAddrBalances balances_;
+   std::map<BinaryData, TxIOPair> maturingTxios_;
+   uint64_t sshBalance_ = 0;
+   uint64_t sshTxioCount_ = 0;
+   uint32_t balancesHeight_ = UINT32_MAX;
+   bool zcChanged_ = false;
 };
 
 #endif
@@ -14,10 +14,123 @@
 using namespace std;
 using namespace ArmorySigner;
 
+static size_t sigCacheEntrySize(const BinaryData& key, const bool&)
+{
+   //key + list and map nodes
+   return key.getSize() + 128;
+}
+
+shared_ptr<SigVerifyCache::CacheType> SigVerifyCache::cache_ =
+   make_shared<SigVerifyCache::CacheType>(
+      SIGCACHE_DEFAULT_BUDGET, SIGCACHE_SHARD_COUNT, sigCacheEntrySize);
+
 //dtors
 StackValue::~StackValue()
 {}
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//// SigVerifyCache
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+const SecureBinaryData& SigVerifyCache::getSalt()
+{
+   static const SecureBinaryData salt = CryptoPRNG::generateRandom(32);
+   return salt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+shared_ptr<SigVerifyCache::CacheType> SigVerifyCache::getCache()
+{
+   return atomic_load(&cache_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SigVerifyCache::getKey(const BinaryData& sigHash,
+   BinaryDataRef pubkey, BinaryDataRef sig)
+{
+   BinaryWriter bw;
+   bw.put_BinaryData(getSalt());
+   bw.put_BinaryData(sigHash);
+   bw.put_var_int(pubkey.getSize());
+   bw.put_BinaryDataRef(pubkey);
+   bw.put_BinaryDataRef(sig);
+
+   return BtcUtils::getSha256(bw.getData());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SigVerifyCache::has(const BinaryData& key)
+{
+   auto cachePtr = getCache();
+   if (cachePtr == nullptr)
+      return false;
+
+   bool val;
+   return cachePtr->get(key, val);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SigVerifyCache::insert(const BinaryData& key)
+{
+   auto cachePtr = getCache();
+   if (cachePtr == nullptr)
+      return;
+
+   cachePtr->put(key, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SigVerifyCache::setBudget(size_t byteBudget)
+{
+   shared_ptr<CacheType> newCache;
+   if (byteBudget != 0)
+   {
+      newCache = make_shared<CacheType>(
+         byteBudget, SIGCACHE_SHARD_COUNT, sigCacheEntrySize);
+   }
+
+   atomic_store(&cache_, newCache);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SigVerifyCache::clear()
+{
+   auto cachePtr = getCache();
+   if (cachePtr != nullptr)
+      cachePtr->clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t SigVerifyCache::hits()
+{
+   auto cachePtr = getCache();
+   if (cachePtr == nullptr)
+      return 0;
+
+   return cachePtr->hits();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64_t SigVerifyCache::misses()
+{
+   auto cachePtr = getCache();
+   if (cachePtr == nullptr)
+      return 0;
+
+   return cachePtr->misses();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t SigVerifyCache::size()
+{
+   auto cachePtr = getCache();
+   if (cachePtr == nullptr)
+      return 0;
+
+   return cachePtr->size();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 //// StackItem
@@ -804,24 +917,44 @@ void StackInterpreter::op_checksig()
    if (sigHashDataObject_ == nullptr)
       sigHashDataObject_ = make_shared<SigHashDataLegacy>();
    auto&& sighashdata =
-      sigHashDataObject_->getDataForSigHash(hashType, *txStubPtr_,
+      sigHashDataObject_->getSha256ForSigHash(hashType, *txStubPtr_,
       outputScriptRef_, inputIndex_);
 
    if(!CryptoECDSA().VerifyPublicKeyValid(pubkey))
       throw runtime_error("invalid pubkey");
 
    //check signature
+   auto result = verifySig(sighashdata, sig, pubkey);
+   stack_.push_back(move(intToRawBinary(result)));
+
+   if (result)
+      txInEvalState_.pubKeyState_.insert(make_pair(pubkey, true));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool StackInterpreter::verifySig(const BinaryData& sighashdata,
+   BinaryDataRef sig, const BinaryData& pubkey) const
+{
+   //sighashdata went through the 1st sha256 round, finish the hash
+   auto&& sigHash = BtcUtils::getSha256(sighashdata);
+
+   //the same sigs are checked on zc, broadcast and chain checks
+   auto&& cacheKey = SigVerifyCache::getKey(sigHash, pubkey, sig);
+   if (SigVerifyCache::has(cacheKey))
+      return true;
+
    bool result;
 #ifndef LIBBTC_ONLY
    auto&& rs = BtcUtils::extractRSFromDERSig(sig);
-   result = CryptoECDSA().VerifyData(sighashdata, rs, pubkey);
+   result = CryptoECDSA().VerifyData_SingleHashed(sighashdata, rs, pubkey);
 #else
-   result = CryptoECDSA().VerifyData(sighashdata, sig, pubkey);
+   result = CryptoECDSA().VerifyData_SingleHashed(sighashdata, sig, pubkey);
 #endif
-   stack_.push_back(move(intToRawBinary(result)));
 
    if (result)
-      txInEvalState_.pubKeyState_.insert(make_pair(pubkey, true));
+      SigVerifyCache::insert(cacheKey);
+
+   return result;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -906,13 +1039,10 @@ void StackInterpreter::op_checkmultisig()
       auto& hashdata = dataToHash[sigD.hashType_];
       if (hashdata.getSize() == 0)
       {
-         hashdata = sigHashDataObject_->getDataForSigHash(
+         hashdata = sigHashDataObject_->getSha256ForSigHash(
             sigD.hashType_, *txStubPtr_, outputScriptRef_, inputIndex_);
       }
 
-      //prepare sig
-      auto&& rs = BtcUtils::extractRSFromDERSig(sigD.sig_);
-
       //pop pubkeys from deque to verify against sig
       while (pubkeys.size() > 0)
       {
@@ -923,14 +1053,10 @@ void StackInterpreter::op_checkmultisig()
          LOGWARN << "Verifying sig for: ";
          LOGWARN << "   pubkey: " << pubkey.second.toHexStr();
 
-         auto&& msg_hash = BtcUtils::getHash256(hashdata);
+         auto&& msg_hash = BtcUtils::getSha256(hashdata);
          LOGWARN << "   message: " << hashdata.toHexStr();
 #endif
-#ifndef LIBBTC_ONLY   
-         if (CryptoECDSA().VerifyData(hashdata, rs, pubkey))
-#else
-         if(CryptoECDSA().VerifyData(hashdata, sigD.sig_, pubkey))
-#endif
+         if (verifySig(hashdata, sigD.sig_, pubkey))
          {
             txInEvalState_.pubKeyState_[pubkey] = true;
             validSigCount++;
@@ -945,6 +1071,14 @@ void StackInterpreter::op_checkmultisig()
       op_0();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void StackInterpreter::setLegacySigHashDataObject(
+   shared_ptr<SigHashDataLegacy> shdo)
+{
+   //p2sh-sw inputs swap this for SHD_SW_ in processSW
+   sigHashDataObject_ = shdo;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void StackInterpreter::processSW(BinaryDataRef outputScript)
 {
@@ -23,6 +23,9 @@
 #define STACKITEM_SIG_PREFIX              0x13
 #define STACKITEM_MULTISIG_PREFIX         0x14
 
+#define SIGCACHE_DEFAULT_BUDGET           32 * 1024 * 1024ULL
+#define SIGCACHE_SHARD_COUNT              16
+
 #include <algorithm>
 #include "BinaryData.h"
 #include "EncryptionUtils.h"
@@ -30,6 +33,7 @@
 #include "SigHashEnum.h"
 #include "TxEvalState.h"
 #include "ResolverFeed.h"
+#include "ThreadSafeClasses.h"
 
 #include "protobuf/Signer.pb.h"
 
@@ -209,8 +213,47 @@ public:
 
 class TransactionStub;
 class SigHashData;
+class SigHashDataLegacy;
 class SigHashDataSegWit;
 
+////////////////////////////////////////////////////////////////////////////////
+class SigVerifyCache
+{
+   /***
+   Process wide set of valid signatures, shared by all StackInterpreter 
+   instances. Keys are the sha256 of a per process random salt followed by
+   the sighash, the pubkey and the sig. Only valid sigs go in, a hit means 
+   the sig checks out.
+
+   Byte bounded and sharded, lru evicted.
+   ***/
+
+private:
+   typedef ArmoryThreading::ShardedLruCache<
+      BinaryData, bool, BinaryDataHash> CacheType;
+
+   static std::shared_ptr<CacheType> cache_;
+
+private:
+   static const SecureBinaryData& getSalt(void);
+   static std::shared_ptr<CacheType> getCache(void);
+
+public:
+   static BinaryData getKey(const BinaryData& sigHash,
+      BinaryDataRef pubkey, BinaryDataRef sig);
+
+   static bool has(const BinaryData&);
+   static void insert(const BinaryData&);
+
+   //0 disables the cache
+   static void setBudget(size_t);
+   static void clear(void);
+
+   static uint64_t hits(void);
+   static uint64_t misses(void);
+   static size_t size(void);
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 class StackInterpreter : public ScriptParser
 {
@@ -739,6 +782,8 @@ private:
    }
 
    void op_checksig(void);
+   bool verifySig(const BinaryData& sigHashData,
+      BinaryDataRef sig, const BinaryData& pubkey) const;
 
    void op_checkmultisig(void);
 
@@ -794,6 +839,8 @@ public:
       SHD_SW_ = shdo;
    }
 
+   void setLegacySigHashDataObject(std::shared_ptr<SigHashDataLegacy>);
+
    unsigned getFlags(void) const { return flags_; }
    void setFlags(unsigned flags) { flags_ = flags; }
 
@@ -158,33 +158,82 @@ int WebSocketServer::callback(
          break;
       }
 
-      if (iter->second.empty())
+      auto& pending = iter->second;
+      if (pending.packets_.empty())
       {
          wsPtr->pendingWrites_.erase(wsPtr->pendingWritesIter_++);
          LOGWARN << "incrementing over empty wsi write list";
          break;
       }
 
-      auto& theList = iter->second.front();
+      auto& theList = pending.packets_.front();
       auto& packet = theList.front();
-      auto body = (uint8_t*)packet.getPtr() + LWS_PRE;
+      size_t packetLen = packet.getSize() - LWS_PRE;
 
-      auto m = lws_write(wsi, 
-         body, packet.getSize() - LWS_PRE,
-         LWS_WRITE_BINARY);
+      if (packetLen <= WEBSOCKET_MESSAGE_PACKET_SIZE)
+      {
+         auto body = (uint8_t*)packet.getPtr() + LWS_PRE;
+         auto m = lws_write(wsi, 
+            body, packetLen,
+            LWS_WRITE_BINARY);
 
-      if (m != (int)packet.getSize() - (int)LWS_PRE)
+         if (m != (int)packetLen)
+         {
+            LOGERR << "failed to send packet of size";
+            LOGERR << "packet is " << packet.getSize() <<
+               " bytes, sent " << m << " bytes";
+         }
+      }
+      else
       {
-         LOGERR << "failed to send packet of size";
-         LOGERR << "packet is " << packet.getSize() <<
-            " bytes, sent " << m << " bytes";
+         /*
+         Large frame, write it as a fragmented ws message, as many slices as
+         the socket takes before choking. Each slice's ws header goes in the
+         LWS_PRE bytes before it, which have already been handed to lws.
+         */
+         while (true)
+         {
+            size_t sliceLen = min<size_t>(
+               WEBSOCKET_LARGE_FRAME_SLICE_SIZE, packetLen - pending.offset_);
+
+            int flags = pending.offset_ == 0 ? 
+               LWS_WRITE_BINARY : LWS_WRITE_CONTINUATION;
+            if (pending.offset_ + sliceLen < packetLen)
+               flags |= LWS_WRITE_NO_FIN;
+
+            auto body = (uint8_t*)packet.getPtr() + LWS_PRE + pending.offset_;
+            auto m = lws_write(wsi, body, sliceLen, (lws_write_protocol)flags);
+            if (m != (int)sliceLen)
+            {
+               LOGERR << "failed to send large frame slice";
+               LOGERR << "slice is " << sliceLen <<
+                  " bytes, sent " << m << " bytes";
+
+               //the rest of the frame can't follow a broken slice, 
+               //close the connection
+               return -1;
+            }
+
+            pending.offset_ += sliceLen;
+            if (pending.offset_ == packetLen || lws_send_pipe_choked(wsi))
+               break;
+         }
+
+         if (pending.offset_ < packetLen)
+         {
+            //resume on the next writeable callback for this wsi
+            ++wsPtr->pendingWritesIter_;
+            break;
+         }
+
+         pending.offset_ = 0;
       }
 
       theList.pop_front();
       if (theList.empty())
       {
-         iter->second.pop_front();
-         if (iter->second.empty())
+         pending.packets_.pop_front();
+         if (pending.packets_.empty())
          {
             wsPtr->pendingWrites_.erase(wsPtr->pendingWritesIter_++);
             break;
@@ -585,24 +634,47 @@ void WebSocketServer::prepareWriteThread()
          }
       }
 
-      //serialize arg
-      vector<uint8_t> serializedData;
-      if (msg->message_->ByteSize() > 0)
+      //large frames if the client negotiated them and the reply would 
+      //otherwise be fragmented
+      SerializedMessage ws_msg;
+      size_t msgSize = msg->message_->ByteSize();
+      auto maxFrameSize = 
+         statePtr->maxFrameSize_->load(memory_order_relaxed);
+
+      if (msgSize > WEBSOCKET_MESSAGE_PACKET_SIZE && 
+         msgSize + 9 <= maxFrameSize)
       {
-         serializedData.resize(msg->message_->ByteSize());
-         auto result = msg->message_->SerializeToArray(
-            &serializedData[0], serializedData.size());
-         if (!result)
+         try
          {
-            LOGERR << "failed to serialize message";
+            ws_msg.constructLargeFrame(*msg->message_,
+               statePtr->bip151Connection_.get(), msg->msgid_);
+         }
+         catch (runtime_error& e)
+         {
+            LOGERR << e.what();
             return;
          }
       }
+      else
+      {
+         //serialize arg
+         vector<uint8_t> serializedData;
+         if (msgSize > 0)
+         {
+            serializedData.resize(msgSize);
+            auto result = msg->message_->SerializeToArray(
+               &serializedData[0], serializedData.size());
+            if (!result)
+            {
+               LOGERR << "failed to serialize message";
+               return;
+            }
+         }
 
-      SerializedMessage ws_msg;
-      ws_msg.construct(
-         serializedData, statePtr->bip151Connection_.get(), 
-         WS_MSGTYPE_FRAGMENTEDPACKET_HEADER, msg->msgid_);
+         ws_msg.construct(
+            serializedData, statePtr->bip151Connection_.get(), 
+            WS_MSGTYPE_FRAGMENTEDPACKET_HEADER, msg->msgid_);
+      }
 
       //push to write map
       writeToSocket(statePtr->wsiPtr_, ws_msg);
@@ -636,7 +708,7 @@ void WebSocketServer::addId(const uint64_t& id, struct lws* ptr)
    auto&& lbds = getAuthPeerLambda();
    auto&& write_pair = make_pair(id, ClientConnection(ptr, id, lbds));
    clientStateMap_.insert(move(write_pair));
-   writeMap_.emplace(ptr, list<list<BinaryData>>());
+   writeMap_.emplace(ptr, PendingWrites());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -709,7 +781,7 @@ void WebSocketServer::updateWriteMap()
          if (iter == writeMap_.end())
             continue;
 
-         iter->second.emplace_back(move(packetList.second));
+         iter->second.packets_.emplace_back(move(packetList.second));
          auto insertIter = pendingWrites_.insert(packetList.first);
          break;
       }      
@@ -1084,6 +1156,38 @@ void ClientConnection::processAEADHandshake(BinaryData msg)
          break;
       }
 
+      case WS_MSGTYPE_FRAMING_LARGE:
+      {
+         //client accepts large frames, payload is its max frame size
+         if (bip151Connection_->getBIP150State() !=
+            BIP150State::SUCCESS)
+         {
+            return false;
+         }
+
+         if (dataBdr.getSize() != 4)
+            return false;
+
+         uint32_t maxFrameSize;
+         memcpy(&maxFrameSize, dataBdr.getPtr(), 4);
+         maxFrameSize = 
+            min<uint32_t>(maxFrameSize, WEBSOCKET_LARGE_FRAME_MAX_SIZE);
+         if (maxFrameSize <= WEBSOCKET_MESSAGE_PACKET_SIZE)
+         {
+            //nothing to gain, stay on fragmented packets
+            break;
+         }
+
+         //ack with the size we settled on, the client only takes large 
+         //frames once it has seen this. Large frames are queued after it
+         BinaryData ackPayload(4);
+         memcpy(ackPayload.getPtr(), &maxFrameSize, 4);
+         writeToClient(WS_MSGTYPE_FRAMING_LARGE, ackPayload.getRef(), true);
+
+         maxFrameSize_->store(maxFrameSize, memory_order_relaxed);
+         break;
+      }
+
       default:
          //unexpected msg id, kill connection
          return false;
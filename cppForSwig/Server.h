@@ -97,6 +97,9 @@ public:
    std::chrono::time_point<std::chrono::system_clock> outKeyTimePoint_;
    std::shared_ptr<std::atomic<int>> run_;
 
+   //largest frame the client accepts, 0 until it negotiates large frames
+   std::shared_ptr<std::atomic<uint32_t>> maxFrameSize_;
+
    std::shared_ptr<ArmoryThreading::Queue<BinaryData>> readQueue_;
 
 private:
@@ -118,12 +121,25 @@ public:
       
       run_ = std::make_shared<std::atomic<int>>();
       run_->store(0, std::memory_order_relaxed);
+
+      maxFrameSize_ = std::make_shared<std::atomic<uint32_t>>();
+      maxFrameSize_->store(0, std::memory_order_relaxed);
    }
 
    void closeConnection(void);
    void processReadQueue(std::shared_ptr<Clients>);
 };
 
+///////////////////////////////////////////////////////////////////////////////
+struct PendingWrites
+{
+   std::list<std::list<BinaryData>> packets_;
+
+   //bytes of the front packet already handed to lws, large frames are
+   //written over several writeable callbacks
+   size_t offset_ = 0;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 class WebSocketServer
 {
@@ -146,7 +162,7 @@ private:
    ArmoryThreading::BlockingQueue<uint64_t> clientConnectionInterruptQueue_;
 
    std::shared_ptr<AuthorizedPeers> authorizedPeers_;
-   std::map<struct lws*, std::list<std::list<BinaryData>>> writeMap_;
+   std::map<struct lws*, PendingWrites> writeMap_;
    lws_context* contextPtr_;
    ArmoryThreading::Queue<std::pair<struct lws*, std::list<BinaryData>>> writeQueue_;
    
@@ -2447,6 +2447,9 @@ void Signer::sign(void)
    //perma flag for segwit verification
    flags_ |= SCRIPT_VERIFY_SEGWIT;
 
+   //spenders and recipients may have changed since the last pass
+   sigHashDataLegacy_ = nullptr;
+
    /* sanity checks begin */
 
    //sizes
@@ -2573,7 +2576,7 @@ SecureBinaryData Signer::signScript(
 {
    auto spender = spenders_[index];
 
-   auto hashToSign = SHD->getDataForSigHash(
+   auto hashToSign = SHD->getSha256ForSigHash(
       spender->getSigHashType(), *this,
       script, index);
    
@@ -2586,7 +2589,7 @@ SecureBinaryData Signer::signScript(
    LOGWARN << "   message: " << dataToHash.toHexStr();
 #endif
 
-   return CryptoECDSA().SignData(hashToSign, privKey, false);
+   return CryptoECDSA().SignData_SingleHashed(hashToSign, privKey, false);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2811,7 +2814,11 @@ shared_ptr<SigHashData> Signer::getSigHashDataForSpender(bool sw) const
    }
    else
    {
-      SHD = make_shared<SigHashDataLegacy>();
+      //legacy spenders share the tx template, reset on each sign() call
+      if (sigHashDataLegacy_ == nullptr)
+         sigHashDataLegacy_ = make_shared<SigHashDataLegacy>();
+
+      SHD = sigHashDataLegacy_;
    }
 
    return SHD;
@@ -34,10 +34,7 @@ typedef int SOCKET;
 
 ////////////////////////////////////////////////////////////////////////////////
 #include <string>
-
-#ifdef _WIN32
 #include <stdexcept>
-#endif
 
 struct SocketError : public std::runtime_error
 {
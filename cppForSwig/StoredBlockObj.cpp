@@ -58,6 +58,9 @@ void StoredDBInfo::unserializeDBValue(BinaryRefReader & brr)
    brr.get_BinaryData(metaHash_, 32);
    brr.get_BinaryData(topScannedBlkHash_, 32);
    metaInt_ = brr.get_uint64_t();
+
+   if (brr.getSizeRemaining() >= 4)
+      flags_ = brr.get_uint32_t();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -83,6 +86,10 @@ void StoredDBInfo::serializeDBValue(BinaryWriter & bw ) const
 
    bw.put_BinaryDataRef(hashRef);
    bw.put_uint64_t(metaInt_);
+
+   //keep flagless sdbis byte for byte identical to older versions
+   if (flags_ != 0)
+      bw.put_uint32_t(flags_);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1877,6 +1884,18 @@ void StoredScriptHistory::substractSummary(const StoredScriptHistory& ssh)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+static inline uint64_t zigzagEncode(int64_t val)
+{
+   return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static inline int64_t zigzagDecode(uint64_t val)
+{
+   return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // SubSSH object code
 //
@@ -1886,6 +1905,115 @@ void StoredScriptHistory::substractSummary(const StoredScriptHistory& ssh)
 // for massively-reused addresses like SatoshiDice.
 ////////////////////////////////////////////////////////////////////////////////
 void StoredSubHistory::unserializeDBValue(BinaryRefReader & brr)
+{
+   if (brr.getSizeRemaining() == 0 || 
+      *brr.getCurrPtr() != SUBSSH_VALUE_MARKER)
+   {
+      unserializeDBValue_Legacy(brr);
+      return;
+   }
+
+   if(hgtX_.getSize() != 4)
+   {
+      LOGERR << "Cannot unserialize DB value until key is set (hgt&dup)";
+      uniqueKey_.resize(0);
+      return;
+   }
+
+   brr.advance(1);
+   auto version = brr.get_uint8_t();
+   if (version != SUBSSH_VALUE_VERSION)
+      throw runtime_error("unsupported subssh value version");
+
+   txioCount_ = (uint32_t)(brr.get_var_int());
+
+   auto flagsLen = brr.get_var_int();
+   BinaryRefReader brrFlags(brr.get_BinaryDataRef(flagsLen));
+   auto valuesLen = brr.get_var_int();
+   BinaryRefReader brrValues(brr.get_BinaryDataRef(valuesLen));
+
+   //keys column runs to the end of the value
+   auto& brrKeys = brr;
+
+   auto thisHeight = DBUtils::hgtxToHeight(hgtX_);
+
+   BinaryData fullTxKey(8);
+   hgtX_.copyTo(fullTxKey.getPtr());
+   auto keyPtr = fullTxKey.getPtr();
+
+   uint8_t flags = 0;
+   uint64_t runLeft = 0;
+   unsigned prevTxIndex = 0;
+
+   for (uint32_t i = 0; i < txioCount_; i++)
+   {
+      if (runLeft == 0)
+      {
+         flags = brrFlags.get_uint8_t();
+         runLeft = brrFlags.get_var_int();
+         if (runLeft == 0)
+            throw runtime_error("invalid subssh flags run");
+      }
+      --runLeft;
+
+      TxIOPair txio;
+      txio.setValue(brrValues.get_var_int());
+      txio.setTxOutFromSelf((flags & SUBSSH_FLAG_FROMSELF) != 0);
+      txio.setFromCoinbase((flags & SUBSSH_FLAG_COINBASE) != 0);
+      txio.setMultisig((flags & SUBSSH_FLAG_MULTISIG) != 0);
+      txio.setUTXO((flags & SUBSSH_FLAG_UTXO) != 0);
+
+      if ((flags & SUBSSH_FLAG_SPENT) == 0)
+      {
+         prevTxIndex += (unsigned)brrKeys.get_var_int();
+         auto txOutIndex = (unsigned)brrKeys.get_var_int();
+
+         hgtX_.copyTo(keyPtr);
+         keyPtr[4] = (uint8_t)(prevTxIndex >> 8);
+         keyPtr[5] = (uint8_t)prevTxIndex;
+         keyPtr[6] = (uint8_t)(txOutIndex >> 8);
+         keyPtr[7] = (uint8_t)txOutIndex;
+         txio.setTxOut(fullTxKey);
+      }
+      else
+      {
+         //output can sit in an earlier block, the input is at this hgtX
+         auto heightDelta = zigzagDecode(brrKeys.get_var_int());
+         auto outputHeight = (uint32_t)((int64_t)thisHeight - heightDelta);
+         auto dupId = brrKeys.get_uint8_t();
+         auto txOutTxIndex = (unsigned)brrKeys.get_var_int();
+         auto txOutIndex = (unsigned)brrKeys.get_var_int();
+
+         keyPtr[0] = (uint8_t)(outputHeight >> 16);
+         keyPtr[1] = (uint8_t)(outputHeight >> 8);
+         keyPtr[2] = (uint8_t)outputHeight;
+         keyPtr[3] = dupId;
+         keyPtr[4] = (uint8_t)(txOutTxIndex >> 8);
+         keyPtr[5] = (uint8_t)txOutTxIndex;
+         keyPtr[6] = (uint8_t)(txOutIndex >> 8);
+         keyPtr[7] = (uint8_t)txOutIndex;
+         txio.setTxOut(fullTxKey);
+
+         auto txInTxIndex = (unsigned)brrKeys.get_var_int();
+         auto txInIndex = (unsigned)brrKeys.get_var_int();
+
+         hgtX_.copyTo(keyPtr);
+         keyPtr[4] = (uint8_t)(txInTxIndex >> 8);
+         keyPtr[5] = (uint8_t)txInTxIndex;
+         keyPtr[6] = (uint8_t)(txInIndex >> 8);
+         keyPtr[7] = (uint8_t)txInIndex;
+         txio.setTxIn(fullTxKey);
+      }
+
+      BinaryData key8B = txio.getDBKeyOfOutput();
+
+      pair<BinaryData, TxIOPair> txioInsertPair(
+         move(key8B), move(txio));
+      txioMap_.insert(move(txioInsertPair));
+   }
+}
+
+void StoredSubHistory::unserializeDBValue_Legacy(BinaryRefReader & brr)
 {
    // Get the TxOut list if a pointer was supplied
    // This list is unspent-TxOuts only if pruning enabled.  You will
@@ -1957,14 +2085,133 @@ void StoredSubHistory::getSummary(BinaryRefReader & brr)
       return;
    }
 
-   BinaryData fullTxKey(8);
-   hgtX_.copyTo(fullTxKey.getPtr());
+   //versioned values lead with the marker and version byte
+   if (brr.getSizeRemaining() > 0 && 
+      *brr.getCurrPtr() == SUBSSH_VALUE_MARKER)
+      brr.advance(2);
 
    txioCount_ = (uint32_t)(brr.get_var_int());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void StoredSubHistory::serializeDBValue(BinaryWriter & bw) const
+{
+   /***
+   Columnar layout:
+      marker | version | txio count
+      flags column, as (flags, run length) pairs, prefixed with its size
+      values column, varints, prefixed with its size
+      keys column, one entry per txio in txioMap_ order:
+         unspent: tx index delta from the previous unspent entry, 
+            txout index
+         spent: zigzag height delta from this hgtX to the output, output
+            dupID, tx index, txout index, then the input tx index and
+            txin index
+
+   Flags barely change within a subssh and unspent entries share this 
+   hgtX, so both shrink to a few bytes. All varints are base 128.
+   ***/
+
+   vector<const TxIOPair*> txios;
+   txios.reserve(txioMap_.size());
+   for (const auto& txioPair : txioMap_)
+   {
+      const auto& txio = txioPair.second;
+      if (txio.hasTxIn() && !txio.getTxRefOfInput().isInitialized())
+      {
+         LOGERR << "TxIO is spent, but input is not initialized";
+         continue;
+      }
+
+      txios.push_back(&txio);
+   }
+
+   BinaryWriter bwFlags, bwValues, bwKeys;
+   bwValues.reserve(txios.size() * 4);
+   bwKeys.reserve(txios.size() * 3);
+
+   uint8_t runFlags = 0;
+   uint64_t runLength = 0;
+   unsigned prevTxIndex = 0;
+
+   for (auto txioPtr : txios)
+   {
+      const auto& txio = *txioPtr;
+      bool isSpent = txio.hasTxIn();
+
+      uint8_t flags = 0;
+      if (txio.isTxOutFromSelf())
+         flags |= SUBSSH_FLAG_FROMSELF;
+      if (txio.isFromCoinbase())
+         flags |= SUBSSH_FLAG_COINBASE;
+      if (isSpent)
+         flags |= SUBSSH_FLAG_SPENT;
+      if (txio.isMultisig())
+         flags |= SUBSSH_FLAG_MULTISIG;
+      if (txio.isUTXO())
+         flags |= SUBSSH_FLAG_UTXO;
+
+      if (runLength > 0 && flags != runFlags)
+      {
+         bwFlags.put_uint8_t(runFlags);
+         bwFlags.put_var_int(runLength);
+         runLength = 0;
+      }
+      runFlags = flags;
+      ++runLength;
+
+      bwValues.put_var_int(txio.getValue());
+
+      auto txOutTxIndex = txio.getTxRefOfOutput().getBlockTxIndex();
+      if (!isSpent)
+      {
+         //txioMap_ is ordered by output key, unspent tx indexes only grow
+         bwKeys.put_var_int(txOutTxIndex - prevTxIndex);
+         bwKeys.put_var_int(txio.getIndexOfOutput());
+         prevTxIndex = txOutTxIndex;
+      }
+      else
+      {
+         //TxIOPair is slow, convert hgtx manually
+         auto outputPtr = txio.getTxRefOfOutput().getDBKey().getPtr();
+         auto inputPtr = txio.getTxRefOfInput().getDBKey().getPtr();
+         auto heightOf = [](const uint8_t* ptr)->int64_t
+         {
+            return ((int64_t)ptr[0] << 16) | ((int64_t)ptr[1] << 8) | ptr[2];
+         };
+
+         bwKeys.put_var_int(
+            zigzagEncode(heightOf(inputPtr) - heightOf(outputPtr)));
+         bwKeys.put_uint8_t(outputPtr[3]);
+         bwKeys.put_var_int(txOutTxIndex);
+         bwKeys.put_var_int(txio.getIndexOfOutput());
+
+         bwKeys.put_var_int(txio.getTxRefOfInput().getBlockTxIndex());
+         bwKeys.put_var_int(txio.getIndexOfInput());
+      }
+   }
+
+   if (runLength > 0)
+   {
+      bwFlags.put_uint8_t(runFlags);
+      bwFlags.put_var_int(runLength);
+   }
+
+   bw.reserve(
+      10 + bwFlags.getSize() + bwValues.getSize() + bwKeys.getSize());
+
+   bw.put_uint8_t(SUBSSH_VALUE_MARKER);
+   bw.put_uint8_t(SUBSSH_VALUE_VERSION);
+   bw.put_var_int(txios.size());
+   bw.put_var_int(bwFlags.getSize());
+   bw.put_BinaryDataRef(bwFlags.getDataRef());
+   bw.put_var_int(bwValues.getSize());
+   bw.put_BinaryDataRef(bwValues.getDataRef());
+   bw.put_BinaryDataRef(bwKeys.getDataRef());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void StoredSubHistory::serializeDBValue_Legacy(BinaryWriter & bw) const
 {
    size_t len = BtcUtils::get_varint_len(txioMap_.size());
    for (const auto& txioPair : txioMap_)
@@ -50,6 +50,7 @@ enum DB_SELECT
    ZERO_CONF,
    TXFILTERS,
    SPENTNESS,
+   BLOCKFILTERS,
    COUNT
 };
 
@@ -99,6 +100,10 @@ static BinaryData serializeDBValue(const T &o, const Args &...a)
    return wr.getData();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//sdbi flags, serialized as an optional trailer, sdbis without one read as 0
+#define SDBI_FLAG_SUBSSH_VERSIONED  0x00000001
+
 ////////////////////////////////////////////////////////////////////////////////
 class StoredDBInfo
 {
@@ -128,6 +133,7 @@ public:
    uint32_t        armoryVer_=ARMORY_DB_VERSION;
    ARMORY_DB_TYPE  armoryType_=ARMORY_DB_FULL; //default db mode
    uint64_t metaInt_ = UINT64_MAX;
+   uint32_t flags_ = 0;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -422,6 +428,19 @@ public:
    std::map<uint16_t, StoredTx> stxMap_;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//subssh values leading with this byte are versioned, legacy values start with
+//a txio count varint, which never uses the 8 byte 0xFF form. Lite dbs only
+//get versioned values once their SUBSSH sdbi carries SDBI_FLAG_SUBSSH_VERSIONED
+#define SUBSSH_VALUE_MARKER   0xFF
+#define SUBSSH_VALUE_VERSION  1
+
+#define SUBSSH_FLAG_FROMSELF  0x01
+#define SUBSSH_FLAG_COINBASE  0x02
+#define SUBSSH_FLAG_SPENT     0x04
+#define SUBSSH_FLAG_MULTISIG  0x08
+#define SUBSSH_FLAG_UTXO      0x10
+
 ////////////////////////////////////////////////////////////////////////////////
 // We must break out script histories into isolated sub-histories, to
 // accommodate thoroughly re-used addresses like 1VayNert* and 1dice*.  If 
@@ -446,6 +465,11 @@ public:
    void       unserializeDBValue(BinaryRefReader & brr);
    void       serializeDBValue(BinaryWriter    & bw) const;
    void       unserializeDBValue(BinaryData const & bd);
+
+   //pre versioning format, unserializeDBValue falls back to it
+   void       unserializeDBValue_Legacy(BinaryRefReader & brr);
+   void       serializeDBValue_Legacy(BinaryWriter & bw) const;
+
    void       unserializeDBValue(BinaryDataRef      bd);
    void       unserializeDBKey(BinaryDataRef key, bool withPrefix=true);
    void       getSummary(BinaryRefReader & brr);
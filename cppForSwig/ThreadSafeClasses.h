@@ -21,6 +21,13 @@
 #include <iostream>
 #include <condition_variable>
 #include <deque>
+#include <mutex>
+#include <iterator>
+#include <stdexcept>
+#include <algorithm>
+#include <list>
+#include <array>
+#include <functional>
 
 #include "make_unique.h"
 
@@ -1014,6 +1021,923 @@ public:
 		return count_.load(std::memory_order_relaxed);
    }
 };
+
+////////////////////////////////////////////////////////////////////////////////
+template<typename T, typename U, typename Compare = std::less<T>>
+class PersistentMap
+{
+   /***
+   Immutable ordered map with structure sharing. Nodes are never modified 
+   once built: a mutation copies the root to leaf path it touches (AVL 
+   rebalanced) and shares every other node with the previous version. 
+   Copying a PersistentMap is O(1), mutating the copy leaves the original 
+   untouched.
+
+   The read side mimics the const interface of std::map, so snapshots can be
+   handed out where a shared_ptr<const std::map> used to be. Iterators are
+   only valid for as long as the map they were obtained from is alive.
+   ***/
+
+public:
+   typedef T key_type;
+   typedef U mapped_type;
+   typedef std::pair<const T, U> value_type;
+   typedef size_t size_type;
+
+private:
+   struct Node
+   {
+      const value_type kv_;
+      const std::shared_ptr<const Node> left_;
+      const std::shared_ptr<const Node> right_;
+      const size_t size_;
+      const int height_;
+
+      Node(const value_type& kv,
+         std::shared_ptr<const Node> left, std::shared_ptr<const Node> right) :
+         kv_(kv), left_(std::move(left)), right_(std::move(right)),
+         size_(1 + nodeSize(left_) + nodeSize(right_)),
+         height_(1 + std::max(nodeHeight(left_), nodeHeight(right_)))
+      {}
+
+      Node(value_type&& kv,
+         std::shared_ptr<const Node> left, std::shared_ptr<const Node> right) :
+         kv_(std::move(kv)), left_(std::move(left)), right_(std::move(right)),
+         size_(1 + nodeSize(left_) + nodeSize(right_)),
+         height_(1 + std::max(nodeHeight(left_), nodeHeight(right_)))
+      {}
+   };
+
+   typedef std::shared_ptr<const Node> NodePtr;
+
+public:
+   /////////////////////////////////////////////////////////////////////////////
+   class const_iterator
+   {
+      friend class PersistentMap;
+
+   public:
+      typedef std::bidirectional_iterator_tag iterator_category;
+      typedef typename PersistentMap::value_type value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const value_type* pointer;
+      typedef const value_type& reference;
+
+   private:
+      //root to current node, kept inline so that lookups don't allocate. 
+      //An AVL tree this deep holds at least fib(66) - 1 nodes.
+      class Path
+      {
+      private:
+         std::array<const Node*, 64> nodes_;
+         size_t size_ = 0;
+
+      public:
+         Path(void)
+         {}
+
+         Path(const Path& rhs) :
+            size_(rhs.size_)
+         {
+            std::copy(rhs.nodes_.begin(), rhs.nodes_.begin() + size_, 
+               nodes_.begin());
+         }
+
+         Path& operator=(const Path& rhs)
+         {
+            size_ = rhs.size_;
+            std::copy(rhs.nodes_.begin(), rhs.nodes_.begin() + size_, 
+               nodes_.begin());
+            return *this;
+         }
+
+         void push_back(const Node* node) 
+         {
+            if (size_ == nodes_.size())
+               throw std::length_error("PersistentMap path overflow");
+            nodes_[size_++] = node;
+         }
+
+         void pop_back(void) { --size_; }
+         const Node* back(void) const { return nodes_[size_ - 1]; }
+         size_t size(void) const { return size_; }
+         void resize(size_t size) { size_ = size; }
+      };
+
+      //empty path for end()
+      const Node* root_ = nullptr;
+      Path path_;
+
+      void pushLeftmost(const Node* node)
+      {
+         while (node != nullptr)
+         {
+            path_.push_back(node);
+            node = node->left_.get();
+         }
+      }
+
+      void pushRightmost(const Node* node)
+      {
+         while (node != nullptr)
+         {
+            path_.push_back(node);
+            node = node->right_.get();
+         }
+      }
+
+   public:
+      const_iterator(void)
+      {}
+
+      reference operator*(void) const { return path_.back()->kv_; }
+      pointer operator->(void) const { return &path_.back()->kv_; }
+
+      const_iterator& operator++(void)
+      {
+         auto node = path_.back();
+         if (node->right_ != nullptr)
+         {
+            pushLeftmost(node->right_.get());
+            return *this;
+         }
+
+         path_.pop_back();
+         while (path_.size() > 0 && path_.back()->right_.get() == node)
+         {
+            node = path_.back();
+            path_.pop_back();
+         }
+
+         return *this;
+      }
+
+      const_iterator& operator--(void)
+      {
+         if (path_.size() == 0)
+         {
+            pushRightmost(root_);
+            return *this;
+         }
+
+         auto node = path_.back();
+         if (node->left_ != nullptr)
+         {
+            pushRightmost(node->left_.get());
+            return *this;
+         }
+
+         path_.pop_back();
+         while (path_.size() > 0 && path_.back()->left_.get() == node)
+         {
+            node = path_.back();
+            path_.pop_back();
+         }
+
+         return *this;
+      }
+
+      const_iterator operator++(int)
+      {
+         auto copy = *this;
+         ++(*this);
+         return copy;
+      }
+
+      const_iterator operator--(int)
+      {
+         auto copy = *this;
+         --(*this);
+         return copy;
+      }
+
+      bool operator==(const const_iterator& rhs) const
+      {
+         if (path_.size() == 0 || rhs.path_.size() == 0)
+            return path_.size() == rhs.path_.size();
+
+         return path_.back() == rhs.path_.back();
+      }
+
+      bool operator!=(const const_iterator& rhs) const
+      {
+         return !(*this == rhs);
+      }
+   };
+
+   typedef const_iterator iterator;
+   typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+   typedef const_reverse_iterator reverse_iterator;
+
+private:
+   NodePtr root_;
+   Compare comp_;
+
+private:
+   static size_t nodeSize(const NodePtr& node)
+   {
+      return node == nullptr ? 0 : node->size_;
+   }
+
+   static int nodeHeight(const NodePtr& node)
+   {
+      return node == nullptr ? 0 : node->height_;
+   }
+
+   template<typename KV>
+   static NodePtr balance(KV&& kv, NodePtr left, NodePtr right)
+   {
+      auto hl = nodeHeight(left);
+      auto hr = nodeHeight(right);
+
+      if (hl > hr + 1)
+      {
+         if (nodeHeight(left->left_) >= nodeHeight(left->right_))
+         {
+            //single right rotation
+            return std::make_shared<Node>(left->kv_, left->left_,
+               std::make_shared<Node>(
+                  std::forward<KV>(kv), left->right_, std::move(right)));
+         }
+
+         //left-right rotation
+         auto& lr = left->right_;
+         return std::make_shared<Node>(lr->kv_,
+            std::make_shared<Node>(left->kv_, left->left_, lr->left_),
+            std::make_shared<Node>(
+               std::forward<KV>(kv), lr->right_, std::move(right)));
+      }
+      else if (hr > hl + 1)
+      {
+         if (nodeHeight(right->right_) >= nodeHeight(right->left_))
+         {
+            //single left rotation
+            return std::make_shared<Node>(right->kv_,
+               std::make_shared<Node>(
+                  std::forward<KV>(kv), std::move(left), right->left_),
+               right->right_);
+         }
+
+         //right-left rotation
+         auto& rl = right->left_;
+         return std::make_shared<Node>(rl->kv_,
+            std::make_shared<Node>(
+               std::forward<KV>(kv), std::move(left), rl->left_),
+            std::make_shared<Node>(right->kv_, rl->right_, right->right_));
+      }
+
+      return std::make_shared<Node>(
+         std::forward<KV>(kv), std::move(left), std::move(right));
+   }
+
+   NodePtr insertNode(const NodePtr& node, 
+      value_type&& kv, bool overwrite, bool& inserted) const
+   {
+      if (node == nullptr)
+      {
+         inserted = true;
+         return std::make_shared<Node>(std::move(kv), nullptr, nullptr);
+      }
+
+      if (comp_(kv.first, node->kv_.first))
+      {
+         auto newLeft = insertNode(node->left_, std::move(kv), overwrite, inserted);
+         if (newLeft == node->left_)
+            return node;
+         return balance(node->kv_, std::move(newLeft), node->right_);
+      }
+      else if (comp_(node->kv_.first, kv.first))
+      {
+         auto newRight = insertNode(node->right_, std::move(kv), overwrite, inserted);
+         if (newRight == node->right_)
+            return node;
+         return balance(node->kv_, node->left_, std::move(newRight));
+      }
+
+      inserted = false;
+      if (!overwrite)
+         return node;
+
+      return std::make_shared<Node>(
+         std::move(kv), node->left_, node->right_);
+   }
+
+   static NodePtr eraseMin(const NodePtr& node, const Node*& minNode)
+   {
+      if (node->left_ == nullptr)
+      {
+         minNode = node.get();
+         return node->right_;
+      }
+
+      auto newLeft = eraseMin(node->left_, minNode);
+      return balance(node->kv_, std::move(newLeft), node->right_);
+   }
+
+   NodePtr eraseNode(const NodePtr& node, const T& key, bool& erased) const
+   {
+      if (node == nullptr)
+         return node;
+
+      if (comp_(key, node->kv_.first))
+      {
+         auto newLeft = eraseNode(node->left_, key, erased);
+         if (!erased)
+            return node;
+         return balance(node->kv_, std::move(newLeft), node->right_);
+      }
+      else if (comp_(node->kv_.first, key))
+      {
+         auto newRight = eraseNode(node->right_, key, erased);
+         if (!erased)
+            return node;
+         return balance(node->kv_, node->left_, std::move(newRight));
+      }
+
+      erased = true;
+      if (node->left_ == nullptr)
+         return node->right_;
+      if (node->right_ == nullptr)
+         return node->left_;
+
+      //replace with in-order successor
+      const Node* minNode = nullptr;
+      auto newRight = eraseMin(node->right_, minNode);
+      return balance(minNode->kv_, node->left_, std::move(newRight));
+   }
+
+   template<typename Pred>
+   const_iterator bound(const T& key, Pred goLeft) const
+   {
+      //descend, the result is the last node we branched left from
+      const_iterator iter;
+      iter.root_ = root_.get();
+
+      size_t depth = 0;
+      auto node = root_.get();
+      while (node != nullptr)
+      {
+         iter.path_.push_back(node);
+         if (goLeft(node->kv_.first))
+         {
+            depth = iter.path_.size();
+            node = node->left_.get();
+         }
+         else
+         {
+            node = node->right_.get();
+         }
+      }
+
+      iter.path_.resize(depth);
+      return iter;
+   }
+
+public:
+   PersistentMap(void)
+   {}
+
+   PersistentMap(const std::map<T, U>& stdMap)
+   {
+      for (auto& data_pair : stdMap)
+         insert_or_assign(data_pair.first, data_pair.second);
+   }
+
+   //read
+   size_t size(void) const { return nodeSize(root_); }
+   bool empty(void) const { return root_ == nullptr; }
+
+   const_iterator begin(void) const
+   {
+      const_iterator iter;
+      iter.root_ = root_.get();
+      iter.pushLeftmost(root_.get());
+      return iter;
+   }
+
+   const_iterator end(void) const
+   {
+      const_iterator iter;
+      iter.root_ = root_.get();
+      return iter;
+   }
+
+   const_iterator cbegin(void) const { return begin(); }
+   const_iterator cend(void) const { return end(); }
+
+   const_reverse_iterator rbegin(void) const 
+   { return const_reverse_iterator(end()); }
+   const_reverse_iterator rend(void) const 
+   { return const_reverse_iterator(begin()); }
+
+   const_iterator find(const T& key) const
+   {
+      const_iterator iter;
+      iter.root_ = root_.get();
+
+      auto node = root_.get();
+      while (node != nullptr)
+      {
+         iter.path_.push_back(node);
+         if (comp_(key, node->kv_.first))
+            node = node->left_.get();
+         else if (comp_(node->kv_.first, key))
+            node = node->right_.get();
+         else
+            return iter;
+      }
+
+      return end();
+   }
+
+   size_t count(const T& key) const
+   {
+      auto node = root_.get();
+      while (node != nullptr)
+      {
+         if (comp_(key, node->kv_.first))
+            node = node->left_.get();
+         else if (comp_(node->kv_.first, key))
+            node = node->right_.get();
+         else
+            return 1;
+      }
+
+      return 0;
+   }
+
+   const U& at(const T& key) const
+   {
+      auto iter = find(key);
+      if (iter == end())
+         throw std::out_of_range("PersistentMap::at");
+
+      return iter->second;
+   }
+
+   const_iterator lower_bound(const T& key) const
+   {
+      return bound(key, [this, &key](const T& nodeKey)->bool
+         { return !comp_(nodeKey, key); });
+   }
+
+   const_iterator upper_bound(const T& key) const
+   {
+      return bound(key, [this, &key](const T& nodeKey)->bool
+         { return comp_(key, nodeKey); });
+   }
+
+   //write, O(log n), only copies the path to the modified node
+   bool insert(value_type kv)
+   {
+      bool inserted = false;
+      root_ = insertNode(root_, std::move(kv), false, inserted);
+      return inserted;
+   }
+
+   bool insert_or_assign(const T& key, U val)
+   {
+      bool inserted = false;
+      root_ = insertNode(root_, 
+         value_type(key, std::move(val)), true, inserted);
+      return inserted;
+   }
+
+   size_t erase(const T& key)
+   {
+      bool erased = false;
+      root_ = eraseNode(root_, key, erased);
+      return erased ? 1 : 0;
+   }
+
+   void clear(void)
+   {
+      root_.reset();
+   }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+template<typename T, typename U> class TransactionalPersistentMap
+{
+   /*
+   Same semantics as TransactionalMap (locked writes, lockless snapshot 
+   reads through get()), backed by a PersistentMap instead of a std::map. 
+   A write costs O(log n) per modified entry rather than a full copy of
+   the map, so batching k entries through update() is O(k log n).
+   */
+
+private:
+   mutable std::mutex mu_;
+   std::shared_ptr<const PersistentMap<T, U>> map_;
+   std::atomic<size_t> count_;
+
+private:
+   void commit(std::shared_ptr<const PersistentMap<T, U>> newMap)
+   {
+      //mu_ has to be held by the caller
+      count_.store(newMap->size(), std::memory_order_relaxed);
+      std::atomic_store(&map_, newMap);
+   }
+
+   template<typename Container> void eraseKeys(const Container& idVec)
+   {
+      if (idVec.size() == 0)
+         return;
+
+      std::unique_lock<std::mutex> lock(mu_);
+      auto newMap = std::make_shared<PersistentMap<T, U>>(*map_);
+
+      bool erased = false;
+      for (auto& id : idVec)
+      {
+         if (newMap->erase(id) != 0)
+            erased = true;
+      }
+
+      if (erased)
+         commit(newMap);
+   }
+
+public:
+   TransactionalPersistentMap(void)
+   {
+      count_.store(0, std::memory_order_relaxed);
+      map_ = std::make_shared<PersistentMap<T, U>>();
+   }
+
+   void insert(std::pair<T, U>&& mv)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      auto newMap = std::make_shared<PersistentMap<T, U>>(*map_);
+      if (!newMap->insert(std::move(mv)))
+         return;
+
+      commit(newMap);
+   }
+
+   void insert(const std::pair<T, U>& obj)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      auto newMap = std::make_shared<PersistentMap<T, U>>(*map_);
+      if (!newMap->insert(obj))
+         return;
+
+      commit(newMap);
+   }
+
+   void update(const std::map<T, U>& updatemap)
+   {
+      //entries in updatemap replace existing ones
+      if (updatemap.size() == 0)
+         return;
+
+      std::unique_lock<std::mutex> lock(mu_);
+      auto newMap = std::make_shared<PersistentMap<T, U>>(*map_);
+      for (auto& data_pair : updatemap)
+         newMap->insert_or_assign(data_pair.first, data_pair.second);
+
+      commit(newMap);
+   }
+
+   void update(const PersistentMap<T, U>& updatemap)
+   {
+      if (updatemap.size() == 0)
+         return;
+
+      std::unique_lock<std::mutex> lock(mu_);
+      auto newMap = std::make_shared<PersistentMap<T, U>>(*map_);
+      for (auto& data_pair : updatemap)
+         newMap->insert_or_assign(data_pair.first, data_pair.second);
+
+      commit(newMap);
+   }
+
+   void erase(const T& id)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      auto newMap = std::make_shared<PersistentMap<T, U>>(*map_);
+      if (newMap->erase(id) == 0)
+         return;
+
+      commit(newMap);
+   }
+
+   void erase(const std::vector<T>& idVec)
+   {
+      eraseKeys(idVec);
+   }
+
+   void erase(const std::deque<T>& idVec)
+   {
+      eraseKeys(idVec);
+   }
+
+   std::shared_ptr<const PersistentMap<T, U>> pop_all(void)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      auto retMap = std::atomic_load(&map_);
+      commit(std::make_shared<PersistentMap<T, U>>());
+      return retMap;
+   }
+
+   std::shared_ptr<const PersistentMap<T, U>> get(void) const
+   {
+      return std::atomic_load(&map_);
+   }
+
+   void clear(void)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      commit(std::make_shared<PersistentMap<T, U>>());
+   }
+
+   size_t size(void) const
+   {
+      return count_.load(std::memory_order_relaxed);
+   }
+};
+////////////////////////////////////////////////////////////////////////////////
+template<typename T, typename U> class LruCache
+{
+   /*
+   size bounded map evicting the least recently used entry, all operations 
+   are locked. Meant for caches of expensive to build values, keep U cheap 
+   to copy (i.e. a shared_ptr)
+   */
+
+private:
+   typedef std::list<std::pair<T, U>> EntryList;
+
+   mutable std::mutex mu_;
+   EntryList entries_;
+   std::map<T, typename EntryList::iterator> index_;
+   const size_t capacity_;
+
+public:
+   LruCache(size_t capacity) :
+      capacity_(std::max(capacity, (size_t)1))
+   {}
+
+   bool get(const T& key, U& val)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      auto iter = index_.find(key);
+      if (iter == index_.end())
+         return false;
+
+      //move to front
+      entries_.splice(entries_.begin(), entries_, iter->second);
+      val = iter->second->second;
+      return true;
+   }
+
+   void put(const T& key, U val)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      auto iter = index_.find(key);
+      if (iter != index_.end())
+      {
+         iter->second->second = std::move(val);
+         entries_.splice(entries_.begin(), entries_, iter->second);
+         return;
+      }
+
+      entries_.emplace_front(key, std::move(val));
+      index_.insert(std::make_pair(key, entries_.begin()));
+
+      while (entries_.size() > capacity_)
+      {
+         index_.erase(entries_.back().first);
+         entries_.pop_back();
+      }
+   }
+
+   void erase(const T& key)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      auto iter = index_.find(key);
+      if (iter == index_.end())
+         return;
+
+      entries_.erase(iter->second);
+      index_.erase(iter);
+   }
+
+   void clear(void)
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      index_.clear();
+      entries_.clear();
+   }
+
+   size_t size(void) const
+   {
+      std::unique_lock<std::mutex> lock(mu_);
+      return entries_.size();
+   }
+
+   size_t capacity(void) const { return capacity_; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+template<typename T, typename U, typename Hash = std::hash<T>> 
+class ShardedLruCache
+{
+   /*
+   byte bounded lru, split in shards that each carry their own lock and 
+   an even share of the budget. Keys are spread across shards by Hash. 
+   Entry sizes are reported by the sizeOf lambda. A shard always keeps its 
+   most recent entry, even if it alone exceeds the shard budget.
+   */
+
+public:
+   typedef std::function<size_t(const T&, const U&)> SizeOfLambda;
+
+private:
+   typedef std::list<std::pair<T, U>> EntryList;
+
+   struct Shard
+   {
+      std::mutex mu_;
+      EntryList entries_;
+      std::map<T, typename EntryList::iterator> index_;
+      size_t byteSize_ = 0;
+   };
+
+   std::vector<std::unique_ptr<Shard>> shards_;
+   std::atomic<size_t> shardBudget_;
+   const SizeOfLambda sizeOf_;
+
+   mutable std::atomic<uint64_t> hits_;
+   mutable std::atomic<uint64_t> misses_;
+
+private:
+   Shard& getShard(const T& key) const
+   {
+      return *shards_[Hash()(key) % shards_.size()];
+   }
+
+   void evict(Shard& shard)
+   {
+      auto budget = shardBudget_.load(std::memory_order_relaxed);
+      while (shard.byteSize_ > budget && shard.entries_.size() > 1)
+      {
+         auto& entry = shard.entries_.back();
+         shard.byteSize_ -= sizeOf_(entry.first, entry.second);
+         shard.index_.erase(entry.first);
+         shard.entries_.pop_back();
+      }
+   }
+
+public:
+   ShardedLruCache(size_t byteBudget, unsigned shardCount, 
+      const SizeOfLambda& sizeOf) :
+      shardBudget_(byteBudget / std::max(shardCount, 1U)), sizeOf_(sizeOf)
+   {
+      hits_.store(0, std::memory_order_relaxed);
+      misses_.store(0, std::memory_order_relaxed);
+
+      for (unsigned i = 0; i < std::max(shardCount, 1U); i++)
+         shards_.push_back(make_unique<Shard>());
+   }
+
+   bool get(const T& key, U& val) const
+   {
+      auto& shard = getShard(key);
+      std::unique_lock<std::mutex> lock(shard.mu_);
+      auto iter = shard.index_.find(key);
+      if (iter == shard.index_.end())
+      {
+         misses_.fetch_add(1, std::memory_order_relaxed);
+         return false;
+      }
+
+      //move to front
+      shard.entries_.splice(
+         shard.entries_.begin(), shard.entries_, iter->second);
+      val = iter->second->second;
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+   }
+
+   void put(const T& key, U val)
+   {
+      auto& shard = getShard(key);
+      std::unique_lock<std::mutex> lock(shard.mu_);
+      auto iter = shard.index_.find(key);
+      if (iter != shard.index_.end())
+      {
+         auto& entry = *iter->second;
+         shard.byteSize_ -= sizeOf_(entry.first, entry.second);
+         entry.second = std::move(val);
+         shard.byteSize_ += sizeOf_(entry.first, entry.second);
+         shard.entries_.splice(
+            shard.entries_.begin(), shard.entries_, iter->second);
+      }
+      else
+      {
+         shard.entries_.emplace_front(key, std::move(val));
+         shard.index_.insert(std::make_pair(key, shard.entries_.begin()));
+         shard.byteSize_ += sizeOf_(key, shard.entries_.front().second);
+      }
+
+      evict(shard);
+   }
+
+   void erase(const T& key)
+   {
+      auto& shard = getShard(key);
+      std::unique_lock<std::mutex> lock(shard.mu_);
+      auto iter = shard.index_.find(key);
+      if (iter == shard.index_.end())
+         return;
+
+      auto& entry = *iter->second;
+      shard.byteSize_ -= sizeOf_(entry.first, entry.second);
+      shard.entries_.erase(iter->second);
+      shard.index_.erase(iter);
+   }
+
+   //resizes in place, shrinking evicts the oldest entries right away
+   void setBudget(size_t byteBudget)
+   {
+      shardBudget_.store(
+         byteBudget / shards_.size(), std::memory_order_relaxed);
+
+      for (auto& shardPtr : shards_)
+      {
+         std::unique_lock<std::mutex> lock(shardPtr->mu_);
+         evict(*shardPtr);
+      }
+   }
+
+   void clear(void)
+   {
+      for (auto& shardPtr : shards_)
+      {
+         std::unique_lock<std::mutex> lock(shardPtr->mu_);
+         shardPtr->index_.clear();
+         shardPtr->entries_.clear();
+         shardPtr->byteSize_ = 0;
+      }
+   }
+
+   size_t size(void) const
+   {
+      size_t count = 0;
+      for (auto& shardPtr : shards_)
+      {
+         std::unique_lock<std::mutex> lock(shardPtr->mu_);
+         count += shardPtr->entries_.size();
+      }
+
+      return count;
+   }
+
+   size_t byteSize(void) const
+   {
+      size_t total = 0;
+      for (auto& shardPtr : shards_)
+      {
+         std::unique_lock<std::mutex> lock(shardPtr->mu_);
+         total += shardPtr->byteSize_;
+      }
+
+      return total;
+   }
+
+   uint64_t hits(void) const { return hits_.load(std::memory_order_relaxed); }
+   uint64_t misses(void) const 
+   { return misses_.load(std::memory_order_relaxed); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Splits [0, count) in threadCount contiguous ranges and runs func over each,
+// the first one on the calling thread. Returns once all ranges are done.
+inline void runOverRanges(size_t count, unsigned threadCount,
+   const std::function<void(size_t, size_t)>& func)
+{
+   if (threadCount == 0)
+      threadCount = 1;
+   auto rangeSize = (count + threadCount - 1) / threadCount;
+
+   std::vector<std::thread> threads;
+   for (unsigned i = 1; i < threadCount; i++)
+   {
+      auto start = std::min(rangeSize * i, count);
+      auto end = std::min(start + rangeSize, count);
+      if (start == end)
+         break;
+      threads.push_back(std::thread(func, start, end));
+   }
+
+   func(0, std::min(rangeSize, count));
+   for (auto& thr : threads)
+   {
+      if (thr.joinable())
+         thr.join();
+   }
+}
 }; //namespace ArmoryThreading
 
 #endif
@@ -6,11 +6,87 @@
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <thread>
+
 #include "Transactions.h"
+#include "ThreadSafeClasses.h"
 #include "make_unique.h"
 
 using namespace std;
 
+atomic<unsigned> TransactionVerifier::threadCount_(1);
+
+////////////////////////////////////////////////////////////////////////////////
+class SigCheckPool
+{
+   /***
+   Workers for parallel input checks. Spawned on demand, up to the highest
+   thread count a verification asked for, then reused by the following
+   verifications. The caller checks inputs as well, it waits on the jobs
+   it queued before returning.
+   ***/
+
+private:
+   ArmoryThreading::BlockingQueue<function<void(void)>> jobQueue_;
+   mutex mu_;
+   vector<thread> threads_;
+
+private:
+   void work(void)
+   {
+      while (true)
+      {
+         function<void(void)> job;
+         try
+         {
+            job = move(jobQueue_.pop_front());
+         }
+         catch (ArmoryThreading::StopBlockingLoop&)
+         {
+            return;
+         }
+
+         job();
+      }
+   }
+
+public:
+   ~SigCheckPool(void)
+   {
+      jobQueue_.terminate();
+      for (auto& thr : threads_)
+      {
+         if (thr.joinable())
+            thr.join();
+      }
+   }
+
+   void run(const function<void(void)>& lbd, unsigned threadCount)
+   {
+      {
+         unique_lock<mutex> lock(mu_);
+         while (threads_.size() + 1 < threadCount)
+            threads_.push_back(thread(&SigCheckPool::work, this));
+      }
+
+      vector<future<void>> futs;
+      for (unsigned i = 1; i < threadCount; i++)
+      {
+         auto task = make_shared<packaged_task<void(void)>>(lbd);
+         futs.push_back(task->get_future());
+         jobQueue_.push_back([task](void)->void { (*task)(); });
+      }
+
+      lbd();
+
+      //the jobs reference the caller's state, wait on all of them
+      for (auto& fut : futs)
+         fut.wait();
+   }
+};
+
+static SigCheckPool sigCheckPool_;
+
 ////////////////////////////////////////////////////////////////////////////////
 TransactionStub::~TransactionStub(void)
 {}
@@ -89,9 +165,35 @@ uint64_t TransactionVerifier::checkOutputs() const
    return inputVal - spendVal;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void TransactionVerifier::setThreadCount(unsigned count)
+{
+   threadCount_.store(count, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned TransactionVerifier::getThreadCount() const
+{
+   size_t threadCount = inputThreadCount_;
+   if (threadCount == 0)
+      threadCount = threadCount_.load(memory_order_relaxed);
+   if (threadCount == 0)
+      threadCount = thread::hardware_concurrency();
+
+   return min(threadCount, 
+      theTx_.txins_.size() / TXVERIFY_MIN_INPUTS_PER_THREAD);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void TransactionVerifier::checkSigs() const
 {
+   auto threadCount = getThreadCount();
+   if (threadCount > 1)
+   {
+      checkSigs_Parallel(false, threadCount);
+      return;
+   }
+
    txEvalState_.reset();
 
    for (unsigned i = 0; i < theTx_.txins_.size(); i++)
@@ -111,6 +213,13 @@ void TransactionVerifier::checkSigs() const
 ////////////////////////////////////////////////////////////////////////////////
 void TransactionVerifier::checkSigs_NoCatch() const
 {
+   auto threadCount = getThreadCount();
+   if (threadCount > 1)
+   {
+      checkSigs_Parallel(true, threadCount);
+      return;
+   }
+
    txEvalState_.reset();
 
    for (unsigned i = 0; i < theTx_.txins_.size(); i++)
@@ -120,6 +229,85 @@ void TransactionVerifier::checkSigs_NoCatch() const
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void TransactionVerifier::checkSigs_Parallel(
+   bool noCatch, unsigned threadCount) const
+{
+   txEvalState_.reset();
+   auto inputCount = theTx_.txins_.size();
+
+   /*
+   Inputs are checked independently but share this object. Set up what
+   evaluation otherwise writes lazily: the segwit and legacy pre states and
+   an op_cs offset entry per input. Past this point, workers only write to the 
+   entries of the inputs they check.
+   */
+   if (theTx_.usesWitness_)
+   {
+      if (sigHashDataObject_ == nullptr)
+         sigHashDataObject_ = make_shared<SigHashDataSegWit>();
+      sigHashDataObject_->computePreState(*this);
+   }
+
+   if (sigHashDataLegacy_ == nullptr)
+      sigHashDataLegacy_ = make_shared<SigHashDataLegacy>();
+   sigHashDataLegacy_->computePreState(*this);
+
+   for (unsigned i = 0; i < inputCount; i++)
+      lastCodeSeparatorMap_.insert(make_pair(i, 0));
+
+   vector<TxInEvalState> states(inputCount);
+   vector<exception_ptr> errors(inputCount);
+   atomic<unsigned> counter(0);
+
+   auto checkLbd = [&](void)->void
+   {
+      while (true)
+      {
+         auto inputId = counter.fetch_add(1, memory_order_relaxed);
+         if (inputId >= inputCount)
+            return;
+
+         auto stack_ptr = getStackInterpreter(inputId);
+         try
+         {
+            auto&& state = checkSig(inputId, stack_ptr.get());
+            if (noCatch)
+            {
+               states[inputId] = state;
+               continue;
+            }
+         }
+         catch (exception&)
+         {
+            if (noCatch)
+            {
+               errors[inputId] = current_exception();
+               continue;
+            }
+         }
+         catch (...)
+         {
+            errors[inputId] = current_exception();
+            continue;
+         }
+
+         states[inputId] = stack_ptr->getTxInEvalState();
+      }
+   };
+
+   sigCheckPool_.run(checkLbd, threadCount);
+
+   //report in input order, the serial path stops at the first error
+   for (unsigned i = 0; i < inputCount; i++)
+   {
+      if (errors[i] != nullptr)
+         rethrow_exception(errors[i]);
+
+      txEvalState_.updateState(i, states[i]);
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 unique_ptr<StackInterpreter> TransactionVerifier::getStackInterpreter(
    unsigned inputid) const
@@ -178,6 +366,11 @@ TxInEvalState TransactionVerifier::checkSig(
       stackPtr->setSegWitSigHashDataObject(sigHashDataObject_);
    }
 
+   //legacy inputs share the serialization template and its sha256 midstates
+   if (sigHashDataLegacy_ == nullptr)
+      sigHashDataLegacy_ = make_shared<SigHashDataLegacy>();
+   stackPtr->setLegacySigHashDataObject(sigHashDataLegacy_);
+
    if ((flags_ & SCRIPT_VERIFY_SEGWIT) &&
       inputScript.getSize() == 0)
    {
@@ -349,6 +542,29 @@ BinaryData SigHashData::getDataForSigHash(SIGHASH_TYPE hashType, const
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SigHashData::getSha256ForSigHash(SIGHASH_TYPE hashType, const
+   TransactionStub& stub, BinaryDataRef subScript, unsigned inputIndex)
+{
+   switch (hashType)
+   {
+   case SIGHASH_ALL:
+      return getSha256ForSigHashAll(stub, subScript, inputIndex);
+
+   default:
+      LOGERR << "unknown sighash type: " << (int)hashType;
+      throw UnsupportedSigHashTypeException("unhandled sighash type");
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SigHashData::getSha256ForSigHashAll(const TransactionStub& stub,
+   BinaryDataRef subScript, unsigned inputIndex)
+{
+   auto&& data = getDataForSigHashAll(stub, subScript, inputIndex);
+   return BtcUtils::getSha256(data);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 vector<BinaryDataRef> SigHashData::tokenize(
    const BinaryData& data, uint8_t token)
@@ -374,7 +590,7 @@ vector<BinaryDataRef> SigHashData::tokenize(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-BinaryData SigHashDataLegacy::getDataForSigHashAll(const TransactionStub& stub, 
+BinaryData SigHashDataLegacy::getSubScript(const TransactionStub& stub, 
    BinaryDataRef subScript, unsigned inputIndex)
 {
    //grab subscript
@@ -398,39 +614,75 @@ BinaryData SigHashDataLegacy::getDataForSigHashAll(const TransactionStub& stub,
       }
    }
 
+   return subscript;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SigHashDataLegacy::getDataForSigHashAll(const TransactionStub& stub, 
+   BinaryDataRef subScript, unsigned inputIndex)
+{
+   auto&& subscript = getSubScript(stub, subScript, inputIndex);
+
+   //pre state
+   computePreState(stub);
+   if (inputIndex >= scriptSigOffsets_.size())
+      throw runtime_error("invalid input index");
+
+   //swap the input's empty scriptSig for the subscript
+   auto offset = scriptSigOffsets_[inputIndex];
+   auto tailOffset = offset + 1;
+
+   BinaryWriter scriptSigData(template_.getSize() + subscript.getSize() + 9);
+   scriptSigData.put_BinaryDataRef(template_.getSliceRef(0, offset));
+   scriptSigData.put_var_int(subscript.getSize());
+   scriptSigData.put_BinaryData(subscript);
+   scriptSigData.put_BinaryDataRef(template_.getSliceRef(
+      tailOffset, template_.getSize() - tailOffset));
+
+   return BinaryData(scriptSigData.getData());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SigHashDataLegacy::getSha256ForSigHashAll(
+   const TransactionStub& stub, BinaryDataRef subScript, unsigned inputIndex)
+{
+   auto&& subscript = getSubScript(stub, subScript, inputIndex);
+
+   //pre state
+   computePreState(stub);
+   if (inputIndex >= scriptSigOffsets_.size())
+      throw runtime_error("invalid input index");
+
+   //resume from the template prefix state
+   auto offset = scriptSigOffsets_[inputIndex];
+   auto tailOffset = offset + 1;
+   auto ctx = midstates_[inputIndex];
+
+   BinaryWriter bwSize;
+   bwSize.put_var_int(subscript.getSize());
+   sha256_Update(&ctx, bwSize.getData().getPtr(), bwSize.getSize());
+   sha256_Update(&ctx, subscript.getPtr(), subscript.getSize());
+   sha256_Update(&ctx, template_.getPtr() + tailOffset,
+      template_.getSize() - tailOffset);
+
+   BinaryData digest(SHA256_DIGEST_LENGTH);
+   sha256_Final(digest.getPtr(), &ctx);
+   return digest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SigHashDataLegacy::computePreState(const TransactionStub& stub)
+{
+   if (initialized_)
+      return;
+
    //isolate outputs
    auto&& serializedOutputs = stub.getSerializedOutputScripts();
 
    //isolate inputs
    auto&& txinsData = stub.getTxInsData();
    auto txin_count = txinsData.size();
-   BinaryWriter strippedTxins;
-
-   for (unsigned i=0; i < txin_count; i++)
-   {
-      strippedTxins.put_BinaryData(txinsData[i].outputHash_);
-      strippedTxins.put_uint32_t(txinsData[i].outputIndex_);
-
-      if (inputIndex != i)
-      {
-         //put empty varint
-         strippedTxins.put_var_int(0);
-
-         //and sequence
-         strippedTxins.put_uint32_t(txinsData[i].sequence_);
-      }
-      else
-      {
-         //scriptsig
-         strippedTxins.put_var_int(subscript.getSize());
-         strippedTxins.put_BinaryData(subscript);
-         
-         //sequence
-         strippedTxins.put_uint32_t(txinsData[i].sequence_);
-      }
-   }
 
-   //wrap it up
    BinaryWriter scriptSigData;
 
    //version
@@ -439,8 +691,19 @@ BinaryData SigHashDataLegacy::getDataForSigHashAll(const TransactionStub& stub,
    //txin count
    scriptSigData.put_var_int(txin_count);
 
-   //txins
-   scriptSigData.put_BinaryData(strippedTxins.getData());
+   //txins, all with an empty scriptSig
+   scriptSigOffsets_.clear();
+   scriptSigOffsets_.reserve(txin_count);
+   for (unsigned i=0; i < txin_count; i++)
+   {
+      scriptSigData.put_BinaryData(txinsData[i].outputHash_);
+      scriptSigData.put_uint32_t(txinsData[i].outputIndex_);
+
+      scriptSigOffsets_.push_back(scriptSigData.getSize());
+      scriptSigData.put_var_int(0);
+
+      scriptSigData.put_uint32_t(txinsData[i].sequence_);
+   }
 
    //txout count
    scriptSigData.put_var_int(stub.getTxOutCount());
@@ -454,7 +717,24 @@ BinaryData SigHashDataLegacy::getDataForSigHashAll(const TransactionStub& stub,
    //sighashall
    scriptSigData.put_uint32_t(1);
 
-   return BinaryData(scriptSigData.getData());
+   template_ = scriptSigData.getData();
+
+   //sha256 state at each scriptSig, hashing the template once
+   midstates_.clear();
+   midstates_.reserve(txin_count);
+
+   SHA256_CTX ctx;
+   sha256_Init(&ctx);
+   size_t hashed = 0;
+   for (auto& offset : scriptSigOffsets_)
+   {
+      sha256_Update(&ctx, template_.getPtr() + hashed, offset - hashed);
+      midstates_.push_back(ctx);
+      hashed = offset;
+   }
+
+   //flag
+   initialized_ = true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -11,6 +11,7 @@
 
 #include <map>
 #include <vector>
+#include <atomic>
 
 #include "BinaryData.h"
 #include "EncryptionUtils.h"
@@ -18,6 +19,10 @@
 #include "BlockDataMap.h"
 #include "Script.h"
 #include "SigHashEnum.h"
+#include "btc/sha2.h"
+
+//txs with fewer inputs per verification thread than this are checked serially
+#define TXVERIFY_MIN_INPUTS_PER_THREAD 16
 
 class UnsupportedSigHashTypeException : public std::runtime_error
 {
@@ -40,6 +45,7 @@ class TransactionStub
 protected:
    unsigned flags_ = 0;
    mutable std::shared_ptr<SigHashDataSegWit> sigHashDataObject_ = nullptr;
+   mutable std::shared_ptr<SigHashDataLegacy> sigHashDataLegacy_ = nullptr;
 
 public:
    mutable std::map<unsigned, size_t> lastCodeSeparatorMap_;
@@ -95,14 +101,18 @@ public:
 class SigHashData
 {
    //this class and its children do not return the sighash, rather the data that
-   //will yield the hash
+   //will yield the hash, or that data through the first of its 2 sha256 rounds
 private:
    virtual BinaryData getDataForSigHashAll(const TransactionStub&,
       BinaryDataRef, unsigned) = 0;
+   virtual BinaryData getSha256ForSigHashAll(const TransactionStub&,
+      BinaryDataRef, unsigned);
 
 public:
    BinaryData getDataForSigHash(SIGHASH_TYPE, const TransactionStub&,
       BinaryDataRef outputScript, unsigned inputIndex);
+   BinaryData getSha256ForSigHash(SIGHASH_TYPE, const TransactionStub&,
+      BinaryDataRef outputScript, unsigned inputIndex);
    
    std::vector<BinaryDataRef> tokenize(const BinaryData&, uint8_t);
 };
@@ -110,14 +120,42 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 class SigHashDataLegacy : public SigHashData
 {
+   /***
+   Legacy sighash data is the tx with all scriptSigs emptied but the one of 
+   the input being signed, which carries the output script. The tx is 
+   serialized once, with every scriptSig empty, as a template for all 
+   inputs. Each input swaps its script in the template, and its hash starts 
+   from the sha256 state of the template prefix up to its scriptSig.
+
+   The template is built on first use: an object is bound to the tx it 
+   first sees, the same way SigHashDataSegWit is with its pre state.
+   ***/
+
+   friend class TransactionVerifier;
+
+private:
+   bool initialized_ = false;
+   BinaryData template_;
+   std::vector<size_t> scriptSigOffsets_;
+   std::vector<SHA256_CTX> midstates_;
+
 private:
+   BinaryData getSubScript(const TransactionStub&, 
+      BinaryDataRef, unsigned);
+
    BinaryData getDataForSigHashAll(const TransactionStub&,
       BinaryDataRef, unsigned);
+   BinaryData getSha256ForSigHashAll(const TransactionStub&,
+      BinaryDataRef, unsigned);
+
+   void computePreState(const TransactionStub&);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 class SigHashDataSegWit : public SigHashData
 {
+   friend class TransactionVerifier;
+
 private:
    bool initialized_ = false;
    BinaryData hashPrevouts_;
@@ -150,10 +188,18 @@ private:
    uint64_t checkOutputs(void) const;
    void checkSigs(void) const;
    void checkSigs_NoCatch(void) const;
+   void checkSigs_Parallel(bool, unsigned) const;
    TxInEvalState checkSig(unsigned, StackInterpreter* ptr=nullptr) const;
+   unsigned getThreadCount(void) const;
 
    mutable TxEvalState txEvalState_;
 
+   //1 by default, 0 to use all cores
+   static std::atomic<unsigned> threadCount_;
+
+   //overrides threadCount_ for this verifier when set
+   unsigned inputThreadCount_ = 0;
+
 protected:
    virtual std::unique_ptr<StackInterpreter> getStackInterpreter(unsigned) const;
 
@@ -185,6 +231,14 @@ public:
    bool verify(bool noCatch = true, bool strict = true) const;
    TxEvalState evaluateState(bool strict = true) const;
 
+   /*
+   Inputs are checked serially unless this is set above 1 (or 0 for all
+   cores), in which case inputs of large txs are checked across that many
+   pooled threads.
+   */
+   static void setThreadCount(unsigned);
+   void setInputThreadCount(unsigned count) { inputThreadCount_ = count; }
+
    BinaryDataRef getSerializedOutputScripts(void) const;
    std::vector<TxInData> getTxInsData(void) const;
    BinaryData getSubScript(unsigned index) const;
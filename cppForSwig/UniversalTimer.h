@@ -120,7 +120,7 @@ private:
       bool    isRunning_;
       std::chrono::time_point<std::chrono::system_clock> start_clock_;
       double  prev_elapsed_;
-      size_t  accum_time_;
+      double  accum_time_;
    };
    static UniversalTimer* theUT_;
    std::map<std::string, timer> call_timers_;
@@ -86,6 +86,8 @@ const BinaryData DBInterface::erasurePlaceHolder_ =
 const BinaryData DBInterface::keyCycleFlag_ =
    BinaryData::fromString(KEY_CYCLE_FLAG);
 
+atomic<unsigned> DBInterface::loadThreadCount_(0);
+
 ////////////////////////////////////////////////////////////////////////////////
 DBInterface::DBInterface(
    LMDBEnv* dbEnv, const std::string& dbName,
@@ -125,8 +127,12 @@ void DBInterface::loadAllEntries(const SecureBinaryData& rootKey)
 
    auto&& saltedRoot = BtcUtils::getHMAC256(controlSalt_, rootKey);
 
+   //every key pair seen during this load, indexed by key counter
+   vector<pair<SecureBinaryData, SecureBinaryData>> keyPairs;
+
    //key derivation method
-   auto computeKeyPair = [&saltedRoot, &decrPrivKey, &macKey](unsigned hmacKeyInt)
+   auto computeKeyPair = [&saltedRoot, &decrPrivKey, &macKey, &keyPairs]
+      (unsigned hmacKeyInt)
    {
       SecureBinaryData hmacKey((uint8_t*)&hmacKeyInt, 4);
       auto hmacVal = BtcUtils::getHMAC512(hmacKey, saltedRoot);
@@ -139,6 +145,8 @@ void DBInterface::loadAllEntries(const SecureBinaryData& rootKey)
       //decryption private key sanity check
       if (!CryptoECDSA::checkPrivKeyIsValid(decrPrivKey))
          throw WalletInterfaceException("invalid decryptin private key");
+
+      keyPairs.push_back(make_pair(decrPrivKey, macKey));
    };
 
    //init first decryption key pair
@@ -196,6 +204,26 @@ void DBInterface::loadAllEntries(const SecureBinaryData& rootKey)
       //read all db entries
       auto tx = LMDBEnv::Transaction(dbEnv_, LMDB::ReadOnly);
 
+      /*
+      Key cycling and gap bookkeeping depend on meta data packets, which 
+      are only recognizable once decrypted. Meta data packets are small, 
+      so packets that could be one are decrypted in order on this thread. 
+      The rest are tagged with the key in use at their position and 
+      decrypted in parallel afterwards.
+      */
+      struct LoadEntry
+      {
+         BinaryDataRef dbKey_;
+         BinaryDataRef packet_;
+         unsigned keyId_;
+         bool decrypted_ = false;
+         pair<BinaryData, BothBinaryDatas> dataPair_;
+      };
+
+      vector<LoadEntry> entries;
+      unsigned pendingCount = 0;
+      auto maxMetaSize = getMaxMetaPacketSize();
+
       int prevDbKey = -1;
       auto iter = db_.begin();
       while (iter.isValid())
@@ -224,6 +252,20 @@ void DBInterface::loadAllEntries(const SecureBinaryData& rootKey)
          //set lowest seen integer key
          prevDbKey = dbKeyInt;
 
+         LoadEntry entry;
+         entry.dbKey_ = key_bdr;
+         entry.packet_ = val_bdr;
+         entry.keyId_ = decrKeyCounter;
+
+         if (val_bdr.getSize() > maxMetaSize)
+         {
+            //cannot be meta data, defer
+            entries.push_back(move(entry));
+            ++pendingCount;
+            iter.advance();
+            continue;
+         }
+
          //grab the data
          auto dataPair = readDataPacket(
             key_bdr, val_bdr, decrPrivKey, macKey, encrVersion_);
@@ -241,12 +283,9 @@ void DBInterface::loadAllEntries(const SecureBinaryData& rootKey)
             continue;
          }
 
-         auto&& keyPair = make_pair(dataPair.first, move(key_bdr.copy()));
-         auto insertIter = dataMapPtr->dataKeyToDbKey_.emplace(keyPair);
-         if (!insertIter.second)
-            throw WalletInterfaceException("duplicated db entry");
-
-         dataMapPtr->dataMap_.emplace(dataPair);
+         entry.dataPair_ = move(dataPair);
+         entry.decrypted_ = true;
+         entries.push_back(move(entry));
          iter.advance();
       }
 
@@ -254,6 +293,77 @@ void DBInterface::loadAllEntries(const SecureBinaryData& rootKey)
       if (gaps.size() != 0)
          throw WalletInterfaceException("unfilled dbkey gaps!");
 
+      //decrypt deferred packets
+      auto encrVersion = encrVersion_;
+      atomic<unsigned> entryCounter(0);
+      exception_ptr eptr = nullptr;
+      mutex eptrMutex;
+
+      auto decryptLbd = [&entries, &entryCounter, &keyPairs, 
+         &eptr, &eptrMutex, encrVersion](void)->void
+      {
+         try
+         {
+            while (true)
+            {
+               auto id = entryCounter.fetch_add(1, memory_order_relaxed);
+               if (id >= entries.size())
+                  return;
+
+               auto& entry = entries[id];
+               if (entry.decrypted_)
+                  continue;
+
+               auto& keyPair = keyPairs[entry.keyId_];
+               entry.dataPair_ = readDataPacket(entry.dbKey_, entry.packet_,
+                  keyPair.first, keyPair.second, encrVersion);
+
+               if (entry.dataPair_.first.getSize() == 0)
+                  throw WalletInterfaceException("empty data key");
+               entry.decrypted_ = true;
+            }
+         }
+         catch (...)
+         {
+            unique_lock<mutex> lock(eptrMutex);
+            if (eptr == nullptr)
+               eptr = current_exception();
+
+            //stop the other workers early
+            entryCounter.store(entries.size(), memory_order_relaxed);
+         }
+      };
+
+      auto threadCount = getLoadThreadCount();
+      threadCount = min(threadCount, 
+         pendingCount / WALLET_LOAD_MIN_ENTRIES_PER_THREAD);
+
+      vector<thread> threads;
+      for (unsigned i = 1; i < threadCount; i++)
+         threads.push_back(thread(decryptLbd));
+      decryptLbd();
+
+      for (auto& thr : threads)
+      {
+         if (thr.joinable())
+            thr.join();
+      }
+
+      if (eptr != nullptr)
+         rethrow_exception(eptr);
+
+      //populate data map in db order
+      for (auto& entry : entries)
+      {
+         auto&& keyPair = make_pair(
+            entry.dataPair_.first, move(entry.dbKey_.copy()));
+         auto insertIter = dataMapPtr->dataKeyToDbKey_.emplace(keyPair);
+         if (!insertIter.second)
+            throw WalletInterfaceException("duplicated db entry");
+
+         dataMapPtr->dataMap_.emplace(move(entry.dataPair_));
+      }
+
       //set dbkey counter
       dataMapPtr->dbKeyCounter_ = prevDbKey + 1;
 
@@ -291,6 +401,39 @@ void DBInterface::loadAllEntries(const SecureBinaryData& rootKey)
    macKey_ = move(macKey);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void DBInterface::setLoadThreadCount(unsigned count)
+{
+   loadThreadCount_.store(count, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned DBInterface::getLoadThreadCount()
+{
+   auto count = loadThreadCount_.load(memory_order_relaxed);
+   if (count == 0)
+      count = thread::hardware_concurrency();
+
+   return max(count, 1U);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t DBInterface::getMaxMetaPacketSize()
+{
+   //erasure place holder payload carries a var_int sized 4 byte dbkey
+   size_t payloadSize = max(
+      keyCycleFlag_.getSize(), erasurePlaceHolder_.getSize() + 5);
+
+   //hmac | empty data key | payload, padded to the next aes block
+   size_t plainSize = 32 + 1 + 
+      BtcUtils::get_varint_len(payloadSize) + payloadSize;
+   size_t blockSize = Cipher::getBlockSize(CipherType_AES);
+   size_t cipherSize = (plainSize / blockSize + 1) * blockSize;
+
+   //compressed pubkey | iv | cipher text
+   return 33 + blockSize + cipherSize;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 BinaryData DBInterface::createDataPacket(const BinaryData& dbKey,
    const BinaryData& dataKey, const BothBinaryDatas& dataVal,
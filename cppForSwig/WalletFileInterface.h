@@ -16,6 +16,8 @@
 #include <string>
 #include <mutex>
 #include <functional>
+#include <atomic>
+#include <thread>
 
 #include "make_unique.h"
 #include "lmdbpp.h"
@@ -28,6 +30,9 @@
 #define ERASURE_PLACE_HOLDER "erased"
 #define KEY_CYCLE_FLAG "cycle"
 
+//below this many encrypted entries per thread, loading stays single threaded
+#define WALLET_LOAD_MIN_ENTRIES_PER_THREAD 64
+
 ////////////////////////////////////////////////////////////////////////////////
 class NoDataInDB : std::runtime_error
 {
@@ -145,6 +150,9 @@ private:
    const unsigned encrVersion_;
    PRNG_Fortuna fortuna_;
 
+   //0 to use all cores
+   static std::atomic<unsigned> loadThreadCount_;
+
 private:
    //serialization methods
    static BinaryData createDataPacket(const BinaryData& dbKey,
@@ -156,6 +164,9 @@ private:
       const SecureBinaryData&, const SecureBinaryData&,
       unsigned encrVersion);
 
+   static unsigned getLoadThreadCount(void);
+   static size_t getMaxMetaPacketSize(void);
+
 public:
    DBInterface(LMDBEnv*, 
       const std::string&, const SecureBinaryData&, unsigned encrVersion);
@@ -163,6 +174,7 @@ public:
 
    ////
    void loadAllEntries(const SecureBinaryData&);
+   static void setLoadThreadCount(unsigned);
    void reset(LMDBEnv*);
    void close(void) { db_.close(); }
 
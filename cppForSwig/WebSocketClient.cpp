@@ -474,6 +474,14 @@ void WebSocketClient::readService()
 
       if (bip151Connection_->connectionComplete())
       {
+         if (payload.getSize() < POLY1305MACLEN + 4)
+         {
+            //large frames come in several chunks, wait for at least
+            //the MAC and the encrypted size
+            leftOverData_ = move(payload);
+            continue;
+         }
+
          //decrypt packet
          auto result = bip151Connection_->decryptPacket(
             payload.getPtr(), payload.getSize(),
@@ -482,7 +490,7 @@ void WebSocketClient::readService()
          if (result != 0)
          {
             //see WebSocketServer::commandThread for the explaination
-            if (result <= WEBSOCKET_MESSAGE_PACKET_SIZE && result > -1)
+            if (result <= (int)maxFrameSize_ && result > -1)
             {
                leftOverData_ = move(payload);
                continue;
@@ -767,12 +775,40 @@ bool WebSocketClient::processAEADHandshake(const WebSocketMessagePartial& msgObj
       bip151Connection_->bip150HandshakeRekey();
       outKeyTimePoint_ = chrono::system_clock::now();
 
+      //ask the server to send replies as single large frames, replies
+      //stay fragmented until it acks
+      if (largeFrames_)
+      {
+         uint32_t maxFrameSize = WEBSOCKET_LARGE_FRAME_MAX_SIZE;
+         BinaryData framingPayload(4);
+         memcpy(framingPayload.getPtr(), &maxFrameSize, 4);
+         writeData(framingPayload, WS_MSGTYPE_FRAMING_LARGE, true);
+      }
+
       //flag connection as ready
       connectionReadyProm_.set_value(true);
 
       break;
    }
 
+   case WS_MSGTYPE_FRAMING_LARGE:
+   {
+      //server ack of our large frame request, payload is its max frame size
+      if (!largeFrames_ ||
+         bip151Connection_->getBIP150State() != BIP150State::SUCCESS ||
+         msgbdr.getSize() != 4)
+      {
+         return false;
+      }
+
+      uint32_t maxFrameSize;
+      memcpy(&maxFrameSize, msgbdr.getPtr(), 4);
+      maxFrameSize_ = max<uint32_t>(WEBSOCKET_MESSAGE_PACKET_SIZE, 
+         min<uint32_t>(maxFrameSize, WEBSOCKET_LARGE_FRAME_MAX_SIZE));
+
+      break;
+   }
+
    default:
       return false;
    }
@@ -131,6 +131,11 @@ private:
    std::shared_ptr<AuthorizedPeers> authPeers_;
    BinaryData leftOverData_;
 
+   //largest frame we take from the server, raised once the server acks
+   //our large frame request
+   bool largeFrames_ = false;
+   std::atomic<uint32_t> maxFrameSize_ = { WEBSOCKET_MESSAGE_PACKET_SIZE };
+
    std::shared_ptr<std::promise<bool>> serverPubkeyProm_;
    std::function<bool(const BinaryData&, const std::string&)> userPromptLambda_;
 
@@ -167,6 +172,12 @@ public:
    void addPublicKey(const SecureBinaryData&);
    void setPubkeyPromptLambda(std::function<bool(const BinaryData&, const std::string&)>);
 
+   //opt in to large frames, call before connectToRemote. Servers that
+   //predate large frames drop the connection on the request
+   void enableLargeFrames(void) { largeFrames_ = true; }
+   uint32_t getMaxFrameSize(void) const 
+   { return maxFrameSize_.load(std::memory_order_relaxed); }
+
    //virtuals
    SocketType type(void) const { return SocketWS; }
    void pushPayload(
@@ -241,6 +241,55 @@ vector<BinaryData> WebSocketMessageCodec::serialize(
    return result;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+BinaryData WebSocketMessageCodec::serializeLargeFrame(
+   const ::google::protobuf::Message& msg, BIP151Connection* connPtr,
+   uint32_t id)
+{
+   /***
+   Large frame serialization, for peers that negotiated it 
+   (WS_MSGTYPE_FRAMING_LARGE). Same layout as a single packet, without the
+   size cap:
+    uint32_t packet size
+    uint8_t type (WS_MSGTYPE_SINGLEPACKET)
+    uint32_t msgid
+    nbytes payload
+
+   The message is serialized once, straight into a buffer sized for the 
+   lws prefix and the MAC, then encrypted in place.
+   ***/
+
+   size_t data_len = msg.ByteSize();
+   if (data_len + 9 > WEBSOCKET_LARGE_FRAME_MAX_SIZE)
+      throw runtime_error("payload too large for large frame serialization");
+
+   BinaryData packet(LWS_PRE + 9 + data_len + POLY1305MACLEN);
+   auto ptr = packet.getPtr() + LWS_PRE;
+
+   uint32_t size = data_len + 5;
+   memcpy(ptr, &size, 4);
+   ptr[4] = WS_MSGTYPE_SINGLEPACKET;
+   memcpy(ptr + 5, &id, 4);
+   if (data_len > 0 && !msg.SerializeToArray(ptr + 9, data_len))
+      throw runtime_error("failed to serialize message");
+
+   size_t plainTextLen = data_len + 9;
+   if (connPtr != nullptr)
+   {
+      if (connPtr->assemblePacket(
+         ptr, plainTextLen, ptr, plainTextLen + POLY1305MACLEN) != 0)
+      {
+         throw runtime_error("failed to encrypt packet, aborting");
+      }
+   }
+   else
+   {
+      packet.resize(LWS_PRE + plainTextLen);
+   }
+
+   return packet;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool WebSocketMessageCodec::reconstructFragmentedMessage(
    const map<uint16_t, BinaryDataRef>& payloadMap, 
@@ -317,6 +366,16 @@ void SerializedMessage::construct(const BinaryDataRef& data,
       WebSocketMessageCodec::serialize(data, connPtr, type, id));
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void SerializedMessage::constructLargeFrame(
+   const ::google::protobuf::Message& msg, 
+   BIP151Connection* connPtr, uint32_t id)
+{
+   packets_.clear();
+   packets_.emplace_back(
+      WebSocketMessageCodec::serializeLargeFrame(msg, connPtr, id));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 BinaryData SerializedMessage::consumeNextPacket()
 {
@@ -382,7 +441,7 @@ bool WebSocketMessagePartial::parsePacket(const BinaryDataRef& dataRef)
    case WS_MSGTYPE_AUTH_CHALLENGE:
    case WS_MSGTYPE_AUTH_REPLY:
    case WS_MSGTYPE_AUTH_PROPOSE:
-
+   case WS_MSGTYPE_FRAMING_LARGE:
    {
       return parseMessageWithoutId(dataSlice);
    }
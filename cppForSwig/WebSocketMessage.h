@@ -20,6 +20,8 @@
 #include "BIP150_151.h"
 
 #define WEBSOCKET_MESSAGE_PACKET_SIZE 1500
+#define WEBSOCKET_LARGE_FRAME_MAX_SIZE 0x2000000
+#define WEBSOCKET_LARGE_FRAME_SLICE_SIZE 0x10000
 #define WEBSOCKET_CALLBACK_ID 0xFFFFFFFE
 #define WEBSOCKET_AEAD_HANDSHAKE_ID 0xFFFFFFFD
 #define WEBSOCKET_MAGIC_WORD 0x56E1
@@ -42,6 +44,8 @@
 #define WS_MSGTYPE_AUTH_REPLY                22
 #define WS_MSGTYPE_AUTH_PROPOSE              23
 
+#define WS_MSGTYPE_FRAMING_LARGE             31
+
 class LWS_Error : public std::runtime_error
 {
 public:
@@ -62,6 +66,8 @@ public:
       const std::string&, BIP151Connection*, uint8_t, uint32_t);
    static std::vector<BinaryData> serializePacketWithoutId(
       const BinaryDataRef&, BIP151Connection*, uint8_t);
+   static BinaryData serializeLargeFrame(
+      const ::google::protobuf::Message&, BIP151Connection*, uint32_t);
 
    static uint32_t getMessageId(const BinaryDataRef&);
     
@@ -85,6 +91,8 @@ public:
       uint8_t, uint32_t id = 0);
    void construct(const BinaryDataRef& data, BIP151Connection*,
       uint8_t, uint32_t id = 0);
+   void constructLargeFrame(const ::google::protobuf::Message&,
+      BIP151Connection*, uint32_t id);
 
    bool isDone(void) const { return index_ >= packets_.size(); }
    BinaryData consumeNextPacket(void);
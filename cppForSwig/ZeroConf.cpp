@@ -19,6 +19,8 @@ using namespace std;
 using namespace ArmoryThreading;
 
 #define ZC_GETDATA_TIMEOUT_MS 60000
+#define ZC_PARALLEL_FILTER_THRESHOLD 32
+#define ZC_FILTER_SHARD_COUNT 64
 
 ///////////////////////////////////////////////////////////////////////////////
 ZcPreprocessPacket::~ZcPreprocessPacket()
@@ -717,6 +719,11 @@ void ZeroConfContainer::parseNewZC(
 
    //zc logic
    set<BinaryDataRef> addedZcKeys;
+
+   //filter the zc that do not conflict with the rest of the batch up front
+   auto&& prefiltered = filterIndependentZc(
+      zcMap, txhashmap, getzckeyfortxhash, getzctxforkey);
+
    for (auto& newZCPair : zcMap)
    {
       auto&& txHash = newZCPair.second->getTxHash().getRef();
@@ -740,9 +747,35 @@ void ZeroConfContainer::parseNewZC(
       }
 
       {
-         auto&& bulkData = ZCisMineBulkFilter(
-            *newZCPair.second, newZCPair.first,
-            getzckeyfortxhash, getzctxforkey);
+         BulkFilterData bulkData;
+         auto preIter = prefiltered.find(newZCPair.first);
+         if (preIter == prefiltered.end())
+         {
+            bulkData = move(ZCisMineBulkFilter(
+               *newZCPair.second, newZCPair.first,
+               getzckeyfortxhash, getzctxforkey));
+         }
+         else
+         {
+            /*
+            Prefiltered against the state prior to this batch. A replacement
+            earlier in the batch may have dropped one of its zc parents since,
+            in which case this zc is invalid too.
+            */
+            bulkData = move(preIter->second);
+            for (auto& input : newZCPair.second->inputs_)
+            {
+               if (!input.isResolved() || !input.opRef_.isZc())
+                  continue;
+
+               if (txmap.find(input.opRef_.getDbTxKeyRef()) == txmap.end())
+               {
+                  newZCPair.second->state_ = Tx_Invalid;
+                  bulkData = BulkFilterData();
+                  break;
+               }
+            }
+         }
 
          //check for replacement
          {
@@ -974,6 +1007,146 @@ void ZeroConfContainer::parseNewZC(
       watcherMap);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+map<BinaryDataRef, ZeroConfContainer::BulkFilterData> 
+ZeroConfContainer::filterIndependentZc(
+   const map<BinaryDataRef, shared_ptr<ParsedTx>>& zcMap,
+   const map<BinaryDataRef, BinaryDataRef>& txhashmap,
+   function<bool(const BinaryData&, BinaryData&)> getzckeyfortxhash,
+   function<const ParsedTx&(const BinaryData&)> getzctxforkey)
+{
+   /*
+   A zc can be filtered ahead of the serial pass in parseNewZC if it has no
+   parent in this batch, does not share an outpoint with any other zc in the
+   batch and does not spend an outpoint already spent by a tracked zc. These
+   only read the snapshot, so they are sharded by tx hash and filtered
+   concurrently. 
+   
+   Everything else (chains within the batch, double spends, replacements, 
+   reparsed zc) is left to the serial pass, which resolves conflicts in 
+   zc key order as before.
+   */
+
+   map<BinaryDataRef, BulkFilterData> result;
+   if (zcMap.size() < ZC_PARALLEL_FILTER_THRESHOLD || MAX_THREADS() < 2)
+      return result;
+
+   //<owner hash, <output id, spender count>>
+   map<BinaryDataRef, map<unsigned, unsigned>> batchSpends;
+   set<BinaryDataRef> batchHashes;
+   for (auto& zcPair : zcMap)
+   {
+      batchHashes.insert(zcPair.second->getTxHash().getRef());
+      for (auto& input : zcPair.second->inputs_)
+      {
+         auto& opRef = input.opRef_;
+         if (!opRef.isInitialized())
+            continue;
+
+         ++batchSpends[opRef.getTxHashRef()][opRef.getIndex()];
+      }
+   }
+
+   typedef pair<BinaryDataRef, shared_ptr<ParsedTx>> KeyTxPair;
+   vector<vector<KeyTxPair>> shards(ZC_FILTER_SHARD_COUNT);
+   unsigned independentCount = 0;
+
+   for (auto& zcPair : zcMap)
+   {
+      auto& parsedTx = *zcPair.second;
+
+      //not preprocessed or already tracked
+      if (parsedTx.inputs_.empty())
+         continue;
+
+      auto& txHash = parsedTx.getTxHash();
+      if (txhashmap.find(txHash.getRef()) != txhashmap.end())
+         continue;
+
+      bool isIndependent = true;
+      for (auto& input : parsedTx.inputs_)
+      {
+         auto& opRef = input.opRef_;
+         if (!opRef.isInitialized() ||
+            batchHashes.find(opRef.getTxHashRef()) != batchHashes.end() ||
+            batchSpends[opRef.getTxHashRef()][opRef.getIndex()] > 1)
+         {
+            isIndependent = false;
+            break;
+         }
+
+         auto spentIter = outPointsSpentByKey_.find(opRef.getTxHashRef());
+         if (spentIter != outPointsSpentByKey_.end() &&
+            spentIter->second.find(opRef.getIndex()) != spentIter->second.end())
+         {
+            isIndependent = false;
+            break;
+         }
+      }
+
+      if (!isIndependent)
+         continue;
+
+      auto shardId = txHash.getPtr()[0] % ZC_FILTER_SHARD_COUNT;
+      shards[shardId].push_back(make_pair(zcPair.first, zcPair.second));
+      ++independentCount;
+   }
+
+   if (independentCount == 0)
+      return result;
+
+   vector<map<BinaryDataRef, BulkFilterData>> shardResults(shards.size());
+   auto counter = make_shared<atomic<unsigned>>();
+   counter->store(0, memory_order_relaxed);
+
+   auto filterShards = [&](void)->void
+   {
+      while (1)
+      {
+         auto id = counter->fetch_add(1, memory_order_relaxed);
+         if (id >= shards.size())
+            return;
+
+         for (auto& keyTx : shards[id])
+         {
+            try
+            {
+               auto&& bulkData = ZCisMineBulkFilter(
+                  *keyTx.second, keyTx.first,
+                  getzckeyfortxhash, getzctxforkey);
+               shardResults[id].emplace(keyTx.first, move(bulkData));
+            }
+            catch (exception&)
+            {
+               //leave it to the serial pass
+               continue;
+            }
+         }
+      }
+   };
+
+   vector<thread> filterThreads;
+   for (unsigned i = 1; i < MAX_THREADS(); i++)
+      filterThreads.push_back(thread(filterShards));
+   filterShards();
+
+   for (auto& thr : filterThreads)
+   {
+      if (thr.joinable())
+         thr.join();
+   }
+
+   for (auto& shardResult : shardResults)
+   {
+      typedef map<BinaryDataRef, BulkFilterData>::iterator shard_iter;
+      result.insert(
+         move_iterator<shard_iter>(shardResult.begin()),
+         move_iterator<shard_iter>(shardResult.end()));
+   }
+
+   return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void ZeroConfContainer::preprocessTx(ParsedTx& tx) const
 {
@@ -573,6 +573,12 @@ private:
       std::function<bool(const BinaryData&, BinaryData&)> getzckeyfortxhash,
       std::function<const ParsedTx&(const BinaryData&)> getzctxbykey);
 
+   std::map<BinaryDataRef, BulkFilterData> filterIndependentZc(
+      const std::map<BinaryDataRef, std::shared_ptr<ParsedTx>>&,
+      const std::map<BinaryDataRef, BinaryDataRef>&,
+      std::function<bool(const BinaryData&, BinaryData&)>,
+      std::function<const ParsedTx&(const BinaryData&)>);
+
    void preprocessTx(ParsedTx&) const;
 
    unsigned loadZeroConfMempool(bool clearMempool);
@@ -48,7 +48,8 @@ enum BDMAction
    BDMAction_Exited,
    BDMAction_ErrorMsg,
    BDMAction_NodeStatus,
-   BDMAction_BDV_Error
+   BDMAction_BDV_Error,
+   BDMAction_HistoryChunk
 };
 
 enum ARMORY_DB_TYPE
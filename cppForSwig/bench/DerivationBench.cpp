@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright (C) 2016, goatpig                                               //
+//  Distributed under the MIT license                                         //
+//  See LICENSE-MIT or https://opensource.org/licenses/MIT                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+BIP32 public chain extension benchmark. Extends a soft derivation chain
+from a random xpub by --count addresses with 1, 2, 4... up to --threads
+derivation threads, then instantiates P2WPKH addresses over the result,
+and reports addresses derived per second.
+
+   DerivationBench --count=10000 --runs=3
+
+The serial baseline is the per index node setup extendPublicChain used to
+run, measured over the same chain.
+***/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+
+#include "btc/ecc.h"
+#include "BIP32_Node.h"
+#include "DerivationScheme.h"
+#include "DecryptedDataContainer.h"
+#include "Addresses.h"
+#include "BlockDataManagerConfig.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchParams
+{
+   unsigned count_ = 10000;
+   unsigned runCount_ = 3;
+   unsigned threadCount_ = thread::hardware_concurrency();
+
+   void parseArgs(int argc, char* argv[]);
+   static void printHelp(void);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::printHelp()
+{
+   cout << "DerivationBench options:" << endl;
+   cout << "  --count=N        addresses per extension (10000)" << endl;
+   cout << "  --runs=N         extensions per thread count step (3)" << endl;
+   cout << "  --threads=N      max derivation threads (" <<
+      thread::hardware_concurrency() << ")" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::parseArgs(int argc, char* argv[])
+{
+   for (int i = 1; i < argc; i++)
+   {
+      string arg(argv[i]);
+      if (arg == "--help" || arg == "-h")
+      {
+         printHelp();
+         exit(0);
+      }
+
+      auto&& keyVal = BlockDataManagerConfig::getKeyValFromLine(arg, '=');
+      auto& key = keyVal.first;
+      auto& val = keyVal.second;
+
+      if (key == "--count")
+         count_ = stoul(val);
+      else if (key == "--runs")
+         runCount_ = stoul(val);
+      else if (key == "--threads")
+         threadCount_ = stoul(val);
+      else
+         throw runtime_error("unknown argument: " + arg);
+   }
+
+   if (count_ == 0 || runCount_ == 0)
+      throw runtime_error("count and run count have to be non zero");
+   if (threadCount_ == 0)
+      threadCount_ = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+   BenchParams params;
+   try
+   {
+      params.parseArgs(argc, argv);
+   }
+   catch (exception& e)
+   {
+      cerr << e.what() << endl;
+      BenchParams::printHelp();
+      return 1;
+   }
+
+   btc_ecc_start();
+
+   auto&& seed = CryptoPRNG::generateRandom(32);
+   BIP32_Node root;
+   root.initFromSeed(seed);
+   root.derivePrivate(0x80000000);
+   auto&& pubRoot = root.getPublicCopy();
+
+   auto pubkey = pubRoot.getPublicKey();
+   auto rootAsset = make_shared<AssetEntry_Single>(
+      -1, BinaryData(), pubkey, nullptr);
+
+   auto chaincode = pubRoot.getChaincode();
+   DerivationScheme_BIP32 derScheme(
+      chaincode, pubRoot.getDepth(), pubRoot.getLeafID());
+
+   //hash every address so the rates include the hash160 pass
+   auto instantiate = [](const vector<shared_ptr<AssetEntry>>& assetVec)->size_t
+   {
+      size_t hashSize = 0;
+      for (auto& asset : assetVec)
+      {
+         AddressEntry_P2WPKH addr(asset);
+         hashSize += addr.getHash().getSize();
+      }
+
+      return hashSize;
+   };
+
+   //serial baseline
+   double baseRate = 0;
+   vector<SecureBinaryData> reference;
+   {
+      double elapsed = 0;
+      for (unsigned r = 0; r < params.runCount_; r++)
+      {
+         auto start = chrono::steady_clock::now();
+
+         vector<shared_ptr<AssetEntry>> assetVec;
+         assetVec.reserve(params.count_);
+         for (unsigned i = 0; i < params.count_; i++)
+         {
+            auto&& nextEntry = derScheme.computeNextPublicEntry(
+               pubkey, BinaryData(), i);
+            assetVec.push_back(nextEntry);
+         }
+         instantiate(assetVec);
+
+         elapsed += chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+
+         if (reference.size() == 0)
+         {
+            for (auto& asset : assetVec)
+            {
+               auto assetSingle =
+                  dynamic_pointer_cast<AssetEntry_Single>(asset);
+               reference.push_back(
+                  assetSingle->getPubKey()->getCompressedKey());
+            }
+         }
+      }
+
+      baseRate = params.count_ * params.runCount_ / elapsed;
+   }
+
+   cout << setw(10) << "threads" << setw(14) << "addr/s" <<
+      setw(12) << "speedup" << endl;
+   cout << setw(10) << "serial" << setw(14) << fixed << setprecision(0) <<
+      baseRate << setw(11) << setprecision(2) << 1.0 << "x" << endl;
+
+   for (unsigned thrCount = 1; ; thrCount *= 2)
+   {
+      if (thrCount > params.threadCount_)
+         thrCount = params.threadCount_;
+
+      DerivationScheme_BIP32::setExtendThreadCount(thrCount);
+
+      double elapsed = 0;
+      for (unsigned r = 0; r < params.runCount_; r++)
+      {
+         auto start = chrono::steady_clock::now();
+         auto&& assetVec = derScheme.extendPublicChain(
+            rootAsset, 0, params.count_ - 1);
+         instantiate(assetVec);
+         elapsed += chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+
+         for (unsigned i = 0; i < assetVec.size(); i++)
+         {
+            auto assetSingle =
+               dynamic_pointer_cast<AssetEntry_Single>(assetVec[i]);
+            if (assetSingle->getPubKey()->getCompressedKey() != reference[i])
+            {
+               cerr << "derivation mismatch at index " << i << endl;
+               btc_ecc_stop();
+               return 1;
+            }
+         }
+      }
+
+      auto rate = params.count_ * params.runCount_ / elapsed;
+      cout << setw(10) << thrCount << setw(14) << fixed << setprecision(0) <<
+         rate << setw(11) << setprecision(2) << rate / baseRate << "x" << endl;
+
+      if (thrCount == params.threadCount_)
+         break;
+   }
+
+   btc_ecc_stop();
+   return 0;
+}
@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright (C) 2016, goatpig                                               //
+//  Distributed under the MIT license                                         //
+//  See LICENSE-MIT or https://opensource.org/licenses/MIT                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+Concurrent LMDB read benchmark. Fills a single db with fixed size random
+keys, then has 1, 2, 4... up to --threads readers hammer it with random
+point reads and reports aggregate throughput at each thread count.
+
+   LmdbReadBench --keys=1000000 --reads=2000000 --dir=/tmp/lmdbbench
+
+Each reader holds a ReadOnly tx and opens a nested one every --nest reads,
+as the db wrapper does per getter, so both the tx lookup and the tx level
+bookkeeping are exercised.
+***/
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+
+#include "lmdbpp.h"
+#include "BlockDataManagerConfig.h"
+
+using namespace std;
+
+#define LMDBBENCH_KEY_SIZE 32
+#define LMDBBENCH_VAL_SIZE 64
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchParams
+{
+   unsigned keyCount_ = 500000;
+
+   //reads per thread count step, split evenly across threads
+   unsigned readCount_ = 4000000;
+
+   //reads between nested tx begin/commit
+   unsigned nestInterval_ = 16;
+
+   unsigned threadCount_ = thread::hardware_concurrency();
+   unsigned seed_ = 1;
+   string dir_ = "./lmdbbench";
+
+   void parseArgs(int argc, char* argv[]);
+   static void printHelp(void);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::printHelp()
+{
+   cout << "LmdbReadBench options:" << endl;
+   cout << "  --keys=N         key count (500000)" << endl;
+   cout << "  --reads=N        reads per step, across all threads (4000000)" << endl;
+   cout << "  --nest=N         reads between nested txes, 0 for none (16)" << endl;
+   cout << "  --threads=N      max reader count (" <<
+      thread::hardware_concurrency() << ")" << endl;
+   cout << "  --seed=N         key generation seed (1)" << endl;
+   cout << "  --dir=PATH       work dir, db file is wiped on start (./lmdbbench)"
+      << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::parseArgs(int argc, char* argv[])
+{
+   for (int i = 1; i < argc; i++)
+   {
+      string arg(argv[i]);
+      if (arg == "--help" || arg == "-h")
+      {
+         printHelp();
+         exit(0);
+      }
+
+      auto&& keyVal = BlockDataManagerConfig::getKeyValFromLine(arg, '=');
+      auto& key = keyVal.first;
+      auto& val = keyVal.second;
+
+      if (key == "--keys")
+         keyCount_ = stoul(val);
+      else if (key == "--reads")
+         readCount_ = stoul(val);
+      else if (key == "--nest")
+         nestInterval_ = stoul(val);
+      else if (key == "--threads")
+         threadCount_ = stoul(val);
+      else if (key == "--seed")
+         seed_ = stoul(val);
+      else if (key == "--dir")
+         dir_ = val;
+      else
+         throw runtime_error("unknown argument: " + arg);
+   }
+
+   if (keyCount_ == 0 || readCount_ == 0)
+      throw runtime_error("key and read counts have to be non zero");
+   if (threadCount_ == 0)
+      threadCount_ = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void makeKey(unsigned id, unsigned seed, uint8_t* key)
+{
+   //deterministic, unordered keys so reads hit random pages
+   mt19937 rng(seed ^ (id * 2654435761U));
+   for (unsigned i = 0; i < LMDBBENCH_KEY_SIZE; i += 4)
+   {
+      auto word = rng();
+      memcpy(key + i, &word, 4);
+   }
+   memcpy(key, &id, 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+   BenchParams params;
+   try
+   {
+      params.parseArgs(argc, argv);
+   }
+   catch (exception& e)
+   {
+      cerr << e.what() << endl;
+      BenchParams::printHelp();
+      return 1;
+   }
+
+   auto dbPath = params.dir_ + "/lmdbbench.db";
+   remove(dbPath.c_str());
+   remove((dbPath + "-lock").c_str());
+
+   LMDBEnv env(2);
+   LMDB db;
+   try
+   {
+      env.open(dbPath, MDB_NOSYNC | MDB_NOTLS);
+      env.setMapSize(
+         (size_t)params.keyCount_ * (LMDBBENCH_KEY_SIZE + LMDBBENCH_VAL_SIZE)
+         * 4 + 64 * 1024 * 1024);
+      db.open(&env, "bench");
+   }
+   catch (exception& e)
+   {
+      cerr << "failed to setup db at " << dbPath << ": " << e.what() << endl;
+      cerr << "make sure " << params.dir_ << " exists" << endl;
+      return 1;
+   }
+
+   //fill
+   {
+      cout << "writing " << params.keyCount_ << " keys" << endl;
+      LMDBEnv::Transaction tx(&env, LMDB::ReadWrite);
+
+      uint8_t key[LMDBBENCH_KEY_SIZE];
+      uint8_t val[LMDBBENCH_VAL_SIZE];
+      for (unsigned i = 0; i < params.keyCount_; i++)
+      {
+         makeKey(i, params.seed_, key);
+         memset(val, i & 0xFF, LMDBBENCH_VAL_SIZE);
+         db.insert(
+            CharacterArrayRef(LMDBBENCH_KEY_SIZE, key),
+            CharacterArrayRef(LMDBBENCH_VAL_SIZE, val));
+      }
+   }
+
+   //precompute keys so the timed loop is all db reads
+   vector<uint8_t> keys((size_t)params.keyCount_ * LMDBBENCH_KEY_SIZE);
+   for (unsigned i = 0; i < params.keyCount_; i++)
+      makeKey(i, params.seed_, &keys[(size_t)i * LMDBBENCH_KEY_SIZE]);
+
+   atomic<unsigned> misses(0);
+   auto reader = [&](unsigned id, unsigned readCount)->void
+   {
+      mt19937 rng(params.seed_ + id);
+      uniform_int_distribution<unsigned> dist(0, params.keyCount_ - 1);
+
+      LMDBEnv::Transaction tx(&env, LMDB::ReadOnly);
+      for (unsigned i = 0; i < readCount; i++)
+      {
+         LMDBEnv::Transaction nestedTx;
+         if (params.nestInterval_ != 0 && i % params.nestInterval_ == 0)
+            nestedTx.open(&env, LMDB::ReadOnly);
+
+         auto keyId = dist(rng);
+         auto keyPtr = &keys[(size_t)keyId * LMDBBENCH_KEY_SIZE];
+         auto val = db.get_NoCopy(CharacterArrayRef(LMDBBENCH_KEY_SIZE, keyPtr));
+         if (val.len != LMDBBENCH_VAL_SIZE ||
+            (uint8_t)val.data[0] != (keyId & 0xFF))
+            misses.fetch_add(1, memory_order_relaxed);
+      }
+   };
+
+   cout << setw(10) << "threads" << setw(16) << "reads/s" <<
+      setw(12) << "speedup" << endl;
+
+   double baseRate = 0;
+   for (unsigned thrCount = 1; ; thrCount *= 2)
+   {
+      if (thrCount > params.threadCount_)
+         thrCount = params.threadCount_;
+
+      auto perThread = max(params.readCount_ / thrCount, 1U);
+
+      auto start = chrono::steady_clock::now();
+      vector<thread> threads;
+      for (unsigned i = 0; i < thrCount; i++)
+         threads.push_back(thread(reader, i, perThread));
+      for (auto& thr : threads)
+         thr.join();
+      auto elapsed = chrono::duration<double>(
+         chrono::steady_clock::now() - start).count();
+
+      auto rate = double(perThread) * thrCount / elapsed;
+      if (baseRate == 0)
+         baseRate = rate;
+
+      cout << setw(10) << thrCount << setw(16) << fixed << setprecision(0) <<
+         rate << setw(11) << setprecision(2) << rate / baseRate << "x" << endl;
+
+      if (thrCount == params.threadCount_)
+         break;
+   }
+
+   db.close();
+   env.close();
+   remove(dbPath.c_str());
+   remove((dbPath + "-lock").c_str());
+
+   if (misses.load() != 0)
+   {
+      cerr << misses.load() << " reads returned unexpected data" << endl;
+      return 1;
+   }
+
+   return 0;
+}
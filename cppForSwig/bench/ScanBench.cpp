@@ -0,0 +1,767 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright (C) 2016, goatpig                                               //
+//  Distributed under the MIT license                                         //
+//  See LICENSE-MIT or https://opensource.org/licenses/MIT                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+Offline scan benchmark. Generates a synthetic blk*.dat chain, then runs
+the BDM initial load (DatabaseBuilder::init -> header update, chain
+organization and the bare or supernode scanner) on it and reports
+throughput, heap allocations, peak RSS and per stage timings.
+
+   ScanBench --blocks=2000 --txs=200 --db=super --dir=/tmp/scanbench
+
+Chain generation is fully deterministic for a given set of parameters and
+seed, so results are comparable across builds. Run each db type in its own
+process, peak RSS is process wide. --arena=off parses scanned blocks on the
+heap instead of the per block arena, to compare both.
+***/
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <cstdlib>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#else
+#include <direct.h>
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include "btc/ecc.h"
+#include "BIP150_151.h"
+#include "BlockDataMap.h"
+#include "BlockUtils.h"
+#include "BlockDataManagerConfig.h"
+#include "BtcUtils.h"
+#include "DBUtils.h"
+#include "UniversalTimer.h"
+#include "log.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+#define MAINNET_GENESIS_BLOCK_HEX \
+   "0100000000000000000000000000000000000000000000000000000000000000" \
+   "000000003ba3edfd7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa" \
+   "4b1e5e4a29ab5f49ffff001d1dac2b7c01010000000100000000000000000000" \
+   "00000000000000000000000000000000000000000000ffffffff4d04ffff001d" \
+   "0104455468652054696d65732030332f4a616e2f32303039204368616e63656c" \
+   "6c6f72206f6e206272696e6b206f66207365636f6e64206261696c6f75742066" \
+   "6f722062616e6b73ffffffff0100f2052a01000000434104678afdb0fe554827" \
+   "1967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4" \
+   "f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac00000000"
+
+#define BENCH_BLOCK_INTERVAL 600
+#define BENCH_COINBASE_VALUE (50 * COIN)
+#define BENCH_TX_FEE 1000
+
+////////////////////////////////////////////////////////////////////////////////
+//process wide heap allocation count, compares the arena and heap parsers
+static std::atomic<uint64_t> allocCount_ = { 0 };
+
+void* operator new(size_t size)
+{
+   allocCount_.fetch_add(1, std::memory_order_relaxed);
+   auto ptr = malloc(size == 0 ? 1 : size);
+   if (ptr == nullptr)
+      throw std::bad_alloc();
+   return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchParams
+{
+   unsigned blockCount_ = 1000;
+   unsigned txPerBlock_ = 100;
+
+   //share of new outputs going to p2sh and p2wpkh scripts, p2pkh otherwise
+   double p2shShare_ = 0.2;
+   double segwitShare_ = 0.3;
+
+   //odds a new output pays to a previously used script
+   double addrReuse_ = 0.2;
+
+   unsigned seed_ = 1;
+   ARMORY_DB_TYPE dbType_ = ARMORY_DB_SUPER;
+   //empty for a temp dir, created and removed by the bench
+   string dir_;
+   unsigned threadCount_ = MAX_THREADS();
+   unsigned ramUsage_ = 4;
+
+   //addresses registered in bare mode
+   unsigned watchedCount_ = 1000;
+
+   //max blk file size in MB
+   unsigned fileSize_ = 128;
+
+   //parse scanned blocks into per block arenas
+   bool arena_ = true;
+
+   void parseArgs(int argc, char* argv[]);
+   static void printHelp(void);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::printHelp()
+{
+   cout << "ScanBench options:" << endl;
+   cout << "  --blocks=N       synthetic chain length (1000)" << endl;
+   cout << "  --txs=N          txs per block, coinbase included (100)" << endl;
+   cout << "  --p2sh=F         share of p2sh outputs (0.2)" << endl;
+   cout << "  --segwit=F       share of p2wpkh outputs (0.3)" << endl;
+   cout << "  --reuse=F        odds an output reuses an address (0.2)" << endl;
+   cout << "  --seed=N         chain generation seed (1)" << endl;
+   cout << "  --db=super|bare  db type to scan with (super)" << endl;
+   cout << "  --watched=N      addresses registered in bare mode (1000)" << endl;
+   cout << "  --threads=N      scan thread count (" << MAX_THREADS() << ")" << endl;
+   cout << "  --ram-usage=N    scanner ram usage ceiling (4)" << endl;
+   cout << "  --filesize=N     max blk file size in MB (128)" << endl;
+   cout << "  --arena=on|off   parse scanned blocks into arenas (on)" << endl;
+   cout << "  --dir=PATH       work dir, kept on exit, can't hold a blocks or" << endl;
+   cout << "                   db dir yet (temp dir, removed on exit)" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::parseArgs(int argc, char* argv[])
+{
+   for (int i = 1; i < argc; i++)
+   {
+      string arg(argv[i]);
+      if (arg == "--help" || arg == "-h")
+      {
+         printHelp();
+         exit(0);
+      }
+
+      auto&& keyVal = BlockDataManagerConfig::getKeyValFromLine(arg, '=');
+      auto& key = keyVal.first;
+      auto& val = keyVal.second;
+
+      if (key == "--blocks")
+         blockCount_ = stoul(val);
+      else if (key == "--txs")
+         txPerBlock_ = stoul(val);
+      else if (key == "--p2sh")
+         p2shShare_ = stod(val);
+      else if (key == "--segwit")
+         segwitShare_ = stod(val);
+      else if (key == "--reuse")
+         addrReuse_ = stod(val);
+      else if (key == "--seed")
+         seed_ = stoul(val);
+      else if (key == "--watched")
+         watchedCount_ = stoul(val);
+      else if (key == "--threads")
+         threadCount_ = stoul(val);
+      else if (key == "--ram-usage")
+         ramUsage_ = stoul(val);
+      else if (key == "--filesize")
+         fileSize_ = stoul(val);
+      else if (key == "--dir")
+         dir_ = val;
+      else if (key == "--arena")
+      {
+         if (val == "on")
+            arena_ = true;
+         else if (val == "off")
+            arena_ = false;
+         else
+            throw runtime_error("invalid arena setting: " + val);
+      }
+      else if (key == "--db")
+      {
+         if (val == "super")
+            dbType_ = ARMORY_DB_SUPER;
+         else if (val == "bare")
+            dbType_ = ARMORY_DB_BARE;
+         else
+            throw runtime_error("invalid db type: " + val);
+      }
+      else
+      {
+         throw runtime_error("unknown argument: " + arg);
+      }
+   }
+
+   if (blockCount_ < 2)
+      throw runtime_error("need at least 2 blocks");
+   if (txPerBlock_ == 0)
+      throw runtime_error("need at least 1 tx per block");
+   if (p2shShare_ + segwitShare_ > 1.0)
+      throw runtime_error("p2sh and segwit shares exceed 1");
+   if (threadCount_ == 0 || ramUsage_ == 0 || fileSize_ == 0)
+      throw runtime_error("thread count, ram usage and file size have to be > 0");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////
+//// SyntheticChain
+////
+////////////////////////////////////////////////////////////////////////////////
+class SyntheticChain
+{
+   struct Utxo
+   {
+      BinaryData txHash_;
+      uint32_t index_;
+      uint64_t value_;
+      bool isWitness_;
+   };
+
+private:
+   const BenchParams& params_;
+   mt19937_64 rng_;
+   uniform_real_distribution<double> roll_;
+
+   vector<Utxo> utxos_;
+   vector<BinaryData> usedScripts_;
+   vector<BinaryData> scrAddrs_;
+   uint64_t addrCounter_ = 0;
+
+   BinaryData topHash_;
+   uint32_t topTime_ = 0;
+
+   //placeholder sig and pubkey, the db does not check signatures
+   const BinaryData dummySig_;
+   const BinaryData dummyPubKey_;
+
+public:
+   unsigned blockCount_ = 0;
+   uint64_t txCount_ = 0;
+   uint64_t segwitTxCount_ = 0;
+   uint64_t byteCount_ = 0;
+   unsigned fileCount_ = 0;
+
+private:
+   uint64_t randomInt(uint64_t max)
+   {
+      return max == 0 ? 0 : rng_() % max;
+   }
+
+   BinaryData newScript(void);
+   BinaryData serializeTx(const vector<Utxo>&,
+      const vector<pair<uint64_t, BinaryData>>&, bool) const;
+   BinaryData makeCoinbase(unsigned height,
+      vector<BinaryData>& txHashes, vector<Utxo>& newUtxos);
+   BinaryData makeTx(vector<BinaryData>& txHashes, vector<Utxo>& newUtxos);
+   BinaryData makeBlock(unsigned height);
+
+public:
+   SyntheticChain(const BenchParams& params) :
+      params_(params), rng_(params.seed_), roll_(0.0, 1.0),
+      dummySig_(72), dummyPubKey_(33)
+   {
+      memset((void*)dummySig_.getPtr(), 0x30, dummySig_.getSize());
+      memset((void*)dummyPubKey_.getPtr(), 0x02, dummyPubKey_.getSize());
+   }
+
+   void write(const string& blkDir);
+   const vector<BinaryData>& getScrAddrs(void) const { return scrAddrs_; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SyntheticChain::newScript()
+{
+   if (usedScripts_.size() > 0 && roll_(rng_) < params_.addrReuse_)
+      return usedScripts_[randomInt(usedScripts_.size())];
+
+   auto&& h160 = BtcUtils::getHash160(WRITE_UINT64_LE(addrCounter_++));
+
+   BinaryData script;
+   auto roll = roll_(rng_);
+   if (roll < params_.segwitShare_)
+      script = BtcUtils::getP2WPKHOutputScript(h160);
+   else if (roll < params_.segwitShare_ + params_.p2shShare_)
+      script = BtcUtils::getP2SHScript(h160);
+   else
+      script = BtcUtils::getP2PKHScript(h160);
+
+   usedScripts_.push_back(script);
+   scrAddrs_.push_back(BtcUtils::getTxOutScrAddr(script));
+   return script;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SyntheticChain::serializeTx(const vector<Utxo>& spent,
+   const vector<pair<uint64_t, BinaryData>>& outputs, bool withWitness) const
+{
+   BinaryWriter bw;
+   bw.put_uint32_t(1);
+   if (withWitness)
+   {
+      bw.put_uint8_t(0);
+      bw.put_uint8_t(1);
+   }
+
+   bw.put_var_int(spent.size());
+   for (auto& utxo : spent)
+   {
+      bw.put_BinaryData(utxo.txHash_);
+      bw.put_uint32_t(utxo.index_);
+
+      if (utxo.isWitness_)
+      {
+         bw.put_var_int(0);
+      }
+      else
+      {
+         bw.put_var_int(dummySig_.getSize() + dummyPubKey_.getSize() + 2);
+         bw.put_uint8_t(dummySig_.getSize());
+         bw.put_BinaryData(dummySig_);
+         bw.put_uint8_t(dummyPubKey_.getSize());
+         bw.put_BinaryData(dummyPubKey_);
+      }
+
+      bw.put_uint32_t(UINT32_MAX);
+   }
+
+   bw.put_var_int(outputs.size());
+   for (auto& output : outputs)
+   {
+      bw.put_uint64_t(output.first);
+      bw.put_var_int(output.second.getSize());
+      bw.put_BinaryData(output.second);
+   }
+
+   if (withWitness)
+   {
+      for (auto& utxo : spent)
+      {
+         if (!utxo.isWitness_)
+         {
+            bw.put_var_int(0);
+            continue;
+         }
+
+         bw.put_var_int(2);
+         bw.put_var_int(dummySig_.getSize());
+         bw.put_BinaryData(dummySig_);
+         bw.put_var_int(dummyPubKey_.getSize());
+         bw.put_BinaryData(dummyPubKey_);
+      }
+   }
+
+   bw.put_uint32_t(0);
+   return bw.getData();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SyntheticChain::makeCoinbase(unsigned height,
+   vector<BinaryData>& txHashes, vector<Utxo>& newUtxos)
+{
+   //the height in the coinbase script keeps coinbase hashes unique
+   BinaryWriter bw;
+   bw.put_uint32_t(1);
+   bw.put_var_int(1);
+   bw.put_BinaryData(BinaryData(32));
+   bw.put_uint32_t(UINT32_MAX);
+   bw.put_var_int(5);
+   bw.put_uint8_t(4);
+   bw.put_uint32_t(height);
+   bw.put_uint32_t(UINT32_MAX);
+
+   auto&& script = newScript();
+   bw.put_var_int(1);
+   bw.put_uint64_t(BENCH_COINBASE_VALUE);
+   bw.put_var_int(script.getSize());
+   bw.put_BinaryData(script);
+   bw.put_uint32_t(0);
+
+   auto&& txHash = BtcUtils::getHash256(bw.getData());
+   newUtxos.push_back({ txHash, 0, BENCH_COINBASE_VALUE, script[0] == 0 });
+   txHashes.push_back(move(txHash));
+
+   return bw.getData();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SyntheticChain::makeTx(
+   vector<BinaryData>& txHashes, vector<Utxo>& newUtxos)
+{
+   //spend 1 or 2 outputs from previous blocks, swap and pop from the pool
+   vector<Utxo> spent;
+   unsigned inputCount = (utxos_.size() > 1 && randomInt(4) == 0) ? 2 : 1;
+   uint64_t total = 0;
+   bool hasWitness = false;
+   for (unsigned i = 0; i < inputCount; i++)
+   {
+      auto id = randomInt(utxos_.size());
+      swap(utxos_[id], utxos_.back());
+      spent.push_back(move(utxos_.back()));
+      utxos_.pop_back();
+
+      total += spent.back().value_;
+      hasWitness |= spent.back().isWitness_;
+   }
+
+   //pay to 1 or 2 outputs depending on what's left after the fee
+   vector<pair<uint64_t, BinaryData>> outputs;
+   auto fee = min<uint64_t>(BENCH_TX_FEE, total / 10);
+   auto value = total - fee;
+   if (value < 2)
+   {
+      outputs.push_back(make_pair(value, newScript()));
+   }
+   else
+   {
+      auto split = value * (10 + randomInt(81)) / 100;
+      split = max<uint64_t>(split, 1);
+      outputs.push_back(make_pair(split, newScript()));
+      outputs.push_back(make_pair(value - split, newScript()));
+   }
+
+   auto&& txHash = BtcUtils::getHash256(serializeTx(spent, outputs, false));
+   for (unsigned i = 0; i < outputs.size(); i++)
+   {
+      newUtxos.push_back(
+         { txHash, i, outputs[i].first, outputs[i].second[0] == 0 });
+   }
+
+   txHashes.push_back(move(txHash));
+   if (!hasWitness)
+      return serializeTx(spent, outputs, false);
+
+   ++segwitTxCount_;
+   return serializeTx(spent, outputs, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData SyntheticChain::makeBlock(unsigned height)
+{
+   vector<BinaryData> txHashes;
+   vector<BinaryData> rawTxs;
+   vector<Utxo> newUtxos;
+
+   rawTxs.push_back(makeCoinbase(height, txHashes, newUtxos));
+   for (unsigned i = 1; i < params_.txPerBlock_; i++)
+   {
+      if (utxos_.size() == 0)
+         break;
+
+      rawTxs.push_back(makeTx(txHashes, newUtxos));
+   }
+
+   //outputs only become spendable in the next block
+   utxos_.insert(utxos_.end(), newUtxos.begin(), newUtxos.end());
+   txCount_ += rawTxs.size();
+
+   topTime_ += BENCH_BLOCK_INTERVAL;
+   BinaryWriter bw;
+   bw.put_uint32_t(1);
+   bw.put_BinaryData(topHash_);
+   bw.put_BinaryData(BtcUtils::calculateMerkleRoot(txHashes));
+   bw.put_uint32_t(topTime_);
+   bw.put_BinaryData(READHEX("ffff001d"));
+   bw.put_uint32_t(0);
+   topHash_ = BtcUtils::getHash256(bw.getData());
+
+   bw.put_var_int(rawTxs.size());
+   for (auto& rawTx : rawTxs)
+      bw.put_BinaryData(rawTx);
+
+   return bw.getData();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SyntheticChain::write(const string& blkDir)
+{
+   auto& magicBytes = NetworkConfig::getMagicBytes();
+   size_t maxFileSize = params_.fileSize_ * 1024ULL * 1024ULL;
+   size_t fileSize = 0;
+   ofstream blkFile;
+
+   auto writeBlock = [&](const BinaryData& rawBlock)->void
+   {
+      size_t blockSize = rawBlock.getSize() + 8;
+      if (!blkFile.is_open() ||
+         (fileSize > 0 && fileSize + blockSize > maxFileSize))
+      {
+         if (blkFile.is_open())
+            blkFile.close();
+
+         auto&& path = BtcUtils::getBlkFilename(blkDir, fileCount_++);
+         blkFile.open(path, ios::binary | ios::out | ios::trunc);
+         if (!blkFile.is_open())
+            throw runtime_error("failed to create " + path);
+         fileSize = 0;
+      }
+
+      blkFile.write(magicBytes.toCharPtr(), 4);
+      uint32_t size = rawBlock.getSize();
+      blkFile.write((const char*)&size, 4);
+      blkFile.write(rawBlock.toCharPtr(), rawBlock.getSize());
+
+      fileSize += blockSize;
+      byteCount_ += blockSize;
+      ++blockCount_;
+   };
+
+   //start from the actual genesis block so the db accepts the chain
+   auto&& genesis = READHEX(MAINNET_GENESIS_BLOCK_HEX);
+   topHash_ = BtcUtils::getHash256(genesis.getSliceRef(0, 80));
+   if (topHash_ != NetworkConfig::getGenesisBlockHash())
+      throw runtime_error("genesis block mismatch");
+   topTime_ = READ_UINT32_LE(genesis.getPtr() + 68);
+   writeBlock(genesis);
+   ++txCount_;
+
+   for (unsigned height = 1; height < params_.blockCount_; height++)
+      writeBlock(makeBlock(height));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////
+//// report
+////
+////////////////////////////////////////////////////////////////////////////////
+static uint64_t getPeakRSS()
+{
+#ifndef _WIN32
+   struct rusage usage;
+   if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+
+#ifdef __APPLE__
+   return usage.ru_maxrss;
+#else
+   return usage.ru_maxrss * 1024ULL;
+#endif
+#else
+   PROCESS_MEMORY_COUNTERS pmc;
+   if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+      return 0;
+   return pmc.PeakWorkingSetSize;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void makeDir(const string& path)
+{
+#ifndef _WIN32
+   mkdir(path.c_str(), 0755);
+#else
+   _mkdir(path.c_str());
+#endif
+   if (!DBUtils::isDir(path))
+      throw runtime_error("failed to create " + path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct TempDir
+{
+   string path_;
+
+   ~TempDir(void)
+   {
+      if (!path_.empty())
+         DBUtils::removeDirectory(path_);
+   }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static void printStage(const string& label, const string& timerName)
+{
+   cout << "   " << left << setw(32) << label << right << setw(10) <<
+      fixed << setprecision(3) << TIMER_READ_SEC(timerName) << "s" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+   btc_ecc_start();
+   startupBIP151CTX();
+   startupBIP150CTX(4, true);
+
+   BenchParams params;
+   try
+   {
+      params.parseArgs(argc, argv);
+   }
+   catch (exception& e)
+   {
+      cerr << e.what() << endl;
+      BenchParams::printHelp();
+      return 1;
+   }
+
+   //config ctor selects mainnet, the synthetic chain sits on its genesis
+   BlockDataManagerConfig config;
+   BlockDataManagerConfig::setDbType(params.dbType_);
+   BlockData::setScannerArena(params.arena_);
+   //only ever remove a work dir we created
+   TempDir tempDir;
+   if (params.dir_.empty())
+   {
+      random_device rd;
+      stringstream ss;
+      ss << "./scanbench-" << hex << rd();
+      params.dir_ = ss.str();
+      tempDir.path_ = params.dir_;
+   }
+   else if (DBUtils::isDir(params.dir_ + "/blocks") ||
+      DBUtils::isDir(params.dir_ + "/db"))
+   {
+      cerr << params.dir_ << " already holds a blocks or db dir" << endl;
+      return 1;
+   }
+
+   config.blkFileLocation_ = params.dir_ + "/blocks";
+   config.dbDir_ = params.dir_ + "/db";
+   config.threadCount_ = params.threadCount_;
+   config.ramUsage_ = params.ramUsage_;
+
+   makeDir(params.dir_);
+   makeDir(config.blkFileLocation_);
+   makeDir(config.dbDir_);
+
+   //generate
+   SyntheticChain chain(params);
+   auto genStart = chrono::steady_clock::now();
+   try
+   {
+      chain.write(config.blkFileLocation_);
+   }
+   catch (exception& e)
+   {
+      cerr << "chain generation failed: " << e.what() << endl;
+      btc_ecc_stop();
+      return 1;
+   }
+
+   auto genTime = chrono::duration<double>(
+      chrono::steady_clock::now() - genStart).count();
+
+   cout << "synthetic chain: " << chain.blockCount_ << " blocks, " <<
+      chain.txCount_ << " txs (" << chain.segwitTxCount_ << " segwit), " <<
+      chain.getScrAddrs().size() << " addresses, " <<
+      fixed << setprecision(2) << double(chain.byteCount_) / 1048576.0 <<
+      " MB in " << chain.fileCount_ << " files, generated in " <<
+      setprecision(3) << genTime << "s" << endl;
+
+   STARTLOGGING(params.dir_ + "/scanbench.log", LogLvlInfo);
+   LOGDISABLESTDOUT();
+
+   //scan
+   double loadTime = 0;
+   uint64_t loadAllocs = 0;
+   try
+   {
+      BlockDataManager bdm(config);
+      if (bdm.hasException())
+         rethrow_exception(bdm.getException());
+
+      if (params.dbType_ == ARMORY_DB_BARE)
+      {
+         //bdm is offline, registration only fills the address map
+         auto& scrAddrs = chain.getScrAddrs();
+         auto batch = make_shared<RegistrationBatch>();
+         for (unsigned i = 0;
+            i < scrAddrs.size() && batch->scrAddrSet_.size() < params.watchedCount_;
+            i++)
+         {
+            batch->scrAddrSet_.insert(
+               scrAddrs[(i * 7919ULL) % scrAddrs.size()].getRef());
+         }
+
+         batch->isNew_ = false;
+         batch->walletID_ = "scanbench";
+
+         auto promPtr = make_shared<promise<bool>>();
+         auto fut = promPtr->get_future();
+         batch->callback_ = [promPtr](set<BinaryDataRef>&)->void
+         {
+            promPtr->set_value(true);
+         };
+
+         bdm.getScrAddrFilter()->pushAddressBatch(batch);
+         fut.wait();
+      }
+
+      auto progress = [](BDMPhase, double, unsigned, unsigned)->void {};
+      auto loadStart = chrono::steady_clock::now();
+      auto allocStart = allocCount_.load(memory_order_relaxed);
+      bdm.doInitialSyncOnLoad(progress);
+      loadAllocs = allocCount_.load(memory_order_relaxed) - allocStart;
+      loadTime = chrono::duration<double>(
+         chrono::steady_clock::now() - loadStart).count();
+   }
+   catch (exception& e)
+   {
+      LOGENABLESTDOUT();
+      LOGERR << "scan failed: " << e.what();
+      btc_ecc_stop();
+      return 1;
+   }
+
+   LOGENABLESTDOUT();
+
+   auto initTime = TIMER_READ_SEC("initdb");
+   cout << "db type: " <<
+      (params.dbType_ == ARMORY_DB_SUPER ? "super" : "bare") <<
+      ", threads: " << params.threadCount_ <<
+      ", ram usage: " << params.ramUsage_ <<
+      ", arena: " << (params.arena_ ? "on" : "off") << endl;
+
+   cout << "stage timings:" << endl;
+   printStage("header db update", "updateblocksindb");
+   printStage("chain organization", "orgChain");
+   if (params.dbType_ == ARMORY_DB_SUPER)
+   {
+      printStage("scan (BlockchainScanner_Super)", "scan");
+      printStage("spentness", "spentness");
+      printStage("ssh (ShardedSshParser)", "updateSSH");
+   }
+   else
+   {
+      printStage("scan (BlockchainScanner)", "scan_nocheck");
+      printStage("  preload", "preload");
+      printStage("  outputs (cumulative)", "outputs");
+      printStage("  inputs (cumulative)", "inputs");
+      printStage("  write", "write");
+      printStage("  throttling", "throttling");
+      printStage("resolve hashes", "resolveHashes");
+   }
+   printStage("scanning total", "scanning");
+   printStage("DatabaseBuilder::init", "initdb");
+   cout << "   " << left << setw(32) << "initial load (wall)" << right <<
+      setw(10) << loadTime << "s" << endl;
+
+   cout << "throughput:" << endl;
+   if (initTime > 0)
+   {
+      cout << "   " << setprecision(1) <<
+         double(chain.blockCount_) / initTime << " blocks/s, " <<
+         double(chain.txCount_) / initTime << " tx/s, " <<
+         setprecision(2) <<
+         double(chain.byteCount_) / 1048576.0 / initTime << " MB/s" << endl;
+   }
+
+   cout << "heap allocations:" << endl;
+   cout << "   " << loadAllocs << " during initial load, " <<
+      setprecision(1) << double(loadAllocs) / double(chain.txCount_) <<
+      " per tx";
+   if (loadTime > 0)
+      cout << ", " << setprecision(0) << double(loadAllocs) / loadTime << "/s";
+   cout << endl;
+
+   cout << "peak RSS: " << setprecision(1) <<
+      double(getPeakRSS()) / 1048576.0 << " MB" << endl;
+
+   CLEANUP_ALL_TIMERS();
+   btc_ecc_stop();
+   return 0;
+}
@@ -0,0 +1,315 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright (C) 2016, goatpig                                               //
+//  Distributed under the MIT license                                         //
+//  See LICENSE-MIT or https://opensource.org/licenses/MIT                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+Legacy sighash benchmark. Builds a synthetic --inputs P2PKH tx over fake
+utxos, then times, for every input:
+
+ - per input reserialization of the tx, the way legacy sighash data used
+   to be computed, and its hash
+ - the sighash data off the shared serialization template, and its hash
+ - the single round hash off the template sha256 midstates
+
+followed by signing the tx and verifying it with 1 thread, sig cache off.
+
+   SigHashBench --inputs=1000 --runs=3
+***/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+#include "btc/ecc.h"
+#include "Signer.h"
+#include "Script.h"
+#include "BlockDataManagerConfig.h"
+
+using namespace std;
+using namespace ArmorySigner;
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchParams
+{
+   unsigned inputCount_ = 1000;
+   unsigned runCount_ = 3;
+
+   void parseArgs(int argc, char* argv[]);
+   static void printHelp(void);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::printHelp()
+{
+   cout << "SigHashBench options:" << endl;
+   cout << "  --inputs=N       inputs in the synthetic tx (1000)" << endl;
+   cout << "  --runs=N         passes per measure (3)" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::parseArgs(int argc, char* argv[])
+{
+   for (int i = 1; i < argc; i++)
+   {
+      string arg(argv[i]);
+      if (arg == "--help" || arg == "-h")
+      {
+         printHelp();
+         exit(0);
+      }
+
+      auto&& keyVal = BlockDataManagerConfig::getKeyValFromLine(arg, '=');
+      auto& key = keyVal.first;
+      auto& val = keyVal.second;
+
+      if (key == "--inputs")
+         inputCount_ = stoul(val);
+      else if (key == "--runs")
+         runCount_ = stoul(val);
+      else
+         throw runtime_error("unknown argument: " + arg);
+   }
+
+   if (inputCount_ == 0 || runCount_ == 0)
+      throw runtime_error("input count and run count have to be non zero");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+class BenchFeed : public ResolverFeed
+{
+private:
+   map<BinaryData, BinaryData> hashToPubkey_;
+   map<BinaryData, SecureBinaryData> pubkeyToPrivkey_;
+
+public:
+   BinaryData addPrivKey(const SecureBinaryData& privKey)
+   {
+      auto&& pubkey = CryptoECDSA().ComputePublicKey(privKey, true);
+      auto&& h160 = BtcUtils::getHash160(pubkey);
+      hashToPubkey_[h160] = pubkey;
+      pubkeyToPrivkey_[pubkey] = privKey;
+      return h160;
+   }
+
+   BinaryData getByVal(const BinaryData& val) override
+   {
+      auto iter = hashToPubkey_.find(val);
+      if (iter == hashToPubkey_.end())
+         throw runtime_error("invalid value");
+      return iter->second;
+   }
+
+   const SecureBinaryData& getPrivKeyForPubkey(
+      const BinaryData& pubkey) override
+   {
+      auto iter = pubkeyToPrivkey_.find(pubkey);
+      if (iter == pubkeyToPrivkey_.end())
+         throw runtime_error("invalid pubkey");
+      return iter->second;
+   }
+
+   void setBip32PathForPubkey(
+      const BinaryData&, const BIP32_AssetPath&) override
+   {}
+
+   BIP32_AssetPath resolveBip32PathForPubkey(const BinaryData&) override
+   {
+      throw runtime_error("no bip32 paths");
+   }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static BinaryData reserializeForInput(
+   const TransactionStub& stub, BinaryDataRef script, unsigned inputIndex)
+{
+   auto&& txinsData = stub.getTxInsData();
+
+   BinaryWriter bw;
+   bw.put_uint32_t(stub.getVersion());
+   bw.put_var_int(txinsData.size());
+   for (unsigned i = 0; i < txinsData.size(); i++)
+   {
+      bw.put_BinaryData(txinsData[i].outputHash_);
+      bw.put_uint32_t(txinsData[i].outputIndex_);
+
+      if (i == inputIndex)
+      {
+         bw.put_var_int(script.getSize());
+         bw.put_BinaryDataRef(script);
+      }
+      else
+      {
+         bw.put_var_int(0);
+      }
+
+      bw.put_uint32_t(txinsData[i].sequence_);
+   }
+
+   bw.put_var_int(stub.getTxOutCount());
+   bw.put_BinaryDataRef(stub.getSerializedOutputScripts());
+   bw.put_uint32_t(stub.getLockTime());
+   bw.put_uint32_t(1);
+
+   return bw.getData();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template<typename T>
+static double timeRuns(unsigned runCount, T lbd)
+{
+   auto start = chrono::steady_clock::now();
+   for (unsigned r = 0; r < runCount; r++)
+      lbd();
+
+   return chrono::duration<double>(
+      chrono::steady_clock::now() - start).count() / runCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+   BenchParams params;
+   try
+   {
+      params.parseArgs(argc, argv);
+   }
+   catch (exception& e)
+   {
+      cerr << e.what() << endl;
+      BenchParams::printHelp();
+      return 1;
+   }
+
+   btc_ecc_start();
+   NetworkConfig::selectNetwork(NETWORK_MODE_MAINNET);
+
+   //synthetic tx, a handful of keys over all inputs
+   auto feed = make_shared<BenchFeed>();
+   vector<BinaryData> scripts;
+   for (unsigned i = 0; i < 16; i++)
+   {
+      auto&& h160 = feed->addPrivKey(CryptoPRNG::generateRandom(32));
+      scripts.push_back(BtcUtils::getP2PKHScript(h160));
+   }
+
+   vector<UTXO> utxos;
+   vector<UnspentTxOut> utxoVec;
+   uint64_t total = 0;
+   for (unsigned i = 0; i < params.inputCount_; i++)
+   {
+      auto&& txHash = CryptoPRNG::generateRandom(32);
+      auto& script = scripts[i % scripts.size()];
+      utxos.push_back(UTXO(COIN, 1, 0, i % 4, txHash, script));
+      utxoVec.push_back(UnspentTxOut(txHash, i % 4, 1, COIN, script));
+      total += COIN;
+   }
+   auto&& recipientH160 = CryptoPRNG::generateRandom(20);
+
+   //fresh signers, sign() skips inputs that already carry a sig
+   vector<shared_ptr<Signer>> signers;
+   for (unsigned r = 0; r < params.runCount_; r++)
+   {
+      auto signer = make_shared<Signer>();
+      for (auto& utxo : utxos)
+         signer->addSpender(make_shared<ScriptSpender>(utxo));
+
+      signer->addRecipient(
+         make_shared<Recipient_P2PKH>(recipientH160, total));
+      signer->setFeed(feed);
+      signers.push_back(signer);
+   }
+
+   unsigned signerId = 0;
+   auto signTime = timeRuns(params.runCount_, [&](void)
+   {
+      signers[signerId++]->sign();
+   });
+
+   BinaryData rawTx(signers.back()->serializeSignedTx());
+   auto bctx = BCTX::parse(rawTx);
+   TransactionVerifier txV(*bctx, utxoVec);
+
+   //sighash measures
+   size_t checksum = 0;
+   auto reserTime = timeRuns(params.runCount_, [&](void)
+   {
+      for (unsigned i = 0; i < params.inputCount_; i++)
+      {
+         auto&& data = reserializeForInput(txV, utxoVec[i].getScript(), i);
+         checksum += BtcUtils::getHash256(data).getPtr()[0];
+      }
+   });
+
+   auto templateTime = timeRuns(params.runCount_, [&](void)
+   {
+      SigHashDataLegacy shd;
+      for (unsigned i = 0; i < params.inputCount_; i++)
+      {
+         auto&& data = shd.getDataForSigHash(
+            SIGHASH_ALL, txV, utxoVec[i].getScript(), i);
+         checksum += BtcUtils::getHash256(data).getPtr()[0];
+      }
+   });
+
+   BinaryData midstateCheck;
+   auto midstateTime = timeRuns(params.runCount_, [&](void)
+   {
+      SigHashDataLegacy shd;
+      for (unsigned i = 0; i < params.inputCount_; i++)
+      {
+         auto&& sha = shd.getSha256ForSigHash(
+            SIGHASH_ALL, txV, utxoVec[i].getScript(), i);
+         checksum += BtcUtils::getSha256(sha).getPtr()[0];
+
+         if (i == params.inputCount_ - 1)
+            midstateCheck = move(sha);
+      }
+   });
+
+   auto&& lastData = reserializeForInput(txV,
+      utxoVec.back().getScript(), params.inputCount_ - 1);
+   if (BtcUtils::getSha256(lastData) != midstateCheck)
+   {
+      cerr << "sighash mismatch" << endl;
+      btc_ecc_stop();
+      return 1;
+   }
+
+   //verification
+   TransactionVerifier::setThreadCount(1);
+   SigVerifyCache::setBudget(0);
+   bool valid = true;
+   auto verifyTime = timeRuns(params.runCount_, [&](void)
+   {
+      TransactionVerifier verifier(*bctx, utxoVec);
+      valid &= verifier.evaluateState().isValid();
+   });
+
+   if (!valid)
+   {
+      cerr << "signed tx failed verification" << endl;
+      btc_ecc_stop();
+      return 1;
+   }
+
+   cout << "tx: " << params.inputCount_ << " inputs, " <<
+      rawTx.getSize() << " bytes (checksum " << checksum % 256 << ")" << endl;
+   cout << setw(24) << "sighash, reserialized" << setw(12) << fixed <<
+      setprecision(4) << reserTime << "s" << endl;
+   cout << setw(24) << "sighash, template" << setw(12) <<
+      templateTime << "s" << endl;
+   cout << setw(24) << "sighash, midstates" << setw(12) <<
+      midstateTime << "s" << setw(10) << setprecision(2) <<
+      reserTime / midstateTime << "x" << endl;
+   cout << setw(24) << "sign" << setw(12) << setprecision(4) <<
+      signTime << "s" << endl;
+   cout << setw(24) << "verify, 1 thread" << setw(12) <<
+      verifyTime << "s" << endl;
+
+   btc_ecc_stop();
+   return 0;
+}
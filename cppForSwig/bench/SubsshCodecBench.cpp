@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright (C) 2016, goatpig                                               //
+//  Distributed under the MIT license                                         //
+//  See LICENSE-MIT or https://opensource.org/licenses/MIT                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+SUBSSH value codec benchmark. Generates synthetic sub histories, serializes
+them in both the legacy and the current versioned format, checks they round
+trip and reports encoded size and decode throughput for each.
+
+   SubsshCodecBench --entries=200000 --txios=4 --spent=40 --rounds=5
+
+Decoding is StoredSubHistory::unserializeDBValue, the per entry cost of
+fillStoredSubHistory, without the db cursor in the way. Entry sizes follow
+a geometric distribution around --txios, so the occasional heavily reused
+address shows up as well.
+***/
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <vector>
+
+#include "StoredBlockObj.h"
+#include "BlockDataManagerConfig.h"
+#include "DBUtils.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchParams
+{
+   unsigned entryCount_ = 200000;
+
+   //mean txio count per entry
+   unsigned txioCount_ = 4;
+
+   //percentage of spent txios
+   unsigned spentPct_ = 40;
+
+   unsigned rounds_ = 5;
+   unsigned seed_ = 1;
+
+   void parseArgs(int argc, char* argv[]);
+   static void printHelp(void);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::printHelp()
+{
+   cout << "SubsshCodecBench options:" << endl;
+   cout << "  --entries=N      subssh entry count (200000)" << endl;
+   cout << "  --txios=N        mean txio count per entry (4)" << endl;
+   cout << "  --spent=N        percentage of spent txios (40)" << endl;
+   cout << "  --rounds=N       decode passes per format (5)" << endl;
+   cout << "  --seed=N         generation seed (1)" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::parseArgs(int argc, char* argv[])
+{
+   for (int i = 1; i < argc; i++)
+   {
+      string arg(argv[i]);
+      if (arg == "--help" || arg == "-h")
+      {
+         printHelp();
+         exit(0);
+      }
+
+      auto&& keyVal = BlockDataManagerConfig::getKeyValFromLine(arg, '=');
+      auto& key = keyVal.first;
+      auto& val = keyVal.second;
+
+      if (key == "--entries")
+         entryCount_ = stoul(val);
+      else if (key == "--txios")
+         txioCount_ = stoul(val);
+      else if (key == "--spent")
+         spentPct_ = stoul(val);
+      else if (key == "--rounds")
+         rounds_ = stoul(val);
+      else if (key == "--seed")
+         seed_ = stoul(val);
+      else
+         throw runtime_error("unknown argument: " + arg);
+   }
+
+   if (entryCount_ == 0 || txioCount_ == 0 || rounds_ == 0)
+      throw runtime_error("entry, txio and round counts have to be non zero");
+   if (spentPct_ > 100)
+      throw runtime_error("spent percentage is over 100");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static BinaryData makeKey(
+   uint32_t height, uint8_t dup, uint16_t txIndex, uint16_t index)
+{
+   BinaryWriter bw;
+   bw.put_BinaryData(DBUtils::heightAndDupToHgtx(height, dup));
+   bw.put_uint16_t(txIndex, BE);
+   bw.put_uint16_t(index, BE);
+   return bw.getData();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct EncodedEntry
+{
+   BinaryData hgtX_;
+   BinaryData legacy_;
+   BinaryData current_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static vector<EncodedEntry> generate(const BenchParams& params,
+   uint64_t& txioTotal)
+{
+   mt19937 rng(params.seed_);
+   geometric_distribution<unsigned> txioDist(1.0 / params.txioCount_);
+   uniform_int_distribution<unsigned> pctDist(0, 99);
+   uniform_int_distribution<unsigned> txIndexDist(0, 2500);
+   uniform_int_distribution<unsigned> outIndexDist(0, 3);
+   uniform_int_distribution<unsigned> ageDist(0, 5000);
+
+   //mostly round-ish amounts with the odd change output
+   uniform_int_distribution<uint64_t> valueDist(546, 5000000000ULL);
+   uniform_int_distribution<unsigned> roundDist(0, 6);
+
+   vector<EncodedEntry> entries;
+   entries.reserve(params.entryCount_);
+   txioTotal = 0;
+
+   for (unsigned i = 0; i < params.entryCount_; i++)
+   {
+      uint32_t height = 100000 + i / 4;
+
+      StoredSubHistory subssh;
+      subssh.hgtX_ = DBUtils::heightAndDupToHgtx(height, 0);
+      subssh.height_ = height;
+
+      auto count = txioDist(rng) + 1;
+      for (unsigned y = 0; y < count; y++)
+      {
+         TxIOPair txio;
+         auto value = valueDist(rng);
+         auto rounding = roundDist(rng);
+         for (unsigned r = 0; r < rounding; r++)
+            value -= value % 10;
+         txio.setValue(value);
+
+         auto txIndex = (uint16_t)txIndexDist(rng);
+         auto outIndex = (uint16_t)outIndexDist(rng);
+         if (pctDist(rng) < params.spentPct_)
+         {
+            auto outHeight = height - min(height, ageDist(rng));
+            txio.setTxOut(makeKey(outHeight, 0, txIndex, outIndex));
+            txio.setTxIn(makeKey(height, 0,
+               (uint16_t)txIndexDist(rng), (uint16_t)outIndexDist(rng)));
+         }
+         else
+         {
+            txio.setTxOut(makeKey(height, 0, txIndex, outIndex));
+            txio.setUTXO(true);
+            txio.setFromCoinbase(txIndex == 0);
+         }
+
+         auto&& key = txio.getDBKeyOfOutput();
+         subssh.txioMap_.insert(make_pair(key, txio));
+      }
+
+      txioTotal += subssh.txioMap_.size();
+
+      EncodedEntry entry;
+      entry.hgtX_ = subssh.hgtX_;
+
+      BinaryWriter bwLegacy, bwCurrent;
+      subssh.serializeDBValue_Legacy(bwLegacy);
+      subssh.serializeDBValue(bwCurrent);
+      entry.legacy_ = bwLegacy.getData();
+      entry.current_ = bwCurrent.getData();
+      entries.push_back(move(entry));
+   }
+
+   return entries;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool checkRoundTrip(const vector<EncodedEntry>& entries)
+{
+   for (auto& entry : entries)
+   {
+      StoredSubHistory fromLegacy, fromCurrent;
+      fromLegacy.hgtX_ = entry.hgtX_;
+      fromCurrent.hgtX_ = entry.hgtX_;
+      fromLegacy.unserializeDBValue(entry.legacy_.getRef());
+      fromCurrent.unserializeDBValue(entry.current_.getRef());
+
+      //compare through the legacy writer, it covers every field we store
+      BinaryWriter bwLegacy, bwCurrent;
+      fromLegacy.serializeDBValue_Legacy(bwLegacy);
+      fromCurrent.serializeDBValue_Legacy(bwCurrent);
+      if (bwLegacy.getData() != bwCurrent.getData() ||
+         bwLegacy.getData() != entry.legacy_)
+         return false;
+   }
+
+   return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static double decode(const vector<EncodedEntry>& entries, bool legacy,
+   unsigned rounds, uint64_t& checksum)
+{
+   auto start = chrono::steady_clock::now();
+   for (unsigned r = 0; r < rounds; r++)
+   {
+      for (auto& entry : entries)
+      {
+         StoredSubHistory subssh;
+         subssh.hgtX_ = entry.hgtX_;
+         subssh.unserializeDBValue(
+            legacy ? entry.legacy_.getRef() : entry.current_.getRef());
+         checksum += subssh.txioMap_.size();
+      }
+   }
+
+   return chrono::duration<double>(
+      chrono::steady_clock::now() - start).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+   BenchParams params;
+   try
+   {
+      params.parseArgs(argc, argv);
+   }
+   catch (exception& e)
+   {
+      cerr << e.what() << endl;
+      BenchParams::printHelp();
+      return 1;
+   }
+
+   uint64_t txioTotal;
+   auto&& entries = generate(params, txioTotal);
+
+   if (!checkRoundTrip(entries))
+   {
+      cerr << "subssh values do not round trip" << endl;
+      return 1;
+   }
+
+   uint64_t legacySize = 0, currentSize = 0;
+   for (auto& entry : entries)
+   {
+      legacySize += entry.legacy_.getSize();
+      currentSize += entry.current_.getSize();
+   }
+
+   cout << entries.size() << " entries, " << txioTotal << " txios" << endl;
+   cout << setw(10) << "format" << setw(14) << "bytes" <<
+      setw(14) << "bytes/txio" << setw(16) << "txios/s" << endl;
+
+   uint64_t checksum = 0;
+   double legacyTime = 0, currentTime = 0;
+
+   //warm up, then alternate so neither format owns the hot cache
+   decode(entries, true, 1, checksum);
+   for (unsigned r = 0; r < params.rounds_; r++)
+   {
+      legacyTime += decode(entries, true, 1, checksum);
+      currentTime += decode(entries, false, 1, checksum);
+   }
+
+   auto report = [&](const string& name, uint64_t size, double elapsed)
+   {
+      cout << setw(10) << name << setw(14) << size <<
+         setw(14) << fixed << setprecision(2) << double(size) / txioTotal <<
+         setw(16) << setprecision(0) <<
+         double(txioTotal) * params.rounds_ / elapsed << endl;
+   };
+
+   report("legacy", legacySize, legacyTime);
+   report("v1", currentSize, currentTime);
+
+   cout << "size ratio: " << setprecision(3) <<
+      double(currentSize) / legacySize <<
+      ", decode speedup: " << legacyTime / currentTime << "x" << endl;
+
+   if (checksum == 0)
+      return 1;
+
+   return 0;
+}
@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//  Copyright (C) 2016, goatpig                                               //
+//  Distributed under the MIT license                                         //
+//  See LICENSE-MIT or https://opensource.org/licenses/MIT                    //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+/***
+Wallet file load benchmark. Writes an encrypted wallet db with --entries
+records over a few sessions (so the load crosses key cycles), then opens
+it repeatedly with 1, 2, 4... up to --threads decryption threads and
+reports wallets and entries opened per second.
+
+   WalletLoadBench --entries=200000 --opens=3 --dir=/tmp/walletbench
+
+Entry sizes loosely follow a watch-only wallet: mostly asset sized
+records with some short comment style ones.
+***/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+
+#include "btc/ecc.h"
+#include "WalletFileInterface.h"
+#include "WalletHeader.h"
+#include "DecryptedDataContainer.h"
+#include "Assets.h"
+#include "BlockDataManagerConfig.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+struct BenchParams
+{
+   unsigned entryCount_ = 200000;
+   unsigned sessionCount_ = 4;
+   unsigned openCount_ = 3;
+   unsigned threadCount_ = thread::hardware_concurrency();
+   string dir_ = "./walletbench";
+
+   void parseArgs(int argc, char* argv[]);
+   static void printHelp(void);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::printHelp()
+{
+   cout << "WalletLoadBench options:" << endl;
+   cout << "  --entries=N      wallet entry count (200000)" << endl;
+   cout << "  --sessions=N     write sessions, one key cycle each (4)" << endl;
+   cout << "  --opens=N        opens per thread count step (3)" << endl;
+   cout << "  --threads=N      max decryption threads (" <<
+      thread::hardware_concurrency() << ")" << endl;
+   cout << "  --dir=PATH       work dir, wallet file is wiped on start "
+      "(./walletbench)" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BenchParams::parseArgs(int argc, char* argv[])
+{
+   for (int i = 1; i < argc; i++)
+   {
+      string arg(argv[i]);
+      if (arg == "--help" || arg == "-h")
+      {
+         printHelp();
+         exit(0);
+      }
+
+      auto&& keyVal = BlockDataManagerConfig::getKeyValFromLine(arg, '=');
+      auto& key = keyVal.first;
+      auto& val = keyVal.second;
+
+      if (key == "--entries")
+         entryCount_ = stoul(val);
+      else if (key == "--sessions")
+         sessionCount_ = stoul(val);
+      else if (key == "--opens")
+         openCount_ = stoul(val);
+      else if (key == "--threads")
+         threadCount_ = stoul(val);
+      else if (key == "--dir")
+         dir_ = val;
+      else
+         throw runtime_error("unknown argument: " + arg);
+   }
+
+   if (entryCount_ == 0 || sessionCount_ == 0 || openCount_ == 0)
+      throw runtime_error("entry, session and open counts have to be non zero");
+   if (threadCount_ == 0)
+      threadCount_ = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+   BenchParams params;
+   try
+   {
+      params.parseArgs(argc, argv);
+   }
+   catch (exception& e)
+   {
+      cerr << e.what() << endl;
+      BenchParams::printHelp();
+      return 1;
+   }
+
+   btc_ecc_start();
+
+   auto dbPath = params.dir_ + "/walletbench.wallet";
+   remove(dbPath.c_str());
+   remove((dbPath + "-lock").c_str());
+
+   auto dbEnv = make_shared<LMDBEnv>();
+   try
+   {
+      dbEnv->open(dbPath, 0);
+      dbEnv->setMapSize((size_t)params.entryCount_ * 1024 + 64 * 1024 * 1024);
+   }
+   catch (exception& e)
+   {
+      cerr << "failed to setup wallet at " << dbPath << ": " << e.what() << endl;
+      cerr << "make sure " << params.dir_ << " exists" << endl;
+      btc_ecc_stop();
+      return 1;
+   }
+
+   auto&& controlSalt = CryptoPRNG::generateRandom(32);
+   auto&& rawRoot = CryptoPRNG::generateRandom(32);
+   string dbName("bench");
+
+   //write
+   {
+      cout << "writing " << params.entryCount_ << " entries" << endl;
+      auto perSession = params.entryCount_ / params.sessionCount_;
+      unsigned written = 0;
+
+      for (unsigned s = 0; s < params.sessionCount_; s++)
+      {
+         auto dbIface = make_shared<DBInterface>(
+            dbEnv.get(), dbName, controlSalt, ENCRYPTION_TOPLAYER_VERSION);
+         dbIface->loadAllEntries(rawRoot);
+
+         auto count = perSession;
+         if (s == params.sessionCount_ - 1)
+            count = params.entryCount_ - written;
+
+         WalletIfaceTransaction tx(nullptr, dbIface.get(), true);
+         for (unsigned i = 0; i < count; i++)
+         {
+            BinaryWriter bwKey;
+            bwKey.put_uint8_t(0x10);
+            bwKey.put_uint32_t(written + i, BE);
+
+            auto&& val = CryptoPRNG::generateRandom(i % 8 == 0 ? 24 : 180);
+            tx.insert(bwKey.getData(), val);
+         }
+
+         written += count;
+      }
+   }
+
+   cout << setw(10) << "threads" << setw(14) << "wallets/s" <<
+      setw(16) << "entries/s" << setw(12) << "speedup" << endl;
+
+   double baseRate = 0;
+   unsigned entryCount = 0;
+   for (unsigned thrCount = 1; ; thrCount *= 2)
+   {
+      if (thrCount > params.threadCount_)
+         thrCount = params.threadCount_;
+
+      DBInterface::setLoadThreadCount(thrCount);
+
+      double elapsed = 0;
+      for (unsigned i = 0; i < params.openCount_; i++)
+      {
+         DBInterface dbIface(
+            dbEnv.get(), dbName, controlSalt, ENCRYPTION_TOPLAYER_VERSION);
+
+         auto start = chrono::steady_clock::now();
+         dbIface.loadAllEntries(rawRoot);
+         elapsed += chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+
+         entryCount = dbIface.getEntryCount();
+      }
+
+      auto rate = params.openCount_ / elapsed;
+      if (baseRate == 0)
+         baseRate = rate;
+
+      cout << setw(10) << thrCount << setw(14) << fixed << setprecision(3) <<
+         rate << setw(16) << setprecision(0) << rate * entryCount <<
+         setw(11) << setprecision(2) << rate / baseRate << "x" << endl;
+
+      if (thrCount == params.threadCount_)
+         break;
+   }
+
+   dbEnv->close();
+   remove(dbPath.c_str());
+   remove((dbPath + "-lock").c_str());
+   btc_ecc_stop();
+
+   if (entryCount != params.entryCount_)
+   {
+      cerr << "loaded " << entryCount << " entries, expected " <<
+         params.entryCount_ << endl;
+      return 1;
+   }
+
+   return 0;
+}
@@ -1,8 +1,10 @@
 #include "sys/time.h"
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "chachapoly_aead.h"
+#include "cpu_features.h"
 #include "poly1305.h"
 
 static const uint8_t testkey[32] = {
@@ -133,6 +135,53 @@ static void bench_chacha20poly1305_crypt(void *data) {
   }
 }
 
+/* bytes/sec of the AEAD for a given message size, best of count runs */
+struct throughput_data {
+  struct chachapolyaead_ctx ctx;
+  uint8_t *buffer;
+  uint32_t size;
+  int iter;
+};
+
+static void bench_aead_throughput(void *data) {
+  struct throughput_data *td = (struct throughput_data *)data;
+  uint32_t seqnr;
+  for (seqnr = 0; seqnr < (uint32_t)td->iter; seqnr++) {
+    chacha20poly1305_crypt(&td->ctx, seqnr, td->buffer, td->buffer,
+                           td->size - 4, 4, 1);
+  }
+}
+
+static void run_throughput(char *name, uint32_t size, int cpu_mask,
+                           int count) {
+  struct throughput_data td;
+  double min = HUGE_VAL;
+  int i;
+
+  /* ~64MB worth of messages per run */
+  td.size = size;
+  td.iter = (int)(64 * 1024 * 1024 / size) + 1;
+  td.buffer = (uint8_t *)calloc(size + POLY1305_TAGLEN, 1);
+  chacha20poly1305_init(&td.ctx, aead_keys, 64);
+  chachapoly_set_cpu_mask(cpu_mask);
+
+  for (i = 0; i < count; i++) {
+    double begin = gettimedouble(), total;
+    bench_aead_throughput(&td);
+    total = gettimedouble() - begin;
+    if (total < min) {
+      min = total;
+    }
+  }
+
+  chachapoly_set_cpu_mask(~0);
+  free(td.buffer);
+
+  printf("%s: ", name);
+  print_number((double)size * td.iter / min / (1024 * 1024));
+  printf(" MB/s\n");
+}
+
 int main(void) {
   struct chacha_ctx ctx_chacha;
   struct chachapolyaead_ctx aead_ctx;
@@ -148,5 +197,13 @@ int main(void) {
                 NULL, &aead_ctx, 20, 4000000);
   run_benchmark("chacha20poly1305_crypt 1MB", bench_chacha20poly1305_crypt,
                 NULL, NULL, &aead_ctx, 20, 30);
+
+  run_throughput("chacha20poly1305 1500B scalar", 1500, 0, 5);
+  run_throughput("chacha20poly1305 1500B sse2", 1500, CHACHAPOLY_CPU_SSE2, 5);
+  run_throughput("chacha20poly1305 1500B simd", 1500, ~0, 5);
+  run_throughput("chacha20poly1305 4MB scalar", 4 * 1024 * 1024, 0, 5);
+  run_throughput("chacha20poly1305 4MB sse2", 4 * 1024 * 1024,
+                 CHACHAPOLY_CPU_SSE2, 5);
+  run_throughput("chacha20poly1305 4MB simd", 4 * 1024 * 1024, ~0, 5);
   return 0;
 }
\ No newline at end of file
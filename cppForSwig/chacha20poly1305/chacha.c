@@ -5,6 +5,7 @@ Public domain.
 */
 
 #include "chacha.h"
+#include "cpu_features.h"
 
 /* $OpenBSD: chacha.c,v 1.1 2013/11/21 00:45:44 djm Exp $ */
 
@@ -81,6 +82,196 @@ void chacha_ivsetup(chacha_ctx *x, const u8 *iv, const u8 *counter) {
   x->input[15] = U8TO32_LITTLE(iv + 4);
 }
 
+#ifdef CHACHAPOLY_X86
+
+/*
+ * Multi-block chacha20: one block per 32 bit lane, so sse2 runs 4 blocks
+ * and avx2 8 blocks per pass. Both process whole passes only and return
+ * the number of bytes consumed, the scalar loop takes the tail. The block
+ * counter in x->input[12..13] is advanced accordingly.
+ */
+
+#define ROTL_SSE2(v, n)                                                        \
+  _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+
+#define QUARTERROUND_SSE2(a, b, c, d)                                          \
+  a = _mm_add_epi32(a, b);                                                     \
+  d = ROTL_SSE2(_mm_xor_si128(d, a), 16);                                      \
+  c = _mm_add_epi32(c, d);                                                     \
+  b = ROTL_SSE2(_mm_xor_si128(b, c), 12);                                      \
+  a = _mm_add_epi32(a, b);                                                     \
+  d = ROTL_SSE2(_mm_xor_si128(d, a), 8);                                       \
+  c = _mm_add_epi32(c, d);                                                     \
+  b = ROTL_SSE2(_mm_xor_si128(b, c), 7);
+
+CHACHAPOLY_TARGET("sse2")
+static u32 chacha_blocks_sse2(chacha_ctx *x, const u8 *m, u8 *c, u32 bytes) {
+  __m128i s[16], v[16];
+  uint64_t ctr = ((uint64_t)x->input[13] << 32) | x->input[12];
+  u32 done = 0;
+  int i, g;
+
+  for (i = 0; i < 16; i++)
+    s[i] = _mm_set1_epi32((int)x->input[i]);
+
+  while (bytes - done >= 4 * 64) {
+    s[12] = _mm_set_epi32((int)(u32)(ctr + 3), (int)(u32)(ctr + 2),
+                          (int)(u32)(ctr + 1), (int)(u32)ctr);
+    s[13] = _mm_set_epi32((int)(u32)((ctr + 3) >> 32), (int)(u32)((ctr + 2) >> 32),
+                          (int)(u32)((ctr + 1) >> 32), (int)(u32)(ctr >> 32));
+
+    for (i = 0; i < 16; i++)
+      v[i] = s[i];
+
+    for (i = 20; i > 0; i -= 2) {
+      QUARTERROUND_SSE2(v[0], v[4], v[8], v[12])
+      QUARTERROUND_SSE2(v[1], v[5], v[9], v[13])
+      QUARTERROUND_SSE2(v[2], v[6], v[10], v[14])
+      QUARTERROUND_SSE2(v[3], v[7], v[11], v[15])
+      QUARTERROUND_SSE2(v[0], v[5], v[10], v[15])
+      QUARTERROUND_SSE2(v[1], v[6], v[11], v[12])
+      QUARTERROUND_SSE2(v[2], v[7], v[8], v[13])
+      QUARTERROUND_SSE2(v[3], v[4], v[9], v[14])
+    }
+
+    for (i = 0; i < 16; i++)
+      v[i] = _mm_add_epi32(v[i], s[i]);
+
+    /* transpose each group of 4 words to get 16 bytes of each block */
+    for (g = 0; g < 4; g++) {
+      __m128i t0 = _mm_unpacklo_epi32(v[4 * g], v[4 * g + 1]);
+      __m128i t1 = _mm_unpacklo_epi32(v[4 * g + 2], v[4 * g + 3]);
+      __m128i t2 = _mm_unpackhi_epi32(v[4 * g], v[4 * g + 1]);
+      __m128i t3 = _mm_unpackhi_epi32(v[4 * g + 2], v[4 * g + 3]);
+      __m128i blk[4];
+      int b;
+
+      blk[0] = _mm_unpacklo_epi64(t0, t1);
+      blk[1] = _mm_unpackhi_epi64(t0, t1);
+      blk[2] = _mm_unpacklo_epi64(t2, t3);
+      blk[3] = _mm_unpackhi_epi64(t2, t3);
+
+      for (b = 0; b < 4; b++) {
+        size_t offset = done + 64 * b + 16 * g;
+        __m128i in = _mm_loadu_si128((const __m128i *)(m + offset));
+        _mm_storeu_si128((__m128i *)(c + offset), _mm_xor_si128(in, blk[b]));
+      }
+    }
+
+    ctr += 4;
+    done += 4 * 64;
+  }
+
+  x->input[12] = (u32)ctr;
+  x->input[13] = (u32)(ctr >> 32);
+  return done;
+}
+
+#define ROTL_AVX2(v, n)                                                        \
+  _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+
+#define QUARTERROUND_AVX2(a, b, c, d)                                          \
+  a = _mm256_add_epi32(a, b);                                                  \
+  d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16);                      \
+  c = _mm256_add_epi32(c, d);                                                  \
+  b = ROTL_AVX2(_mm256_xor_si256(b, c), 12);                                   \
+  a = _mm256_add_epi32(a, b);                                                  \
+  d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8);                       \
+  c = _mm256_add_epi32(c, d);                                                  \
+  b = ROTL_AVX2(_mm256_xor_si256(b, c), 7);
+
+CHACHAPOLY_TARGET("avx2")
+static u32 chacha_blocks_avx2(chacha_ctx *x, const u8 *m, u8 *c, u32 bytes) {
+  __m256i s[16], v[16];
+  const __m256i rot16 = _mm256_setr_epi8(
+      2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+      2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+  const __m256i rot8 = _mm256_setr_epi8(
+      3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+      3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+  uint64_t ctr = ((uint64_t)x->input[13] << 32) | x->input[12];
+  u32 done = 0;
+  int i, g;
+
+  for (i = 0; i < 16; i++)
+    s[i] = _mm256_set1_epi32((int)x->input[i]);
+
+  while (bytes - done >= 8 * 64) {
+    u32 lo[8], hi[8];
+    __m256i blk[4][4];
+
+    for (i = 0; i < 8; i++) {
+      lo[i] = (u32)(ctr + i);
+      hi[i] = (u32)((ctr + i) >> 32);
+    }
+    s[12] = _mm256_loadu_si256((const __m256i *)lo);
+    s[13] = _mm256_loadu_si256((const __m256i *)hi);
+
+    for (i = 0; i < 16; i++)
+      v[i] = s[i];
+
+    for (i = 20; i > 0; i -= 2) {
+      QUARTERROUND_AVX2(v[0], v[4], v[8], v[12])
+      QUARTERROUND_AVX2(v[1], v[5], v[9], v[13])
+      QUARTERROUND_AVX2(v[2], v[6], v[10], v[14])
+      QUARTERROUND_AVX2(v[3], v[7], v[11], v[15])
+      QUARTERROUND_AVX2(v[0], v[5], v[10], v[15])
+      QUARTERROUND_AVX2(v[1], v[6], v[11], v[12])
+      QUARTERROUND_AVX2(v[2], v[7], v[8], v[13])
+      QUARTERROUND_AVX2(v[3], v[4], v[9], v[14])
+    }
+
+    for (i = 0; i < 16; i++)
+      v[i] = _mm256_add_epi32(v[i], s[i]);
+
+    /*
+    transpose each group of 4 words within the 128 bit halves,
+    blk[g][b] then holds words 4g..4g+3 of block b (low half) and
+    block b + 4 (high half)
+    */
+    for (g = 0; g < 4; g++) {
+      __m256i t0 = _mm256_unpacklo_epi32(v[4 * g], v[4 * g + 1]);
+      __m256i t1 = _mm256_unpacklo_epi32(v[4 * g + 2], v[4 * g + 3]);
+      __m256i t2 = _mm256_unpackhi_epi32(v[4 * g], v[4 * g + 1]);
+      __m256i t3 = _mm256_unpackhi_epi32(v[4 * g + 2], v[4 * g + 3]);
+
+      blk[g][0] = _mm256_unpacklo_epi64(t0, t1);
+      blk[g][1] = _mm256_unpackhi_epi64(t0, t1);
+      blk[g][2] = _mm256_unpacklo_epi64(t2, t3);
+      blk[g][3] = _mm256_unpackhi_epi64(t2, t3);
+    }
+
+    /* pair up the halves into 32 byte runs of each block */
+    for (i = 0; i < 4; i++) {
+      for (g = 0; g < 4; g += 2) {
+        size_t lowOffset = done + 64 * i + 16 * g;
+        size_t highOffset = lowOffset + 4 * 64;
+        __m256i low = _mm256_permute2x128_si256(blk[g][i], blk[g + 1][i], 0x20);
+        __m256i high =
+            _mm256_permute2x128_si256(blk[g][i], blk[g + 1][i], 0x31);
+
+        _mm256_storeu_si256(
+            (__m256i *)(c + lowOffset),
+            _mm256_xor_si256(
+                _mm256_loadu_si256((const __m256i *)(m + lowOffset)), low));
+        _mm256_storeu_si256(
+            (__m256i *)(c + highOffset),
+            _mm256_xor_si256(
+                _mm256_loadu_si256((const __m256i *)(m + highOffset)), high));
+      }
+    }
+
+    ctr += 8;
+    done += 8 * 64;
+  }
+
+  x->input[12] = (u32)ctr;
+  x->input[13] = (u32)(ctr >> 32);
+  return done;
+}
+
+#endif /* CHACHAPOLY_X86 */
+
 void chacha_encrypt_bytes(chacha_ctx *x, const u8 *m, u8 *c, u32 bytes) {
   u32 x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
   u32 j0, j1, j2, j3, j4, j5, j6, j7, j8, j9, j10, j11, j12, j13, j14, j15;
@@ -91,6 +282,25 @@ void chacha_encrypt_bytes(chacha_ctx *x, const u8 *m, u8 *c, u32 bytes) {
   if (!bytes)
     return;
 
+#ifdef CHACHAPOLY_X86
+  {
+    int features = chachapoly_cpu_features();
+    u32 done = 0;
+
+    if ((features & CHACHAPOLY_CPU_AVX2) && bytes >= 8 * 64)
+      done += chacha_blocks_avx2(x, m, c, bytes);
+    if ((features & CHACHAPOLY_CPU_SSE2) && bytes - done >= 4 * 64)
+      done += chacha_blocks_sse2(x, m + done, c + done, bytes - done);
+
+    if (done == bytes)
+      return;
+
+    m += done;
+    c += done;
+    bytes -= done;
+  }
+#endif
+
   j0 = x->input[0];
   j1 = x->input[1];
   j2 = x->input[2];
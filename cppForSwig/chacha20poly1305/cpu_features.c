@@ -0,0 +1,73 @@
+/*
+ * Runtime x86 feature detection for the SIMD chacha20 and poly1305 paths.
+ * Detection runs once, concurrent first calls compute the same value and
+ * publish it atomically.
+ */
+
+#include "cpu_features.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CPU_LOAD(x) _InterlockedCompareExchange(&(x), 0, 0)
+#define CPU_STORE(x, v) _InterlockedExchange(&(x), (v))
+#else
+#define CPU_LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define CPU_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+#endif
+
+static volatile long cpu_mask = ~0;
+
+#ifdef CHACHAPOLY_X86
+
+static volatile long cpu_features = -1;
+
+static int detect_cpu_features(void) {
+  int result = 0;
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  {
+    int regs[4];
+    int max_leaf;
+    __cpuid(regs, 0);
+    max_leaf = regs[0];
+    if (max_leaf >= 1) {
+      __cpuid(regs, 1);
+      if (regs[3] & (1 << 26))
+        result |= CHACHAPOLY_CPU_SSE2;
+
+      /* avx2 also needs avx and the OS to save the ymm registers */
+      if (max_leaf >= 7 && (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) &&
+          (_xgetbv(0) & 6) == 6) {
+        __cpuidex(regs, 7, 0);
+        if (regs[1] & (1 << 5))
+          result |= CHACHAPOLY_CPU_AVX2;
+      }
+    }
+  }
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    result |= CHACHAPOLY_CPU_SSE2;
+  if (__builtin_cpu_supports("avx2"))
+    result |= CHACHAPOLY_CPU_AVX2;
+#endif
+
+  return result;
+}
+
+#endif /* CHACHAPOLY_X86 */
+
+int chachapoly_cpu_features(void) {
+#ifdef CHACHAPOLY_X86
+  long features = CPU_LOAD(cpu_features);
+  if (features == -1) {
+    features = detect_cpu_features();
+    CPU_STORE(cpu_features, features);
+  }
+  return (int)(features & CPU_LOAD(cpu_mask));
+#else
+  return 0;
+#endif
+}
+
+void chachapoly_set_cpu_mask(int mask) { CPU_STORE(cpu_mask, mask); }
@@ -0,0 +1,37 @@
+/*
+ * Runtime x86 feature detection for the SIMD chacha20 and poly1305 paths.
+ *
+ * CHACHAPOLY_X86 is defined when the SIMD code can be compiled,
+ * chachapoly_cpu_features then reports what the running CPU supports.
+ */
+
+#ifndef CHACHAPOLY_CPU_FEATURES_H
+#define CHACHAPOLY_CPU_FEATURES_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CHACHAPOLY_X86
+#define CHACHAPOLY_TARGET(x) __attribute__((target(x)))
+#include <immintrin.h>
+
+#elif defined(_MSC_VER)
+#define CHACHAPOLY_X86
+#define CHACHAPOLY_TARGET(x)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+#endif
+
+#define CHACHAPOLY_CPU_SSE2 1
+#define CHACHAPOLY_CPU_AVX2 2
+
+/* features of the running cpu usable by this library, 0 off x86 */
+int chachapoly_cpu_features(void);
+
+/* restrict the SIMD paths to mask, for benchmarks and tests */
+void chachapoly_set_cpu_mask(int mask);
+
+#endif /* CHACHAPOLY_CPU_FEATURES_H */
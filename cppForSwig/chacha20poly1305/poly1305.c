@@ -6,6 +6,7 @@
 /* $OpenBSD: poly1305.c,v 1.3 2013/12/19 22:57:13 djm Exp $ */
 
 #include "poly1305.h"
+#include "cpu_features.h"
 
 #define mul32x32_64(a, b) ((uint64_t)(a) * (b))
 
@@ -21,6 +22,216 @@
     (p)[3] = (uint8_t)((v) >> 24);                                             \
   } while (0)
 
+#ifdef CHACHAPOLY_X86
+
+/*
+ * Multi-block poly1305: each lane accumulates every n-th block with r^n as
+ * the multiplier (n = 2 for sse2, 4 for avx2), the lanes are folded back
+ * into a single accumulator with r once the full passes are done:
+ *   h = ((H[0] * r + H[1]) * r + ... + H[n - 1]) * r
+ * Limbs are the same 26 bit radix as the scalar code.
+ */
+
+#define POLY1305_SIMD_MIN_BYTES 256
+
+/* h = h * r mod 2^130 - 5, partially reduced */
+static void poly1305_mul_scalar(uint32_t h[5], const uint32_t r[5]) {
+  uint64_t s1 = r[1] * 5, s2 = r[2] * 5, s3 = r[3] * 5, s4 = r[4] * 5;
+  uint64_t t[5], c;
+
+  t[0] = (uint64_t)h[0] * r[0] + h[1] * s4 + h[2] * s3 + h[3] * s2 + h[4] * s1;
+  t[1] = (uint64_t)h[0] * r[1] + (uint64_t)h[1] * r[0] + h[2] * s4 +
+         h[3] * s3 + h[4] * s2;
+  t[2] = (uint64_t)h[0] * r[2] + (uint64_t)h[1] * r[1] +
+         (uint64_t)h[2] * r[0] + h[3] * s4 + h[4] * s3;
+  t[3] = (uint64_t)h[0] * r[3] + (uint64_t)h[1] * r[2] +
+         (uint64_t)h[2] * r[1] + (uint64_t)h[3] * r[0] + h[4] * s4;
+  t[4] = (uint64_t)h[0] * r[4] + (uint64_t)h[1] * r[3] +
+         (uint64_t)h[2] * r[2] + (uint64_t)h[3] * r[1] +
+         (uint64_t)h[4] * r[0];
+
+  c = t[0] >> 26;
+  h[0] = (uint32_t)t[0] & 0x3ffffff;
+  t[1] += c;
+  c = t[1] >> 26;
+  h[1] = (uint32_t)t[1] & 0x3ffffff;
+  t[2] += c;
+  c = t[2] >> 26;
+  h[2] = (uint32_t)t[2] & 0x3ffffff;
+  t[3] += c;
+  c = t[3] >> 26;
+  h[3] = (uint32_t)t[3] & 0x3ffffff;
+  t[4] += c;
+  c = t[4] >> 26;
+  h[4] = (uint32_t)t[4] & 0x3ffffff;
+  c = h[0] + c * 5;
+  h[0] = (uint32_t)c & 0x3ffffff;
+  h[1] += (uint32_t)(c >> 26);
+}
+
+/* h = sum of lanes[i] * r^(n - i), lanes hold 5 limbs each */
+static void poly1305_fold_lanes(uint32_t h[5], const uint64_t *lanes,
+                                int n, const uint32_t r[5]) {
+  int i, k;
+  for (k = 0; k < 5; k++)
+    h[k] = 0;
+
+  for (i = 0; i < n; i++) {
+    for (k = 0; k < 5; k++)
+      h[k] += (uint32_t)lanes[k * n + i];
+    poly1305_mul_scalar(h, r);
+  }
+}
+
+/* vector h = h * r + m carry chain, shared by both widths */
+#define POLY1305_CARRY(VEC, ADD, SRL, AND, SLL, h, t, mask)                    \
+  do {                                                                         \
+    VEC c_;                                                                    \
+    c_ = SRL(t[0], 26);                                                        \
+    h[0] = AND(t[0], mask);                                                    \
+    t[1] = ADD(t[1], c_);                                                      \
+    c_ = SRL(t[1], 26);                                                        \
+    h[1] = AND(t[1], mask);                                                    \
+    t[2] = ADD(t[2], c_);                                                      \
+    c_ = SRL(t[2], 26);                                                        \
+    h[2] = AND(t[2], mask);                                                    \
+    t[3] = ADD(t[3], c_);                                                      \
+    c_ = SRL(t[3], 26);                                                        \
+    h[3] = AND(t[3], mask);                                                    \
+    t[4] = ADD(t[4], c_);                                                      \
+    c_ = SRL(t[4], 26);                                                        \
+    h[4] = AND(t[4], mask);                                                    \
+    h[0] = ADD(h[0], ADD(c_, SLL(c_, 2)));                                     \
+    c_ = SRL(h[0], 26);                                                        \
+    h[0] = AND(h[0], mask);                                                    \
+    h[1] = ADD(h[1], c_);                                                      \
+  } while (0)
+
+#define POLY1305_MUL(ADD, MUL, h, r, s, t)                                     \
+  do {                                                                         \
+    t[0] = ADD(ADD(ADD(MUL(h[0], r[0]), MUL(h[1], s[4])),                      \
+                   ADD(MUL(h[2], s[3]), MUL(h[3], s[2]))),                     \
+               MUL(h[4], s[1]));                                               \
+    t[1] = ADD(ADD(ADD(MUL(h[0], r[1]), MUL(h[1], r[0])),                      \
+                   ADD(MUL(h[2], s[4]), MUL(h[3], s[3]))),                     \
+               MUL(h[4], s[2]));                                               \
+    t[2] = ADD(ADD(ADD(MUL(h[0], r[2]), MUL(h[1], r[1])),                      \
+                   ADD(MUL(h[2], r[0]), MUL(h[3], s[4]))),                     \
+               MUL(h[4], s[3]));                                               \
+    t[3] = ADD(ADD(ADD(MUL(h[0], r[3]), MUL(h[1], r[2])),                      \
+                   ADD(MUL(h[2], r[1]), MUL(h[3], r[0]))),                     \
+               MUL(h[4], s[4]));                                               \
+    t[4] = ADD(ADD(ADD(MUL(h[0], r[4]), MUL(h[1], r[3])),                      \
+                   ADD(MUL(h[2], r[2]), MUL(h[3], r[1]))),                     \
+               MUL(h[4], r[0]));                                               \
+  } while (0)
+
+CHACHAPOLY_TARGET("sse2")
+static size_t poly1305_blocks_sse2(uint32_t h[5], const uint32_t r[5],
+                                   const unsigned char *m, size_t inlen) {
+  uint32_t r2[5];
+  __m128i R[5], S[5], H[5], T[5];
+  const __m128i mask = _mm_set1_epi64x(0x3ffffff);
+  const __m128i hibit = _mm_set1_epi64x(1 << 24);
+  uint64_t lanes[5 * 2];
+  size_t done = 0;
+  int k;
+
+  for (k = 0; k < 5; k++)
+    r2[k] = r[k];
+  poly1305_mul_scalar(r2, r);
+
+  for (k = 0; k < 5; k++) {
+    R[k] = _mm_set1_epi64x(r2[k]);
+    S[k] = _mm_set1_epi64x((uint64_t)r2[k] * 5);
+    H[k] = _mm_setzero_si128();
+  }
+
+  while (inlen - done >= 32) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(m + done));
+    __m128i b = _mm_loadu_si128((const __m128i *)(m + done + 16));
+    __m128i lo = _mm_unpacklo_epi64(a, b);
+    __m128i hi = _mm_unpackhi_epi64(a, b);
+
+    POLY1305_MUL(_mm_add_epi64, _mm_mul_epu32, H, R, S, T);
+    POLY1305_CARRY(__m128i, _mm_add_epi64, _mm_srli_epi64, _mm_and_si128,
+                   _mm_slli_epi64, H, T, mask);
+
+    H[0] = _mm_add_epi64(H[0], _mm_and_si128(lo, mask));
+    H[1] = _mm_add_epi64(H[1], _mm_and_si128(_mm_srli_epi64(lo, 26), mask));
+    H[2] = _mm_add_epi64(
+        H[2], _mm_and_si128(_mm_or_si128(_mm_srli_epi64(lo, 52),
+                                         _mm_slli_epi64(hi, 12)),
+                            mask));
+    H[3] = _mm_add_epi64(H[3], _mm_and_si128(_mm_srli_epi64(hi, 14), mask));
+    H[4] = _mm_add_epi64(H[4],
+                         _mm_or_si128(_mm_srli_epi64(hi, 40), hibit));
+
+    done += 32;
+  }
+
+  for (k = 0; k < 5; k++)
+    _mm_storeu_si128((__m128i *)(lanes + 2 * k), H[k]);
+  poly1305_fold_lanes(h, lanes, 2, r);
+  return done;
+}
+
+CHACHAPOLY_TARGET("avx2")
+static size_t poly1305_blocks_avx2(uint32_t h[5], const uint32_t r[5],
+                                   const unsigned char *m, size_t inlen) {
+  uint32_t r4[5];
+  __m256i R[5], S[5], H[5], T[5];
+  const __m256i mask = _mm256_set1_epi64x(0x3ffffff);
+  const __m256i hibit = _mm256_set1_epi64x(1 << 24);
+  uint64_t lanes[5 * 4];
+  size_t done = 0;
+  int k;
+
+  for (k = 0; k < 5; k++)
+    r4[k] = r[k];
+  poly1305_mul_scalar(r4, r);
+  poly1305_mul_scalar(r4, r4);
+
+  for (k = 0; k < 5; k++) {
+    R[k] = _mm256_set1_epi64x(r4[k]);
+    S[k] = _mm256_set1_epi64x((uint64_t)r4[k] * 5);
+    H[k] = _mm256_setzero_si256();
+  }
+
+  while (inlen - done >= 64) {
+    /* lanes come out as blocks 0, 2, 1, 3, put them back in order */
+    __m256i a = _mm256_loadu_si256((const __m256i *)(m + done));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(m + done + 32));
+    __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+    __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+
+    POLY1305_MUL(_mm256_add_epi64, _mm256_mul_epu32, H, R, S, T);
+    POLY1305_CARRY(__m256i, _mm256_add_epi64, _mm256_srli_epi64,
+                   _mm256_and_si256, _mm256_slli_epi64, H, T, mask);
+
+    H[0] = _mm256_add_epi64(H[0], _mm256_and_si256(lo, mask));
+    H[1] = _mm256_add_epi64(H[1],
+                            _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask));
+    H[2] = _mm256_add_epi64(
+        H[2], _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52),
+                                               _mm256_slli_epi64(hi, 12)),
+                               mask));
+    H[3] = _mm256_add_epi64(H[3],
+                            _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask));
+    H[4] = _mm256_add_epi64(H[4],
+                            _mm256_or_si256(_mm256_srli_epi64(hi, 40), hibit));
+
+    done += 64;
+  }
+
+  for (k = 0; k < 5; k++)
+    _mm256_storeu_si256((__m256i *)(lanes + 4 * k), H[k]);
+  poly1305_fold_lanes(h, lanes, 4, r);
+  return done;
+}
+
+#endif /* CHACHAPOLY_X86 */
+
 void poly1305_auth(unsigned char out[POLY1305_TAGLEN], const unsigned char *m,
                    size_t inlen, const unsigned char key[POLY1305_KEYLEN]) {
   uint32_t t0, t1, t2, t3;
@@ -67,6 +278,30 @@ void poly1305_auth(unsigned char out[POLY1305_TAGLEN], const unsigned char *m,
   h3 = 0;
   h4 = 0;
 
+#ifdef CHACHAPOLY_X86
+  if (inlen >= POLY1305_SIMD_MIN_BYTES) {
+    int features = chachapoly_cpu_features();
+    uint32_t r[5] = {r0, r1, r2, r3, r4};
+    uint32_t hv[5];
+    size_t done = 0;
+
+    if (features & CHACHAPOLY_CPU_AVX2)
+      done = poly1305_blocks_avx2(hv, r, m, inlen);
+    else if (features & CHACHAPOLY_CPU_SSE2)
+      done = poly1305_blocks_sse2(hv, r, m, inlen);
+
+    if (done > 0) {
+      h0 = hv[0];
+      h1 = hv[1];
+      h2 = hv[2];
+      h3 = hv[3];
+      h4 = hv[4];
+      m += done;
+      inlen -= done;
+    }
+  }
+#endif
+
   /* full blocks */
   if (inlen < 16)
     goto poly1305_donna_atmost15bytes;
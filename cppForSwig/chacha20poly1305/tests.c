@@ -4,6 +4,7 @@
 * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
 **********************************************************************/
 
+#undef NDEBUG
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -11,6 +12,7 @@
 
 #include "chacha.h"
 #include "chachapoly_aead.h"
+#include "cpu_features.h"
 #include "poly1305.h"
 
 struct chacha20_testvector {
@@ -124,6 +126,60 @@ static const struct poly1305_testvector poly1305_testvectors[] = {
      {0xa6, 0xf7, 0x45, 0x00, 0x8f, 0x81, 0xc9, 0x16, 0xa2, 0x0d, 0xcc, 0x74,
       0xee, 0xf2, 0xb2, 0xf0}}};
 
+/* the SIMD paths have to match the scalar code for every length/offset */
+static void test_simd_matches_scalar(int cpu_mask) {
+  static uint8_t input[4096 + 64];
+  static uint8_t out_simd[4096 + 64];
+  static uint8_t out_scalar[4096 + 64];
+  uint8_t key[32];
+  uint8_t iv[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  uint8_t tag_simd[16], tag_scalar[16];
+  struct chacha_ctx ctx;
+  unsigned int i, len;
+
+  for (i = 0; i < sizeof(input); i++)
+    input[i] = (uint8_t)(i * 7 + 3);
+  for (i = 0; i < sizeof(key); i++)
+    key[i] = (uint8_t)(0xa5 ^ i);
+
+  for (len = 0; len <= 4096; len += (len < 1100 ? 1 : 61)) {
+    /* run a block first so the counter is not 0 for the long pass */
+    chachapoly_set_cpu_mask(cpu_mask);
+    chacha_keysetup(&ctx, key, 256);
+    chacha_ivsetup(&ctx, iv, NULL);
+    chacha_encrypt_bytes(&ctx, input, out_simd, 64);
+    chacha_encrypt_bytes(&ctx, input + 3, out_simd, len);
+    poly1305_auth(tag_simd, input + (len & 7), len, key);
+
+    chachapoly_set_cpu_mask(0);
+    chacha_keysetup(&ctx, key, 256);
+    chacha_ivsetup(&ctx, iv, NULL);
+    chacha_encrypt_bytes(&ctx, input, out_scalar, 64);
+    chacha_encrypt_bytes(&ctx, input + 3, out_scalar, len);
+    poly1305_auth(tag_scalar, input + (len & 7), len, key);
+
+    assert(memcmp(out_simd, out_scalar, len) == 0);
+    assert(memcmp(tag_simd, tag_scalar, 16) == 0);
+  }
+
+  /* 32 bit block counter carry into the high word */
+  {
+    uint8_t counter[8] = {0xfe, 0xff, 0xff, 0xff, 0, 0, 0, 0};
+    chachapoly_set_cpu_mask(cpu_mask);
+    chacha_keysetup(&ctx, key, 256);
+    chacha_ivsetup(&ctx, iv, counter);
+    chacha_encrypt_bytes(&ctx, input, out_simd, 1024);
+
+    chachapoly_set_cpu_mask(0);
+    chacha_keysetup(&ctx, key, 256);
+    chacha_ivsetup(&ctx, iv, counter);
+    chacha_encrypt_bytes(&ctx, input, out_scalar, 1024);
+    assert(memcmp(out_simd, out_scalar, 1024) == 0);
+  }
+
+  chachapoly_set_cpu_mask(~0);
+}
+
 int main(void) {
   struct chacha_ctx ctx;
   uint8_t iv[8] = {0, 0, 0, 0, 0, 0, 0, 0};
@@ -205,4 +261,8 @@ int main(void) {
   chacha20poly1305_crypt(&aead_ctx, seqnr, plaintext_buf_new, ciphertext_buf,
                          252, 4, 0);
   assert(memcmp(plaintext_buf, plaintext_buf_new, 252) == 0);
+
+  test_simd_matches_scalar(CHACHAPOLY_CPU_SSE2);
+  test_simd_matches_scalar(~0);
+  return 0;
 }
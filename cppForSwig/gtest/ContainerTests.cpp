@@ -102,6 +102,345 @@ TEST_F(ContainerTests, TransactionalMap)
    EXPECT_EQ(total, calctotal);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(ContainerTests, PersistentMap)
+{
+   //random ops, checked against std::map
+   srand(1234);
+   PersistentMap<unsigned, unsigned> pmap;
+   map<unsigned, unsigned> refMap;
+
+   vector<pair<PersistentMap<unsigned, unsigned>, map<unsigned, unsigned>>> 
+      snapshots;
+
+   for (unsigned i = 0; i < 5000; i++)
+   {
+      auto key = (unsigned)rand() % 2000;
+      switch (rand() % 3)
+      {
+      case 0:
+         EXPECT_EQ(pmap.insert(make_pair(key, i)), 
+            refMap.insert(make_pair(key, i)).second);
+         break;
+
+      case 1:
+         pmap.insert_or_assign(key, i);
+         refMap[key] = i;
+         break;
+
+      default:
+         EXPECT_EQ(pmap.erase(key), refMap.erase(key));
+      }
+
+      if (i % 500 == 0)
+         snapshots.push_back(make_pair(pmap, refMap));
+   }
+
+   ASSERT_EQ(pmap.size(), refMap.size());
+   EXPECT_TRUE(equal(pmap.begin(), pmap.end(), refMap.begin()));
+   EXPECT_TRUE(equal(pmap.rbegin(), pmap.rend(), refMap.rbegin()));
+
+   //older versions are left untouched by later writes
+   for (auto& snapshot : snapshots)
+   {
+      ASSERT_EQ(snapshot.first.size(), snapshot.second.size());
+      EXPECT_TRUE(equal(snapshot.first.begin(), snapshot.first.end(), 
+         snapshot.second.begin()));
+   }
+
+   //lookups
+   for (unsigned key = 0; key < 2001; key++)
+   {
+      EXPECT_EQ(pmap.count(key), refMap.count(key));
+
+      auto iter = pmap.find(key);
+      auto refIter = refMap.find(key);
+      if (refIter == refMap.end())
+      {
+         EXPECT_TRUE(iter == pmap.end());
+         EXPECT_THROW(pmap.at(key), out_of_range);
+      }
+      else
+      {
+         ASSERT_TRUE(iter != pmap.end());
+         EXPECT_EQ(iter->second, refIter->second);
+         EXPECT_EQ(pmap.at(key), refIter->second);
+      }
+
+      auto lb = pmap.lower_bound(key);
+      auto refLb = refMap.lower_bound(key);
+      if (refLb == refMap.end())
+         EXPECT_TRUE(lb == pmap.end());
+      else
+         EXPECT_EQ(lb->first, refLb->first);
+
+      auto ub = pmap.upper_bound(key);
+      auto refUb = refMap.upper_bound(key);
+      if (refUb == refMap.end())
+      {
+         EXPECT_TRUE(ub == pmap.end());
+      }
+      else
+      {
+         EXPECT_EQ(ub->first, refUb->first);
+
+         //walk back from the bound
+         if (refUb != refMap.begin())
+            EXPECT_EQ((--ub)->first, (--refUb)->first);
+      }
+   }
+
+   //iterator copies carry their own path
+   auto iter = pmap.find(refMap.begin()->first);
+   auto iterCopy = iter++;
+   EXPECT_EQ(iterCopy->first, refMap.begin()->first);
+   EXPECT_EQ(iter->first, next(refMap.begin())->first);
+   EXPECT_EQ((++iterCopy)->first, iter->first);
+
+   pmap.clear();
+   EXPECT_TRUE(pmap.empty());
+   EXPECT_TRUE(pmap.begin() == pmap.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(ContainerTests, TransactionalPersistentMap)
+{
+   unsigned iterations = 200;
+   TransactionalPersistentMap<unsigned, unsigned> theMap;
+
+   auto insert_thread = [&theMap, &iterations](unsigned id)
+   {
+      for (auto i = id * iterations; i < (id + 1) * iterations; i++)
+      {
+         theMap.insert(make_pair(i, i));
+      }
+   };
+
+   auto find_thread = [&theMap, &iterations](unsigned id, uint32_t* tally)
+   {
+      for (auto i = id * iterations; i < (id + 1) * iterations; i++)
+      {
+         auto mapptr = theMap.get();
+         auto iter = mapptr->find(i);
+         if (iter != mapptr->end())
+            *tally += iter->second;
+      }
+   };
+
+   vector<thread> vecthr;
+   for (unsigned i = 0; i < threadCount_; i++)
+      vecthr.push_back(thread(insert_thread, i));
+
+   for (auto& thr : vecthr)
+      if (thr.joinable())
+         thr.join();
+
+   vecthr.clear();
+   vector<uint32_t> tallies(threadCount_);
+
+   for (unsigned i = 0; i < threadCount_; i++)
+      vecthr.push_back(thread(find_thread, i, &tallies[0] + i));
+
+   insert_thread(threadCount_);
+
+   for (auto& thr : vecthr)
+      if (thr.joinable())
+         thr.join();
+
+   uint32_t total = 0;
+   for (auto& tally : tallies)
+      total += tally;
+
+   uint32_t maxtotal = threadCount_ * iterations - 1;
+   uint32_t calctotal = (maxtotal + 1) * maxtotal;
+   calctotal /= 2;
+
+   EXPECT_EQ(total, calctotal);
+   EXPECT_EQ(theMap.size(), (threadCount_ + 1) * iterations);
+
+   //batched update overwrites, snapshots taken before are unaffected
+   auto snapshot = theMap.get();
+   map<unsigned, unsigned> updateMap;
+   for (unsigned i = 0; i < iterations; i++)
+      updateMap[i] = i + 1;
+   theMap.update(updateMap);
+
+   auto updated = theMap.get();
+   EXPECT_EQ(updated->size(), snapshot->size());
+   EXPECT_EQ(snapshot->at(10), 10U);
+   EXPECT_EQ(updated->at(10), 11U);
+
+   //erase
+   vector<unsigned> eraseVec;
+   for (unsigned i = 0; i < iterations; i++)
+      eraseVec.push_back(i);
+   theMap.erase(eraseVec);
+   theMap.erase(iterations);
+
+   EXPECT_EQ(theMap.size(), threadCount_ * iterations - 1);
+   EXPECT_EQ(theMap.get()->begin()->first, iterations + 1);
+   EXPECT_EQ(snapshot->size(), (threadCount_ + 1) * iterations);
+
+   auto popped = theMap.pop_all();
+   EXPECT_EQ(popped->size(), threadCount_ * iterations - 1);
+   EXPECT_EQ(theMap.size(), 0U);
+   EXPECT_TRUE(theMap.get()->empty());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(ContainerTests, LruCache)
+{
+   LruCache<unsigned, unsigned> cache(4);
+   for (unsigned i = 0; i < 4; i++)
+      cache.put(i, i * 10);
+   EXPECT_EQ(cache.size(), 4);
+
+   //touch 0 so that 1 is the oldest entry
+   unsigned val;
+   ASSERT_TRUE(cache.get(0, val));
+   EXPECT_EQ(val, 0);
+
+   cache.put(4, 40);
+   EXPECT_EQ(cache.size(), 4);
+   EXPECT_FALSE(cache.get(1, val));
+   ASSERT_TRUE(cache.get(0, val));
+   ASSERT_TRUE(cache.get(4, val));
+   EXPECT_EQ(val, 40);
+
+   //overwrite refreshes, 2 is evicted next
+   cache.put(3, 33);
+   cache.put(5, 50);
+   EXPECT_FALSE(cache.get(2, val));
+   ASSERT_TRUE(cache.get(3, val));
+   EXPECT_EQ(val, 33);
+
+   cache.erase(3);
+   EXPECT_FALSE(cache.get(3, val));
+   EXPECT_EQ(cache.size(), 3);
+
+   cache.clear();
+   EXPECT_EQ(cache.size(), 0);
+   EXPECT_FALSE(cache.get(0, val));
+
+   //concurrent access
+   LruCache<unsigned, unsigned> sharedCache(64);
+   auto worker = [&sharedCache](unsigned id)
+   {
+      for (unsigned i = 0; i < 1000; i++)
+      {
+         auto key = (id * 1000 + i) % 128;
+         unsigned result;
+         if (sharedCache.get(key, result))
+            ASSERT_EQ(result, key * 2);
+         else
+            sharedCache.put(key, key * 2);
+      }
+   };
+
+   vector<thread> vecthr;
+   for (unsigned i = 0; i < threadCount_; i++)
+      vecthr.push_back(thread(worker, i));
+
+   for (auto& thr : vecthr)
+      thr.join();
+
+   EXPECT_LE(sharedCache.size(), 64);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(ContainerTests, ShardedLruCache)
+{
+   //single shard, 10 bytes per entry, room for 4
+   auto sizeOf = [](const unsigned&, const unsigned&)->size_t { return 10; };
+   ShardedLruCache<unsigned, unsigned> cache(40, 1, sizeOf);
+   for (unsigned i = 0; i < 4; i++)
+      cache.put(i, i * 10);
+   EXPECT_EQ(cache.size(), 4);
+   EXPECT_EQ(cache.byteSize(), 40);
+
+   //touch 0 so that 1 is the oldest entry
+   unsigned val;
+   ASSERT_TRUE(cache.get(0, val));
+   EXPECT_EQ(val, 0);
+
+   cache.put(4, 40);
+   EXPECT_EQ(cache.size(), 4);
+   EXPECT_FALSE(cache.get(1, val));
+   ASSERT_TRUE(cache.get(4, val));
+   EXPECT_EQ(val, 40);
+
+   EXPECT_EQ(cache.hits(), 2);
+   EXPECT_EQ(cache.misses(), 1);
+
+   cache.erase(4);
+   EXPECT_FALSE(cache.get(4, val));
+   EXPECT_EQ(cache.byteSize(), 30);
+
+   //resizing in place evicts the oldest entries down to the new budget
+   cache.setBudget(20);
+   EXPECT_EQ(cache.size(), 2);
+   EXPECT_EQ(cache.byteSize(), 20);
+   EXPECT_FALSE(cache.get(2, val));
+   ASSERT_TRUE(cache.get(0, val));
+
+   cache.setBudget(40);
+   cache.put(5, 50);
+   cache.put(6, 60);
+   EXPECT_EQ(cache.size(), 4);
+   ASSERT_TRUE(cache.get(3, val));
+   EXPECT_EQ(val, 30);
+
+   //entries are weighed by size, an oversized entry evicts the rest but 
+   //is kept
+   auto sizeOfVal = [](const unsigned&, const unsigned& v)->size_t 
+      { return v; };
+   ShardedLruCache<unsigned, unsigned> weighedCache(100, 1, sizeOfVal);
+   weighedCache.put(0, 30);
+   weighedCache.put(1, 30);
+   weighedCache.put(2, 30);
+   EXPECT_EQ(weighedCache.size(), 3);
+
+   weighedCache.put(3, 50);
+   EXPECT_EQ(weighedCache.size(), 2);
+   EXPECT_FALSE(weighedCache.get(0, val));
+   EXPECT_FALSE(weighedCache.get(1, val));
+   EXPECT_LE(weighedCache.byteSize(), 100);
+
+   weighedCache.put(4, 500);
+   EXPECT_EQ(weighedCache.size(), 1);
+   ASSERT_TRUE(weighedCache.get(4, val));
+   EXPECT_EQ(val, 500);
+
+   weighedCache.clear();
+   EXPECT_EQ(weighedCache.size(), 0);
+   EXPECT_EQ(weighedCache.byteSize(), 0);
+
+   //concurrent access across shards
+   ShardedLruCache<unsigned, unsigned> sharedCache(640, 8, sizeOf);
+   auto worker = [&sharedCache](unsigned id)
+   {
+      for (unsigned i = 0; i < 1000; i++)
+      {
+         auto key = (id * 1000 + i) % 128;
+         unsigned result;
+         if (sharedCache.get(key, result))
+            ASSERT_EQ(result, key * 2);
+         else
+            sharedCache.put(key, key * 2);
+      }
+   };
+
+   vector<thread> vecthr;
+   for (unsigned i = 0; i < threadCount_; i++)
+      vecthr.push_back(thread(worker, i));
+
+   for (auto& thr : vecthr)
+      thr.join();
+
+   EXPECT_LE(sharedCache.size(), 64);
+   EXPECT_EQ(sharedCache.hits() + sharedCache.misses(), threadCount_ * 1000);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 TEST_F(ContainerTests, PileTest_Sequential)
 {
@@ -1092,7 +1092,7 @@ TEST_F(CryptoPPTest, DetSigning)
     BTC_PRNG dummyPRNG;
 
     // Data
-    SecureBinaryData dataToSign(data5U.c_str());
+    SecureBinaryData dataToSign(BinaryData::fromString(data5U));
     CryptoPP::StringSource(dataToSign.toBinStr(), true,
                            new CryptoPP::SignerFilter(dummyPRNG, signer,
                            new CryptoPP::StringSink(outputSig)));
@@ -1100,7 +1100,7 @@ TEST_F(CryptoPPTest, DetSigning)
     // Verify the sig.
     BTC_PUBKEY pubKeyY = CryptoECDSA::ComputePublicKey(prvKeyY);
     BTC_VERIFIER verifier(pubKeyY);
-    SecureBinaryData finalSig(outputSig);
+    SecureBinaryData finalSig(BinaryData::fromString(outputSig));
     EXPECT_TRUE(verifier.VerifyMessage((const byte*)dataToSign.getPtr(), 
                                                     dataToSign.getSize(),
                                        (const byte*)finalSig.getPtr(), 
@@ -3289,6 +3289,728 @@ TEST_F(BlockObjTest, DISABLED_RegisteredTxStuff)
    EXPECT_TRUE(false);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, TxFilterPool)
+{
+   //3 blocks, 2nd block carries a duplicate prefix
+   vector<vector<BinaryData>> hashes(3);
+   for (unsigned i = 0; i < 3; i++)
+   {
+      for (unsigned y = 0; y < 50 * (i + 1); y++)
+      {
+         BinaryWriter bw;
+         bw.put_uint32_t(i);
+         bw.put_uint32_t(y);
+         hashes[i].push_back(BtcUtils::getHash256(bw.getData()));
+      }
+   }
+   hashes[1][7] = hashes[1][3];
+
+   set<TxFilter<TxFilterType>> filters;
+   for (unsigned i = 0; i < 3; i++)
+   {
+      TxFilter<TxFilterType> filter(i + 10, hashes[i].size());
+      filter.update(hashes[i]);
+      filters.insert(filter);
+   }
+
+   TxFilterPool<TxFilterType> pool(filters);
+   BinaryWriter bw;
+   pool.serialize(bw);
+   auto& poolData = bw.getData();
+
+   //zero copy lookups against the probe index
+   TxFilterPool<TxFilterType> poolRef(poolData.getPtr(), poolData.getSize());
+   EXPECT_EQ(poolRef.getVersion(), TXFILTER_POOL_VERSION);
+
+   for (unsigned i = 0; i < 3; i++)
+   {
+      for (unsigned y = 0; y < hashes[i].size(); y++)
+      {
+         auto&& result = poolRef.compare(hashes[i][y]);
+         auto&& refResult = pool.compare(hashes[i][y]);
+         EXPECT_EQ(result, refResult);
+
+         auto iter = result.find(i + 10);
+         ASSERT_NE(iter, result.end());
+         EXPECT_NE(iter->second.find(y), iter->second.end());
+      }
+   }
+
+   auto&& dupResult = poolRef.compare(hashes[1][3]);
+   ASSERT_EQ(dupResult.size(), 1U);
+   EXPECT_EQ(dupResult[11], set<uint32_t>({ 3, 7 }));
+
+   auto&& miss = poolRef.compare(BtcUtils::getHash256(READHEX("00")));
+   EXPECT_EQ(miss.size(), 0U);
+
+   auto&& blockKeys = poolRef.getBlockKeys();
+   EXPECT_EQ(blockKeys, vector<uint32_t>({ 12, 11, 10 }));
+
+   //round trip
+   TxFilterPool<TxFilterType> poolDeser;
+   poolDeser.deserialize((uint8_t*)poolData.getPtr(), poolData.getSize());
+   BinaryWriter bwDeser;
+   poolDeser.serialize(bwDeser);
+   EXPECT_EQ(bwDeser.getData(), poolData);
+
+   //legacy pools are still readable
+   BinaryWriter bwLegacy;
+   bwLegacy.put_uint32_t(filters.size());
+   for (auto& filter : filters)
+      filter.serialize(bwLegacy);
+   auto& legacyData = bwLegacy.getData();
+
+   TxFilterPool<TxFilterType> legacyRef(
+      legacyData.getPtr(), legacyData.getSize());
+   EXPECT_EQ(legacyRef.getVersion(), 1U);
+   EXPECT_EQ(legacyRef.compare(hashes[2][42]), poolRef.compare(hashes[2][42]));
+   EXPECT_EQ(legacyRef.getBlockKeys(), blockKeys);
+
+   TxFilterPool<TxFilterType> upgraded;
+   upgraded.deserialize((uint8_t*)legacyData.getPtr(), legacyData.getSize());
+   BinaryWriter bwUpgraded;
+   upgraded.serialize(bwUpgraded);
+   EXPECT_EQ(bwUpgraded.getData(), poolData);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, TxFilterPool_Batch)
+{
+   vector<vector<BinaryData>> hashes(4);
+   for (unsigned i = 0; i < 4; i++)
+   {
+      for (unsigned y = 0; y < 37 * (i + 1); y++)
+      {
+         BinaryWriter bw;
+         bw.put_uint32_t(i);
+         bw.put_uint32_t(y);
+         hashes[i].push_back(BtcUtils::getHash256(bw.getData()));
+      }
+   }
+   hashes[3][20] = hashes[0][5];
+
+   set<TxFilter<TxFilterType>> filters;
+   for (unsigned i = 0; i < 4; i++)
+   {
+      TxFilter<TxFilterType> filter(i, hashes[i].size());
+      filter.update(hashes[i]);
+      filters.insert(filter);
+   }
+
+   TxFilterPool<TxFilterType> pool(filters);
+   BinaryWriter bw;
+   pool.serialize(bw);
+   auto& poolData = bw.getData();
+   TxFilterPool<TxFilterType> poolRef(poolData.getPtr(), poolData.getSize());
+
+   BinaryWriter bwLegacy;
+   bwLegacy.put_uint32_t(filters.size());
+   for (auto& filter : filters)
+      filter.serialize(bwLegacy);
+   auto& legacyData = bwLegacy.getData();
+   TxFilterPool<TxFilterType> legacyRef(
+      legacyData.getPtr(), legacyData.getSize());
+
+   auto checkBatch = [&](const vector<BinaryData>& batch)->void
+   {
+      auto&& poolResults = pool.compareBatch(batch);
+      auto&& refResults = poolRef.compareBatch(batch);
+      auto&& legacyResults = legacyRef.compareBatch(batch);
+      ASSERT_EQ(poolResults.size(), batch.size());
+      ASSERT_EQ(refResults.size(), batch.size());
+      ASSERT_EQ(legacyResults.size(), batch.size());
+
+      for (unsigned i = 0; i < batch.size(); i++)
+      {
+         auto&& expected = pool.compare(batch[i]);
+         EXPECT_EQ(poolResults[i], expected);
+         EXPECT_EQ(refResults[i], expected);
+         EXPECT_EQ(legacyResults[i], expected);
+      }
+   };
+
+   //few keys, vectorized path
+   vector<BinaryData> smallBatch;
+   smallBatch.push_back(hashes[0][5]);
+   smallBatch.push_back(hashes[2][100]);
+   smallBatch.push_back(BtcUtils::getHash256(READHEX("00")));
+   smallBatch.push_back(hashes[3][147]);
+   smallBatch.push_back(hashes[1][0]);
+   checkBatch(smallBatch);
+
+   auto&& dupResults = poolRef.compareBatch(smallBatch);
+   EXPECT_EQ(dupResults[0].size(), 2U);
+   EXPECT_EQ(dupResults[2].size(), 0U);
+
+   //many keys, sorted lookup path
+   vector<BinaryData> bigBatch;
+   for (auto& hashVec : hashes)
+      bigBatch.insert(bigBatch.end(), hashVec.begin(), hashVec.end());
+   bigBatch.push_back(BtcUtils::getHash256(READHEX("01")));
+   checkBatch(bigBatch);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, BlockFilter)
+{
+   vector<BinaryData> scripts;
+   vector<uint64_t> elements;
+   for (unsigned i = 0; i < 500; i++)
+   {
+      BinaryWriter bw;
+      bw.put_uint32_t(i);
+      scripts.push_back(BtcUtils::getHash160(bw.getData()));
+      elements.push_back(BlockFilter::hashScript(
+         SCRIPT_PREFIX_HASH160, scripts.back()));
+   }
+
+   auto outpointHash = BtcUtils::getHash256(scripts[0]);
+   elements.push_back(BlockFilter::hashOutpoint(outpointHash, 3));
+   elements.push_back(elements[0]);
+
+   auto&& filter = BlockFilter::create(elements);
+   EXPECT_EQ(filter.getCount(), 501ULL);
+
+   BlockFilter filterDeser(filter.serialize());
+   EXPECT_EQ(filterDeser.getCount(), 501ULL);
+
+   //every element hits
+   for (auto& script : scripts)
+   {
+      vector<uint64_t> keys{ BlockFilter::hashScript(
+         SCRIPT_PREFIX_HASH160, script) };
+      EXPECT_TRUE(filterDeser.matchAny(keys));
+   }
+
+   vector<uint64_t> outpointKeys{
+      BlockFilter::hashOutpoint(outpointHash, 3) };
+   EXPECT_TRUE(filterDeser.matchAny(outpointKeys));
+
+   //unrelated keys don't, save for the odd false positive
+   vector<uint64_t> missKeys;
+   for (unsigned i = 0; i < 1000; i++)
+   {
+      BinaryWriter bw;
+      bw.put_uint32_t(i + 1000);
+      missKeys.push_back(BlockFilter::hashScript(
+         SCRIPT_PREFIX_HASH160, BtcUtils::getHash160(bw.getData())));
+   }
+
+   missKeys.push_back(BlockFilter::hashOutpoint(outpointHash, 4));
+   missKeys.push_back(BlockFilter::hashScript(
+      SCRIPT_PREFIX_P2SH, scripts[0]));
+
+   unsigned hits = 0;
+   for (auto& key : missKeys)
+   {
+      vector<uint64_t> keys{ key };
+      if (filterDeser.matchAny(keys))
+         ++hits;
+   }
+   EXPECT_LE(hits, 2U);
+
+   //sorted batches hit as soon as one key is in the set
+   sort(missKeys.begin(), missKeys.end());
+   auto batch = missKeys;
+   batch.push_back(BlockFilter::hashScript(SCRIPT_PREFIX_HASH160, scripts[42]));
+   sort(batch.begin(), batch.end());
+   EXPECT_TRUE(filterDeser.matchAny(batch));
+   EXPECT_FALSE(filterDeser.matchAny(vector<uint64_t>()));
+
+   //truncated data
+   auto&& raw = filter.serialize();
+   EXPECT_THROW(BlockFilter(raw.getSliceCopy(0, raw.getSize() / 2)),
+      runtime_error);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, BlockData_Arena)
+{
+   auto getID = [](const BinaryData&)->unsigned { return 0; };
+
+   auto checkBlock = [&getID](const BinaryData& rawBlock)->void
+   {
+      BlockData heapBlock, arenaBlock;
+      heapBlock.deserialize(rawBlock.getPtr(), rawBlock.getSize(),
+         nullptr, getID, true, true);
+
+      arenaBlock.useArena(true);
+      arenaBlock.deserialize(rawBlock.getPtr(), rawBlock.getSize(),
+         nullptr, getID, true, true);
+
+      auto arena = arenaBlock.getArena();
+      ASSERT_NE(arena, nullptr);
+      EXPECT_EQ(heapBlock.getArena(), nullptr);
+      EXPECT_EQ(arena->chunkCount(), 1U);
+
+      auto& heapTxns = heapBlock.getTxns();
+      auto& arenaTxns = arenaBlock.getTxns();
+      ASSERT_EQ(heapTxns.size(), arenaTxns.size());
+      EXPECT_GE(arena->allocationCount(), heapTxns.size());
+
+      auto compareTables = [](const OffsetTable& lhs, const OffsetTable& rhs)
+      {
+         ASSERT_EQ(lhs.size(), rhs.size());
+         for (unsigned i = 0; i < lhs.size(); i++)
+            EXPECT_EQ(lhs[i], rhs[i]);
+      };
+
+      for (unsigned i = 0; i < heapTxns.size(); i++)
+      {
+         auto& heapTx = *heapTxns[i];
+         auto& arenaTx = *arenaTxns[i];
+
+         EXPECT_EQ(heapTx.data_, arenaTx.data_);
+         EXPECT_EQ(heapTx.size_, arenaTx.size_);
+         EXPECT_EQ(heapTx.version_, arenaTx.version_);
+         EXPECT_EQ(heapTx.lockTime_, arenaTx.lockTime_);
+         EXPECT_EQ(heapTx.usesWitness_, arenaTx.usesWitness_);
+         EXPECT_EQ(heapTx.isCoinbase_, arenaTx.isCoinbase_);
+         EXPECT_EQ(heapTx.getHash(), arenaTx.getHash());
+
+         compareTables(heapTx.txins_, arenaTx.txins_);
+         compareTables(heapTx.txouts_, arenaTx.txouts_);
+         compareTables(heapTx.witnesses_, arenaTx.witnesses_);
+
+         Tx tx(BinaryDataRef(heapTx.data_, heapTx.size_));
+         EXPECT_EQ(tx.getThisHash(), arenaTx.getHash());
+         EXPECT_EQ(arenaTx.txins_.size(), tx.getNumTxIn());
+         EXPECT_EQ(arenaTx.txouts_.size(), tx.getNumTxOut());
+      }
+
+      //parsed txns outlive their block and arena
+      auto txPtr = arenaTxns.back();
+      BCTX txCopy(*txPtr);
+      arenaBlock = BlockData();
+      arena.reset();
+
+      compareTables(txCopy.txouts_, heapTxns.back()->txouts_);
+      compareTables(txPtr->txouts_, heapTxns.back()->txouts_);
+   };
+
+   checkBlock(rawBlock_);
+
+   ifstream blkfile("../reorgTest/blk_3.dat", ios::binary);
+   blkfile.seekg(0, ios::end);
+   auto size = blkfile.tellg();
+   blkfile.seekg(8, ios::beg);
+   BinaryData rawBlock3((size_t)size - 8);
+   blkfile.read((char*)rawBlock3.getPtr(), rawBlock3.getSize());
+   checkBlock(rawBlock3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, BlockDataCache_TxOffsets)
+{
+   auto getID = [](const BinaryData&)->unsigned { return 0; };
+
+   auto checkBlock = [&getID](const BinaryData& rawBlock)->void
+   {
+      BlockData block;
+      block.deserialize(rawBlock.getPtr(), rawBlock.getSize(),
+         nullptr, getID, true, true);
+
+      auto&& offsets = BlockDataCache::computeTxOffsets(
+         rawBlock.getPtr(), rawBlock.getSize());
+
+      auto& txns = block.getTxns();
+      ASSERT_EQ(offsets.size(), txns.size());
+      for (unsigned i = 0; i < txns.size(); i++)
+      {
+         EXPECT_EQ(offsets[i].first, txns[i]->data_ - rawBlock.getPtr());
+         EXPECT_EQ(offsets[i].second, txns[i]->size_);
+      }
+
+      //cached tables are keyed by block hash
+      auto& cache = BlockDataCache::instance();
+      auto table1 = cache.getTxOffsets(
+         block.getHash(), rawBlock.getPtr(), rawBlock.getSize());
+      auto table2 = cache.getTxOffsets(block.getHash(), nullptr, 0);
+      EXPECT_EQ(table1, table2);
+      EXPECT_EQ(*table1, offsets);
+   };
+
+   checkBlock(rawBlock_);
+
+   ifstream blkfile("../reorgTest/blk_3.dat", ios::binary);
+   blkfile.seekg(0, ios::end);
+   auto size = blkfile.tellg();
+   blkfile.seekg(8, ios::beg);
+   BinaryData rawBlock3((size_t)size - 8);
+   blkfile.read((char*)rawBlock3.getPtr(), rawBlock3.getSize());
+   checkBlock(rawBlock3);
+
+   EXPECT_THROW(BlockDataCache::computeTxOffsets(
+      rawBlock3.getPtr(), rawBlock3.getSize() - 10), runtime_error);
+   EXPECT_THROW(BlockDataCache::computeTxOffsets(
+      rawBlock3.getPtr(), 40), BlockDeserializingException);
+
+   //file maps are reused until the file changes
+   auto& cache = BlockDataCache::instance();
+   string path("./blkdatacache_test.dat");
+   {
+      ofstream out(path, ios::binary | ios::trunc);
+      out.write(rawBlock_.toCharPtr(), rawBlock_.getSize());
+   }
+
+   auto map1 = cache.getFileMap(path);
+   auto map2 = cache.getFileMap(path);
+   ASSERT_NE(map1->getPtr(), nullptr);
+   EXPECT_EQ(map1, map2);
+   EXPECT_EQ(map1->size(), rawBlock_.getSize());
+
+   {
+      ofstream out(path, ios::binary | ios::app);
+      out.write(rawBlock3.toCharPtr(), rawBlock3.getSize());
+   }
+
+   auto map3 = cache.getFileMap(path);
+   EXPECT_NE(map1, map3);
+   EXPECT_EQ(map3->size(), rawBlock_.getSize() + rawBlock3.getSize());
+   EXPECT_EQ(memcmp(map3->getPtr(), rawBlock_.getPtr(), rawBlock_.getSize()), 0);
+
+   //missing files aren't cached
+   remove(path.c_str());
+   auto map4 = cache.getFileMap(path);
+   EXPECT_EQ(map4->getPtr(), nullptr);
+
+   cache.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, BlockDataLoader_Lru)
+{
+   string dir("./blkloadertest");
+   DBUtils::removeDirectory(dir);
+   mkdir(dir);
+
+   //4 blk files of 4kB each
+   size_t fileSize = 4096;
+   for (unsigned i = 0; i < 4; i++)
+   {
+      BinaryData data(fileSize);
+      memset(data.getPtr(), i + 1, fileSize);
+      ofstream out(BtcUtils::getBlkFilename(dir, i), ios::binary);
+      out.write(data.toCharPtr(), data.getSize());
+   }
+
+   BlockDataLoader bdl(dir);
+
+   //no cap, every get maps anew
+   auto map0 = bdl.get(0);
+   ASSERT_NE(map0->getPtr(), nullptr);
+   EXPECT_EQ(map0->size(), fileSize);
+   EXPECT_EQ(map0->getPtr()[0], 1);
+   EXPECT_NE(bdl.get(0), map0);
+   EXPECT_EQ(bdl.getStats().mapCount_, 2U);
+   EXPECT_EQ(bdl.getStats().peakMappedSize_, 0U);
+
+   //room for 2 files
+   bdl.setMappedCap(2 * fileSize);
+   map0 = bdl.get(0);
+   EXPECT_EQ(bdl.get(0), map0);
+   auto map1 = bdl.get(1);
+   EXPECT_EQ(bdl.get(1), map1);
+   EXPECT_EQ(bdl.getStats().mapCount_, 4U);
+   EXPECT_EQ(bdl.getStats().releaseCount_, 0U);
+
+   //0 is now the most recent, 2 evicts 1
+   EXPECT_EQ(bdl.get(0), map0);
+   auto map2 = bdl.get(2);
+   EXPECT_EQ(map2->getPtr()[0], 3);
+   EXPECT_EQ(bdl.get(0), map0);
+   EXPECT_EQ(bdl.get(2), map2);
+
+   auto stats = bdl.getStats();
+   EXPECT_EQ(stats.mapCount_, 5U);
+   EXPECT_EQ(stats.releaseCount_, 1U);
+   EXPECT_EQ(stats.peakMappedSize_, 3 * fileSize);
+
+   //1 was evicted, it is mapped anew and evicts 0
+   auto map1b = bdl.get(1);
+   EXPECT_NE(map1b, map1);
+   EXPECT_EQ(bdl.get(2), map2);
+   EXPECT_NE(bdl.get(0), map0);
+   EXPECT_EQ(bdl.getStats().mapCount_, 7U);
+   EXPECT_EQ(bdl.getStats().releaseCount_, 3U);
+
+   //evicted maps stay valid for as long as they're held
+   EXPECT_EQ(map1->getPtr()[fileSize - 1], 2);
+
+   //read ahead goes through the lru
+   bdl.readAhead({ 2, 3 });
+   stats = bdl.getStats();
+   EXPECT_EQ(stats.readAheadCount_, 2U);
+   EXPECT_EQ(stats.mapCount_, 8U);
+
+   //explicit release drops the entry
+   bdl.release(3);
+   EXPECT_EQ(bdl.getStats().releaseCount_, stats.releaseCount_ + 1);
+   bdl.release(3);
+   EXPECT_EQ(bdl.getStats().releaseCount_, stats.releaseCount_ + 1);
+
+   //the map handed out is kept even if it alone exceeds the cap
+   bdl.setMappedCap(fileSize / 2);
+   auto map3 = bdl.get(3);
+   ASSERT_NE(map3->getPtr(), nullptr);
+   EXPECT_EQ(map3->getPtr()[0], 4);
+   EXPECT_EQ(bdl.get(3), map3);
+
+   //concurrent gets of the same file all get the lru entry
+   bdl.setMappedCap(4 * fileSize);
+   vector<shared_ptr<BlockDataFileMap>> maps(8);
+   vector<thread> threads;
+   for (unsigned i = 0; i < maps.size(); i++)
+   {
+      threads.push_back(thread([&bdl, &maps, i](void)->void
+      {
+         maps[i] = bdl.get(1);
+      }));
+   }
+
+   for (auto& thr : threads)
+      thr.join();
+
+   for (auto& mapPtr : maps)
+      EXPECT_EQ(mapPtr, bdl.get(1));
+
+   DBUtils::removeDirectory(dir);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, DISABLED_BlockData_ArenaBench)
+{
+   //parse the same block repeatedly, heap vs arena backed BCTX
+   auto getID = [](const BinaryData&)->unsigned { return 0; };
+   const unsigned iterations = 500;
+   const unsigned txCount = 2000;
+
+   //synthetic block, merkle root isn't checked
+   BinaryWriter bw;
+   bw.put_BinaryData(rawHead_);
+   bw.put_var_int(txCount);
+   for (unsigned i = 0; i < txCount; i++)
+      bw.put_BinaryData(i % 2 ? rawTx0_ : rawTx1_);
+   auto& rawBlock = bw.getData();
+
+   auto run = [&](bool useArena)->void
+   {
+      size_t arenaAllocs = 0;
+      size_t arenaChunks = 0;
+
+      auto start = chrono::system_clock::now();
+      for (unsigned i = 0; i < iterations; i++)
+      {
+         BlockData bd;
+         bd.useArena(useArena);
+         bd.deserialize(rawBlock.getPtr(), rawBlock.getSize(),
+            nullptr, getID, false, false);
+
+         if (useArena)
+         {
+            arenaAllocs += bd.getArena()->allocationCount();
+            arenaChunks += bd.getArena()->chunkCount();
+         }
+      }
+      chrono::duration<double> elapsed = chrono::system_clock::now() - start;
+
+      cout << (useArena ? "arena: " : "heap:  ") <<
+         iterations / elapsed.count() << " blocks/s, " <<
+         (iterations * rawBlock.getSize()) / elapsed.count() / 1024 / 1024 <<
+         " MB/s";
+      if (useArena)
+      {
+         cout << ", " << arenaAllocs / elapsed.count() << " arena allocs/s, " <<
+            arenaChunks / elapsed.count() << " slabs/s";
+      }
+      cout << endl;
+   };
+
+   run(false);
+   run(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, HeaderIndex)
+{
+   //3 and a half chunks worth of headers
+   auto count = HEADER_INDEX_CHUNK_SIZE * 3 + HEADER_INDEX_CHUNK_SIZE / 2;
+   map<unsigned, shared_ptr<BlockHeader>> headerMap;
+   for (unsigned i = 0; i < count; i++)
+   {
+      auto header = make_shared<BlockHeader>(rawHead_);
+      header->setBlockFileNum(i / 100);
+      header->setBlockFileOffset(i * 1000);
+      headerMap[i] = header;
+   }
+
+   auto emptyIndex = make_shared<const HeaderIndex>();
+   auto index1 = emptyIndex->update(headerMap, count);
+   ASSERT_EQ(index1->size(), count);
+   EXPECT_EQ(index1->epoch(), emptyIndex->epoch() + 1);
+
+   for (unsigned i = 0; i < count; i++)
+   {
+      EXPECT_EQ(index1->header(i), headerMap[i]);
+      EXPECT_EQ(index1->hash(i), headerMap[i]->getThisHashRef());
+      EXPECT_EQ(index1->timestamp(i), headerMap[i]->getTimestamp());
+      EXPECT_EQ(index1->difficulty(i), headerMap[i]->getDifficulty());
+      EXPECT_EQ(index1->fileID(i), i / 100);
+      EXPECT_EQ(index1->offset(i), i * 1000);
+   }
+
+   //reorg: truncate and replace the top of the chain
+   unsigned branchPoint = HEADER_INDEX_CHUNK_SIZE * 2 + 10;
+   unsigned newCount = branchPoint + 5;
+   map<unsigned, shared_ptr<BlockHeader>> branchMap;
+   for (unsigned i = branchPoint; i < newCount; i++)
+   {
+      auto header = make_shared<BlockHeader>(rawHead_);
+      header->setBlockFileNum(1000);
+      header->setBlockFileOffset(i);
+      branchMap[i] = header;
+   }
+
+   auto index2 = index1->update(branchMap, newCount);
+   ASSERT_EQ(index2->size(), newCount);
+   for (unsigned i = 0; i < branchPoint; i++)
+      EXPECT_EQ(index2->header(i), headerMap[i]);
+
+   for (unsigned i = branchPoint; i < newCount; i++)
+   {
+      EXPECT_EQ(index2->header(i), branchMap[i]);
+      EXPECT_EQ(index2->fileID(i), 1000U);
+      EXPECT_EQ(index2->offset(i), i);
+   }
+
+   //previous version is untouched
+   ASSERT_EQ(index1->size(), count);
+   for (unsigned i = branchPoint; i < count; i++)
+   {
+      EXPECT_EQ(index1->header(i), headerMap[i]);
+      EXPECT_EQ(index1->fileID(i), i / 100);
+   }
+
+   //grow with gaps, as id indexes do
+   map<unsigned, shared_ptr<BlockHeader>> gapMap;
+   gapMap[count + 3] = headerMap[0];
+   auto index3 = index2->update(gapMap, count + 4);
+   ASSERT_EQ(index3->size(), count + 4);
+   EXPECT_EQ(index3->header(newCount), nullptr);
+   EXPECT_EQ(index3->fileID(newCount), UINT32_MAX);
+   EXPECT_EQ(index3->header(count + 3), headerMap[0]);
+   EXPECT_EQ(index3->header(branchPoint), branchMap[branchPoint]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockObjTest, HeaderIndex_MedianTime)
+{
+   //timestamps trending up with some noise, as real chains do
+   auto count = HEADER_INDEX_CHUNK_SIZE + 500;
+   auto makeHeader = [this](uint32_t timestamp)->shared_ptr<BlockHeader>
+   {
+      BinaryData rawHeader = rawHead_;
+      memcpy(rawHeader.getPtr() + 68, &timestamp, 4);
+      return make_shared<BlockHeader>(rawHeader);
+   };
+
+   auto computeMedianTimes = [](const vector<uint32_t>& timestamps)
+   {
+      vector<uint32_t> result;
+      for (size_t i = 0; i < timestamps.size(); i++)
+      {
+         auto start = i >= MEDIAN_TIME_SPAN - 1 ? i - MEDIAN_TIME_SPAN + 1 : 0;
+         vector<uint32_t> window(
+            timestamps.begin() + start, timestamps.begin() + i + 1);
+         sort(window.begin(), window.end());
+         auto val = window[window.size() / 2];
+         if (i > 0)
+            val = max(val, result.back());
+         result.push_back(val);
+      }
+
+      return result;
+   };
+
+   auto checkIndex = [&](shared_ptr<const HeaderIndex> index,
+      const vector<uint32_t>& timestamps)
+   {
+      auto&& medianTimes = computeMedianTimes(timestamps);
+      ASSERT_EQ(index->size(), medianTimes.size());
+      for (size_t i = 0; i < medianTimes.size(); i++)
+         ASSERT_EQ(index->medianTime(i), medianTimes[i]);
+
+      for (auto& ts : { medianTimes.front() - 1, medianTimes.front(), 
+         medianTimes[medianTimes.size() / 3], medianTimes.back(),
+         medianTimes.back() + 1 })
+      {
+         auto iter = lower_bound(medianTimes.begin(), medianTimes.end(), ts);
+         auto medianPos = size_t(iter - medianTimes.begin());
+         EXPECT_EQ(index->lowerBoundMedianTime(ts), medianPos);
+
+         //first block at or past ts within the last median window
+         auto pos = index->lowerBoundTimestamp(ts);
+         ASSERT_LE(pos, medianPos);
+         if (pos < timestamps.size())
+            EXPECT_GE(timestamps[pos], ts);
+         for (size_t i = pos >= MEDIAN_TIME_SPAN ? pos - MEDIAN_TIME_SPAN : 0;
+            i < pos; i++)
+         {
+            EXPECT_LT(timestamps[i], ts);
+         }
+      }
+   };
+
+   srand(0);
+   vector<uint32_t> timestamps;
+   map<unsigned, shared_ptr<BlockHeader>> headerMap;
+   for (unsigned i = 0; i < count; i++)
+   {
+      uint32_t ts = 1500000000 + i * 600 + (rand() % 7200) - 3600;
+      timestamps.push_back(ts);
+      headerMap[i] = makeHeader(ts);
+   }
+
+   auto index1 = make_shared<const HeaderIndex>(true)->update(headerMap, count);
+   checkIndex(index1, timestamps);
+
+   //id indexes don't carry median times
+   auto idIndex = make_shared<const HeaderIndex>()->update(headerMap, count);
+   EXPECT_EQ(idIndex->medianTime(count - 1), 0U);
+
+   //reorg across the chunk boundary with a far off timestamp
+   unsigned branchPoint = HEADER_INDEX_CHUNK_SIZE - 3;
+   map<unsigned, shared_ptr<BlockHeader>> branchMap;
+   timestamps.resize(branchPoint + 10);
+   for (unsigned i = branchPoint; i < branchPoint + 10; i++)
+   {
+      timestamps[i] = (i == branchPoint + 2 ? 
+         2000000000 : 1500000000 + i * 600);
+      branchMap[i] = makeHeader(timestamps[i]);
+   }
+
+   auto index2 = index1->update(branchMap, branchPoint + 10);
+   checkIndex(index2, timestamps);
+
+   //ordered timestamps resolve exactly
+   map<unsigned, shared_ptr<BlockHeader>> orderedMap;
+   vector<uint32_t> ordered;
+   for (unsigned i = 0; i < 100; i++)
+   {
+      ordered.push_back(1500000000 + i * 600);
+      orderedMap[i] = makeHeader(ordered.back());
+   }
+
+   auto index3 = make_shared<const HeaderIndex>(true)->update(orderedMap, 100);
+   for (auto& ts : { 1500000000U - 1, 1500000000U, 1500000000U + 6001,
+      1500000000U + 99 * 600, 1500000000U + 99 * 600 + 1 })
+   {
+      auto iter = lower_bound(ordered.begin(), ordered.end(), ts);
+      EXPECT_EQ(index3->lowerBoundTimestamp(ts), size_t(iter - ordered.begin()));
+   }
+}
+
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -4714,6 +5436,15 @@ TEST_F(StoredBlockObjTest, SScriptHistorySer)
    ssh.version_ = 1;
    ssh.scanHeight_ = 65535;
 
+   //subssh values below are in the legacy format, the versioned one is
+   //covered by SSubHistoryValueVersions
+   auto serializeLegacy = [](const StoredSubHistory& subssh)->BinaryData
+   {
+      BinaryWriter bw;
+      subssh.serializeDBValue_Legacy(bw);
+      return bw.getData();
+   };
+
    /////////////////////////////////////////////////////////////////////////////
    // Empty ssh (shouldn't be written in supernode, should be in full node)
    BinaryData expect, expSub1, expSub2;
@@ -4739,8 +5470,8 @@ TEST_F(StoredBlockObjTest, SScriptHistorySer)
    expSub1 = READHEX("01""00""0100000000000000""0001""0001");
    expSub2 = READHEX("01""00""0002000000000000""0002""0002");
    EXPECT_EQ(serializeDBValue(ssh, ARMORY_DB_BARE), expect);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("00010000")]), expSub2);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("00010000")]), expSub2);
 
    /////////////////////////////////////////////////////////////////////////////
    // Added another TxIO to the second subSSH
@@ -4753,8 +5484,8 @@ TEST_F(StoredBlockObjTest, SScriptHistorySer)
                        "00""0002000000000000""0002""0002"
                        "00""0000030000000000""0004""0004");
    EXPECT_EQ(serializeDBValue(ssh, ARMORY_DB_BARE), expect);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("00010000")]), expSub2);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("00010000")]), expSub2);
 
    /////////////////////////////////////////////////////////////////////////////
    // Now we explicitly delete a TxIO (with pruning, this should be basically
@@ -4767,8 +5498,8 @@ TEST_F(StoredBlockObjTest, SScriptHistorySer)
    expSub2 = READHEX("01"
                        "00""0000030000000000""0004""0004");
    EXPECT_EQ(serializeDBValue(ssh, ARMORY_DB_BARE), expect);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("00010000")]), expSub2);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("00010000")]), expSub2);
    
    /////////////////////////////////////////////////////////////////////////////
    // Insert a multisig TxIO -- this should increment totalTxioCount_, but not 
@@ -4783,8 +5514,8 @@ TEST_F(StoredBlockObjTest, SScriptHistorySer)
                        "00""0000030000000000""0004""0004"
                        "10""0000000400000000""0006""0006");
    EXPECT_EQ(serializeDBValue(ssh, ARMORY_DB_BARE), expect);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("00010000")]), expSub2);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("00010000")]), expSub2);
    
    /////////////////////////////////////////////////////////////////////////////
    // Remove the multisig
@@ -4795,8 +5526,8 @@ TEST_F(StoredBlockObjTest, SScriptHistorySer)
    expSub2 = READHEX("01"
                        "00""0000030000000000""0004""0004");
    EXPECT_EQ(serializeDBValue(ssh, ARMORY_DB_BARE), expect);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("00010000")]), expSub2);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("00010000")]), expSub2);
 
    /////////////////////////////////////////////////////////////////////////////
    // Remove a full subSSH (it shouldn't be deleted, though, that will be done
@@ -4807,8 +5538,8 @@ TEST_F(StoredBlockObjTest, SScriptHistorySer)
    expSub2 = READHEX("01"
                        "00""0000030000000000""0004""0004");
    EXPECT_EQ(serializeDBValue(ssh, ARMORY_DB_BARE), expect);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
-   EXPECT_EQ(serializeDBValue(ssh.subHistMap_[READHEX("00010000")]), expSub2);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("0000ff00")]), expSub1);
+   EXPECT_EQ(serializeLegacy(ssh.subHistMap_[READHEX("00010000")]), expSub2);
    
 }
 
@@ -4918,6 +5649,115 @@ TEST_F(StoredBlockObjTest, SScriptHistoryUnser)
                        //"10""0000000400000000""0006""0006");
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(StoredBlockObjTest, SSubHistoryValueVersions)
+{
+   BinaryData uniq = READHEX("00""0000ffff0000ffff0000ffff0000ffff0000ffff");
+   BinaryData hgtX = DBUtils::heightAndDupToHgtx(70000, 1);
+
+   BinaryWriter bwKey;
+   bwKey.put_uint8_t(DB_PREFIX_SCRIPT);
+   BinaryData dbKey = bwKey.getData() + uniq + hgtX;
+
+   //unspent outputs with mixed flags, then spends of outputs from this block
+   //and from earlier ones, including a different dupID
+   StoredSubHistory subssh;
+   subssh.unserializeDBKey(dbKey);
+
+   TxIOPair txio0(hgtX + READHEX("0000""0000"), 50 * COIN);
+   txio0.setFromCoinbase(true);
+   txio0.setUTXO(true);
+
+   TxIOPair txio1(hgtX + READHEX("0003""0001"), 12345);
+   txio1.setTxOutFromSelf(true);
+
+   TxIOPair txio2(hgtX + READHEX("0003""0002"), 1);
+   txio2.setTxOutFromSelf(true);
+
+   TxIOPair txio3(hgtX + READHEX("0150""0000"), 700000);
+   txio3.setMultisig(true);
+
+   TxIOPair txio4(
+      DBUtils::heightAndDupToHgtx(100, 0) + READHEX("0002""0003"), 2 * COIN);
+   txio4.setTxIn(hgtX + READHEX("0004""0000"));
+
+   TxIOPair txio5(
+      DBUtils::heightAndDupToHgtx(69999, 2) + READHEX("0001""0000"), 42);
+   txio5.setTxIn(hgtX + READHEX("0005""0002"));
+
+   TxIOPair txio6(hgtX + READHEX("0004""0001"), 3);
+   txio6.setTxIn(hgtX + READHEX("0006""0000"));
+
+   for (auto txio : { txio0, txio1, txio2, txio3, txio4, txio5, txio6 })
+      subssh.txioMap_.insert(make_pair(txio.getDBKeyOfOutput(), txio));
+
+   auto checkTxios = [&subssh](const StoredSubHistory& result)->void
+   {
+      EXPECT_EQ(result.txioCount_, subssh.txioMap_.size());
+      ASSERT_EQ(result.txioMap_.size(), subssh.txioMap_.size());
+
+      auto iter = result.txioMap_.begin();
+      for (auto& txioPair : subssh.txioMap_)
+      {
+         auto& expected = txioPair.second;
+         auto& txio = iter->second;
+         EXPECT_EQ(iter->first, txioPair.first);
+         EXPECT_EQ(txio.getValue(), expected.getValue());
+         EXPECT_EQ(txio.getDBKeyOfOutput(), expected.getDBKeyOfOutput());
+         EXPECT_EQ(txio.hasTxIn(), expected.hasTxIn());
+         if (expected.hasTxIn())
+            EXPECT_EQ(txio.getDBKeyOfInput(), expected.getDBKeyOfInput());
+         EXPECT_EQ(txio.isTxOutFromSelf(), expected.isTxOutFromSelf());
+         EXPECT_EQ(txio.isFromCoinbase(), expected.isFromCoinbase());
+         EXPECT_EQ(txio.isMultisig(), expected.isMultisig());
+         EXPECT_EQ(txio.isUTXO(), expected.isUTXO());
+         ++iter;
+      }
+   };
+
+   //versioned values lead with the marker and version
+   BinaryWriter bwV1;
+   subssh.serializeDBValue(bwV1);
+   auto& valV1 = bwV1.getData();
+   ASSERT_GE(valV1.getSize(), 3U);
+   EXPECT_EQ(valV1.getPtr()[0], SUBSSH_VALUE_MARKER);
+   EXPECT_EQ(valV1.getPtr()[1], SUBSSH_VALUE_VERSION);
+
+   StoredSubHistory fromV1;
+   fromV1.unserializeDBKey(dbKey);
+   fromV1.unserializeDBValue(valV1);
+   checkTxios(fromV1);
+
+   //legacy values are still understood
+   BinaryWriter bwLegacy;
+   subssh.serializeDBValue_Legacy(bwLegacy);
+   auto& valLegacy = bwLegacy.getData();
+   EXPECT_NE(valLegacy.getPtr()[0], SUBSSH_VALUE_MARKER);
+   EXPECT_LT(valV1.getSize(), valLegacy.getSize());
+
+   StoredSubHistory fromLegacy;
+   fromLegacy.unserializeDBKey(dbKey);
+   fromLegacy.unserializeDBValue(valLegacy);
+   checkTxios(fromLegacy);
+
+   //summary reads the count off both formats
+   for (auto val : { valV1, valLegacy })
+   {
+      StoredSubHistory summary;
+      summary.unserializeDBKey(dbKey);
+      BinaryRefReader brr(val);
+      summary.getSummary(brr);
+      EXPECT_EQ(summary.txioCount_, subssh.txioMap_.size());
+   }
+
+   //unknown versions are rejected
+   BinaryData badVersion(valV1);
+   badVersion.getPtr()[1] = SUBSSH_VALUE_VERSION + 1;
+   StoredSubHistory fromBad;
+   fromBad.unserializeDBKey(dbKey);
+   EXPECT_THROW(fromBad.unserializeDBValue(badVersion), runtime_error);
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -6229,14 +7069,163 @@ TEST_F(BlockUtilsBare, Load5Blocks)
 
    auto bdvPtr = DBTestUtils::getBDV(clients_, bdvID);
 
-   //wait on signals
+   //wait on signals
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+   auto wlt = bdvPtr->getWalletOrLockbox(wallet1id);
+   auto wltLB1 = bdvPtr->getWalletOrLockbox(LB1ID);
+   auto wltLB2 = bdvPtr->getWalletOrLockbox(LB2ID);
+
+
+   const ScrAddrObj* scrObj;
+   scrObj = wlt->getScrAddrObjByKey(TestChain::scrAddrA);
+   EXPECT_EQ(scrObj->getFullBalance(), 50*COIN);
+   scrObj = wlt->getScrAddrObjByKey(TestChain::scrAddrB);
+   EXPECT_EQ(scrObj->getFullBalance(), 70*COIN);
+   scrObj = wlt->getScrAddrObjByKey(TestChain::scrAddrC);
+   EXPECT_EQ(scrObj->getFullBalance(), 20*COIN);
+   scrObj = wlt->getScrAddrObjByKey(TestChain::scrAddrD);
+   EXPECT_EQ(scrObj->getFullBalance(), 65*COIN);
+   scrObj = wlt->getScrAddrObjByKey(TestChain::scrAddrE);
+   EXPECT_EQ(scrObj->getFullBalance(), 30*COIN);
+   scrObj = wlt->getScrAddrObjByKey(TestChain::scrAddrF);
+   EXPECT_EQ(scrObj->getFullBalance(),  5*COIN);
+
+   scrObj = wltLB1->getScrAddrObjByKey(TestChain::lb1ScrAddr);
+   EXPECT_EQ(scrObj->getFullBalance(), 5*COIN);
+   scrObj = wltLB1->getScrAddrObjByKey(TestChain::lb1ScrAddrP2SH);
+   EXPECT_EQ(scrObj->getFullBalance(), 25*COIN);
+   scrObj = wltLB2->getScrAddrObjByKey(TestChain::lb2ScrAddr);
+   EXPECT_EQ(scrObj->getFullBalance(), 30*COIN);
+   scrObj = wltLB2->getScrAddrObjByKey(TestChain::lb2ScrAddrP2SH);
+   EXPECT_EQ(scrObj->getFullBalance(), 0*COIN);
+
+   EXPECT_EQ(wlt->getFullBalance(), 240*COIN);
+   EXPECT_EQ(wltLB1->getFullBalance(), 30*COIN);
+   EXPECT_EQ(wltLB2->getFullBalance(), 30*COIN);
+
+   //cleanup
+   bdvPtr.reset();
+   wlt.reset();
+   wltLB1.reset();
+   wltLB2.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsBare, Load5Blocks_BlockFilterDb)
+{
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+
+   vector<BinaryData> scrAddrVec;
+   scrAddrVec.push_back(TestChain::scrAddrA);
+   DBTestUtils::registerWallet(clients_, bdvID, scrAddrVec, "wallet1");
+
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+
+   //the initial scan filters every block it parsed
+   auto blockchain = theBDMt_->bdm()->blockchain();
+   for (unsigned i = 0; i <= 5; i++)
+   {
+      auto header = blockchain->getHeaderByHeight(i, 0xFF);
+      EXPECT_TRUE(iface_->getBlockFilter(header->getThisID()).isValid());
+   }
+
+   //filters have their own db, none of them land in txfilters
+   auto&& tx = iface_->beginTransaction(TXFILTERS, LMDB::ReadOnly);
+   auto dbIter = iface_->getIterator(TXFILTERS);
+   EXPECT_FALSE(dbIter->seekToStartsWith(DB_PREFIX_BLOCKFILTER));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsBare, Load5Blocks_UpgradeSubHistories)
+{
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+
+   vector<BinaryData> scrAddrVec;
+   scrAddrVec.push_back(TestChain::scrAddrA);
+   scrAddrVec.push_back(TestChain::scrAddrB);
+   scrAddrVec.push_back(TestChain::scrAddrC);
+   scrAddrVec.push_back(TestChain::scrAddrD);
+   scrAddrVec.push_back(TestChain::scrAddrE);
+   scrAddrVec.push_back(TestChain::scrAddrF);
+   DBTestUtils::registerWallet(clients_, bdvID, scrAddrVec, "wallet1");
+
+   auto bdvPtr = DBTestUtils::getBDV(clients_, bdvID);
+
+   //wait on signals
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+
+   //fresh dbs are flagged and write versioned values
+   auto&& sdbi = iface_->getStoredDBInfo(SUBSSH, 0);
+   EXPECT_TRUE(sdbi.flags_ & SDBI_FLAG_SUBSSH_VERSIONED);
+
+   auto getSubsshValues = [this](void)->map<BinaryData, BinaryData>
+   {
+      map<BinaryData, BinaryData> result;
+      auto&& tx = iface_->beginTransaction(SUBSSH, LMDB::ReadOnly);
+      auto dbIter = iface_->getIterator(SUBSSH);
+      if (!dbIter->seekToStartsWith(DB_PREFIX_SCRIPT))
+         return result;
+
+      do
+      {
+         result.insert(make_pair(dbIter->getKey(), dbIter->getValue()));
+      } while (dbIter->advanceAndRead(DB_PREFIX_SCRIPT));
+
+      return result;
+   };
+
+   //roll the db back to legacy values, as written by older versions
+   auto&& subsshValues = getSubsshValues();
+   ASSERT_GT(subsshValues.size(), 0ULL);
+   {
+      auto&& tx = iface_->beginTransaction(SUBSSH, LMDB::ReadWrite);
+      for (auto& subsshPair : subsshValues)
+      {
+         EXPECT_EQ(subsshPair.second.getPtr()[0], SUBSSH_VALUE_MARKER);
+
+         StoredSubHistory subssh;
+         subssh.unserializeDBKey(subsshPair.first);
+         subssh.unserializeDBValue(subsshPair.second);
+
+         BinaryWriter bw;
+         subssh.serializeDBValue_Legacy(bw);
+         iface_->putValue(SUBSSH, subsshPair.first.getRef(), bw.getDataRef());
+      }
+
+      sdbi = iface_->getStoredDBInfo(SUBSSH, 0);
+      sdbi.flags_ = 0;
+      iface_->putStoredDBInfo(SUBSSH, sdbi, 0);
+   }
+
+   //shutdown bdm
+   bdvPtr.reset();
+   clients_->exitRequestLoop();
+   clients_->shutdown();
+
+   delete clients_;
+   delete theBDMt_;
+
+   //restart bdm, init migrates the legacy values in place
+   initBDM();
+
+   theBDMt_->start(config.initMode_);
+   bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+   DBTestUtils::registerWallet(clients_, bdvID, scrAddrVec, "wallet1");
+   bdvPtr = DBTestUtils::getBDV(clients_, bdvID);
+
    DBTestUtils::goOnline(clients_, bdvID);
    DBTestUtils::waitOnBDMReady(clients_, bdvID);
-   auto wlt = bdvPtr->getWalletOrLockbox(wallet1id);
-   auto wltLB1 = bdvPtr->getWalletOrLockbox(LB1ID);
-   auto wltLB2 = bdvPtr->getWalletOrLockbox(LB2ID);
 
+   sdbi = iface_->getStoredDBInfo(SUBSSH, 0);
+   EXPECT_TRUE(sdbi.flags_ & SDBI_FLAG_SUBSSH_VERSIONED);
+   EXPECT_EQ(getSubsshValues(), subsshValues);
 
+   auto wlt = bdvPtr->getWalletOrLockbox(wallet1id);
    const ScrAddrObj* scrObj;
    scrObj = wlt->getScrAddrObjByKey(TestChain::scrAddrA);
    EXPECT_EQ(scrObj->getFullBalance(), 50*COIN);
@@ -6251,24 +7240,9 @@ TEST_F(BlockUtilsBare, Load5Blocks)
    scrObj = wlt->getScrAddrObjByKey(TestChain::scrAddrF);
    EXPECT_EQ(scrObj->getFullBalance(),  5*COIN);
 
-   scrObj = wltLB1->getScrAddrObjByKey(TestChain::lb1ScrAddr);
-   EXPECT_EQ(scrObj->getFullBalance(), 5*COIN);
-   scrObj = wltLB1->getScrAddrObjByKey(TestChain::lb1ScrAddrP2SH);
-   EXPECT_EQ(scrObj->getFullBalance(), 25*COIN);
-   scrObj = wltLB2->getScrAddrObjByKey(TestChain::lb2ScrAddr);
-   EXPECT_EQ(scrObj->getFullBalance(), 30*COIN);
-   scrObj = wltLB2->getScrAddrObjByKey(TestChain::lb2ScrAddrP2SH);
-   EXPECT_EQ(scrObj->getFullBalance(), 0*COIN);
-
-   EXPECT_EQ(wlt->getFullBalance(), 240*COIN);
-   EXPECT_EQ(wltLB1->getFullBalance(), 30*COIN);
-   EXPECT_EQ(wltLB2->getFullBalance(), 30*COIN);
-
    //cleanup
    bdvPtr.reset();
    wlt.reset();
-   wltLB1.reset();
-   wltLB2.reset();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -7367,6 +8341,87 @@ TEST_F(BlockUtilsBare, Load5Blocks_FullReorg)
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsBare, Load5Blocks_Balances_IncrementalVsRecompute)
+{
+   TestUtils::setBlocks({ "0", "1", "2", "3" }, blk0dat_);
+
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+
+   vector<BinaryData> scrAddrVec;
+   scrAddrVec.push_back(TestChain::scrAddrA);
+   scrAddrVec.push_back(TestChain::scrAddrB);
+   scrAddrVec.push_back(TestChain::scrAddrC);
+   scrAddrVec.push_back(TestChain::scrAddrD);
+   scrAddrVec.push_back(TestChain::scrAddrE);
+   scrAddrVec.push_back(TestChain::scrAddrF);
+   DBTestUtils::registerWallet(clients_, bdvID, scrAddrVec, "wallet1");
+
+   auto bdvPtr = DBTestUtils::getBDV(clients_, bdvID);
+
+   //wait on signals
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+   auto wlt = bdvPtr->getWalletOrLockbox(wallet1id);
+
+   //materialized balances have to match a recompute from the full history
+   auto checkBalances = [&](unsigned confTarget)->void
+   {
+      auto height = theBDMt_->bdm()->blockchain()->top()->getBlockHeight();
+
+      uint64_t full = 0, spendable = 0, unconf = 0, count = 0;
+      for (auto& scrAddr : scrAddrVec)
+      {
+         auto scrObj = wlt->getScrAddrObjByKey(scrAddr);
+         ASSERT_EQ(scrObj->getBalancesHeight(), height);
+
+         auto& balances = scrObj->getBalances();
+         EXPECT_EQ(balances.full_, scrObj->getFullBalance());
+         EXPECT_EQ(balances.spendable_, scrObj->getSpendableBalance(height));
+         EXPECT_EQ(balances.unconfirmed_, 
+            scrObj->getUnconfirmedBalance(height, confTarget));
+         EXPECT_EQ(balances.txioCount_, scrObj->getTxioCountFromSSH());
+
+         full += balances.full_;
+         spendable += balances.spendable_;
+         unconf += balances.unconfirmed_;
+         count += balances.txioCount_;
+      }
+
+      EXPECT_EQ(wlt->getFullBalance(), full);
+      EXPECT_EQ(wlt->getSpendableBalance(height), spendable);
+      EXPECT_EQ(wlt->getUnconfirmedBalance(height), unconf);
+      EXPECT_EQ(wlt->getWltTotalTxnCount(), count);
+   };
+
+   checkBalances(MIN_CONFIRMATIONS);
+
+   //new block, no reorg
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4A" }, blk0dat_);
+   DBTestUtils::triggerNewBlockNotification(theBDMt_);
+   DBTestUtils::waitOnNewBlockSignal(clients_, bdvID);
+   checkBalances(MIN_CONFIRMATIONS);
+
+   //reorg to 5, spends in 4A are reorged out
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4A", "4", "5" }, blk0dat_);
+   DBTestUtils::triggerNewBlockNotification(theBDMt_);
+   DBTestUtils::waitOnNewBlockSignal(clients_, bdvID);
+   checkBalances(MIN_CONFIRMATIONS);
+
+   //reorg to 5A
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4A", "4", "5", "5A" }, blk0dat_);
+   DBTestUtils::triggerNewBlockNotification(theBDMt_);
+   DBTestUtils::waitOnNewBlockSignal(clients_, bdvID);
+   checkBalances(MIN_CONFIRMATIONS);
+
+   //conf target changes rebuild the unconfirmed balances
+   wlt->setConfTarget(3, "");
+   checkBalances(3);
+   wlt->setConfTarget(1, "");
+   checkBalances(1);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 TEST_F(BlockUtilsBare, Load5Blocks_DoubleReorg)
 {
@@ -7589,6 +8644,85 @@ TEST_F(BlockUtilsBare, Load5Blocks_ReloadBDM_Reorg)
    EXPECT_EQ(wltLB2->getFullBalance(), 10 * COIN);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsBare, Load5Blocks_ChainSnapshot)
+{
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+
+   //wait on signals
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+
+   auto bc = theBDMt_->bdm()->blockchain();
+   auto&& snapshot = iface_->getChainSnapshot();
+   EXPECT_EQ(snapshot.getSize(),
+      CHAIN_SNAPSHOT_HEADER_SIZE + 6 * CHAIN_SNAPSHOT_ENTRY_SIZE);
+   EXPECT_EQ(snapshot, bc->getChainSnapshot());
+
+   //organizes a fresh chain off copies of the loaded headers
+   auto organize = [bc](BinaryDataRef snapshotRef)->shared_ptr<Blockchain>
+   {
+      map<BinaryData, shared_ptr<BlockHeader>> headers;
+      for (auto& headerPair : *bc->allHeaders())
+      {
+         headers.insert(make_pair(headerPair.first,
+            make_shared<BlockHeader>(*headerPair.second)));
+      }
+
+      auto chain = make_shared<Blockchain>(NetworkConfig::getGenesisBlockHash());
+      chain->addBlocksInBulk(headers, false);
+
+      auto&& state = chain->organizeFromSnapshot(snapshotRef, 2);
+      EXPECT_TRUE(state.prevTopStillValid_);
+      EXPECT_EQ(state.newTop_, chain->top());
+      return chain;
+   };
+
+   auto chain = organize(snapshot);
+   EXPECT_EQ(chain->top()->getThisHash(), bc->top()->getThisHash());
+   EXPECT_EQ(chain->getChainSnapshot(), snapshot);
+
+   //snapshot trailing the top is caught up
+   auto heightIndex = bc->getHeightIndex();
+   BinaryWriter bw;
+   bw.put_uint8_t(CHAIN_SNAPSHOT_VERSION);
+   bw.put_uint32_t(3);
+   bw.put_BinaryDataRef(heightIndex->hash(2));
+   bw.put_BinaryDataRef(snapshot.getSliceRef(
+      CHAIN_SNAPSHOT_HEADER_SIZE, 3 * CHAIN_SNAPSHOT_ENTRY_SIZE));
+
+   chain = organize(bw.getData());
+   EXPECT_EQ(chain->top()->getBlockHeight(), 5);
+   EXPECT_EQ(chain->getChainSnapshot(), snapshot);
+
+   //entries that don't match the headers db are rejected, falls back to a 
+   //full organize
+   BinaryData badSnapshot(snapshot);
+   auto entryPtr = badSnapshot.getPtr() + 
+      CHAIN_SNAPSHOT_HEADER_SIZE + 2 * CHAIN_SNAPSHOT_ENTRY_SIZE;
+   ++*(uint64_t*)(entryPtr + 9);
+
+   chain = organize(badSnapshot);
+   EXPECT_EQ(chain->top()->getBlockHeight(), 5);
+   EXPECT_EQ(chain->getChainSnapshot(), snapshot);
+
+   //entries that don't link up are rejected. Swap the header part (id, dup, 
+   //file id, offset) of 2 entries: each still matches the headers db and the
+   //difficulty sums still go up, only the prev hash links break
+   badSnapshot = snapshot;
+   entryPtr = badSnapshot.getPtr() + 
+      CHAIN_SNAPSHOT_HEADER_SIZE + 2 * CHAIN_SNAPSHOT_ENTRY_SIZE;
+   swap_ranges(entryPtr, entryPtr + 17, entryPtr + CHAIN_SNAPSHOT_ENTRY_SIZE);
+
+   chain = organize(badSnapshot);
+   EXPECT_EQ(chain->top()->getBlockHeight(), 5);
+   EXPECT_EQ(chain->getChainSnapshot(), snapshot);
+
+   chain = organize(BinaryDataRef());
+   EXPECT_EQ(chain->getChainSnapshot(), snapshot);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 TEST_F(BlockUtilsBare, CorruptedBlock)
 {
@@ -9847,6 +10981,124 @@ TEST_F(BlockUtilsBare, Load5Blocks_CheckWalletFilters)
    EXPECT_EQ(wlt2_count, 0);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsBare, Load4Blocks_HistoryStream)
+{
+   //one block per page, so that the unit test chain spans several pages
+   struct PageSizeGuard
+   {
+      const uint32_t txnPerPage_ = HistoryPager::getTxnPerPage();
+      PageSizeGuard(void) { HistoryPager::setTxnPerPage(0); }
+      ~PageSizeGuard(void) { HistoryPager::setTxnPerPage(txnPerPage_); }
+   } pageSizeGuard;
+
+   TestUtils::setBlocks({ "0", "1", "2", "3" }, blk0dat_);
+
+   vector<BinaryData> scrAddrVec;
+   scrAddrVec.push_back(TestChain::scrAddrA);
+   scrAddrVec.push_back(TestChain::scrAddrB);
+   scrAddrVec.push_back(TestChain::scrAddrC);
+
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+   DBTestUtils::registerWallet(clients_, bdvID, scrAddrVec, "wallet1");
+   auto bdvPtr = DBTestUtils::getBDV(clients_, bdvID);
+
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+   auto delegateID = DBTestUtils::getLedgerDelegate(clients_, bdvID);
+
+   auto pageCount = bdvPtr->getWalletsPageCount();
+   ASSERT_GE(pageCount, 3U);
+
+   vector<ClientClasses::LedgerEntry> expected;
+   for (uint32_t i = 0; i < pageCount; i++)
+   {
+      auto&& page = DBTestUtils::getHistoryPage(clients_, bdvID, delegateID, i);
+      expected.insert(expected.end(), page.begin(), page.end());
+   }
+   ASSERT_FALSE(expected.empty());
+   DBTestUtils::getPendingNotifications(clients_, bdvID);
+
+   //the server stops once the window is used up
+   auto&& streamID = 
+      CryptoPRNG::generateRandom(HISTORY_STREAM_ID_LENGTH).toHexStr();
+   DBTestUtils::streamHistory(clients_, bdvID, delegateID, streamID, 1);
+
+   auto&& chunks = DBTestUtils::getHistoryChunks(clients_, bdvID, streamID);
+   ASSERT_EQ(chunks.size(), 1U);
+   EXPECT_FALSE(chunks[0].second);
+
+   //a new block followed by a wallet registration remaps the pages, the 
+   //stream sticks to the original ones
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4" }, blk0dat_);
+   DBTestUtils::triggerNewBlockNotification(theBDMt_);
+   DBTestUtils::waitOnNewBlockSignal(clients_, bdvID);
+
+   BinaryData emptyScrAddr(1);
+   emptyScrAddr.getPtr()[0] = SCRIPT_PREFIX_HASH160;
+   emptyScrAddr.append(CryptoPRNG::generateRandom(20));
+   DBTestUtils::registerWallet(clients_, bdvID, { emptyScrAddr }, "wallet2");
+   EXPECT_GT(bdvPtr->getWalletsPageCount(), pageCount);
+   DBTestUtils::getPendingNotifications(clients_, bdvID);
+
+   //each ack frees up room for as many chunks
+   DBTestUtils::ackHistoryStream(clients_, bdvID, streamID, 1);
+   auto&& moreChunks = 
+      DBTestUtils::getHistoryChunks(clients_, bdvID, streamID);
+   ASSERT_EQ(moreChunks.size(), 1U);
+   chunks.insert(chunks.end(), moreChunks.begin(), moreChunks.end());
+
+   //acking past the window doesn't buy more room than the window
+   DBTestUtils::ackHistoryStream(clients_, bdvID, streamID, pageCount);
+   moreChunks = DBTestUtils::getHistoryChunks(clients_, bdvID, streamID);
+   ASSERT_EQ(moreChunks.size(), 1U);
+   chunks.insert(chunks.end(), moreChunks.begin(), moreChunks.end());
+
+   while (chunks.size() < pageCount)
+   {
+      ASSERT_FALSE(chunks.back().second);
+      DBTestUtils::ackHistoryStream(clients_, bdvID, streamID, 1);
+      moreChunks = DBTestUtils::getHistoryChunks(clients_, bdvID, streamID);
+      ASSERT_EQ(moreChunks.size(), 1U);
+      chunks.insert(chunks.end(), moreChunks.begin(), moreChunks.end());
+   }
+   ASSERT_EQ(chunks.size(), pageCount);
+
+   vector<ClientClasses::LedgerEntry> streamed;
+   for (unsigned i = 0; i < chunks.size(); i++)
+   {
+      EXPECT_EQ(chunks[i].second, i == chunks.size() - 1);
+      streamed.insert(streamed.end(), 
+         chunks[i].first.begin(), chunks[i].first.end());
+   }
+
+   ASSERT_EQ(streamed.size(), expected.size());
+   for (unsigned i = 0; i < streamed.size(); i++)
+   {
+      EXPECT_EQ(streamed[i].getTxHash(), expected[i].getTxHash());
+      EXPECT_EQ(streamed[i].getBlockNum(), expected[i].getBlockNum());
+      EXPECT_EQ(streamed[i].getValue(), expected[i].getValue());
+   }
+
+   //the stream is gone after its last chunk, late acks are ignored
+   DBTestUtils::ackHistoryStream(clients_, bdvID, streamID, 1);
+   EXPECT_TRUE(
+      DBTestUtils::getHistoryChunks(clients_, bdvID, streamID).empty());
+
+   //cancelled streams stop right away
+   auto&& cancelID = 
+      CryptoPRNG::generateRandom(HISTORY_STREAM_ID_LENGTH).toHexStr();
+   DBTestUtils::streamHistory(clients_, bdvID, delegateID, cancelID, 1);
+   EXPECT_EQ(
+      DBTestUtils::getHistoryChunks(clients_, bdvID, cancelID).size(), 1U);
+
+   DBTestUtils::ackHistoryStream(clients_, bdvID, cancelID, 0, true);
+   DBTestUtils::ackHistoryStream(clients_, bdvID, cancelID, 4);
+   EXPECT_TRUE(
+      DBTestUtils::getHistoryChunks(clients_, bdvID, cancelID).empty());
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 TEST_F(BlockUtilsBare, ZC_InOut_SameBlock)
 {
@@ -10015,6 +11267,209 @@ TEST_F(TestCryptoECDSA, VerifyPubKeyValidity)
    EXPECT_TRUE(CryptoECDSA().VerifyPublicKeyValid(uncompPointPub2));
 }
 
+////////////////////////////////////////////////////////////////////////////////
+class WebSocketCodecTests : public ::testing::Test
+{
+protected:
+   unique_ptr<BIP151Connection> cliCon_;
+   unique_ptr<BIP151Connection> srvCon_;
+
+   virtual void SetUp(void)
+   {
+      startupBIP151CTX();
+      startupBIP150CTX(4, false);
+
+      auto getpubkeymap = [](void)->const map<string, btc_pubkey>&
+      {
+         throw runtime_error("");
+      };
+
+      auto getprivkey = [](const BinaryDataRef&)->const SecureBinaryData&
+      {
+         throw runtime_error("");
+      };
+
+      auto getauthset = [](void)->const set<SecureBinaryData>&
+      {
+         throw runtime_error("");
+      };
+
+      AuthPeersLambdas akl1(getpubkeymap, getprivkey, getauthset);
+      AuthPeersLambdas akl2(getpubkeymap, getprivkey, getauthset);
+      cliCon_ = make_unique<BIP151Connection>(akl1);
+      srvCon_ = make_unique<BIP151Connection>(akl2);
+
+      //bip151 handshake, server to client then client to server
+      BinaryData encinit(ENCINITMSGSIZE);
+      BinaryData encack(BIP151PUBKEYSIZE);
+      srvCon_->getEncinitData(encinit.getPtr(), encinit.getSize(),
+         BIP151SymCiphers::CHACHA20POLY1305_OPENSSH);
+      cliCon_->processEncinit(encinit.getPtr(), encinit.getSize(), false);
+      cliCon_->getEncackData(encack.getPtr(), encack.getSize());
+      srvCon_->processEncack(encack.getPtr(), encack.getSize(), true);
+
+      cliCon_->getEncinitData(encinit.getPtr(), encinit.getSize(),
+         BIP151SymCiphers::CHACHA20POLY1305_OPENSSH);
+      srvCon_->processEncinit(encinit.getPtr(), encinit.getSize(), false);
+      srvCon_->getEncackData(encack.getPtr(), encack.getSize());
+      cliCon_->processEncack(encack.getPtr(), encack.getSize(), true);
+
+      ASSERT_TRUE(cliCon_->connectionComplete());
+      ASSERT_TRUE(srvCon_->connectionComplete());
+   }
+
+   virtual void TearDown(void)
+   {
+      cliCon_.reset();
+      srvCon_.reset();
+      shutdownBIP151CTX();
+   }
+
+   //n entries of 1kB each
+   static ::Codec_CommonTypes::ManyBinaryData makeMessage(unsigned n)
+   {
+      ::Codec_CommonTypes::ManyBinaryData msg;
+      for (unsigned i = 0; i < n; i++)
+      {
+         auto&& data = CryptoPRNG::generateRandom(1024);
+         auto val = msg.add_value();
+         val->set_data(data.getPtr(), data.getSize());
+      }
+
+      return msg;
+   }
+
+   //feeds packets to the client in rx sized chunks, as lws does, 
+   //returns the decrypted packets
+   vector<BinaryData> receive(const vector<BinaryData>& packets,
+      uint32_t maxFrameSize)
+   {
+      vector<BinaryData> result;
+      BinaryData leftOver;
+      for (auto& packet : packets)
+      {
+         auto packetRef = packet.getSliceRef(
+            LWS_PRE, packet.getSize() - LWS_PRE);
+
+         size_t pos = 0;
+         while (pos < packetRef.getSize())
+         {
+            auto len = min<size_t>(
+               per_session_data__bdv::rcv_size, packetRef.getSize() - pos);
+            leftOver.append(packetRef.getSliceRef(pos, len));
+            pos += len;
+
+            if (leftOver.getSize() < POLY1305MACLEN + 4)
+               continue;
+
+            auto status = cliCon_->decryptPacket(
+               leftOver.getPtr(), leftOver.getSize(),
+               leftOver.getPtr(), leftOver.getSize());
+            if (status != 0)
+            {
+               EXPECT_GT(status, 0);
+               EXPECT_LE(status, (int)maxFrameSize);
+               continue;
+            }
+
+            leftOver.resize(leftOver.getSize() - POLY1305MACLEN);
+            result.emplace_back(move(leftOver));
+            leftOver.clear();
+         }
+      }
+
+      EXPECT_EQ(leftOver.getSize(), 0U);
+      return result;
+   }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(WebSocketCodecTests, LargeFrame)
+{
+   auto&& msg = makeMessage(300);
+   auto msgId = 1234U;
+
+   SerializedMessage ws_msg;
+   ws_msg.constructLargeFrame(msg, srvCon_.get(), msgId);
+   ASSERT_EQ(ws_msg.count(), 1U);
+
+   vector<BinaryData> packets;
+   while (!ws_msg.isDone())
+      packets.emplace_back(ws_msg.consumeNextPacket());
+   EXPECT_EQ(packets[0].getSize(), 
+      LWS_PRE + 9 + msg.ByteSize() + POLY1305MACLEN);
+
+   auto&& plainText = receive(packets, WEBSOCKET_LARGE_FRAME_MAX_SIZE);
+   ASSERT_EQ(plainText.size(), 1U);
+
+   WebSocketMessagePartial partial;
+   ASSERT_TRUE(partial.parsePacket(plainText[0].getRef()));
+   ASSERT_TRUE(partial.isReady());
+   EXPECT_EQ(partial.getId(), msgId);
+   EXPECT_EQ(partial.getType(), WS_MSGTYPE_SINGLEPACKET);
+
+   ::Codec_CommonTypes::ManyBinaryData result;
+   ASSERT_TRUE(partial.getMessage(&result));
+   EXPECT_EQ(result.SerializeAsString(), msg.SerializeAsString());
+
+   //the next packet still decrypts, the AEAD sequence is in sync
+   auto&& smallMsg = makeMessage(1);
+   SerializedMessage ws_msg2;
+   auto&& smallData = BinaryData::fromString(smallMsg.SerializeAsString());
+   ws_msg2.construct(smallData.getRef(), srvCon_.get(),
+      WS_MSGTYPE_FRAGMENTEDPACKET_HEADER, msgId + 1);
+   packets.clear();
+   while (!ws_msg2.isDone())
+      packets.emplace_back(ws_msg2.consumeNextPacket());
+
+   auto&& plainText2 = receive(packets, WEBSOCKET_MESSAGE_PACKET_SIZE);
+   ASSERT_EQ(plainText2.size(), 1U);
+   WebSocketMessagePartial partial2;
+   ASSERT_TRUE(partial2.parsePacket(plainText2[0].getRef()));
+   EXPECT_EQ(partial2.getId(), msgId + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(WebSocketCodecTests, DISABLED_LargeFrame_Bench)
+{
+   //8MB reply, serialized and encrypted with the 1500 byte framing,
+   //then as a single large frame
+   auto&& msg = makeMessage(8 * 1024);
+   unsigned rounds = 10;
+
+   auto start = chrono::steady_clock::now();
+   size_t packetCount = 0;
+   for (unsigned i = 0; i < rounds; i++)
+   {
+      vector<uint8_t> serializedData(msg.ByteSize());
+      msg.SerializeToArray(&serializedData[0], serializedData.size());
+
+      SerializedMessage ws_msg;
+      ws_msg.construct(serializedData, srvCon_.get(), 
+         WS_MSGTYPE_FRAGMENTEDPACKET_HEADER, i);
+      packetCount = ws_msg.count();
+   }
+   auto fragmentedTime = chrono::duration_cast<chrono::milliseconds>(
+      chrono::steady_clock::now() - start).count();
+
+   start = chrono::steady_clock::now();
+   for (unsigned i = 0; i < rounds; i++)
+   {
+      SerializedMessage ws_msg;
+      ws_msg.constructLargeFrame(msg, srvCon_.get(), i);
+   }
+   auto largeFrameTime = chrono::duration_cast<chrono::milliseconds>(
+      chrono::steady_clock::now() - start).count();
+
+   auto mb = double(msg.ByteSize() * rounds) / (1024.0 * 1024.0);
+   cout << "fragmented: " << packetCount << " packets per reply, " <<
+      mb * 1000.0 / max<double>(fragmentedTime, 1) << " MB/s" << endl;
+   cout << "large frame: " <<
+      (msg.ByteSize() / WEBSOCKET_LARGE_FRAME_SLICE_SIZE) + 1 << 
+      " lws writes per reply, " <<
+      mb * 1000.0 / max<double>(largeFrameTime, 1) << " MB/s" << endl;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 class WebSocketTests : public ::testing::Test
 {
@@ -10747,6 +12202,103 @@ TEST_F(WebSocketTests, GrabAddrLedger_PostReg)
    theBDMt_ = nullptr;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(WebSocketTests, WebSocketStack_LargeFrames)
+{
+   TestUtils::setBlocks({ "0", "1", "2", "3" }, blk0dat_);
+
+   //run clients from server object instead
+   clients_->exitRequestLoop();
+   clients_->shutdown();
+
+   delete clients_;
+   delete theBDMt_;
+   clients_ = nullptr;
+
+   theBDMt_ = new BlockDataManagerThread(config);
+   WebSocketServer::initAuthPeers(authPeersPassLbd_);
+   WebSocketServer::start(theBDMt_, true);
+   theBDMt_->start(config.initMode_);
+
+   auto pCallback = make_shared<DBTestUtils::UTCallback>();
+   auto&& bdvObj = AsyncClient::BlockDataViewer::getNewBDV(
+      "127.0.0.1", config.listenPort_, BlockDataManagerConfig::getDataDir(),
+      authPeersPassLbd_, BlockDataManagerConfig::ephemeralPeers_, pCallback);
+   bdvObj->enableLargeFrames();
+   bdvObj->connectToRemote();
+   bdvObj->registerWithDB(NetworkConfig::getMagicBytes());
+
+   //the server acks the large frame request ahead of any reply
+   auto wsSock = dynamic_pointer_cast<WebSocketClient>(
+      bdvObj->getSocketObject());
+   ASSERT_NE(wsSock, nullptr);
+   EXPECT_EQ(wsSock->getMaxFrameSize(), WEBSOCKET_LARGE_FRAME_MAX_SIZE);
+
+   vector<BinaryData> scrAddrVec;
+   scrAddrVec.push_back(TestChain::scrAddrA);
+   scrAddrVec.push_back(TestChain::scrAddrB);
+   scrAddrVec.push_back(TestChain::scrAddrC);
+
+   bdvObj->goOnline();
+   pCallback->waitOnSignal(BDMAction_Ready);
+
+   auto&& wallet = bdvObj->instantiateWallet("wallet1");
+   auto&& registrationId = wallet.registerAddresses(scrAddrVec, false);
+   pCallback->waitOnSignal(BDMAction_Refresh, registrationId);
+
+   auto w1AddrBalances = DBTestUtils::getAddrBalancesFromDB(wallet);
+   ASSERT_EQ(w1AddrBalances.size(), scrAddrVec.size());
+   EXPECT_EQ(w1AddrBalances[TestChain::scrAddrA][0], 50 * COIN);
+   EXPECT_EQ(w1AddrBalances[TestChain::scrAddrB][0], 30 * COIN);
+   EXPECT_EQ(w1AddrBalances[TestChain::scrAddrC][0], 55 * COIN);
+
+   //grab a mined tx hash from the wallet history
+   auto&& delegate = DBTestUtils::getLedgerDelegate(bdvObj);
+   auto&& ledgers = DBTestUtils::getHistoryPage(delegate, 0);
+   ASSERT_FALSE(ledgers.empty());
+   auto knownHash = ledgers[0].getTxHash();
+
+   //the batch reply carries an entry per requested hash, 10k unknown 
+   //hashes put it around 140kB, sent as a single large frame in 3 slices
+   set<BinaryData> hashes;
+   hashes.insert(knownHash);
+   while (hashes.size() < 10001)
+      hashes.insert(CryptoPRNG::generateRandom(32));
+
+   auto prom = make_shared<promise<AsyncClient::TxBatchResult>>();
+   auto fut = prom->get_future();
+   auto lbd = [prom](ReturnMessage<AsyncClient::TxBatchResult> msg)->void
+   {
+      prom->set_value(msg.get());
+   };
+   bdvObj->getTxBatchByHash(hashes, lbd);
+
+   auto&& txBatch = fut.get();
+   ASSERT_EQ(txBatch.size(), hashes.size());
+
+   unsigned unknownCount = 0;
+   for (auto& txPair : txBatch)
+   {
+      if (txPair.first == knownHash)
+      {
+         ASSERT_NE(txPair.second, nullptr);
+         EXPECT_EQ(txPair.second->getThisHash(), knownHash);
+         continue;
+      }
+
+      EXPECT_EQ(txPair.second, nullptr);
+      ++unknownCount;
+   }
+   EXPECT_EQ(unknownCount, 10000U);
+
+   //cleanup
+   bdvObj->shutdown(config.cookie_);
+   WebSocketServer::waitOnShutdown();
+
+   delete theBDMt_;
+   theBDMt_ = nullptr;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 TEST_F(WebSocketTests, WebSocketStack_ManyZC)
 {
@@ -510,6 +510,39 @@ void NodeUnitTest::pushZC(const vector<pair<BinaryData, unsigned>>& txVec,
    processInvTx(invVec);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void NodeUnitTest::pushZcBulk(const vector<BinaryData>& rawTxVec)
+{
+   /*
+   Stress test path: skips the fake mempool and its outpoint collision 
+   checks, the zc are only inv'ed and served on getdata. They will not be 
+   mined.
+   */
+   vector<InvEntry> invVec;
+   map<BinaryData, BinaryData> rawTxMap;
+   invVec.reserve(rawTxVec.size());
+
+   for (auto& rawTx : rawTxVec)
+   {
+      auto&& hash = BtcUtils::getHash256(rawTx);
+      if (!seenHashes_.insert(hash).second)
+         continue;
+
+      InvEntry ie;
+      ie.invtype_ = Inv_Msg_Witness_Tx;
+      memcpy(ie.hash, hash.getPtr(), 32);
+      invVec.emplace_back(ie);
+
+      rawTxMap.insert(make_pair(move(hash), rawTx));
+   }
+
+   if (invVec.empty())
+      return;
+
+   rawTxMap_.update(rawTxMap);
+   processInvTx(invVec);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void NodeUnitTest::purgeSpender(const BinaryData& rawTx)
 {
@@ -114,6 +114,7 @@ public:
 
    //<raw tx, blocks to wait until mining>
    void pushZC(const std::vector<std::pair<BinaryData, unsigned>>&, bool);
+   void pushZcBulk(const std::vector<BinaryData>&);
    void evictZC(const BinaryData&);
    uint64_t getFeeForTx(const Tx&) const;
 
@@ -8,6 +8,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "TestUtils.h"
+#include "../DatabaseBuilder.h"
 
 using namespace std;
 using namespace ArmorySigner;
@@ -156,6 +157,193 @@ TEST_F(PRNGTest, FortunaTest)
    EXPECT_EQ(check8[3], 0);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+class TxVerifierTest : public ::testing::Test
+{
+protected:
+   virtual void SetUp()
+   {
+      NetworkConfig::selectNetwork(NETWORK_MODE_MAINNET);
+   }
+
+   virtual void TearDown()
+   {
+      TransactionVerifier::setThreadCount(1);
+      SigVerifyCache::setBudget(SIGCACHE_DEFAULT_BUDGET);
+   }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(TxVerifierTest, ParallelInputs_SigCache)
+{
+   //sign a 64 input p2pkh tx over fake utxos
+   auto feed = make_shared<ResolverUtils::TestResolverFeed>();
+   vector<BinaryData> scripts;
+   for (unsigned i = 0; i < 8; i++)
+   {
+      auto&& privKey = CryptoPRNG::generateRandom(32);
+      feed->addPrivKey(privKey, true);
+
+      auto&& pubKey = CryptoECDSA().ComputePublicKey(privKey, true);
+      scripts.push_back(BtcUtils::getP2PKHScript(BtcUtils::getHash160(pubKey)));
+   }
+
+   Signer signer;
+   vector<UnspentTxOut> utxoVec;
+   uint64_t total = 0;
+   for (unsigned i = 0; i < 64; i++)
+   {
+      auto&& txHash = CryptoPRNG::generateRandom(32);
+      auto& script = scripts[i % scripts.size()];
+      UTXO utxo(COIN, 1, 0, i % 3, txHash, script);
+      signer.addSpender(make_shared<ScriptSpender>(utxo));
+
+      utxoVec.push_back(UnspentTxOut(txHash, i % 3, 1, COIN, script));
+      total += COIN;
+   }
+
+   auto recipient = make_shared<Recipient_P2PKH>(
+      TestChain::scrAddrA.getSliceCopy(1, 20), total);
+   signer.addRecipient(recipient);
+
+   signer.setFeed(feed);
+   signer.sign();
+   BinaryData rawTx(signer.serializeSignedTx());
+
+   auto verify = [&utxoVec](const BinaryData& rawTx, unsigned threadCount)
+   {
+      TransactionVerifier::setThreadCount(threadCount);
+      auto bctx = BCTX::parse(rawTx);
+      TransactionVerifier txV(*bctx, utxoVec);
+      return txV.evaluateState().isValid();
+   };
+
+   //no cache
+   SigVerifyCache::setBudget(0);
+   EXPECT_TRUE(verify(rawTx, 1));
+   EXPECT_TRUE(verify(rawTx, 4));
+   EXPECT_EQ(SigVerifyCache::size(), 0);
+
+   //concurrent verifications share the pooled workers
+   atomic<unsigned> validCount(0);
+   vector<thread> verifyThreads;
+   for (unsigned i = 0; i < 3; i++)
+   {
+      verifyThreads.push_back(thread([&](void)->void
+      {
+         if (verify(rawTx, 4))
+            validCount.fetch_add(1, memory_order_relaxed);
+      }));
+   }
+
+   for (auto& thr : verifyThreads)
+      thr.join();
+   EXPECT_EQ(validCount.load(), 3U);
+
+   //cold then warm cache
+   SigVerifyCache::setBudget(SIGCACHE_DEFAULT_BUDGET);
+   EXPECT_TRUE(verify(rawTx, 4));
+   EXPECT_EQ(SigVerifyCache::size(), 64);
+
+   auto hits = SigVerifyCache::hits();
+   EXPECT_TRUE(verify(rawTx, 1));
+   EXPECT_EQ(SigVerifyCache::hits(), hits + 64);
+   hits = SigVerifyCache::hits();
+   EXPECT_TRUE(verify(rawTx, 4));
+   EXPECT_EQ(SigVerifyCache::hits(), hits + 64);
+
+   //lower the output value, all sigs have to fail, cached or not
+   auto bctx = BCTX::parse(rawTx);
+   auto valPtr = (uint64_t*)(rawTx.getPtr() + bctx->txouts_[0].first);
+   --(*valPtr);
+
+   EXPECT_FALSE(verify(rawTx, 1));
+   EXPECT_FALSE(verify(rawTx, 4));
+   EXPECT_EQ(SigVerifyCache::size(), 64);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(TxVerifierTest, LegacySigHash_Template)
+{
+   //build an unsigned 20 input tx with assorted sequences
+   vector<UnspentTxOut> utxoVec;
+   BinaryWriter bwTxIns;
+   for (unsigned i = 0; i < 20; i++)
+   {
+      auto&& privKey = CryptoPRNG::generateRandom(32);
+      auto&& pubKey = CryptoECDSA().ComputePublicKey(privKey, true);
+      auto&& script = BtcUtils::getP2PKHScript(BtcUtils::getHash160(pubKey));
+
+      auto&& txHash = CryptoPRNG::generateRandom(32);
+      utxoVec.push_back(UnspentTxOut(txHash, i % 3, 1, COIN, script));
+
+      bwTxIns.put_BinaryData(txHash);
+      bwTxIns.put_uint32_t(i % 3);
+      bwTxIns.put_var_int(0);
+      bwTxIns.put_uint32_t(0xFFFFFFFF - i);
+   }
+
+   BinaryWriter bwTxOuts;
+   for (unsigned i = 0; i < 2; i++)
+   {
+      auto&& script = BtcUtils::getP2PKHScript(
+         CryptoPRNG::generateRandom(20));
+      bwTxOuts.put_uint64_t(COIN * (i + 1));
+      bwTxOuts.put_var_int(script.getSize());
+      bwTxOuts.put_BinaryData(script);
+   }
+
+   BinaryWriter bwTx;
+   bwTx.put_uint32_t(1);
+   bwTx.put_var_int(20);
+   bwTx.put_BinaryData(bwTxIns.getData());
+   bwTx.put_var_int(2);
+   bwTx.put_BinaryData(bwTxOuts.getData());
+   bwTx.put_uint32_t(123456);
+
+   auto bctx = BCTX::parse(bwTx.getData());
+   TransactionVerifier txV(*bctx, utxoVec);
+
+   //one object for all inputs, checked against the per input serialization
+   auto SHD = make_shared<SigHashDataLegacy>();
+   for (unsigned i = 0; i < 20; i++)
+   {
+      auto& script = utxoVec[i].getScript();
+
+      BinaryWriter bwRef;
+      bwRef.put_uint32_t(1);
+      bwRef.put_var_int(20);
+      BinaryRefReader brrTxIns(bwTxIns.getData());
+      for (unsigned y = 0; y < 20; y++)
+      {
+         bwRef.put_BinaryDataRef(brrTxIns.get_BinaryDataRef(36));
+         brrTxIns.advance(1);
+         if (y == i)
+         {
+            bwRef.put_var_int(script.getSize());
+            bwRef.put_BinaryData(script);
+         }
+         else
+         {
+            bwRef.put_var_int(0);
+         }
+         bwRef.put_BinaryDataRef(brrTxIns.get_BinaryDataRef(4));
+      }
+      bwRef.put_var_int(2);
+      bwRef.put_BinaryData(bwTxOuts.getData());
+      bwRef.put_uint32_t(123456);
+      bwRef.put_uint32_t(1);
+
+      auto&& data = SHD->getDataForSigHash(SIGHASH_ALL, txV, script, i);
+      EXPECT_EQ(data, bwRef.getData());
+
+      auto&& hash = SHD->getSha256ForSigHash(SIGHASH_ALL, txV, script, i);
+      EXPECT_EQ(hash, BtcUtils::getSha256(bwRef.getData()));
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -249,6 +437,7 @@ protected:
       DBUtils::removeDirectory("./ldbtestdir");
 
       mkdir("./ldbtestdir");
+      DatabaseBuilder::setCheckChainCacheSize(CHECKCHAIN_UTXO_CACHE_SIZE);
 
       LOGENABLESTDOUT();
       CLEANUP_ALL_TIMERS();
@@ -273,27 +462,49 @@ protected:
 };
 
 ////////////////////////////////////////////////////////////////////////////////
-TEST_F(SignerTest, DISABLED_CheckChain_Test)
+TEST_F(SignerTest, CheckChain_Test)
 {
-   //this test fails because the p2sh tx in our unit test chain are botched
-   //(the input script has opcode when it should only be push data)
-
-   config.threadCount_ = 1;
+   //the p2sh txs in blocks 3 and 4 of our unit test chain are botched 
+   //(the input script has opcodes when it should only be push data), 
+   //check the blocks before them
+   TestUtils::setBlocks({ "0", "1", "2" }, blk0dat_);
    config.checkChain_ = true;
 
-   BlockDataManager bdm(config);
-
-   try
+   auto checkChain = [this](void)->ChainCheckStats
    {
-      bdm.doInitialSyncOnLoad(TestUtils::nullProgress);
-   }
-   catch (exception&)
-   {
-      //signify the failure
-      EXPECT_TRUE(false);
-   }
+      DBUtils::removeDirectory(ldbdir_);
+      mkdir(ldbdir_);
+
+      BlockDataManager bdm(config);
+
+      //tx 2:2 carries a high S sig, libbtc's verifier rejects those
+      //so it is our one expected script failure
+      EXPECT_THROW(bdm.doInitialSyncOnLoad(TestUtils::nullProgress),
+         runtime_error);
+
+      return bdm.getCheckChainStats();
+   };
 
-   EXPECT_EQ(bdm.getCheckedTxCount(), 20);
+   auto&& stats = checkChain();
+   EXPECT_EQ(stats.checked_, 1U);
+   EXPECT_EQ(stats.failed_, 1U);
+   ASSERT_EQ(stats.failedTxs_.size(), 1U);
+   EXPECT_EQ(stats.failedTxs_[0], make_pair(2U, 2U));
+
+   //both spent outputs are from recent blocks and come out of the cache
+   EXPECT_EQ(stats.cacheHits_, 2U);
+   EXPECT_EQ(stats.blkFileOutputs_, 0U);
+
+   //no utxo cache, all outpoints are resolved from the blk files
+   DatabaseBuilder::setCheckChainCacheSize(0);
+   stats = checkChain();
+   EXPECT_EQ(stats.checked_, 1U);
+   EXPECT_EQ(stats.failed_, 1U);
+   ASSERT_EQ(stats.failedTxs_.size(), 1U);
+   EXPECT_EQ(stats.failedTxs_[0], make_pair(2U, 2U));
+
+   EXPECT_EQ(stats.cacheHits_, 0U);
+   EXPECT_EQ(stats.blkFileOutputs_, 2U);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
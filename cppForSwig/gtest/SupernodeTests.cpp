@@ -384,6 +384,96 @@ TEST_F(BlockUtilsSuper, Load5Blocks)
    EXPECT_EQ(ssh.totalTxioCount_, 2);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsSuper, Load5Blocks_BatchAccessors)
+{
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+
+   //grab every tx hash in the chain
+   auto bc = theBDMt_->bdm()->blockchain();
+   vector<BinaryData> hashes;
+   for (unsigned hgt = 0; hgt <= 5; hgt++)
+   {
+      auto header = bc->getHeaderByHeight(hgt, 0xFF);
+      for (uint16_t txi = 0; txi < header->getNumTx(); txi++)
+      {
+         StoredTx stx;
+         ASSERT_TRUE(iface_->getStoredTx(stx, hgt, txi, false));
+         hashes.push_back(stx.thisHash_);
+      }
+   }
+   ASSERT_GT(hashes.size(), 6U);
+
+   //duplicates and unknown hashes have to come back in request order too
+   hashes.push_back(hashes[3]);
+   hashes.insert(hashes.begin() + 2, READHEX(
+      "0102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f20"));
+
+   vector<BinaryDataRef> hashRefs;
+   for (auto& hash : hashes)
+      hashRefs.push_back(hash.getRef());
+
+   auto&& dbKeys = iface_->getDBKeysForHashes(hashRefs);
+   auto&& heights = iface_->getHeightsForTxHashes(hashRefs);
+   auto&& stxs = iface_->getStoredTxBatch(hashRefs);
+   ASSERT_EQ(dbKeys.size(), hashes.size());
+   ASSERT_EQ(heights.size(), hashes.size());
+   ASSERT_EQ(stxs.size(), hashes.size());
+
+   vector<BinaryData> stxoKeys;
+   for (unsigned i = 0; i < hashes.size(); i++)
+   {
+      EXPECT_EQ(dbKeys[i], iface_->getDBKeyForHash(hashes[i]));
+      EXPECT_EQ(heights[i], iface_->getHeightForTxHash(hashes[i]));
+
+      StoredTx stx;
+      if (!iface_->getStoredTx_byHash(hashes[i], &stx))
+      {
+         EXPECT_EQ(i, 2U);
+         EXPECT_FALSE(stxs[i].isInitialized());
+         continue;
+      }
+
+      ASSERT_TRUE(stxs[i].isInitialized());
+      EXPECT_EQ(stxs[i].thisHash_, hashes[i]);
+      EXPECT_EQ(stxs[i].getSerializedTx(), stx.getSerializedTx());
+
+      for (auto& stxoPair : stx.stxoMap_)
+      {
+         auto stxoKey = dbKeys[i];
+         stxoKey.append(WRITE_UINT16_BE(stxoPair.first));
+         stxoKeys.emplace_back(move(stxoKey));
+      }
+   }
+   EXPECT_EQ(heights[2], UINT32_MAX);
+   EXPECT_TRUE(dbKeys[2].empty());
+
+   //unknown txout key
+   stxoKeys.insert(stxoKeys.begin() + 1, READHEX("00000a0000000005"));
+
+   auto&& stxos = iface_->getStoredTxOutBatch(stxoKeys);
+   ASSERT_EQ(stxos.size(), stxoKeys.size());
+   for (unsigned i = 0; i < stxoKeys.size(); i++)
+   {
+      StoredTxOut stxo;
+      if (!iface_->getStoredTxOut(stxo, stxoKeys[i]))
+      {
+         EXPECT_EQ(i, 1U);
+         EXPECT_FALSE(stxos[i].isInitialized());
+         continue;
+      }
+
+      ASSERT_TRUE(stxos[i].isInitialized());
+      EXPECT_EQ(stxos[i].getSerializedTxOut(), stxo.getSerializedTxOut());
+      EXPECT_EQ(stxos[i].getValue(), stxo.getValue());
+      EXPECT_EQ(stxos[i].spentness_, stxo.spentness_);
+      EXPECT_EQ(stxos[i].spentByTxInKey_, stxo.spentByTxInKey_);
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 TEST_F(BlockUtilsSuper, Load5Blocks_ReloadBDM)
 {
@@ -1542,6 +1632,169 @@ TEST_F(BlockUtilsSuper, Load5Blocks_DynamicReorg_GrabSTXO)
    EXPECT_FALSE(iface_->getStoredTxOut(stxo7, key6_1_1_0));
 }
 
+////////////////////////////////////////////////////////////////////////////////
+static BinaryData makeFloodZc(
+   const BinaryData& prevHash, unsigned prevId, unsigned outCount)
+{
+   //unsigned tx spending one outpoint, the zc parser does not check scripts
+   BinaryWriter bw;
+   bw.put_uint32_t(1);
+   bw.put_var_int(1);
+   bw.put_BinaryData(prevHash);
+   bw.put_uint32_t(prevId);
+   bw.put_var_int(0);
+   bw.put_uint32_t(UINT32_MAX);
+
+   auto&& script = BtcUtils::getP2PKHScript(
+      TestChain::scrAddrF.getSliceCopy(1, 20));
+   bw.put_var_int(outCount);
+   for (unsigned i = 0; i < outCount; i++)
+   {
+      bw.put_uint64_t(1000);
+      bw.put_var_int(script.getSize());
+      bw.put_BinaryData(script);
+   }
+
+   bw.put_uint32_t(0);
+   return bw.getData();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool waitOnZcCount(
+   BlockDataManagerThread* bdmt, size_t count, unsigned timeoutMs)
+{
+   auto zcCont = bdmt->bdm()->zeroConfCont();
+   for (unsigned i = 0; i < timeoutMs / 10; i++)
+   {
+      auto ss = zcCont->getSnapshot();
+      if (ss != nullptr && ss->txMap_.size() >= count)
+         return true;
+
+      this_thread::sleep_for(chrono::milliseconds(10));
+   }
+
+   return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/*
+Fans block 5 tx 2 out into width1 * width2 zc over 3 generations. Each
+generation is pushed once its parents are tracked, so the last one is a
+single flood of zc that only spend outputs of tracked zc. Returns the time 
+it took to process the last generation, in seconds.
+*/
+static double floodZc(
+   BlockDataManagerThread* bdmt, shared_ptr<NodeUnitTest> node,
+   unsigned width1, unsigned width2, vector<BinaryData>& lastGen)
+{
+   auto&& rootTx = TestUtils::getTx(5, 2);
+   DBTestUtils::ZcVector zcVec;
+   zcVec.push_back(rootTx, 14000000);
+   DBTestUtils::pushNewZc(bdmt, zcVec);
+   EXPECT_TRUE(waitOnZcCount(bdmt, 1, 10000));
+
+   auto&& gen1 = makeFloodZc(BtcUtils::getHash256(rootTx), 0, width1);
+   node->pushZcBulk({ gen1 });
+   EXPECT_TRUE(waitOnZcCount(bdmt, 2, 10000));
+
+   vector<BinaryData> gen2;
+   auto&& gen1Hash = BtcUtils::getHash256(gen1);
+   for (unsigned i = 0; i < width1; i++)
+      gen2.push_back(makeFloodZc(gen1Hash, i, width2));
+   node->pushZcBulk(gen2);
+   EXPECT_TRUE(waitOnZcCount(bdmt, 2 + width1, 60000));
+
+   lastGen.clear();
+   for (auto& tx : gen2)
+   {
+      auto&& hash = BtcUtils::getHash256(tx);
+      for (unsigned i = 0; i < width2; i++)
+         lastGen.push_back(makeFloodZc(hash, i, 1));
+   }
+
+   auto start = chrono::steady_clock::now();
+   node->pushZcBulk(lastGen);
+   EXPECT_TRUE(waitOnZcCount(
+      bdmt, 2 + width1 + lastGen.size(), 600000));
+
+   return chrono::duration_cast<chrono::milliseconds>(
+      chrono::steady_clock::now() - start).count() / 1000.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsSuper, ZcFlood)
+{
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4" }, blk0dat_);
+
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+
+   auto node = dynamic_pointer_cast<NodeUnitTest>(config.bitcoinNodes_.first);
+   ASSERT_NE(node, nullptr);
+   node->setIface(iface_);
+
+   vector<BinaryData> lastGen;
+   floodZc(theBDMt_, node, 20, 50, lastGen);
+
+   auto zcCont = theBDMt_->bdm()->zeroConfCont();
+   auto ss = zcCont->getSnapshot();
+   ASSERT_NE(ss, nullptr);
+   EXPECT_EQ(ss->txMap_.size(), 1022);
+   for (auto& tx : lastGen)
+      EXPECT_TRUE(zcCont->hasTxByHash(BtcUtils::getHash256(tx)));
+
+   //replace the first 40 zc of the last generation in a single batch
+   vector<BinaryData> replacements;
+   for (unsigned i = 0; i < 40; i++)
+   {
+      Tx tx(lastGen[i]);
+      auto&& op = tx.getTxInCopy(0).getOutPoint();
+      replacements.push_back(
+         makeFloodZc(op.getTxHash(), op.getTxOutIndex(), 2));
+   }
+   node->pushZcBulk(replacements);
+
+   auto&& lastHash = BtcUtils::getHash256(replacements.back());
+   for (unsigned i = 0; i < 1000; i++)
+   {
+      if (zcCont->hasTxByHash(lastHash))
+         break;
+      this_thread::sleep_for(chrono::milliseconds(10));
+   }
+
+   ss = zcCont->getSnapshot();
+   EXPECT_EQ(ss->txMap_.size(), 1022);
+   for (unsigned i = 0; i < 40; i++)
+   {
+      EXPECT_FALSE(zcCont->hasTxByHash(BtcUtils::getHash256(lastGen[i])));
+      EXPECT_TRUE(zcCont->hasTxByHash(BtcUtils::getHash256(replacements[i])));
+   }
+   EXPECT_TRUE(zcCont->hasTxByHash(BtcUtils::getHash256(lastGen[40])));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsSuper, DISABLED_ZcFlood_Bench)
+{
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4" }, blk0dat_);
+
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+
+   auto node = dynamic_pointer_cast<NodeUnitTest>(config.bitcoinNodes_.first);
+   ASSERT_NE(node, nullptr);
+   node->setIface(iface_);
+
+   vector<BinaryData> lastGen;
+   auto elapsed = floodZc(theBDMt_, node, 200, 100, lastGen);
+
+   cout << lastGen.size() << " zc in " << elapsed << "s, " <<
+      lastGen.size() / elapsed << " zc/s" << endl;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // I thought I was going to do something different with this set of tests,
 // but I ended up with an exact copy of the BlockUtilsSuper fixture.  Oh well.
@@ -2156,6 +2409,85 @@ TEST_F(BlockUtilsWithWalletTest, RegisterAfterZC)
    EXPECT_EQ(scrObj->getFullBalance(), 65 * COIN);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(BlockUtilsWithWalletTest, Balances_IncrementalVsRecompute)
+{
+   TestUtils::setBlocks({ "0", "1", "2", "3" }, blk0dat_);
+
+   vector<BinaryData> scrAddrVec;
+   scrAddrVec.push_back(TestChain::scrAddrA);
+   scrAddrVec.push_back(TestChain::scrAddrB);
+   scrAddrVec.push_back(TestChain::scrAddrC);
+   scrAddrVec.push_back(TestChain::scrAddrD);
+   scrAddrVec.push_back(TestChain::scrAddrE);
+   scrAddrVec.push_back(TestChain::scrAddrF);
+
+   theBDMt_->start(config.initMode_);
+   auto&& bdvID = DBTestUtils::registerBDV(clients_, NetworkConfig::getMagicBytes());
+   DBTestUtils::registerWallet(clients_, bdvID, scrAddrVec, "wallet1");
+   auto bdvPtr = DBTestUtils::getBDV(clients_, bdvID);
+
+   DBTestUtils::goOnline(clients_, bdvID);
+   DBTestUtils::waitOnBDMReady(clients_, bdvID);
+   auto wlt = bdvPtr->getWalletOrLockbox(wallet1id);
+
+   //materialized balances have to match a recompute from the full history
+   auto checkBalances = [&](unsigned confTarget)->void
+   {
+      auto height = theBDMt_->bdm()->blockchain()->top()->getBlockHeight();
+
+      uint64_t full = 0, spendable = 0, unconf = 0, count = 0;
+      for (auto& scrAddr : scrAddrVec)
+      {
+         auto scrObj = wlt->getScrAddrObjByKey(scrAddr);
+         ASSERT_EQ(scrObj->getBalancesHeight(), height);
+
+         auto& balances = scrObj->getBalances();
+         EXPECT_EQ(balances.full_, scrObj->getFullBalance());
+         EXPECT_EQ(balances.spendable_, scrObj->getSpendableBalance(height));
+         EXPECT_EQ(balances.unconfirmed_, 
+            scrObj->getUnconfirmedBalance(height, confTarget));
+         EXPECT_EQ(balances.txioCount_, scrObj->getTxioCountFromSSH());
+
+         full += balances.full_;
+         spendable += balances.spendable_;
+         unconf += balances.unconfirmed_;
+         count += balances.txioCount_;
+      }
+
+      EXPECT_EQ(wlt->getFullBalance(), full);
+      EXPECT_EQ(wlt->getSpendableBalance(height), spendable);
+      EXPECT_EQ(wlt->getUnconfirmedBalance(height), unconf);
+      EXPECT_EQ(wlt->getWltTotalTxnCount(), count);
+   };
+
+   checkBalances(MIN_CONFIRMATIONS);
+
+   //new block, no reorg
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4A" }, blk0dat_);
+   DBTestUtils::triggerNewBlockNotification(theBDMt_);
+   DBTestUtils::waitOnNewBlockSignal(clients_, bdvID);
+   checkBalances(MIN_CONFIRMATIONS);
+
+   //reorg to 5
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4A", "4", "5" }, blk0dat_);
+   DBTestUtils::triggerNewBlockNotification(theBDMt_);
+   DBTestUtils::waitOnNewBlockSignal(clients_, bdvID);
+   checkBalances(MIN_CONFIRMATIONS);
+
+   //reorg to 5A
+   TestUtils::setBlocks({ "0", "1", "2", "3", "4A", "4", "5", "5A" }, blk0dat_);
+   DBTestUtils::triggerNewBlockNotification(theBDMt_);
+   DBTestUtils::waitOnNewBlockSignal(clients_, bdvID);
+   checkBalances(MIN_CONFIRMATIONS);
+
+   //conf target changes rebuild the unconfirmed balances
+   wlt->setConfTarget(3, "");
+   checkBalances(3);
+   wlt->setConfTarget(1, "");
+   checkBalances(1);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 TEST_F(BlockUtilsWithWalletTest, ZC_Reorg)
 {
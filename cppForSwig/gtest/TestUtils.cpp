@@ -349,6 +349,85 @@ namespace DBTestUtils
       return levData;
    }
 
+   /////////////////////////////////////////////////////////////////////////////
+   void streamHistory(Clients* clients, const string& bdvId,
+      const string& delegateId, const string& streamId, unsigned window)
+   {
+      auto message = make_shared<BDVCommand>();
+      message->set_method(Methods::streamHistory);
+      message->set_bdvid(bdvId);
+      message->set_delegateid(delegateId);
+      message->set_hash(streamId);
+      message->set_value(window);
+
+      processCommand(clients, message);
+   }
+
+   /////////////////////////////////////////////////////////////////////////////
+   void ackHistoryStream(Clients* clients, const string& bdvId,
+      const string& streamId, unsigned count, bool cancel)
+   {
+      auto message = make_shared<BDVCommand>();
+      message->set_method(Methods::ackHistoryStream);
+      message->set_bdvid(bdvId);
+      message->set_hash(streamId);
+      message->set_value(count);
+      message->set_flag(cancel);
+
+      processCommand(clients, message);
+   }
+
+   /////////////////////////////////////////////////////////////////////////////
+   vector<shared_ptr<BDVCallback>> getPendingNotifications(
+      Clients* clients, const string& bdvId)
+   {
+      auto bdv_obj = clients->get(bdvId);
+      auto unittest_cbptr = dynamic_cast<UnitTest_Callback*>(bdv_obj->cb_.get());
+      if (unittest_cbptr == nullptr)
+         throw runtime_error("unexpected callback ptr type");
+
+      vector<shared_ptr<BDVCallback>> result;
+      while (true)
+      {
+         auto&& notifPtr = unittest_cbptr->getNotification(false);
+         if (notifPtr == nullptr)
+            return result;
+
+         result.push_back(notifPtr);
+      }
+   }
+
+   /////////////////////////////////////////////////////////////////////////////
+   vector<pair<vector<::ClientClasses::LedgerEntry>, bool>> getHistoryChunks(
+      Clients* clients, const string& bdvId, const string& streamId)
+   {
+      //stream chunks are pushed from within the command, they are all
+      //queued by the time it returns
+      vector<pair<vector<::ClientClasses::LedgerEntry>, bool>> chunks;
+      auto&& notifs = getPendingNotifications(clients, bdvId);
+      for (auto& callbackPtr : notifs)
+      {
+         for (int i = 0; i < callbackPtr->notification_size(); i++)
+         {
+            auto& notif = callbackPtr->notification(i);
+            if (notif.requestid() != streamId)
+               continue;
+
+            if (notif.type() != NotificationType::history_chunk)
+               throw runtime_error("history stream error");
+
+            pair<vector<::ClientClasses::LedgerEntry>, bool> chunk;
+            for (int y = 0; y < notif.ledgers().values_size(); y++)
+               chunk.first.push_back(
+                  ::ClientClasses::LedgerEntry(callbackPtr, i, y));
+            chunk.second = notif.lastchunk();
+            chunks.push_back(move(chunk));
+         }
+      }
+
+      return chunks;
+   }
+
    /////////////////////////////////////////////////////////////////////////////
    tuple<shared_ptr<BDVCallback>, unsigned> waitOnSignal(
       Clients* clients, const string& bdvId, NotificationType signal)
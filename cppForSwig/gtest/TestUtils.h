@@ -124,6 +124,17 @@ namespace DBTestUtils
       Clients* clients, const std::string& bdvId,
       const std::string& delegateId, uint32_t pageId);
 
+   void streamHistory(Clients* clients, const std::string& bdvId,
+      const std::string& delegateId, const std::string& streamId, 
+      unsigned window);
+   void ackHistoryStream(Clients* clients, const std::string& bdvId,
+      const std::string& streamId, unsigned count, bool cancel = false);
+   std::vector<std::shared_ptr<::Codec_BDVCommand::BDVCallback>> 
+      getPendingNotifications(Clients* clients, const std::string& bdvId);
+   std::vector<std::pair<std::vector<::ClientClasses::LedgerEntry>, bool>> 
+      getHistoryChunks(Clients* clients, const std::string& bdvId, 
+      const std::string& streamId);
+
    std::tuple<std::shared_ptr<::Codec_BDVCommand::BDVCallback>, unsigned> waitOnSignal(
       Clients* clients, const std::string& bdvId,
       ::Codec_BDVCommand::NotificationType signal);
@@ -226,6 +226,65 @@ TEST_F(DerivationTests, ArmoryChain_Tests)
       "0436e30c6b3295df86d8085d3171bfb11608943c4282a0bf98e841088a14e33cda8412dcf74fb6c8cb89dd00f208ca2c03a437b93730e8d92b45d6841e07ae4e6f");
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(DerivationTests, BIP32_BulkPublicChain)
+{
+   BIP32_Node root;
+   root.initFromSeed(seed_);
+   root.derivePrivate(0x80000000);
+   auto&& pubRoot = root.getPublicCopy();
+
+   auto chaincode = pubRoot.getChaincode();
+   auto pubkey = pubRoot.getPublicKey();
+   auto rootAsset = make_shared<AssetEntry_Single>(
+      -1, BinaryData(), pubkey, nullptr);
+
+   //serial reference, node by node
+   unsigned count = 1000;
+   vector<SecureBinaryData> expected;
+   for (unsigned i = 0; i < count; i++)
+   {
+      auto node = pubRoot;
+      node.derivePublic(i);
+      expected.push_back(node.getPublicKey());
+   }
+
+   DerivationScheme_BIP32 derScheme(
+      chaincode, pubRoot.getDepth(), pubRoot.getLeafID());
+
+   for (auto threadCount : { 1, 4 })
+   {
+      DerivationScheme_BIP32::setExtendThreadCount(threadCount);
+      auto&& assetVec = derScheme.extendPublicChain(rootAsset, 0, count - 1);
+      ASSERT_EQ(assetVec.size(), count);
+
+      for (unsigned i = 0; i < count; i++)
+      {
+         auto assetSingle =
+            dynamic_pointer_cast<AssetEntry_Single>(assetVec[i]);
+         ASSERT_NE(assetSingle, nullptr);
+         EXPECT_EQ(assetSingle->getIndex(), (int)i);
+
+         auto assetPubkey = assetSingle->getPubKey();
+         EXPECT_EQ(assetPubkey->getCompressedKey(), expected[i]);
+         EXPECT_EQ(assetPubkey->compressedHash160_,
+            BtcUtils::getHash160(expected[i]));
+      }
+   }
+
+   //partial range
+   auto&& assetVec = derScheme.extendPublicChain(rootAsset, 500, 505);
+   ASSERT_EQ(assetVec.size(), 6);
+   for (unsigned i = 0; i < 6; i++)
+   {
+      auto assetSingle = dynamic_pointer_cast<AssetEntry_Single>(assetVec[i]);
+      EXPECT_EQ(assetSingle->getPubKey()->getCompressedKey(),
+         expected[500 + i]);
+   }
+
+   DerivationScheme_BIP32::setExtendThreadCount(0);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -1872,6 +1931,78 @@ TEST_F(WalletInterfaceTest, EncryptionTest_OpenCloseAmend)
    dbEnv->close();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+TEST_F(WalletInterfaceTest, EncryptionTest_ParallelLoad)
+{
+   auto dbEnv = make_shared<LMDBEnv>();
+   dbEnv->open(dbPath_, 0);
+
+   auto&& controlSalt = CryptoPRNG::generateRandom(32);
+   auto&& rawRoot = CryptoPRNG::generateRandom(32);
+   string dbName("test");
+
+   map<BinaryData, BinaryData> expected;
+
+   /*
+   Write over several sessions so the entries span a few key cycles, 
+   erase some along the way to create gaps and erasure place holders.
+   Small values keep some data packets in the size range of meta data.
+   */
+   for (unsigned session = 0; session < 3; session++)
+   {
+      auto dbIface = make_shared<DBInterface>(
+         dbEnv.get(), dbName, controlSalt, ENCRYPTION_TOPLAYER_VERSION);
+      dbIface->loadAllEntries(rawRoot);
+      ASSERT_EQ(dbIface->getEntryCount(), expected.size());
+
+      {
+         WalletIfaceTransaction tx(nullptr, dbIface.get(), true);
+         unsigned eraseCount = 0;
+         for (auto iter = expected.begin(); iter != expected.end();)
+         {
+            if (eraseCount++ % 7 != 0)
+            {
+               ++iter;
+               continue;
+            }
+
+            tx.erase(iter->first);
+            expected.erase(iter++);
+         }
+      }
+
+      WalletIfaceTransaction tx(nullptr, dbIface.get(), true);
+      for (unsigned i = 0; i < 400; i++)
+      {
+         bool small = i % 3 == 0;
+         auto&& key = CryptoPRNG::generateRandom(small ? 4 : 16);
+         auto&& val = CryptoPRNG::generateRandom(small ? 1 : 80);
+         auto valToWrite = val;
+         tx.insert(key, valToWrite);
+         expected[key] = val;
+      }
+   }
+
+   auto checkLoad = [&](unsigned threadCount)->void
+   {
+      DBInterface::setLoadThreadCount(threadCount);
+      auto dbIface = make_shared<DBInterface>(
+         dbEnv.get(), dbName, controlSalt, ENCRYPTION_TOPLAYER_VERSION);
+      dbIface->loadAllEntries(rawRoot);
+      ASSERT_EQ(dbIface->getEntryCount(), expected.size());
+
+      WalletIfaceTransaction tx(nullptr, dbIface.get(), false);
+      for (auto& keyVal : expected)
+         EXPECT_EQ(tx.getDataRef(keyVal.first), keyVal.second);
+   };
+
+   checkLoad(1);
+   checkLoad(4);
+   DBInterface::setLoadThreadCount(0);
+
+   dbEnv->close();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 TEST_F(WalletInterfaceTest, Passphrase_Test)
 {
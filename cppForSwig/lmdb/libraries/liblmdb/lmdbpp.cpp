@@ -26,6 +26,46 @@ static std::string errorString(int rc)
    return mdb_strerror(rc);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+struct ThreadTxSlot
+{
+   uint64_t envId_;
+   LMDBThreadTxInfo* txInfo_;
+};
+
+//one slot per env this thread has an open tx on, rarely more than a couple
+static thread_local std::vector<ThreadTxSlot> threadTxSlots_;
+
+static LMDBThreadTxInfo* getThreadTxSlot(uint64_t envId)
+{
+   for (auto& slot : threadTxSlots_)
+   {
+      if (slot.envId_ == envId)
+         return slot.txInfo_;
+   }
+
+   return nullptr;
+}
+
+static void setThreadTxSlot(uint64_t envId, LMDBThreadTxInfo* txInfo)
+{
+   threadTxSlots_.push_back({ envId, txInfo });
+}
+
+static void clearThreadTxSlot(uint64_t envId)
+{
+   for (auto iter = threadTxSlots_.begin(); iter != threadTxSlots_.end(); ++iter)
+   {
+      if (iter->envId_ == envId)
+      {
+         threadTxSlots_.erase(iter);
+         return;
+      }
+   }
+}
+
+std::atomic<uint64_t> LMDBEnv::envIdCounter_(1);
+
 inline void LMDB::Iterator::checkHasDb() const
 {
    if (!db_)
@@ -64,20 +104,12 @@ inline void LMDB::Iterator::checkOk() const
 
 void LMDB::Iterator::openCursor()
 {
-   auto tID = std::this_thread::get_id();
    LMDBEnv *const _env = db_->env;
-   std::unique_lock<std::mutex> lock(_env->threadTxMutex_);
-   
-   auto txnIter = _env->txForThreads_.find(tID);
-   if (txnIter == _env->txForThreads_.end())
-      throw std::runtime_error("Iterator must be created within Transaction");
-   
-   lock.unlock();
-   
-   if (txnIter->second.transactionLevel_ == 0)
+   auto txInfo = _env->getThreadTx();
+   if (txInfo == nullptr || txInfo->transactionLevel_ == 0)
       throw std::runtime_error("Iterator must be created within Transaction");
    
-   txnPtr_ = &txnIter->second;
+   txnPtr_ = txInfo;
   
    int rc = mdb_cursor_open(txnPtr_->txn_, db_->dbi, &csr_);
    if (rc != MDB_SUCCESS)
@@ -340,6 +372,7 @@ void LMDBEnv::open(const char *filename, unsigned flags)
       throw std::logic_error("Database environment already open (close it first)");
 
    txForThreads_.clear();
+   envId_ = envIdCounter_.fetch_add(1);
    
    int rc;
 
@@ -373,6 +406,11 @@ void LMDBEnv::close()
    }
 }
 
+LMDBThreadTxInfo* LMDBEnv::getThreadTx() const
+{
+   return getThreadTxSlot(envId_);
+}
+
 size_t LMDBEnv::getMapSize() const
 {
    return mdb_env_getmapsize(dbenv);
@@ -458,10 +496,20 @@ void LMDBEnv::Transaction::begin()
    began = true;
 
    auto tID = std::this_thread::get_id();
-   
-   std::unique_lock<std::mutex> lock(env->threadTxMutex_);
-   LMDBThreadTxInfo& thTx = env->txForThreads_[tID];
-   lock.unlock();
+   std::unique_lock<std::mutex> lock(env->threadTxMutex_, std::defer_lock);
+
+   //only the first tx level of this thread on this env touches the map
+   auto thTxPtr = env->getThreadTx();
+   if (thTxPtr == nullptr)
+   {
+      lock.lock();
+      thTxPtr = &env->txForThreads_[tID];
+      lock.unlock();
+
+      setThreadTxSlot(env->envId_, thTxPtr);
+   }
+
+   LMDBThreadTxInfo& thTx = *thTxPtr;
    
    if (thTx.transactionLevel_ != 0 && mode_ == LMDB::ReadWrite && thTx.mode_ == LMDB::ReadOnly)
       throw LMDBException("Cannot access ReadOnly Transaction in ReadWrite mode");
@@ -484,6 +532,8 @@ void LMDBEnv::Transaction::begin()
    int rc = mdb_txn_begin(env->dbenv, nullptr, modef, &thTx.txn_);
    if (rc != MDB_SUCCESS)
    {
+      clearThreadTxSlot(env->envId_);
+
       lock.lock();
       env->txForThreads_.erase(tID);
       lock.unlock();
@@ -512,15 +562,11 @@ void LMDBEnv::Transaction::commit()
    began=false;
 
    //look for an existing transaction in this thread
-   auto tID = std::this_thread::get_id();
-   std::unique_lock<std::mutex> lock(env->threadTxMutex_);
-   auto txnIter = env->txForThreads_.find(tID);
-
-   if (txnIter == env->txForThreads_.end())
+   auto thTxPtr = env->getThreadTx();
+   if (thTxPtr == nullptr)
       throw LMDBException("Transaction bound to unknown thread");
-   lock.unlock();
 
-   LMDBThreadTxInfo& thTx = txnIter->second;
+   LMDBThreadTxInfo& thTx = *thTxPtr;
 
    if (thTx.transactionLevel_-- == 1)
    {
@@ -537,8 +583,10 @@ void LMDBEnv::Transaction::commit()
          throw LMDBException("Failed to close env tx (" + errorString(rc) +")");
       }
       
-      lock.lock();
-      env->txForThreads_.erase(txnIter);
+      clearThreadTxSlot(env->envId_);
+
+      std::unique_lock<std::mutex> lock(env->threadTxMutex_);
+      env->txForThreads_.erase(std::this_thread::get_id());
    }
 }
 
@@ -590,15 +638,11 @@ void LMDB::open(LMDBEnv *_env, const std::string &name)
    this->env = _env;
    
    LMDBEnv::Transaction tx(_env);
-   auto tID = std::this_thread::get_id();
-   std::unique_lock<std::mutex> lock(_env->threadTxMutex_);
-   auto txnIter = _env->txForThreads_.find(tID);
-
-   if (txnIter == _env->txForThreads_.end())
+   auto txInfo = _env->getThreadTx();
+   if (txInfo == nullptr)
       throw LMDBException("Failed to insert: need transaction");
-   lock.unlock();
       
-   int rc = mdb_open(txnIter->second.txn_, name.c_str(), MDB_CREATE, &dbi);
+   int rc = mdb_open(txInfo->txn_, name.c_str(), MDB_CREATE, &dbi);
    if (rc != MDB_SUCCESS)
    {
       // cleanup here
@@ -614,17 +658,11 @@ void LMDB::insert(
    MDB_val mkey = { key.len, const_cast<char*>(key.data) };
    MDB_val mval = { value.len, const_cast<char*>(value.data) };
 
-   auto tID = std::this_thread::get_id();
-
-   std::unique_lock<std::mutex> lock(env->threadTxMutex_);
-
-   auto txnIter = env->txForThreads_.find(tID);
-
-   if (txnIter == env->txForThreads_.end())
+   auto txInfo = env->getThreadTx();
+   if (txInfo == nullptr)
       throw LMDBException("Failed to insert: need transaction");
-   lock.unlock();
 
-   int rc = mdb_put(txnIter->second.txn_, dbi, &mkey, &mval, 0);
+   int rc = mdb_put(txInfo->txn_, dbi, &mkey, &mval, 0);
    if (rc == MDB_SUCCESS)
       return;
 
@@ -635,16 +673,12 @@ void LMDB::insert(
 
 void LMDB::erase(const CharacterArrayRef& key)
 {
-   auto tID = std::this_thread::get_id();
-   std::unique_lock<std::mutex> lock(env->threadTxMutex_);
-   auto txnIter = env->txForThreads_.find(tID);
-
-   if (txnIter == env->txForThreads_.end())
+   auto txInfo = env->getThreadTx();
+   if (txInfo == nullptr)
       throw LMDBException("Failed to insert: need transaction");
-   lock.unlock();
       
    MDB_val mkey = { key.len, const_cast<char*>(key.data) };
-   int rc = mdb_del(txnIter->second.txn_, dbi, &mkey, 0);
+   int rc = mdb_del(txInfo->txn_, dbi, &mkey, 0);
    if (rc != MDB_SUCCESS && rc != MDB_NOTFOUND)
    {
       std::cout << "failed to erase data, returned following error string: " << errorString(rc) << std::endl;
@@ -654,13 +688,9 @@ void LMDB::erase(const CharacterArrayRef& key)
 
 void LMDB::wipe(const CharacterArrayRef& key)
 {
-   auto tID = std::this_thread::get_id();
-   std::unique_lock<std::mutex> lock(env->threadTxMutex_);
-   auto txnIter = env->txForThreads_.find(tID);
-
-   if (txnIter == env->txForThreads_.end())
+   auto txInfo = env->getThreadTx();
+   if (txInfo == nullptr)
       throw LMDBException("Failed to insert: need transaction");
-   lock.unlock();
 
    try
    {
@@ -675,7 +705,7 @@ void LMDB::wipe(const CharacterArrayRef& key)
    }   
 
    MDB_val mkey = { key.len, const_cast<char*>(key.data) };
-   int rc = mdb_del(txnIter->second.txn_, dbi, &mkey, 0); // , MDB_WIPE_DATA);
+   int rc = mdb_del(txInfo->txn_, dbi, &mkey, 0); // , MDB_WIPE_DATA);
    if (rc != MDB_SUCCESS && rc != MDB_NOTFOUND)
    {
       std::cout << "failed to erase data, returned following error string: " << errorString(rc) << std::endl;
@@ -697,23 +727,14 @@ CharacterArrayRef LMDB::get_NoCopy(const CharacterArrayRef& key) const
 {
    //simple get without the use of iterators
 
-   auto tID = std::this_thread::get_id();
-   std::unique_lock<std::mutex> lock(env->threadTxMutex_);
-   
-   auto txnIter = env->txForThreads_.find(tID);
-   if (txnIter == env->txForThreads_.end())
+   auto txInfo = env->getThreadTx();
+   if (txInfo == nullptr)
       throw std::runtime_error("Need transaction to get data");
-   
-   /*
-   TODO: this is slow, set get routines within the tx directly to avoid 
-   locking the txmap
-   */
-   lock.unlock(); 
 
    MDB_val mkey = { key.len, const_cast<char*>(key.data) };
    MDB_val mdata = { 0, 0 };
 
-   int rc = mdb_get(txnIter->second.txn_, dbi, &mkey, &mdata);
+   int rc = mdb_get(txInfo->txn_, dbi, &mkey, &mdata);
    if (rc == MDB_NOTFOUND)
       return CharacterArrayRef(0, (char*)nullptr);
    
@@ -726,16 +747,11 @@ CharacterArrayRef LMDB::get_NoCopy(const CharacterArrayRef& key) const
 
 void LMDB::drop(void)
 {
-   auto tID = std::this_thread::get_id();
-   std::unique_lock<std::mutex> lock(env->threadTxMutex_);
-
-   auto txnIter = env->txForThreads_.find(tID);
-   if (txnIter == env->txForThreads_.end())
+   auto txInfo = env->getThreadTx();
+   if (txInfo == nullptr)
       throw std::runtime_error("Need transaction to get data");
 
-   lock.unlock();
-
-   if (mdb_drop(txnIter->second.txn_, dbi, 0) != MDB_SUCCESS)
+   if (mdb_drop(txInfo->txn_, dbi, 0) != MDB_SUCCESS)
       throw std::runtime_error("Failed to drop DB!");
 }
 
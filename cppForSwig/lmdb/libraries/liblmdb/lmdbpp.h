@@ -14,6 +14,8 @@
 #include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
 #include "lmdb.h"
 
 struct MDB_env;
@@ -262,11 +264,25 @@ private:
    unsigned dbCount_ = 1;
 
    std::string filename_;
+
+   /***
+   The map only tracks open txes for bookkeeping and is locked at tx 
+   begin/commit. Reads go through a thread local slot keyed by envId_ 
+   instead. Ids are never reused and a fresh one is drawn on open(), so
+   slots left over from a destroyed or reopened env can't match.
+   ***/
    std::mutex threadTxMutex_;
    std::unordered_map<std::thread::id, LMDBThreadTxInfo> txForThreads_;
+   uint64_t envId_;
+
+   static std::atomic<uint64_t> envIdCounter_;
    
    friend class LMDB;
 
+private:
+   //lock free, returns nullptr if this thread has no tx on this env
+   LMDBThreadTxInfo* getThreadTx(void) const;
+
 public:
    class Transaction
    {
@@ -306,8 +322,9 @@ public:
       Transaction(const Transaction&); // no copies
    };
 
-   LMDBEnv() { }
-   LMDBEnv(unsigned dbCount) { dbCount_ = dbCount; }
+   LMDBEnv() : envId_(envIdCounter_.fetch_add(1)) { }
+   LMDBEnv(unsigned dbCount) : envId_(envIdCounter_.fetch_add(1))
+   { dbCount_ = dbCount; }
    ~LMDBEnv();
    
    // open a database by filename
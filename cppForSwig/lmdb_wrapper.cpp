@@ -17,6 +17,8 @@
 #include <list>
 #include <vector>
 #include <set>
+#include <numeric>
+#include <algorithm>
 #include "BinaryData.h"
 #include "BtcUtils.h"
 #include "BlockObj.h"
@@ -48,6 +50,7 @@ const map<string, size_t> LMDBBlockDatabase::mapSizes_ = {
    {"zeroconf", 10 * 1024 * 1024 * 1024ULL},
    {"txfilters", 10 * 1024 * 1024 * 1024ULL},
    {"spentness", 100 * 1024 * 1024 * 1024ULL},
+   {"blockfilters", 64 * 1024 * 1024 * 1024ULL},
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -456,6 +459,9 @@ void LMDBBlockDatabase::closeDatabases(void)
       dbPair.second->close();
    dbMap_.clear();
    dbIsOpen_ = false;
+
+   //blk files may be swapped under a closed db, drop cached maps
+   BlockDataCache::instance().clear();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -773,6 +779,75 @@ unsigned LMDBBlockDatabase::getHeightForTxHash(
    return DBUtils::hgtxToHeight(hgtx);
 }
 
+/////////////////////////////////////////////////////////////////////////////
+vector<BinaryData> LMDBBlockDatabase::getDBKeysForHashes(
+   const vector<BinaryDataRef>& hashes) const
+{
+   vector<BinaryData> result(hashes.size());
+
+   //hint keys are the hash prefix, resolve in hash order
+   vector<size_t> order(hashes.size());
+   iota(order.begin(), order.end(), 0);
+   sort(order.begin(), order.end(), [&hashes](size_t a, size_t b)->bool
+   {
+      return hashes[a] < hashes[b];
+   });
+
+   auto&& hintsTx = beginTransaction(TXHINTS, LMDB::ReadOnly);
+
+   //supernode checks hint hashes against the STXO db
+   unique_ptr<DbTransaction> stxoTx;
+   if (getDbType() == ARMORY_DB_SUPER)
+      stxoTx = beginTransaction(STXO, LMDB::ReadOnly);
+
+   size_t prevId = SIZE_MAX;
+   for (auto& id : order)
+   {
+      if (prevId != SIZE_MAX && hashes[prevId] == hashes[id])
+      {
+         result[id] = result[prevId];
+         continue;
+      }
+
+      result[id] = getDBKeyForHash(hashes[id]);
+      prevId = id;
+   }
+
+   return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+vector<unsigned> LMDBBlockDatabase::getHeightsForTxHashes(
+   const vector<BinaryDataRef>& hashes) const
+{
+   auto&& dbKeys = getDBKeysForHashes(hashes);
+
+   vector<unsigned> result;
+   result.reserve(dbKeys.size());
+   for (auto& dbKey : dbKeys)
+   {
+      if (dbKey.empty())
+      {
+         result.push_back(UINT32_MAX);
+         continue;
+      }
+
+      auto hgtx = dbKey.getSliceRef(0, 4);
+      if (getDbType() == ARMORY_DB_SUPER)
+      {
+         auto block_id = DBUtils::hgtxToHeight(hgtx);
+         auto header = blockchainPtr_->getHeaderById(block_id);
+         result.push_back(header->getBlockHeight());
+      }
+      else
+      {
+         result.push_back(DBUtils::hgtxToHeight(hgtx));
+      }
+   }
+
+   return result;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Put value based on BinaryData key.  If batch writing, pass in the batch
 void LMDBBlockDatabase::putValue(DB_SELECT db, 
@@ -1203,12 +1278,12 @@ bool LMDBBlockDatabase::getFullUTXOMapForSSH(
 }
 
 /////////////////////////////////////////////////////////////////////////////
-// TODO: We should also read the HeaderHgtList entries to get the blockchain
-//       sorting that is saved in the DB.  But right now, I'm not sure what
-//       that would get us since we are reading all the headers and doing
-//       a fresh organize/sort anyway.
+// Headers are gathered under a single read tx, then unserialized and hashed 
+// across threadCount threads. The callback is always fired from the calling 
+// thread, in key order.
 void LMDBBlockDatabase::readAllHeaders(
-   const function<void(shared_ptr<BlockHeader>, uint32_t, uint8_t)> &callback
+   const function<void(shared_ptr<BlockHeader>, uint32_t, uint8_t)> &callback,
+   unsigned threadCount
 )
 {
    auto&& tx = beginTransaction(HEADERS, LMDB::ReadOnly);
@@ -1220,6 +1295,8 @@ void LMDBBlockDatabase::readAllHeaders(
       return;
    }
    
+   //refs point into the db map, they are valid for as long as tx is alive
+   vector<pair<BinaryDataRef, BinaryDataRef>> rawHeaders;
    do
    {
       ldbIter->resetReaders();
@@ -1231,30 +1308,82 @@ void LMDBBlockDatabase::readAllHeaders(
          continue;
       }
 
-      StoredHeader sbh;
-      ldbIter->getKeyReader().get_BinaryData(sbh.thisHash_, 32);
+      rawHeaders.push_back(make_pair(
+         ldbIter->getKeyReader().get_BinaryDataRef(32),
+         ldbIter->getValueRef()));
+
+   } while(ldbIter->advanceAndRead(DB_PREFIX_HEADHASH));
+
+   struct DecodedHeader
+   {
+      shared_ptr<BlockHeader> header_;
+      uint32_t height_;
+      uint8_t dup_;
+   };
+
+   vector<DecodedHeader> decoded(rawHeaders.size());
+   atomic<unsigned> corruptCount(0);
+   auto decodeRange = [&](size_t start, size_t end)->void
+   {
+      for (size_t i = start; i < end; i++)
+      {
+         StoredHeader sbh;
+         sbh.thisHash_ = rawHeaders[i].first;
+         sbh.unserializeDBValue(HEADERS, rawHeaders[i].second);
 
-      sbh.unserializeDBValue(HEADERS, ldbIter->getValueRef());
+         auto regHead = make_shared<BlockHeader>();
 
-      auto regHead = make_shared<BlockHeader>();
+         regHead->unserialize(sbh.dataCopy_);
+         regHead->setBlockSize(sbh.numBytes_);
+         regHead->setNumTx(sbh.numTx_);
 
-      regHead->unserialize(sbh.dataCopy_);
-      regHead->setBlockSize(sbh.numBytes_);
-      regHead->setNumTx(sbh.numTx_);
+         regHead->setBlockFileNum(sbh.fileID_);
+         regHead->setBlockFileOffset(sbh.offset_);
+         regHead->setUniqueID(sbh.uniqueID_);
 
-      regHead->setBlockFileNum(sbh.fileID_);
-      regHead->setBlockFileOffset(sbh.offset_);
-      regHead->setUniqueID(sbh.uniqueID_);
+         if (sbh.thisHash_ != regHead->getThisHash())
+         {
+            LOGWARN << "Corruption detected: block header hash " <<
+               sbh.thisHash_.copySwapEndian().toHexStr() << " does not match "
+               << regHead->getThisHash().copySwapEndian().toHexStr();
+            corruptCount.fetch_add(1, memory_order_relaxed);
+         }
 
-      if (sbh.thisHash_ != regHead->getThisHash())
-      {
-         LOGWARN << "Corruption detected: block header hash " <<
-            sbh.thisHash_.copySwapEndian().toHexStr() << " does not match "
-            << regHead->getThisHash().copySwapEndian().toHexStr();
+         auto& entry = decoded[i];
+         entry.header_ = regHead;
+         entry.height_ = sbh.blockHeight_;
+         entry.dup_ = sbh.duplicateID_;
       }
-      callback(regHead, sbh.blockHeight_, sbh.duplicateID_);
+   };
 
-   } while(ldbIter->advanceAndRead(DB_PREFIX_HEADHASH));
+   ArmoryThreading::runOverRanges(
+      rawHeaders.size(), threadCount, decodeRange);
+
+   if (corruptCount.load() != 0)
+      LOGWARN << corruptCount.load() << " corrupt headers in db";
+
+   for (auto& entry : decoded)
+      callback(entry.header_, entry.height_, entry.dup_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData LMDBBlockDatabase::getChainSnapshot(void) const
+{
+   auto&& tx = beginTransaction(HEADERS, LMDB::ReadOnly);
+
+   BinaryWriter bw(1);
+   bw.put_uint8_t((uint8_t)DB_PREFIX_CHAINSNAPSHOT);
+   return getValueNoCopy(HEADERS, bw.getDataRef());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LMDBBlockDatabase::putChainSnapshot(BinaryDataRef snapshot)
+{
+   auto&& tx = beginTransaction(HEADERS, LMDB::ReadWrite);
+
+   BinaryWriter bw(1);
+   bw.put_uint8_t((uint8_t)DB_PREFIX_CHAINSNAPSHOT);
+   putValue(HEADERS, bw.getDataRef(), snapshot);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1718,27 +1847,57 @@ Tx LMDBBlockDatabase::getFullTxCopy(
    if (txIndex >= bhPtr->getNumTx())
       throw range_error("txid > numTx");
 
+   //slice the tx out of the cached block map, siblings aren't parsed
+   auto fileMapPtr = getBlockFileMap(bhPtr);
+   auto blockPtr = fileMapPtr->getPtr() + bhPtr->getOffset();
+
+   auto txOffsets = BlockDataCache::instance().getTxOffsets(
+      bhPtr->getThisHash(), blockPtr, bhPtr->getBlockSize());
+   if (txIndex >= txOffsets->size())
+      throw range_error("txid > numTx");
+
+   auto& txOffset = (*txOffsets)[txIndex];
+   BinaryRefReader brr(blockPtr + txOffset.first, txOffset.second);
+
+   return Tx(brr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+shared_ptr<BlockDataFileMap> LMDBBlockDatabase::getBlockFileMap(
+   shared_ptr<BlockHeader> bhPtr) const
+{
    if (blkFolder_.size() == 0)
       throw LmdbWrapperException("invalid blkFolder");
 
-   //open block file
-   BlockDataLoader bdl(blkFolder_);
-
-   auto fileMapPtr = bdl.get(bhPtr->getBlockFileNum());
-   auto dataPtr = fileMapPtr->getPtr();
+   auto& cache = BlockDataCache::instance();
+   auto&& filename = BtcUtils::getBlkFilename(
+      blkFolder_, bhPtr->getBlockFileNum());
 
-   auto getID = [bhPtr]
-      (const BinaryData&)->uint32_t {return bhPtr->getThisID(); };
+   auto isValid = [bhPtr](shared_ptr<BlockDataFileMap> fileMapPtr)->bool
+   {
+      auto dataPtr = fileMapPtr->getPtr();
+      if (dataPtr == nullptr ||
+         bhPtr->getOffset() + bhPtr->getBlockSize() > fileMapPtr->size())
+         return false;
 
-   BlockData block;
-   block.deserialize(dataPtr + bhPtr->getOffset(),
-      bhPtr->getBlockSize(), bhPtr, getID, false, false);
+      //make sure the map still holds this block
+      auto& rawHeader = bhPtr->serialize();
+      return rawHeader.getSize() == 0 ||
+         memcmp(dataPtr + bhPtr->getOffset(), 
+            rawHeader.getPtr(), rawHeader.getSize()) == 0;
+   };
 
-   auto bctx = block.getTxns()[txIndex];
+   auto fileMapPtr = cache.getFileMap(filename);
+   if (isValid(fileMapPtr))
+      return fileMapPtr;
 
-   BinaryRefReader brr(bctx->data_, bctx->size_);
+   //stale map, remap once
+   cache.evictFileMap(filename);
+   fileMapPtr = cache.getFileMap(filename);
+   if (!isValid(fileMapPtr))
+      throw LmdbWrapperException("block data missing from blk file");
 
-   return Tx(brr);
+   return fileMapPtr;
 }
 
 
@@ -1945,13 +2104,7 @@ bool LMDBBlockDatabase::getStoredHeader(
 {
    try
    {
-      if (blkFolder_.size() == 0)
-         throw LmdbWrapperException("invalid blkFolder");
-
-      //open block file
-      BlockDataLoader bdl(blkFolder_);
-
-      auto fileMapPtr = bdl.get(bh->getBlockFileNum());
+      auto fileMapPtr = getBlockFileMap(bh);
       auto dataPtr = fileMapPtr->getPtr();
       BinaryRefReader brr(dataPtr + bh->getOffset(), bh->getBlockSize());
 
@@ -1971,17 +2124,11 @@ bool LMDBBlockDatabase::getStoredHeader(
 ////////////////////////////////////////////////////////////////////////////////
 BinaryData LMDBBlockDatabase::getRawBlock(uint32_t height, uint8_t dupId) const
 {
-   if (blkFolder_.size() == 0)
-      throw LmdbWrapperException("invalid blkFolder");
-
    auto bh = blockchainPtr_->getHeaderByHeight(height, dupId);
    if (bh->getDuplicateID() != dupId)
       throw LmdbWrapperException("invalid dupId");
 
-   //open block file
-   BlockDataLoader bdl(blkFolder_);
-
-   auto fileMapPtr = bdl.get(bh->getBlockFileNum());
+   auto fileMapPtr = getBlockFileMap(bh);
    auto dataPtr = fileMapPtr->getPtr();
    return BinaryData(dataPtr + bh->getOffset(), bh->getBlockSize());
 }
@@ -2110,25 +2257,59 @@ bool LMDBBlockDatabase::getStoredTx_byHash(const BinaryData& txHash,
    if (dbKey.getSize() < 6)
       return false;
 
-   if (getDbType() == ARMORY_DB_SUPER)
-   {
-      auto hgtx = dbKey.getSliceRef(0, 4);
-      if (DBUtils::hgtxToDupID(hgtx) == 0x7F)
-      {
-         auto block_id = DBUtils::hgtxToHeight(hgtx);
-         auto header = blockchainPtr_->getHeaderById(block_id);
+   return getStoredTx_byDBKey(*stx, getTxKeyForHint(dbKey));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BinaryData LMDBBlockDatabase::getTxKeyForHint(const BinaryData& dbKey) const
+{
+   if (getDbType() != ARMORY_DB_SUPER)
+      return dbKey;
+
+   auto hgtx = dbKey.getSliceRef(0, 4);
+   if (DBUtils::hgtxToDupID(hgtx) != 0x7F)
+      return dbKey;
+
+   auto block_id = DBUtils::hgtxToHeight(hgtx);
+   auto header = blockchainPtr_->getHeaderById(block_id);
          
-         BinaryWriter bw;
-         bw.put_BinaryData(DBUtils::heightAndDupToHgtx(
-            header->getBlockHeight(), header->getDuplicateID()));
-         bw.put_BinaryDataRef(dbKey.getSliceRef(
-            4, dbKey.getSize() - 4));
+   BinaryWriter bw;
+   bw.put_BinaryData(DBUtils::heightAndDupToHgtx(
+      header->getBlockHeight(), header->getDuplicateID()));
+   bw.put_BinaryDataRef(dbKey.getSliceRef(
+      4, dbKey.getSize() - 4));
 
-         dbKey = bw.getData();
-      }
+   return bw.getData();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+vector<StoredTx> LMDBBlockDatabase::getStoredTxBatch(
+   const vector<BinaryDataRef>& txHashes) const
+{
+   vector<StoredTx> result(txHashes.size());
+   auto&& dbKeys = getDBKeysForHashes(txHashes);
+
+   //height|dup|txid keys sort txs from the same block next to each other
+   vector<pair<BinaryData, size_t>> txKeys;
+   txKeys.reserve(dbKeys.size());
+   for (size_t i = 0; i < dbKeys.size(); i++)
+   {
+      if (dbKeys[i].getSize() < 6)
+         continue;
+
+      txKeys.emplace_back(getTxKeyForHint(dbKeys[i]), i);
+   }
+
+   sort(txKeys.begin(), txKeys.end());
+
+   for (auto& keyPair : txKeys)
+   {
+      //don't hand back partially deserialized txs
+      if (!getStoredTx_byDBKey(result[keyPair.second], keyPair.first))
+         result[keyPair.second] = StoredTx();
    }
 
-   return getStoredTx_byDBKey(*stx, dbKey);
+   return result;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2373,6 +2554,34 @@ bool LMDBBlockDatabase::getStoredTxOut(
    return false;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+vector<StoredTxOut> LMDBBlockDatabase::getStoredTxOutBatch(
+   const vector<BinaryData>& dbKeys) const
+{
+   vector<StoredTxOut> result(dbKeys.size());
+
+   vector<size_t> order(dbKeys.size());
+   iota(order.begin(), order.end(), 0);
+   sort(order.begin(), order.end(), [&dbKeys](size_t a, size_t b)->bool
+   {
+      return dbKeys[a] < dbKeys[b];
+   });
+
+   auto&& stxoTx = beginTransaction(STXO, LMDB::ReadOnly);
+
+   unique_ptr<DbTransaction> spentnessTx;
+   if (getDbType() == ARMORY_DB_SUPER)
+      spentnessTx = beginTransaction(SPENTNESS, LMDB::ReadOnly);
+
+   for (auto& id : order)
+   {
+      if (!getStoredTxOut(result[id], dbKeys[id]))
+         result[id] = StoredTxOut();
+   }
+
+   return result;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool LMDBBlockDatabase::getStoredTxOut(      
                               StoredTxOut & stxo,
@@ -2862,6 +3071,47 @@ void LMDBBlockDatabase::resetSSHdb_Super()
    openDatabases(DatabaseContainer::baseDir_);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+BlockFilter LMDBBlockDatabase::getBlockFilter(uint32_t blockId) const
+{
+   auto&& key = DBUtils::getBlockFilterKey(blockId);
+   auto&& tx = beginTransaction(BLOCKFILTERS, LMDB::ReadOnly);
+
+   auto val = getValueNoCopy(BLOCKFILTERS, key);
+   if (val.getSize() == 0)
+      return BlockFilter();
+
+   try
+   {
+      return BlockFilter(val);
+   }
+   catch (exception&)
+   {
+      LOGWARN << "invalid block filter for block id " << blockId;
+   }
+
+   return BlockFilter();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LMDBBlockDatabase::putBlockFilters(
+   const map<uint32_t, BlockFilter>& filterMap)
+{
+   if (filterMap.size() == 0)
+      return;
+
+   auto&& tx = beginTransaction(BLOCKFILTERS, LMDB::ReadWrite);
+   for (auto& filterPair : filterMap)
+   {
+      if (!filterPair.second.isValid())
+         continue;
+
+      auto&& key = DBUtils::getBlockFilterKey(filterPair.first);
+      putValue(BLOCKFILTERS, 
+         key.getRef(), filterPair.second.serialize().getRef());
+   }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 void LMDBBlockDatabase::putMissingHashes(
    const set<BinaryData>& hashSet, uint32_t id)
@@ -3026,6 +3276,9 @@ string DatabaseContainer::getDbName(DB_SELECT db)
    case SPENTNESS:
       return "spentness";
 
+   case BLOCKFILTERS:
+      return "blockfilters";
+
    default:
       throw LmdbWrapperException("unknown db");
    }
@@ -3163,6 +3416,12 @@ StoredDBInfo DatabaseContainer_Single::open()
       sdbi.metaHash_ = BtcUtils::EmptyHash_;
       sdbi.topBlkHgt_ = 0;
       sdbi.armoryType_ = BlockDataManagerConfig::getDbType();
+
+      //fresh lite SUBSSH dbs start out with versioned values, supernode
+      //SUBSSH has its own format
+      if (dbSelect_ == SUBSSH && sdbi.armoryType_ != ARMORY_DB_SUPER)
+         sdbi.flags_ |= SDBI_FLAG_SUBSSH_VERSIONED;
+
       putStoredDBInfo(sdbi, 0);
    }
 
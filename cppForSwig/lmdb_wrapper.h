@@ -33,6 +33,9 @@
 
 #define SHARD_FILTER_DBKEY          0xAC28337D
 
+#define TXFILTER_POOL_MAGIC         0xFFFFFFFF
+#define TXFILTER_POOL_VERSION       2
+
 #ifndef UNIT_TESTS
 #define SHARD_FILTER_SCRADDR_STEP   1500
 #define SHARD_FILTER_SPENTNESS_STEP 5000
@@ -111,6 +114,7 @@ struct DbTxException : public std::runtime_error
 #define BULK_SCAN false
 
 class BlockHeader;
+class BlockDataFileMap;
 class Tx;
 class TxIn;
 class TxOut;
@@ -304,14 +308,300 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 template<typename T> class TxFilterPool
 {
-   //16 bytes bucket filter for transactions hash lookup
-   //each bucket represents on blk file
+   /***
+   Per blk file filter for transactions hash lookup. 
+   
+   v1 pools are a flat list of per block filters:
+      count (4) | {size (4) | blockKey (4) | txcount (4) | T * txcount} * count
+
+   v2 pools are a hashed probe index over every hash prefix in the file:
+      magic (4) | version (4) | block count (4) | entry count (4) | 
+      slot count (4) | {blockKey (4) | first ordinal (4)} * block count | 
+      {T prefix | ordinal (4)} * slot count
+
+   Ordinals number the transactions of the file in block order, the block 
+   section maps them back to (blockKey, txIndex). The slot table is open 
+   addressed with linear probing, empty slots carry UINT32_MAX as ordinal. 
+   Hash prefixes are uniformly distributed so they are used as is to pick 
+   the first slot.
+
+   Only v2 is written, v1 is still read so that existing dbs can be migrated.
+   ***/
 
 private:
    std::set<TxFilter<T>> pool_;
    const uint8_t* poolPtr_ = nullptr;
    size_t len_ = SIZE_MAX;
 
+private:
+   static const size_t headerSize_ = 20;
+   static const size_t slotSize_ = sizeof(T) + 4;
+
+   static uint32_t getPoolVersion(const uint8_t* ptr, size_t len)
+   {
+      if (ptr == nullptr || len < headerSize_ || 
+         *(uint32_t*)ptr != TXFILTER_POOL_MAGIC)
+         return 1;
+
+      return *(uint32_t*)(ptr + 4);
+   }
+
+   static size_t getSlotCount(size_t entryCount)
+   {
+      //keep load factor under 3/4, there is always at least 1 empty slot
+      size_t slotCount = 1;
+      while (slotCount * 3 <= entryCount * 4)
+         slotCount <<= 1;
+
+      return slotCount;
+   }
+
+   static size_t checkIndex(const uint8_t* ptr, size_t len)
+   {
+      if (ptr == nullptr || len < headerSize_)
+         throw TxFilterException("invalid pool index");
+
+      if (getPoolVersion(ptr, len) != TXFILTER_POOL_VERSION)
+         throw TxFilterException("unsupported pool version");
+
+      size_t blockCount = *(uint32_t*)(ptr + 8);
+      size_t entryCount = *(uint32_t*)(ptr + 12);
+      size_t slotCount = *(uint32_t*)(ptr + 16);
+
+      if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0 ||
+         slotCount <= entryCount)
+         throw TxFilterException("invalid pool index slot count");
+
+      if (len != headerSize_ + blockCount * 8 + slotCount * slotSize_)
+         throw TxFilterException("invalid pool index size");
+
+      return blockCount;
+   }
+
+   static std::pair<uint32_t, uint32_t> resolveOrdinal(
+      const uint8_t* blockPtr, size_t blockCount, uint32_t ordinal)
+   {
+      //find last block with first ordinal <= ordinal
+      size_t low = 0, high = blockCount;
+      while (high - low > 1)
+      {
+         auto mid = (low + high) / 2;
+         auto first = *(uint32_t*)(blockPtr + mid * 8 + 4);
+         if (first <= ordinal)
+            low = mid;
+         else
+            high = mid;
+      }
+
+      if (blockCount == 0)
+         throw TxFilterException("ordinal out of range");
+
+      auto entryPtr = blockPtr + low * 8;
+      auto first = *(uint32_t*)(entryPtr + 4);
+      if (first > ordinal)
+         throw TxFilterException("ordinal out of range");
+
+      return std::make_pair(*(uint32_t*)entryPtr, ordinal - first);
+   }
+
+   template<typename U>
+   static void probeSlots(const uint8_t* slotPtr, size_t slotCount,
+      const U& key, std::vector<uint32_t>& ordinals)
+   {
+      ordinals.clear();
+      auto mask = slotCount - 1;
+      auto pos = (size_t)key & mask;
+      for (size_t i = 0; i < slotCount; i++)
+      {
+         auto slot = slotPtr + pos * slotSize_;
+         auto ordinal = *(uint32_t*)(slot + sizeof(U));
+         if (ordinal == UINT32_MAX)
+            break;
+
+         if (*(U*)slot == key)
+            ordinals.push_back(ordinal);
+
+         pos = (pos + 1) & mask;
+      }
+   }
+
+   static void probeSlots(const uint8_t* slotPtr, size_t slotCount,
+      uint32_t key, std::vector<uint32_t>& ordinals)
+   {
+      TxFilterBatch::probe(slotPtr, slotCount, key, ordinals);
+   }
+
+   void probeIndex(const T& key, 
+      std::map<uint32_t, std::set<uint32_t>>& returnMap,
+      std::vector<uint32_t>& ordinals) const
+   {
+      //expects a checked index
+      size_t blockCount = *(uint32_t*)(poolPtr_ + 8);
+      size_t entryCount = *(uint32_t*)(poolPtr_ + 12);
+      size_t slotCount = *(uint32_t*)(poolPtr_ + 16);
+
+      auto blockPtr = poolPtr_ + headerSize_;
+      auto slotPtr = blockPtr + blockCount * 8;
+
+      probeSlots(slotPtr, slotCount, key, ordinals);
+      for (auto& ordinal : ordinals)
+      {
+         if (ordinal >= entryCount)
+            throw TxFilterException("invalid pool index ordinal");
+
+         auto&& blockTx = resolveOrdinal(blockPtr, blockCount, ordinal);
+         returnMap[blockTx.first].insert(blockTx.second);
+      }
+   }
+
+   std::map<uint32_t, std::set<uint32_t>> compareIndex(const T& key) const
+   {
+      checkIndex(poolPtr_, len_);
+
+      std::map<uint32_t, std::set<uint32_t>> returnMap;
+      std::vector<uint32_t> ordinals;
+      probeIndex(key, returnMap, ordinals);
+      return returnMap;
+   }
+
+   void compareIndexBatch(const std::vector<T>& keys,
+      std::vector<std::map<uint32_t, std::set<uint32_t>>>& results) const
+   {
+      auto blockCount = checkIndex(poolPtr_, len_);
+      size_t slotCount = *(uint32_t*)(poolPtr_ + 16);
+      auto slotPtr = poolPtr_ + headerSize_ + blockCount * 8;
+      auto mask = slotCount - 1;
+
+      //slots are random access, prefetch a few keys ahead to overlap the 
+      //cache misses
+      const size_t prefetchDistance = 8;
+      std::vector<uint32_t> ordinals;
+      for (size_t i = 0; i < keys.size() && i < prefetchDistance; i++)
+         TxFilterBatch::prefetch(slotPtr + ((size_t)keys[i] & mask) * slotSize_);
+
+      for (size_t i = 0; i < keys.size(); i++)
+      {
+         if (i + prefetchDistance < keys.size())
+         {
+            auto pos = (size_t)keys[i + prefetchDistance] & mask;
+            TxFilterBatch::prefetch(slotPtr + pos * slotSize_);
+         }
+
+         probeIndex(keys[i], results[i], ordinals);
+      }
+   }
+
+   template<typename U>
+   static const std::vector<U>& makeBatch(const std::vector<U>& keys)
+   {
+      return keys;
+   }
+
+   static TxFilterBatch makeBatch(const std::vector<uint32_t>& keys)
+   {
+      return TxFilterBatch(keys);
+   }
+
+   static void mergeBatchHits(uint32_t blockKey,
+      const std::vector<std::pair<size_t, uint32_t>>& hits,
+      std::vector<std::map<uint32_t, std::set<uint32_t>>>& results)
+   {
+      for (auto& hit : hits)
+         results[hit.first][blockKey].insert(hit.second);
+   }
+
+   void deserializeIndex(const uint8_t* ptr, size_t len)
+   {
+      auto blockCount = checkIndex(ptr, len);
+      uint32_t entryCount = *(uint32_t*)(ptr + 12);
+      size_t slotCount = *(uint32_t*)(ptr + 16);
+
+      auto blockPtr = ptr + headerSize_;
+      auto slotPtr = blockPtr + blockCount * 8;
+
+      //recreate the per block filters
+      std::vector<TxFilter<T>> filters;
+      filters.reserve(blockCount);
+      for (size_t i = 0; i < blockCount; i++)
+      {
+         auto blockKey = *(uint32_t*)(blockPtr + i * 8);
+         auto first = *(uint32_t*)(blockPtr + i * 8 + 4);
+         auto next = entryCount;
+         if (i + 1 < blockCount)
+            next = *(uint32_t*)(blockPtr + (i + 1) * 8 + 4);
+
+         if (next < first)
+            throw TxFilterException("deser error");
+
+         TxFilter<T> filter(blockKey, next - first);
+         filter.filterVector_.resize(next - first);
+         filters.push_back(std::move(filter));
+      }
+
+      size_t found = 0;
+      for (size_t i = 0; i < slotCount; i++)
+      {
+         auto slot = slotPtr + i * slotSize_;
+         auto ordinal = *(uint32_t*)(slot + sizeof(T));
+         if (ordinal == UINT32_MAX)
+            continue;
+
+         if (ordinal >= entryCount)
+            throw TxFilterException("deser error");
+
+         //blocks are stored in ascending ordinal order
+         size_t low = 0, high = blockCount;
+         while (high - low > 1)
+         {
+            auto mid = (low + high) / 2;
+            if (*(uint32_t*)(blockPtr + mid * 8 + 4) <= ordinal)
+               low = mid;
+            else
+               high = mid;
+         }
+
+         auto first = *(uint32_t*)(blockPtr + low * 8 + 4);
+         filters[low].filterVector_[ordinal - first] = *(T*)slot;
+         ++found;
+      }
+
+      if (found != entryCount)
+         throw TxFilterException("deser error");
+
+      for (auto& filter : filters)
+         pool_.insert(std::move(filter));
+      len_ = pool_.size();
+   }
+
+   void deserializeLegacy(uint8_t* ptr, size_t len)
+   {
+      //sanity check
+      if (ptr == nullptr || len < 4)
+         throw TxFilterException("invalid pointer");
+
+      len_ = *(uint32_t*)ptr;
+
+      if (len_ == 0)
+         throw TxFilterException("empty pool ptr");
+
+      size_t offset = 4;
+
+      for (unsigned i = 0; i < len_; i++)
+      {
+         if (offset >= len)
+            throw TxFilterException("deser error");
+
+         auto filtersize = (uint32_t*)(ptr + offset);
+
+         TxFilter<TxFilterType> filter;
+         filter.deserialize(ptr + offset);
+
+         offset += *filtersize;
+
+         pool_.insert(std::move(filter));
+      }
+   }
+
 public:
    TxFilterPool(void) 
    {}
@@ -321,7 +611,7 @@ public:
    {}
 
    TxFilterPool(const TxFilterPool<T>& filter) :
-      pool_(filter.pool_), len_(filter.len_)
+      pool_(filter.pool_), poolPtr_(filter.poolPtr_), len_(filter.len_)
    {}
 
    TxFilterPool(const uint8_t* ptr, size_t len) :
@@ -336,6 +626,14 @@ public:
 
    bool isValid(void) const { return len_ != SIZE_MAX; }
 
+   uint32_t getVersion(void) const
+   {
+      if (poolPtr_ == nullptr)
+         return TXFILTER_POOL_VERSION;
+
+      return getPoolVersion(poolPtr_, len_);
+   }
+
    std::map<uint32_t, std::set<uint32_t>> compare(const BinaryData& hash) const
    {
       if (hash.getSize() != 32)
@@ -363,6 +661,9 @@ public:
       }
       else if (poolPtr_ != nullptr) //running against a pointer
       {
+         if (getVersion() == TXFILTER_POOL_VERSION)
+            return compareIndex(*(T*)hash.getPtr());
+
          //get count
          auto size = (uint32_t*)poolPtr_;
          uint32_t* filterSize;
@@ -394,12 +695,87 @@ public:
       return returnMap;
    }
 
-   std::vector<TxFilter<T>> getFilterPoolPtr(void)
+   std::vector<std::map<uint32_t, std::set<uint32_t>>> compareBatch(
+      const std::vector<BinaryData>& hashes) const
+   {
+      /***
+      Same as compare, for many hashes in one pass over the pool. Results 
+      are returned in the order of the hashes vector.
+      ***/
+
+      if (!isValid())
+         throw TxFilterException("invalid pool");
+
+      std::vector<T> keys;
+      keys.reserve(hashes.size());
+      for (auto& hash : hashes)
+      {
+         if (hash.getSize() != 32)
+            throw TxFilterException("hash is 32 bytes long");
+
+         keys.push_back(*(T*)hash.getPtr());
+      }
+
+      std::vector<std::map<uint32_t, std::set<uint32_t>>> results;
+      results.resize(hashes.size());
+
+      if (pool_.size())
+      {
+         auto&& batch = makeBatch(keys);
+         for (auto& filter : pool_)
+            mergeBatchHits(filter.getBlockKey(), filter.compareBatch(batch), results);
+      }
+      else if (poolPtr_ != nullptr) //running against a pointer
+      {
+         if (getVersion() == TXFILTER_POOL_VERSION)
+         {
+            compareIndexBatch(keys, results);
+            return results;
+         }
+
+         //get count
+         auto size = (uint32_t*)poolPtr_;
+         uint32_t* filterSize;
+         size_t pos = 4;
+         auto&& batch = makeBatch(keys);
+
+         for (uint32_t i = 0; i < *size; i++)
+         {
+            if (pos >= len_)
+               throw TxFilterException("overflow while reading pool ptr");
+
+            //iterate through entries
+            filterSize = (uint32_t*)(poolPtr_ + pos);
+
+            TxFilter<T> filterPtr(poolPtr_ + pos);
+            mergeBatchHits(
+               filterPtr.getBlockKey(), filterPtr.compareBatch(batch), results);
+
+            pos += *filterSize;
+         }
+      }
+      else
+         throw TxFilterException("invalid pool");
+
+      return results;
+   }
+
+   std::vector<uint32_t> getBlockKeys(void) const
    {
       if (poolPtr_ == nullptr)
          throw TxFilterException("missing pool ptr");
 
-      std::vector<TxFilter<T>> filters;
+      std::vector<uint32_t> blockKeys;
+
+      if (getVersion() == TXFILTER_POOL_VERSION)
+      {
+         auto blockCount = checkIndex(poolPtr_, len_);
+         auto blockPtr = poolPtr_ + headerSize_;
+         for (size_t i = 0; i < blockCount; i++)
+            blockKeys.push_back(*(uint32_t*)(blockPtr + i * 8));
+
+         return blockKeys;
+      }
 
       //get count
       auto size = (uint32_t*)poolPtr_;
@@ -415,51 +791,67 @@ public:
          filterSize = (uint32_t*)(poolPtr_ + pos);
 
          TxFilter<T> filterPtr(poolPtr_ + pos);
-         filters.push_back(filterPtr);
+         blockKeys.push_back(filterPtr.getBlockKey());
 
          pos += *filterSize;
       }
 
-      return filters;
+      return blockKeys;
    }
 
    void serialize(BinaryWriter& bw) const
    {
-      bw.put_uint32_t(len_); //item count
-
+      //count all hash prefixes in the file
+      size_t entryCount = 0;
       for (auto& filter : pool_)
-      {
-         filter.serialize(bw);
-      }
-   }
+         entryCount += filter.filterVector_.size();
 
-   void deserialize(uint8_t* ptr, size_t len)
-   {
-      //sanity check
-      if (ptr == nullptr || len < 4)
-         throw TxFilterException("invalid pointer");
+      if (entryCount >= UINT32_MAX)
+         throw TxFilterException("too many entries for pool index");
 
-      len_ = *(uint32_t*)ptr;
+      auto slotCount = getSlotCount(entryCount);
 
-      if (len_ == 0)
-         throw TxFilterException("empty pool ptr");
+      bw.put_uint32_t(TXFILTER_POOL_MAGIC);
+      bw.put_uint32_t(TXFILTER_POOL_VERSION);
+      bw.put_uint32_t(pool_.size());
+      bw.put_uint32_t(entryCount);
+      bw.put_uint32_t(slotCount);
 
-      size_t offset = 4;
+      //fill slots with UINT32_MAX to flag them as empty
+      BinaryData slots(slotCount * slotSize_);
+      memset(slots.getPtr(), 0xFF, slots.getSize());
+      auto slotPtr = slots.getPtr();
+      auto mask = slotCount - 1;
 
-      for (unsigned i = 0; i < len_; i++)
+      uint32_t ordinal = 0;
+      for (auto& filter : pool_)
       {
-         if (offset >= len)
-            throw TxFilterException("deser error");
-
-         auto filtersize = (uint32_t*)(ptr + offset);
+         bw.put_uint32_t(filter.getBlockKey());
+         bw.put_uint32_t(ordinal);
 
-         TxFilter<TxFilterType> filter;
-         filter.deserialize(ptr + offset);
+         for (auto& key : filter.filterVector_)
+         {
+            auto pos = (size_t)key & mask;
+            while (*(uint32_t*)(slotPtr + pos * slotSize_ + sizeof(T)) != 
+               UINT32_MAX)
+               pos = (pos + 1) & mask;
+
+            auto slot = slotPtr + pos * slotSize_;
+            memcpy(slot, &key, sizeof(T));
+            memcpy(slot + sizeof(T), &ordinal, 4);
+            ++ordinal;
+         }
+      }
 
-         offset += *filtersize;
+      bw.put_BinaryData(slots);
+   }
 
-         pool_.insert(std::move(filter));
-      }
+   void deserialize(uint8_t* ptr, size_t len)
+   {
+      if (getPoolVersion(ptr, len) == TXFILTER_POOL_VERSION)
+         deserializeIndex(ptr, len);
+      else
+         deserializeLegacy(ptr, len);
    }
 
    const TxFilter<T>& getFilterById(uint32_t id)
@@ -703,6 +1095,13 @@ public:
 
    unsigned getHeightForTxHash(const BinaryDataRef& hash) const;
 
+   // Batched versions of the 2 above. Results are in request order, hashes
+   // are resolved in key order within a single read tx.
+   std::vector<BinaryData> getDBKeysForHashes(
+      const std::vector<BinaryDataRef>&) const;
+   std::vector<unsigned> getHeightsForTxHashes(
+      const std::vector<BinaryDataRef>&) const;
+
    /////////////////////////////////////////////////////////////////////////////
    // Put value based on BinaryDataRefs key and value
    void putValue(DB_SELECT db, BinaryDataRef key, BinaryDataRef value);
@@ -716,9 +1115,16 @@ public:
 
    /////////////////////////////////////////////////////////////////////////////
    void readAllHeaders(
-      const std::function<void(std::shared_ptr<BlockHeader>, uint32_t, uint8_t)> &callback
+      const std::function<void(std::shared_ptr<BlockHeader>, uint32_t, uint8_t)> &callback,
+      unsigned threadCount = 1
       );
 
+   //serialized main chain, see Blockchain::getChainSnapshot. There is only
+   //ever one, stored under a fixed DB_PREFIX_CHAINSNAPSHOT key and
+   //overwritten on each init
+   BinaryData getChainSnapshot(void) const;
+   void putChainSnapshot(BinaryDataRef);
+
    std::map<uint32_t, uint32_t> getSSHSummary(BinaryDataRef scrAddrStr);
 
    uint32_t getStxoCountForTx(const BinaryData & dbKey6) const;
@@ -774,6 +1180,12 @@ public:
    bool getStoredTx_byHash(const BinaryData& txHash,
       StoredTx* stx = nullptr) const;
 
+   // Results are in request order, txs missing from the chain are left
+   // uninitialized. Fetches are sorted by key so txs from the same block 
+   // are sliced back to back.
+   std::vector<StoredTx> getStoredTxBatch(
+      const std::vector<BinaryDataRef>& txHashes) const;
+
    bool getStoredTx(StoredTx & st,
       uint32_t blkHgt,
       uint16_t txIndex,
@@ -808,6 +1220,11 @@ public:
    bool getStoredTxOut(
       StoredTxOut & stxo, const BinaryData& txHash, uint16_t txoutid) const;
 
+   // 8 byte txout keys, results are in request order. Missing outputs are 
+   // left uninitialized.
+   std::vector<StoredTxOut> getStoredTxOutBatch(
+      const std::vector<BinaryData>& dbKeys) const;
+
    void getSpentness(StoredTxOut& stxo);
 
    void getUTXOflags(std::map<BinaryData, StoredSubHistory>&) const;
@@ -958,6 +1375,11 @@ public:
       putValue(TXFILTERS, key, data);
    }
 
+   //block filters are keyed by block id in their own db, an invalid filter
+   //means none
+   BlockFilter getBlockFilter(uint32_t blockId) const;
+   void putBlockFilters(const std::map<uint32_t, BlockFilter>&);
+
    void putMissingHashes(const std::set<BinaryData>&, uint32_t);
    std::set<BinaryData> getMissingHashes(uint32_t) const;
 
@@ -974,6 +1396,13 @@ public:
    std::map<DB_SELECT, std::shared_ptr<DatabaseContainer>> dbMap_;
    const static std::map<std::string, size_t> mapSizes_;
 
+private:
+   std::shared_ptr<BlockDataFileMap> getBlockFileMap(
+      std::shared_ptr<BlockHeader>) const;
+
+   //supernode hints carry the block id, swap it for height & dup
+   BinaryData getTxKeyForHint(const BinaryData&) const;
+
 private:
    bool                 dbIsOpen_;
    uint32_t             ldbBlockSize_;
@@ -17,6 +17,7 @@ using namespace std;
 #include "BDM_mainthread.h"
 #include "BDM_Server.h"
 #include "TerminalPassphrasePrompt.h"
+#include "Transactions.h"
 
 int main(int argc, char* argv[])
 {
@@ -48,6 +49,8 @@ int main(int argc, char* argv[])
    LOGINFO << "Running on " << bdmConfig.threadCount_ << " threads";
    LOGINFO << "Ram usage level: " << bdmConfig.ramUsage_;
 
+   TransactionVerifier::setThreadCount(bdmConfig.sigCheckThreadCount_);
+
    //init state
    BlockDataManagerConfig::setServiceType(SERVICE_WEBSOCKET);
    BlockDataManagerThread bdmThread(bdmConfig);